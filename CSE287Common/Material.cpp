@@ -43,6 +43,9 @@ Material operator*(double scalar, const Material& rhs)
 	temp.specularColor = scalar * rhs.specularColor;
 	temp.emissiveColor = scalar * rhs.emissiveColor;
 	temp.shininess = scalar * rhs.shininess;
+	temp.reflectivity = scalar * rhs.reflectivity;
+	temp.transparency = scalar * rhs.transparency;
+	temp.indexOfRefraction = scalar * rhs.indexOfRefraction;
 
 	return temp;
 }
\ No newline at end of file
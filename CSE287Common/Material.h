@@ -27,6 +27,19 @@ public:
 	/** @brief	Shininess exponent for specular lighting calculations. */
 	double shininess = 128.0;
 
+	/** @brief	Fraction of the light arriving from the mirror direction that is reflected. 
+	 *			Zero for surfaces that do not reflect the rest of the scene. */
+	double reflectivity = 0.0;
+
+	/** @brief	Fraction of the light that interacts with the surface as a dielectric (glass,
+	 *			water) and is split between reflection and refraction by the Fresnel equations.
+	 *			Zero for opaque surfaces. */
+	double transparency = 0.0;
+
+	/** @brief	Index of refraction of the material inside the surface. The outside is assumed to
+	 *			be air with an index of 1. */
+	double indexOfRefraction = 1.5;
+
 	/**
 	 * @fn	Material( const color & diffuseColor = WHITE )
 	 *
@@ -48,6 +61,16 @@ public:
 
 	virtual color getEmisive(const dvec2& uv = dvec2(0.5, 0.5)) const;
 
+	/**
+	 * @fn	void setEmissive( const color & emissiveColor )
+	 *
+	 * @brief	Sets the emissive color. The surface gives off light equal to the emissive color
+	 * 			times the diffuse color.
+	 *
+	 * @param	emissiveColor	The emissive color. BLACK for surfaces that do not glow.
+	 */
+	void setEmissive( const color & emissiveColor ) { this->emissiveColor = emissiveColor; }
+
 	Material& operator+=(const Material& rhs)
 	{
 		this->ambientColor += rhs.ambientColor;
@@ -55,6 +78,9 @@ public:
 		this->specularColor += rhs.specularColor;
 		this->emissiveColor += rhs.emissiveColor;
 		this->shininess += rhs.shininess;
+		this->reflectivity += rhs.reflectivity;
+		this->transparency += rhs.transparency;
+		this->indexOfRefraction += rhs.indexOfRefraction;
 
 		return *this;
 	}
@@ -0,0 +1,64 @@
+#include "AccumulationBuffer.h"
+
+
+void AccumulationBuffer::setBufferSize(const int& width, const int& height)
+{
+	this->width = width;
+	this->height = height;
+
+	sums.reset(new std::atomic<float>[3 * width * height]);
+
+	clear();
+
+} // end setBufferSize
+
+
+void AccumulationBuffer::clear()
+{
+	for (int i = 0; i < 3 * width * height; i++) {
+		sums[i].store(0.0f, std::memory_order_relaxed);
+	}
+
+} // end clear
+
+
+void AccumulationBuffer::addSample(const int& x, const int& y, const color& rgb)
+{
+	if (x < 0 || y < 0 || x >= width || y >= height) {
+		return;
+	}
+
+	std::atomic<float>* pixel = &sums[3 * (y * width + x)];
+
+	for (int channel = 0; channel < 3; channel++) {
+
+		// Black channels are common and need no update
+		if (rgb[channel] != 0.0) {
+			atomicAdd(pixel[channel], (float)rgb[channel]);
+		}
+	}
+
+} // end addSample
+
+
+color AccumulationBuffer::getSum(const int& x, const int& y) const
+{
+	const std::atomic<float>* pixel = &sums[3 * (y * width + x)];
+
+	return color(pixel[0].load(std::memory_order_relaxed), pixel[1].load(std::memory_order_relaxed),
+				 pixel[2].load(std::memory_order_relaxed), 1.0);
+
+} // end getSum
+
+
+void AccumulationBuffer::resolve(FrameBuffer& frameBuffer, const double& scale) const
+{
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+
+			color sum = getSum(x, y);
+			frameBuffer.setPixel(x, y, color(scale * dvec3(sum), 1.0));
+		}
+	}
+
+} // end resolve
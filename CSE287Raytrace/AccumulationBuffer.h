@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "FrameBuffer.h"
+#include "ThreadPool.h"
+
+/**
+ * @class	AccumulationBuffer
+ *
+ * @brief	Floating point red, green, and blue sums for every pixel of a window, used to average
+ * 			many samples per pixel over several frames. Any thread may add to any pixel at any
+ * 			time without a lock, so samples that land on pixels other than the one being
+ * 			rendered (light paths splatted onto the image) can be added while other threads
+ * 			render those pixels.
+ */
+class AccumulationBuffer
+{
+public:
+
+	/**
+	 * @fn	void AccumulationBuffer::setBufferSize(const int & width, const int & height);
+	 *
+	 * @brief	Sizes the buffer to match a window and clears it.
+	 *
+	 * @param	width 	of the window in pixels.
+	 * @param	height	of the window in pixels.
+	 */
+	void setBufferSize(const int & width, const int & height);
+
+
+	/**
+	 * @fn	void AccumulationBuffer::clear();
+	 *
+	 * @brief	Sets the sum of every pixel to black.
+	 */
+	void clear();
+
+
+	/**
+	 * @fn	void AccumulationBuffer::addSample(const int & x, const int & y, const color & rgb);
+	 *
+	 * @brief	Adds to the sum of a pixel. May be called concurrently by any number of threads.
+	 * 			Positions outside of the window are ignored.
+	 *
+	 * @param	x  	column of the pixel.
+	 * @param	y  	row of the pixel.
+	 * @param	rgb	Color added. Alpha is ignored.
+	 */
+	void addSample(const int & x, const int & y, const color & rgb);
+
+
+	/**
+	 * @fn	color AccumulationBuffer::getSum(const int & x, const int & y) const;
+	 *
+	 * @brief	Returns the sum of a pixel with an alpha of one.
+	 *
+	 * @param	x	column of the pixel.
+	 * @param	y	row of the pixel.
+	 *
+	 * @returns	The sum.
+	 */
+	color getSum(const int & x, const int & y) const;
+
+
+	/**
+	 * @fn	void AccumulationBuffer::resolve(FrameBuffer & frameBuffer, const double & scale) const;
+	 *
+	 * @brief	Writes the scaled sum of every pixel to a frame buffer of the same size.
+	 *
+	 * @param [in,out]	frameBuffer	Buffer that is set.
+	 * @param 		  	scale	   	Factor applied to every sum, usually one over the number of
+	 * 								samples per pixel.
+	 */
+	void resolve(FrameBuffer & frameBuffer, const double & scale) const;
+
+
+	/** @returns	Width of the buffer in pixels. */
+	int getWidth() const { return width; }
+
+	/** @returns	Height of the buffer in pixels. */
+	int getHeight() const { return height; }
+
+protected:
+
+	/** @brief	Width of the buffer in pixels */
+	int width = 0;
+
+	/** @brief	Height of the buffer in pixels */
+	int height = 0;
+
+	/** @brief	Red, green, and blue sums of every pixel, row by row from the bottom */
+	std::unique_ptr<std::atomic<float>[]> sums;
+
+}; // end AccumulationBuffer class
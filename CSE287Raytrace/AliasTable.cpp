@@ -0,0 +1,92 @@
+#include "AliasTable.h"
+
+
+void AliasTable::build(const std::vector<double>& weights)
+{
+	probabilities.clear();
+	thresholds.clear();
+	aliases.clear();
+
+	totalWeight = 0.0;
+	for (double weight : weights) {
+		totalWeight += weight;
+	}
+
+	if (weights.empty() || totalWeight <= 0.0) {
+		return;
+	}
+
+	int count = (int)weights.size();
+
+	probabilities.resize(count);
+	thresholds.resize(count);
+	aliases.resize(count);
+
+	// Scale the probabilities so that the average slot holds exactly 1
+	std::vector<double> scaled(count);
+	std::vector<int> small, large;
+
+	for (int i = 0; i < count; i++) {
+
+		probabilities[i] = weights[i] / totalWeight;
+		scaled[i] = probabilities[i] * count;
+
+		if (scaled[i] < 1.0) {
+			small.push_back(i);
+		}
+		else {
+			large.push_back(i);
+		}
+	}
+
+	// Fill each under full slot with part of an over full item
+	while (!small.empty() && !large.empty()) {
+
+		int under = small.back();
+		small.pop_back();
+
+		int over = large.back();
+
+		thresholds[under] = scaled[under];
+		aliases[under] = over;
+
+		scaled[over] -= 1.0 - scaled[under];
+
+		if (scaled[over] < 1.0) {
+			large.pop_back();
+			small.push_back(over);
+		}
+	}
+
+	// Whatever is left is full to within round off
+	for (int i : large) {
+		thresholds[i] = 1.0;
+		aliases[i] = i;
+	}
+	for (int i : small) {
+		thresholds[i] = 1.0;
+		aliases[i] = i;
+	}
+
+} // end build
+
+
+int AliasTable::sample(const double& u, double& probability) const
+{
+	if (empty()) {
+		probability = 0.0;
+		return -1;
+	}
+
+	int count = (int)thresholds.size();
+
+	double scaled = u * count;
+	int slot = glm::min((int)scaled, count - 1);
+
+	int item = (scaled - slot) < thresholds[slot] ? slot : aliases[slot];
+
+	probability = probabilities[item];
+
+	return item;
+
+} // end sample
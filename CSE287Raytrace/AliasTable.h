@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Defines.h"
+
+/**
+ * @class	AliasTable
+ *
+ * @brief	Discrete distribution over a set of items with given weights that can be sampled in
+ * 			constant time (Walker's alias method as built by Vose). Each slot of the table holds
+ * 			an item, a second "alias" item, and the probability of keeping the first.
+ */
+class AliasTable
+{
+public:
+
+	/**
+	 * @fn	void AliasTable::build(const std::vector<double> & weights);
+	 *
+	 * @brief	Builds the table. Items are chosen in proportion to their weights. Items with zero
+	 * 			weight are never chosen.
+	 *
+	 * @param	weights	Nonnegative weight of each item.
+	 */
+	void build(const std::vector<double> & weights);
+
+
+	/**
+	 * @fn	int AliasTable::sample(const double & u, double & probability) const;
+	 *
+	 * @brief	Chooses an item.
+	 *
+	 * @param 		  	u		   	Uniform random number in [0, 1).
+	 * @param [out]	probability	Probability of choosing the item.
+	 *
+	 * @returns	Index of the chosen item. -1 if the table is empty.
+	 */
+	int sample(const double & u, double & probability) const;
+
+
+	/** @returns	Probability of choosing an item. */
+	double getProbability(const int & item) const { return probabilities[item]; }
+
+	/** @returns	True if there is nothing to choose. */
+	bool empty() const { return thresholds.empty(); }
+
+	/** @returns	Sum of the weights the table was built from. */
+	double getTotalWeight() const { return totalWeight; }
+
+protected:
+
+	/** @brief	Normalized probability of each item */
+	std::vector<double> probabilities;
+
+	/** @brief	Probability of keeping the item of each slot rather than its alias */
+	std::vector<double> thresholds;
+
+	/** @brief	Item chosen in place of the item of each slot */
+	std::vector<int> aliases;
+
+	/** @brief	Sum of the weights */
+	double totalWeight = 0.0;
+
+}; // end AliasTable class
@@ -0,0 +1,154 @@
+#include "AnalyticVisibility.h"
+
+
+double AnalyticVisibility::lightVisibility(const BoundingVolumeHierarchy& accelerator, const dvec3& point,
+										   const dvec3& lightPosition, const double& lightRadius, const double& time)
+{
+	dvec3 toLight = lightPosition - point;
+	double lightDistance = glm::length(toLight);
+
+	// Points inside the light see all of it
+	if (lightDistance <= lightRadius) {
+		return 1.0;
+	}
+
+	dvec3 axis = toLight / lightDistance;
+	double lightAngle = asin(lightRadius / lightDistance);
+
+	// Occluders must overlap the cone from the point to the light
+	ShadowFrustum region;
+	region.apex = point;
+	region.axis = axis;
+	region.cosHalfAngle = cos(lightAngle);
+	region.sinHalfAngle = lightRadius / lightDistance;
+	region.maxDistance = lightDistance;
+
+	std::vector<ImplicitSurface*> occluders;
+	accelerator.gatherSurfaces(region, SHADOW_RAY, time, occluders);
+
+	double visibility = 1.0;
+
+	for (ImplicitSurface* occluder : occluders) {
+
+		Sphere* sphere = dynamic_cast<Sphere*>(occluder);
+
+		if (sphere != nullptr) {
+
+			dvec3 toCenter = sphere->getCenter(time) - point;
+			double distance = glm::length(toCenter);
+
+			// Skip the sphere the point is on and spheres beyond the light
+			if (distance <= sphere->radius + EPSILON || distance - sphere->radius >= lightDistance) {
+				continue;
+			}
+
+			double occluderAngle = asin(sphere->radius / distance);
+			double separation = acos(glm::clamp(glm::dot(toCenter / distance, axis), -1.0, 1.0));
+
+			visibility *= 1.0 - coneOverlap(lightAngle, occluderAngle, separation);
+		}
+		else {
+
+			// Surfaces other than spheres either block the center of the light or do not
+			Ray feeler(point + EPSILON * axis, axis, SHADOW_RAY);
+			feeler.time = time;
+
+			if (occluder->findIntersect(feeler).t < lightDistance - EPSILON) {
+				return 0.0;
+			}
+		}
+
+		if (visibility <= 0.0) {
+			return 0.0;
+		}
+	}
+
+	return visibility;
+
+} // end lightVisibility
+
+
+double AnalyticVisibility::ambientOcclusion(const BoundingVolumeHierarchy& accelerator, const dvec3& point,
+											const dvec3& normal, const double& maxDistance, const double& time)
+{
+	BoundingBox region(point - dvec3(maxDistance), point + dvec3(maxDistance));
+
+	std::vector<ImplicitSurface*> occluders;
+	accelerator.gatherSurfaces(region, SECONDARY_RAY, time, occluders);
+
+	double unoccluded = 1.0;
+
+	for (ImplicitSurface* occluder : occluders) {
+
+		Sphere* sphere = dynamic_cast<Sphere*>(occluder);
+
+		if (sphere == nullptr) {
+			continue;
+		}
+
+		dvec3 toCenter = sphere->getCenter(time) - point;
+		double distance = glm::length(toCenter);
+		double gap = distance - sphere->radius;
+
+		// Skip the sphere the point is on and spheres out of range
+		if (gap <= EPSILON || gap >= maxDistance) {
+			continue;
+		}
+
+		// Cosine weighted solid angle (form factor) of the sphere. Spheres that cross the
+		// horizon only count the part above it.
+		double cosine = glm::dot(normal, toCenter / distance);
+		double h2 = (distance * distance) / (sphere->radius * sphere->radius);
+		double k2 = 1.0 - h2 * cosine * cosine;
+
+		double formFactor;
+		if (k2 > 0.0) {
+			formFactor = cosine * acos(-cosine * sqrt((h2 - 1.0) / (1.0 - cosine * cosine))) - sqrt(k2 * (h2 - 1.0));
+			formFactor = (formFactor / h2 + atan(sqrt(k2 / (h2 - 1.0)))) / PI;
+		}
+		else {
+			formFactor = glm::max(cosine, 0.0) / h2;
+		}
+
+		unoccluded *= 1.0 - glm::clamp(formFactor, 0.0, 1.0) * (1.0 - gap / maxDistance);
+	}
+
+	return unoccluded;
+
+} // end ambientOcclusion
+
+
+double AnalyticVisibility::coneOverlap(const double& lightAngle, const double& occluderAngle, const double& separation)
+{
+	// Cones are apart
+	if (separation >= lightAngle + occluderAngle) {
+		return 0.0;
+	}
+
+	// Point lights are either hidden or not
+	if (lightAngle <= 0.0) {
+		return 1.0;
+	}
+
+	// Solid angles of the cones written to keep precision for narrow cones
+	double lightArea = 4.0 * PI * glm::pow(sin(0.5 * lightAngle), 2.0);
+	double occluderArea = 4.0 * PI * glm::pow(sin(0.5 * occluderAngle), 2.0);
+
+	// One cone contains the other
+	if (separation <= glm::abs(lightAngle - occluderAngle)) {
+		return glm::min(lightArea, occluderArea) / lightArea;
+	}
+
+	// Area of the intersection of two spherical caps
+	double cosL = cos(lightAngle), sinL = sin(lightAngle);
+	double cosO = cos(occluderAngle), sinO = sin(occluderAngle);
+	double cosS = cos(separation), sinS = sin(separation);
+
+	double overlap = 2.0 * (PI
+		- acos(glm::clamp((cosS - cosL * cosO) / (sinL * sinO), -1.0, 1.0))
+		- cosL * acos(glm::clamp((cosO - cosS * cosL) / (sinS * sinL), -1.0, 1.0))
+		- cosO * acos(glm::clamp((cosL - cosS * cosO) / (sinS * sinO), -1.0, 1.0)));
+
+	return glm::clamp(overlap / lightArea, 0.0, 1.0);
+
+} // end coneOverlap
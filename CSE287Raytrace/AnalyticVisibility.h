@@ -0,0 +1,76 @@
+#pragma once
+
+#include "BoundingVolumeHierarchy.h"
+#include "Sphere.h"
+
+/**
+ * @class	AnalyticVisibility
+ *
+ * @brief	Noise free estimates of soft shadows and ambient occlusion cast by spheres. A sphere
+ * 			seen from a point covers a cone of directions whose angle is known exactly, so the
+ * 			part of a spherical light or of the hemisphere above a surface that it hides can be
+ * 			found without tracing any rays. Occluders near the point are found with a range
+ * 			query on the bounding volume hierarchy. The results of separate spheres are
+ * 			combined by multiplication, which treats them as uncorrelated.
+ */
+class AnalyticVisibility
+{
+public:
+
+	/**
+	 * @fn	static double AnalyticVisibility::lightVisibility(const BoundingVolumeHierarchy & accelerator, const dvec3 & point, const dvec3 & lightPosition, const double & lightRadius, const double & time = 0.0);
+	 *
+	 * @brief	Estimates the fraction of a spherical light that can be seen from a point. Each
+	 * 			sphere between the point and the light hides the part of the cone toward the light
+	 * 			that overlaps its own cone. Other surfaces block the center of the light or not
+	 * 			at all.
+	 *
+	 * @param	accelerator  	Hierarchy containing the surfaces of the scene.
+	 * @param	point		 	Point being shaded.
+	 * @param	lightPosition	Center of the light.
+	 * @param	lightRadius  	Radius of the light. Zero for a point light.
+	 * @param	time		 	(Optional) Time within the shutter interval.
+	 *
+	 * @returns	Visible fraction of the light from 0 (in full shadow) to 1 (fully lit).
+	 */
+	static double lightVisibility(const BoundingVolumeHierarchy & accelerator, const dvec3 & point,
+								  const dvec3 & lightPosition, const double & lightRadius, const double & time = 0.0);
+
+
+	/**
+	 * @fn	static double AnalyticVisibility::ambientOcclusion(const BoundingVolumeHierarchy & accelerator, const dvec3 & point, const dvec3 & normal, const double & maxDistance, const double & time = 0.0);
+	 *
+	 * @brief	Estimates the fraction of ambient light that reaches a point. Each sphere within
+	 * 			range removes its cosine weighted solid angle above the horizon of the surface.
+	 * 			The effect of a sphere fades to nothing as its distance approaches maxDistance.
+	 * 			Only spheres are considered.
+	 *
+	 * @param	accelerator	Hierarchy containing the surfaces of the scene.
+	 * @param	point	   	Point being shaded.
+	 * @param	normal	   	Unit surface normal at the point.
+	 * @param	maxDistance	Spheres farther than this from the point are ignored.
+	 * @param	time	   	(Optional) Time within the shutter interval.
+	 *
+	 * @returns	Unoccluded fraction from 0 (fully occluded) to 1 (nothing nearby).
+	 */
+	static double ambientOcclusion(const BoundingVolumeHierarchy & accelerator, const dvec3 & point,
+								   const dvec3 & normal, const double & maxDistance, const double & time = 0.0);
+
+protected:
+
+	/**
+	 * @fn	static double AnalyticVisibility::coneOverlap(const double & lightAngle, const double & occluderAngle, const double & separation);
+	 *
+	 * @brief	Fraction of a cone of directions toward a light that is covered by the cone of an
+	 * 			occluder. Found exactly from the area of the intersection of the two spherical caps
+	 * 			the cones cut from the unit sphere.
+	 *
+	 * @param	lightAngle   	Half angle of the cone toward the light.
+	 * @param	occluderAngle	Half angle of the cone toward the occluder.
+	 * @param	separation   	Angle between the axes of the cones.
+	 *
+	 * @returns	The covered fraction of the cone toward the light.
+	 */
+	static double coneOverlap(const double & lightAngle, const double & occluderAngle, const double & separation);
+
+}; // end AnalyticVisibility class
@@ -0,0 +1,16 @@
+#include "AsyncTask.h"
+
+
+AsyncTask<std::shared_ptr<TextureImage>> loadTextureAsync(std::string ppmFileName, TASK_PRIORITY priority)
+{
+	co_await schedule(ThreadPool::getShared(), priority);
+
+	std::shared_ptr<TextureImage> texture = std::make_shared<TextureImage>();
+
+	if (!texture->loadTextureImage(ppmFileName.c_str())) {
+		co_return nullptr;
+	}
+
+	co_return texture;
+
+} // end loadTextureAsync
@@ -0,0 +1,499 @@
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+#include "TextureImage.h"
+#include "ThreadPool.h"
+
+/**
+ * @class	CancellationToken
+ *
+ * @brief	Lets the code that started an asynchronous operation ask it to stop early. Copies share
+ * 			one flag, so the caller keeps a copy and hands another to the operation, which checks
+ * 			it at points where stopping leaves things in a consistent state.
+ */
+class CancellationToken
+{
+public:
+
+	/** @brief	Creates a token that has not been cancelled. */
+	CancellationToken() : cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+
+	/** @brief	Asks every operation holding a copy of the token to stop. */
+	void cancel() const { cancelled->store(true, std::memory_order_relaxed); }
+
+
+	/** @returns	True once cancel has been called on any copy of the token. */
+	bool isCancelled() const { return cancelled->load(std::memory_order_relaxed); }
+
+protected:
+
+	/** @brief	Flag shared by every copy */
+	std::shared_ptr<std::atomic<bool>> cancelled;
+
+}; // end CancellationToken class
+
+
+/**
+ * @struct	AsyncPromiseBase
+ *
+ * @brief	State shared by the coroutine of an AsyncTask and whoever waits on it. The state word
+ * 			holds nothing while the coroutine runs, the awaiting coroutine once one suspends on it,
+ * 			and finishedState() once it is done. Whichever of finishing and awaiting happens second
+ * 			resumes the awaiting coroutine, so neither needs a lock.
+ */
+struct AsyncPromiseBase
+{
+	/** @brief	Marks the state of a coroutine that has finished */
+	static void * finishedState() { return reinterpret_cast<void *>(1); }
+
+	/**
+	 * @struct	FinalAwaiter
+	 *
+	 * @brief	Publishes that the coroutine has finished and hands the thread to the coroutine
+	 * 			awaiting it, if one already is.
+	 */
+	struct FinalAwaiter
+	{
+		bool await_ready() const noexcept { return false; }
+
+		template <typename Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+		{
+			AsyncPromiseBase & promise = handle.promise();
+
+			// The frame may be destroyed by a waiting thread as soon as this is published
+			void * waiting = promise.state.exchange(finishedState(), std::memory_order_acq_rel);
+
+			// Threads that wait with AsyncTask::wait sleep on the shared pool
+			ThreadPool::getShared().notifyWaiters();
+
+			if (waiting != nullptr) {
+				return std::coroutine_handle<>::from_address(waiting);
+			}
+
+			return std::noop_coroutine();
+		}
+
+		void await_resume() const noexcept {}
+	};
+
+	/** @brief	Runs until the first suspension point, which is usually a move onto a pool */
+	std::suspend_never initial_suspend() noexcept { return {}; }
+
+	/** @brief	Keeps the frame alive so the result can be read after the coroutine finishes */
+	FinalAwaiter final_suspend() noexcept { return {}; }
+
+	void unhandled_exception() { error = std::current_exception(); }
+
+	/** @brief	Nothing, the awaiting coroutine, or finishedState() */
+	std::atomic<void *> state{ nullptr };
+
+	/** @brief	Exception that escaped the coroutine, thrown again to whoever waits on it */
+	std::exception_ptr error;
+
+}; // end AsyncPromiseBase struct
+
+
+template <typename T>
+class AsyncTask;
+
+/**
+ * @struct	AsyncPromise
+ *
+ * @brief	Promise of a coroutine that returns an AsyncTask. Stores the value it returns.
+ */
+template <typename T>
+struct AsyncPromise : public AsyncPromiseBase
+{
+	AsyncTask<T> get_return_object();
+
+	void return_value(T result) { value.emplace(std::move(result)); }
+
+	T takeResult()
+	{
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		return std::move(*value);
+	}
+
+	std::optional<T> value;
+
+}; // end AsyncPromise struct
+
+
+template <>
+struct AsyncPromise<void> : public AsyncPromiseBase
+{
+	AsyncTask<void> get_return_object();
+
+	void return_void() {}
+
+	void takeResult()
+	{
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+}; // end AsyncPromise struct
+
+
+/**
+ * @class	AsyncTask
+ *
+ * @brief	Result of an asynchronous operation written as a coroutine. Another coroutine gets the
+ * 			result with co_await and is suspended until it is ready. Code that is not a
+ * 			coroutine calls get, which runs queued pool tasks until the result is ready.
+ *
+ * 			A coroutine starts running on the thread that calls it and usually moves itself onto
+ * 			a pool with co_await schedule(). While suspended it costs only its frame, so any number
+ * 			of operations may be waiting without tying up threads. The task owns the frame and
+ * 			waits for the coroutine to finish before destroying it.
+ */
+template <typename T>
+class AsyncTask
+{
+public:
+
+	typedef AsyncPromise<T> promise_type;
+
+	AsyncTask() {}
+
+	explicit AsyncTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+	AsyncTask(AsyncTask && other) noexcept : handle(other.handle) { other.handle = nullptr; }
+
+	AsyncTask & operator=(AsyncTask && other) noexcept
+	{
+		if (this != &other) {
+			release();
+			handle = other.handle;
+			other.handle = nullptr;
+		}
+		return *this;
+	}
+
+	AsyncTask(const AsyncTask &) = delete;
+	AsyncTask & operator=(const AsyncTask &) = delete;
+
+	~AsyncTask() { release(); }
+
+
+	/** @returns	True once the coroutine has finished. */
+	bool isReady() const
+	{
+		return !handle || handle.promise().state.load(std::memory_order_acquire) == AsyncPromiseBase::finishedState();
+	}
+
+
+	/**
+	 * @fn	T AsyncTask::get()
+	 *
+	 * @brief	Waits for the coroutine to finish, running queued tasks of the shared pool in the
+	 * 			meantime and sleeping while there are none, and returns its result. May be called
+	 * 			once.
+	 *
+	 * @returns	The value the coroutine returned.
+	 */
+	T get()
+	{
+		wait();
+
+		return handle.promise().takeResult();
+	}
+
+
+	/**
+	 * @fn	void AsyncTask::wait() const
+	 *
+	 * @brief	Returns once the coroutine has finished, running queued tasks of the shared pool in
+	 * 			the meantime and sleeping while there are none.
+	 */
+	void wait() const
+	{
+		if (!isReady()) {
+			ThreadPool::getShared().waitUntil([this] { return isReady(); });
+		}
+	}
+
+
+	/**
+	 * @struct	Awaiter
+	 *
+	 * @brief	Suspends the awaiting coroutine until this one finishes. The awaiting coroutine is
+	 * 			resumed by the thread that finishes it.
+	 */
+	struct Awaiter
+	{
+		bool await_ready() const noexcept
+		{
+			return handle.promise().state.load(std::memory_order_acquire) == AsyncPromiseBase::finishedState();
+		}
+
+		bool await_suspend(std::coroutine_handle<> waiting) noexcept
+		{
+			// Fails only if the coroutine finished in the meantime, in which case there is no need to wait
+			void * expected = nullptr;
+			return handle.promise().state.compare_exchange_strong(expected, waiting.address(), std::memory_order_acq_rel);
+		}
+
+		T await_resume() { return handle.promise().takeResult(); }
+
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	Awaiter operator co_await() && { return Awaiter{ handle }; }
+
+	Awaiter operator co_await() & { return Awaiter{ handle }; }
+
+protected:
+
+	/** @brief	Waits for the coroutine and destroys its frame. */
+	void release()
+	{
+		if (handle) {
+			wait();
+			handle.destroy();
+			handle = nullptr;
+		}
+	}
+
+	/** @brief	Frame of the coroutine */
+	std::coroutine_handle<promise_type> handle;
+
+}; // end AsyncTask class
+
+
+template <typename T>
+inline AsyncTask<T> AsyncPromise<T>::get_return_object()
+{
+	return AsyncTask<T>(std::coroutine_handle<AsyncPromise<T>>::from_promise(*this));
+}
+
+inline AsyncTask<void> AsyncPromise<void>::get_return_object()
+{
+	return AsyncTask<void>(std::coroutine_handle<AsyncPromise<void>>::from_promise(*this));
+}
+
+
+/**
+ * @struct	ScheduleAwaiter
+ *
+ * @brief	Suspends a coroutine and queues its resumption as a task of a pool.
+ */
+struct ScheduleAwaiter
+{
+	bool await_ready() const noexcept { return false; }
+
+	void await_suspend(std::coroutine_handle<> waiting)
+	{
+		pool.spawn([waiting] { waiting.resume(); }, priority);
+	}
+
+	void await_resume() const noexcept {}
+
+	ThreadPool & pool;
+	TASK_PRIORITY priority;
+
+}; // end ScheduleAwaiter struct
+
+
+/**
+ * @fn	inline ScheduleAwaiter schedule(ThreadPool & pool = ThreadPool::getShared(), const TASK_PRIORITY & priority = NORMAL_PRIORITY)
+ *
+ * @brief	co_await schedule() moves the rest of a coroutine onto a pool, so the thread that called
+ * 			it gets on with its own work.
+ *
+ * @param	pool		(Optional) Pool the coroutine continues on.
+ * @param	priority	(Optional) Priority it is queued with.
+ */
+inline ScheduleAwaiter schedule(ThreadPool & pool = ThreadPool::getShared(), const TASK_PRIORITY & priority = NORMAL_PRIORITY)
+{
+	return ScheduleAwaiter{ pool, priority };
+}
+
+
+/**
+ * @class	AsyncMutex
+ *
+ * @brief	Lock for coroutines. A coroutine that finds it taken is suspended rather than blocking
+ * 			its thread, and the lock is handed to the longest waiting coroutine, which is resumed
+ * 			on a pool. A thread that holds the lock may therefore run queued tasks, including
+ * 			coroutines that want the same lock, without deadlocking.
+ *
+ * 			co_await lock() yields a Guard that releases the lock when it is destroyed.
+ */
+class AsyncMutex
+{
+public:
+
+	/**
+	 * @fn	AsyncMutex::AsyncMutex(ThreadPool & pool = ThreadPool::getShared())
+	 *
+	 * @brief	Constructor.
+	 *
+	 * @param	pool	(Optional) Pool that coroutines handed the lock are resumed on.
+	 */
+	AsyncMutex(ThreadPool & pool = ThreadPool::getShared()) : pool(pool) {}
+
+	AsyncMutex(const AsyncMutex &) = delete;
+	AsyncMutex & operator=(const AsyncMutex &) = delete;
+
+
+	/**
+	 * @class	Guard
+	 *
+	 * @brief	Holds the lock until it is destroyed.
+	 */
+	class Guard
+	{
+	public:
+
+		explicit Guard(AsyncMutex * mutex) : mutex(mutex) {}
+
+		Guard(Guard && other) noexcept : mutex(other.mutex) { other.mutex = nullptr; }
+
+		Guard(const Guard &) = delete;
+		Guard & operator=(const Guard &) = delete;
+
+		~Guard()
+		{
+			if (mutex != nullptr) {
+				mutex->unlock();
+			}
+		}
+
+	protected:
+
+		/** @brief	The lock held. Null once ownership has moved to another guard. */
+		AsyncMutex * mutex;
+
+	}; // end Guard class
+
+
+	/**
+	 * @struct	LockAwaiter
+	 *
+	 * @brief	Takes the lock at once if it is free, and otherwise suspends the coroutine until
+	 * 			the lock is handed to it.
+	 */
+	struct LockAwaiter
+	{
+		bool await_ready() { return mutex.tryLock(); }
+
+		bool await_suspend(std::coroutine_handle<> waiting)
+		{
+			std::lock_guard<std::mutex> lock(mutex.queueMutex);
+
+			// Released in the meantime
+			if (!mutex.locked) {
+				mutex.locked = true;
+				return false;
+			}
+
+			mutex.waiting.push_back(waiting);
+			return true;
+		}
+
+		Guard await_resume() { return Guard(&mutex); }
+
+		AsyncMutex & mutex;
+	};
+
+
+	/** @returns	An awaitable that yields a Guard once the lock is held. */
+	LockAwaiter lock() { return LockAwaiter{ *this }; }
+
+protected:
+
+	/** @returns	True if the lock was free and is now held. */
+	bool tryLock()
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		if (locked) {
+			return false;
+		}
+
+		locked = true;
+		return true;
+	}
+
+
+	/** @brief	Hands the lock to the longest waiting coroutine, or frees it if none is waiting. */
+	void unlock()
+	{
+		std::coroutine_handle<> next;
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+
+			if (waiting.empty()) {
+				locked = false;
+				return;
+			}
+
+			next = waiting.front();
+			waiting.pop_front();
+		}
+
+		// Resumed as a task of its own so the releasing coroutine is not held up by it
+		pool.spawn([next] { next.resume(); });
+	}
+
+	/** @brief	Pool that coroutines handed the lock are resumed on */
+	ThreadPool & pool;
+
+	/** @brief	Guards locked and waiting. Only held for a few instructions, never while the lock is used. */
+	std::mutex queueMutex;
+
+	/** @brief	True while some coroutine holds the lock */
+	bool locked = false;
+
+	/** @brief	Coroutines waiting for the lock, longest waiting first */
+	std::deque<std::coroutine_handle<>> waiting;
+
+}; // end AsyncMutex class
+
+
+/**
+ * @fn	template <typename Function> AsyncTask<std::invoke_result_t<Function>> runAsync(Function work, TASK_PRIORITY priority = NORMAL_PRIORITY)
+ *
+ * @brief	Runs a function on the shared pool, such as one that builds a scene, and returns a task
+ * 			that can be awaited for its result. Arguments are taken by value because they must
+ * 			outlive the call.
+ *
+ * @param	work		Function to run.
+ * @param	priority	(Optional) Priority it is queued with.
+ */
+template <typename Function>
+AsyncTask<std::invoke_result_t<Function>> runAsync(Function work, TASK_PRIORITY priority = NORMAL_PRIORITY)
+{
+	co_await schedule(ThreadPool::getShared(), priority);
+
+	co_return work();
+}
+
+
+/**
+ * @fn	AsyncTask<std::shared_ptr<TextureImage>> loadTextureAsync(std::string ppmFileName, TASK_PRIORITY priority = NORMAL_PRIORITY);
+ *
+ * @brief	Reads a texture image on the shared pool.
+ *
+ * @param	ppmFileName	Path of the image.
+ * @param	priority   	(Optional) Priority the read is queued with.
+ *
+ * @returns	The image, or null if it could not be read.
+ */
+AsyncTask<std::shared_ptr<TextureImage>> loadTextureAsync(std::string ppmFileName, TASK_PRIORITY priority = NORMAL_PRIORITY);
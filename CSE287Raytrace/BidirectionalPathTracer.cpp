@@ -0,0 +1,912 @@
+#include "BidirectionalPathTracer.h"
+
+/**
+ * @struct	LobeWeights
+ *
+ * @brief	Reflectance of each part of a surface. Parts are chosen in proportion to these when
+ * 			a path leaves the surface.
+ */
+struct LobeWeights
+{
+	/** @brief	Lambertian part */
+	double diffuse = 0.0;
+
+	/** @brief	Phong part, the highlight and blurry reflections */
+	double glossy = 0.0;
+
+	/** @brief	Perfect mirror part */
+	double mirror = 0.0;
+
+	/** @brief	Part that is split between reflection and refraction by the Fresnel equations */
+	double dielectric = 0.0;
+
+	/** @brief	Factor applied to the Lambertian and Phong BRDFs */
+	double scale = 0.0;
+
+	/** @returns	Sum of the weights. */
+	double total() const { return diffuse + glossy + mirror + dielectric; }
+};
+
+/**
+ * @fn	static LobeWeights getLobeWeights(const Material & material, const double & mirrorCutoff)
+ *
+ * @brief	Splits a material into its parts the same way shadeHit does: the dielectric part
+ * 			replaces a fraction of everything else. Opaque parts whose reflectances add up to
+ * 			more than one are scaled down, so no surface reflects more light than it receives.
+ */
+static LobeWeights getLobeWeights(const Material & material, const double & mirrorCutoff)
+{
+	double transparency = glm::clamp(material.transparency, 0.0, 1.0);
+	double diffuse = luminance(material.getDiffuse());
+	double specular = luminance(material.getSpecular());
+	double reflectivity = glm::max(material.reflectivity, 0.0);
+
+	bool mirror = reflectivity > 0.0 && material.shininess >= mirrorCutoff;
+	double sum = diffuse + specular + reflectivity;
+
+	LobeWeights weights;
+	weights.scale = (1.0 - transparency) / glm::max(sum, 1.0);
+	weights.diffuse = weights.scale * diffuse;
+	weights.glossy = weights.scale * (specular + (mirror ? 0.0 : reflectivity));
+	weights.mirror = mirror ? weights.scale * reflectivity : 0.0;
+	weights.dielectric = transparency;
+
+	return weights;
+}
+
+/**
+ * @fn	static double toArea(const double & pdf, const PathVertex & from, const PathVertex & to)
+ *
+ * @brief	Converts the density of the direction from one vertex to another with respect to
+ * 			solid angle to a density with respect to area at the second vertex.
+ */
+static double toArea(const double & pdf, const PathVertex & from, const PathVertex & to)
+{
+	dvec3 toVertex = to.point - from.point;
+	double distanceSquared = glm::dot(toVertex, toVertex);
+
+	if (distanceSquared <= 0.0) {
+		return 0.0;
+	}
+
+	double density = pdf / distanceSquared;
+
+	// Lights without an area take no cosine
+	if (to.normal != dvec3(0.0)) {
+		density *= glm::abs(glm::dot(to.normal, toVertex)) / sqrt(distanceSquared);
+	}
+
+	return density;
+}
+
+/**
+ * @fn	static double geometry(const PathVertex & a, const PathVertex & b)
+ *
+ * @brief	Geometric term of the segment between two vertices: the cosines at both ends over the
+ * 			squared distance. Visibility is not tested.
+ */
+static double geometry(const PathVertex & a, const PathVertex & b)
+{
+	dvec3 toB = b.point - a.point;
+	double distanceSquared = glm::dot(toB, toB);
+
+	if (distanceSquared <= 0.0) {
+		return 0.0;
+	}
+
+	dvec3 direction = toB / sqrt(distanceSquared);
+
+	double cosineA = a.normal != dvec3(0.0) ? glm::abs(glm::dot(a.normal, direction)) : 1.0;
+	double cosineB = b.normal != dvec3(0.0) ? glm::abs(glm::dot(b.normal, direction)) : 1.0;
+
+	return cosineA * cosineB / distanceSquared;
+}
+
+/**
+ * @fn	static bool isVisible(const BoundingVolumeHierarchy & accelerator, const PathVertex & a, const PathVertex & b)
+ *
+ * @brief	Traces a shadow feeler between two vertices.
+ */
+static bool isVisible(const BoundingVolumeHierarchy & accelerator, const PathVertex & a, const PathVertex & b)
+{
+	dvec3 toB = b.point - a.point;
+
+	// Both ends are moved off their surfaces toward each other. The feeler is aimed between
+	// the moved ends, since aiming it from a moved origin at the surface point makes it pass
+	// beside that point and clip the curved surface around it at grazing angles.
+	dvec3 origin = a.point;
+	if (a.normal != dvec3(0.0)) {
+		origin += (glm::dot(a.normal, toB) > 0.0 ? EPSILON : -EPSILON) * a.normal;
+	}
+
+	dvec3 target = b.point;
+	if (b.normal != dvec3(0.0)) {
+		target += (glm::dot(b.normal, toB) < 0.0 ? EPSILON : -EPSILON) * b.normal;
+	}
+
+	dvec3 toTarget = target - origin;
+	double distance = glm::length(toTarget);
+
+	Ray feeler(origin, toTarget / distance, SHADOW_RAY);
+
+	return !accelerator.isOccluded(feeler, distance - EPSILON);
+}
+
+/**
+ * @fn	static double remapZero(const double & pdf)
+ *
+ * @brief	Densities of mirror and dielectric choices are stored as zero and take no part in the
+ * 			ratios of the MIS weights.
+ */
+static double remapZero(const double & pdf)
+{
+	return pdf != 0.0 ? pdf : 1.0;
+}
+
+
+void BidirectionalPathTracer::build(const LightVector& lights, const std::vector<int>& activeLights, const EmissiveLights& emissiveLights,
+									const double& mirrorCutoff, const int& maxBounces, const int& threadCount)
+{
+	this->mirrorCutoff = mirrorCutoff;
+	this->maxBounces = glm::max(maxBounces, 1);
+
+	sources.clear();
+	std::vector<double> powers;
+
+	// Ambient and directional lights have no position to start a path from
+	for (int i : activeLights) {
+
+		Source source;
+		source.light = std::dynamic_pointer_cast<PositionalLight>(lights[i]);
+
+		if (source.light == nullptr) {
+			continue;
+		}
+
+		source.spot = std::dynamic_pointer_cast<SpotLight>(lights[i]);
+
+		// The spot falls off linearly to its edge, on average giving off half its intensity
+		double solidAngle = source.spot != nullptr ? 0.5 * TWO_PI * (1.0 - source.spot->cutOffCosineRadians) : 2.0 * TWO_PI;
+
+		sources.push_back(source);
+		powers.push_back(PI * luminance(source.light->diffuseLightColor) * solidAngle);
+	}
+
+	for (int i = 0; i < emissiveLights.size(); i++) {
+
+		Source source;
+		source.emitter = emissiveLights.getEmitter(i);
+
+		sources.push_back(source);
+		powers.push_back(PI * emissiveLights.getPower(i));
+	}
+
+	distribution.build(powers);
+
+	totalPower = 0.0;
+	for (double power : powers) {
+		totalPower += power;
+	}
+
+	// Light paths hold the light and one vertex per bounce. Camera paths also hold the camera.
+	arenas.resize(glm::max(threadCount, 1));
+
+	for (PathArena& arena : arenas) {
+		arena.lightPath.resize(this->maxBounces + 1);
+		arena.cameraPath.resize(this->maxBounces + 2);
+	}
+
+} // end build
+
+
+void BidirectionalPathTracer::renderSample(const BoundingVolumeHierarchy& accelerator, const RenderView& camera, const int& x, const int& y,
+										   const unsigned int& seed, const color& background, AccumulationBuffer& film)
+{
+	PathArena& arena = arenas[ThreadPool::getThreadIndex() % arenas.size()];
+	PathVertex* lightPath = arena.lightPath.data();
+	PathVertex* cameraPath = arena.cameraPath.data();
+
+	RandomSequence random(seed);
+
+	// Path from the camera through a random point of the pixel
+	PathVertex& eye = cameraPath[0];
+	eye.type = CAMERA_VERTEX;
+	eye.point = camera.eye;
+	eye.normal = -camera.w;
+	eye.throughput = color(1.0, 1.0, 1.0, 1.0);
+	eye.delta = false;
+
+	Ray viewRay = camera.getSampleRay(x, y, random.next2());
+
+	double directionPdf;
+	getImportance(camera, viewRay.direct, directionPdf);
+
+	int cameraCount = randomWalk(accelerator, viewRay, eye.throughput, directionPdf, true, random, cameraPath, maxBounces + 2);
+
+	// Light paths are traced even for pixels that see nothing, since they land on other pixels
+	int lightCount = traceLightPath(accelerator, random, lightPath);
+
+	color total = cameraCount == 1 ? background : color(0.0, 0.0, 0.0, 0.0);
+
+	for (int t = 1; t <= cameraCount; t++) {
+		for (int s = 0; s <= lightCount; s++) {
+
+			// A light seen directly by the camera is found by the camera path alone
+			int bounces = s + t - 2;
+			if ((s == 1 && t == 1) || bounces < 0 || bounces > maxBounces) {
+				continue;
+			}
+
+			int pixelX, pixelY;
+			color contribution = connect(accelerator, camera, lightPath, cameraPath, s, t, random, pixelX, pixelY);
+
+			if (t == 1) {
+				film.addSample(pixelX, pixelY, contribution);
+			}
+			else {
+				total += contribution;
+			}
+		}
+	}
+
+	film.addSample(x, y, total);
+
+} // end renderSample
+
+
+int BidirectionalPathTracer::traceLightPath(const BoundingVolumeHierarchy& accelerator, RandomSequence& random, PathVertex* path) const
+{
+	PathVertex& light = path[0];
+
+	if (!sampleLight(random, light)) {
+		return 0;
+	}
+
+	const Source& source = sources[light.source];
+	dvec2 u = random.next2();
+	dvec3 direction;
+
+	if (source.emitter != nullptr) {
+
+		// Cosine weighted about the normal, in proportion to the light given off
+		double radius = sqrt(u.x);
+		double phi = TWO_PI * u.y;
+
+		direction = orthonormalBasis(light.normal) * dvec3(radius * cos(phi), radius * sin(phi), sqrt(glm::max(1.0 - u.x, 0.0)));
+	}
+	else {
+
+		// Uniform over the sphere or the cone of a spot
+		double cosMax = source.spot != nullptr ? source.spot->cutOffCosineRadians : -1.0;
+		double cosTheta = 1.0 - u.x * (1.0 - cosMax);
+		double sinTheta = sqrt(glm::max(1.0 - cosTheta * cosTheta, 0.0));
+		double phi = TWO_PI * u.y;
+
+		dvec3 axis = source.spot != nullptr ? source.spot->spotDirection : dvec3(0.0, 0.0, 1.0);
+		direction = orthonormalBasis(axis) * dvec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+	}
+
+	double pdf = emissionPdf(light, direction);
+	color emitted = getEmission(light, direction);
+
+	if (pdf <= 0.0 || luminance(emitted) <= 0.0) {
+		return 1;
+	}
+
+	double cosine = light.normal != dvec3(0.0) ? glm::abs(glm::dot(light.normal, direction)) : 1.0;
+
+	Ray ray(light.point + EPSILON * light.normal, direction, SECONDARY_RAY);
+
+	return randomWalk(accelerator, ray, light.throughput * emitted * cosine / pdf, pdf, false, random, path, maxBounces + 1);
+
+} // end traceLightPath
+
+
+int BidirectionalPathTracer::randomWalk(const BoundingVolumeHierarchy& accelerator, Ray ray, color throughput, double pdf,
+										const bool& fromCamera, RandomSequence& random, PathVertex* path, const int& capacity) const
+{
+	int count = 1;
+
+	while (count < capacity) {
+
+		HitRecord hit = accelerator.findClosestIntersection(ray);
+
+		if (hit.t == INFINITY) {
+			break;
+		}
+
+		PathVertex& previous = path[count - 1];
+		PathVertex& vertex = path[count];
+
+		vertex.type = SURFACE_VERTEX;
+		vertex.point = hit.interceptPoint;
+		vertex.normal = hit.surfaceNormal;
+		vertex.throughput = throughput;
+		vertex.material = hit.material;
+		vertex.rayStatus = hit.rayStatus;
+		vertex.source = -1;
+		vertex.delta = false;
+		vertex.pdfForward = toArea(pdf, previous, vertex);
+		vertex.pdfReverse = 0.0;
+
+		if (++count == capacity) {
+			break;
+		}
+
+		dvec3 toPrevious = -ray.direct;
+		dvec3 direction;
+		color weight;
+		double pdfReverse;
+
+		if (!sampleScatter(vertex, toPrevious, fromCamera, random, direction, weight, pdf, pdfReverse, vertex.delta)) {
+			break;
+		}
+
+		throughput *= weight;
+
+		// The density of going back the other way belongs to the vertex before
+		previous.pdfReverse = toArea(pdfReverse, vertex, previous);
+
+		if (luminance(throughput) <= 0.0) {
+			break;
+		}
+
+		double side = glm::dot(direction, vertex.normal) > 0.0 ? EPSILON : -EPSILON;
+
+		ray = Ray(vertex.point + side * vertex.normal, direction, SECONDARY_RAY);
+	}
+
+	return count;
+
+} // end randomWalk
+
+
+color BidirectionalPathTracer::connect(const BoundingVolumeHierarchy& accelerator, const RenderView& camera, PathVertex* lightPath,
+									   PathVertex* cameraPath, const int& s, const int& t, RandomSequence& random, int& pixelX, int& pixelY) const
+{
+	color black(0.0, 0.0, 0.0, 0.0);
+	color contribution = black;
+
+	PathVertex sampled;
+
+	if (s == 0) {
+
+		// The camera path found an emitter by itself
+		const PathVertex& pt = cameraPath[t - 1];
+
+		if (pt.type == SURFACE_VERTEX) {
+			contribution = pt.throughput * getEmission(pt, glm::normalize(cameraPath[t - 2].point - pt.point));
+		}
+	}
+	else if (t == 1) {
+
+		// Light path seen directly by the camera, which lands on whatever pixel it projects to
+		const PathVertex& qs = lightPath[s - 1];
+
+		if (!isConnectible(qs) || !camera.projectPoint(qs.point, pixelX, pixelY)) {
+			return black;
+		}
+
+		double directionPdf;
+		double importance = getImportance(camera, glm::normalize(qs.point - camera.eye), directionPdf);
+
+		contribution = qs.throughput * evaluate(camera, qs, s > 1 ? &lightPath[s - 2] : nullptr, cameraPath[0]) *
+			importance * geometry(qs, cameraPath[0]);
+
+		if (luminance(contribution) > 0.0 && !isVisible(accelerator, qs, cameraPath[0])) {
+			return black;
+		}
+	}
+	else if (s == 1) {
+
+		// A new point on a light
+		const PathVertex& pt = cameraPath[t - 1];
+
+		if (!isConnectible(pt) || !sampleLight(random, sampled)) {
+			return black;
+		}
+
+		contribution = sampled.throughput * evaluate(camera, sampled, nullptr, pt) * geometry(sampled, pt) *
+			evaluate(camera, pt, &cameraPath[t - 2], sampled) * pt.throughput;
+
+		if (luminance(contribution) > 0.0 && !isVisible(accelerator, pt, sampled)) {
+			return black;
+		}
+	}
+	else {
+
+		const PathVertex& qs = lightPath[s - 1];
+		const PathVertex& pt = cameraPath[t - 1];
+
+		if (!isConnectible(qs) || !isConnectible(pt)) {
+			return black;
+		}
+
+		contribution = qs.throughput * evaluate(camera, qs, &lightPath[s - 2], pt) * geometry(qs, pt) *
+			evaluate(camera, pt, &cameraPath[t - 2], qs) * pt.throughput;
+
+		if (luminance(contribution) > 0.0 && !isVisible(accelerator, pt, qs)) {
+			return black;
+		}
+	}
+
+	if (luminance(contribution) <= 0.0) {
+		return black;
+	}
+
+	return contribution * misWeight(camera, lightPath, cameraPath, sampled, s, t);
+
+} // end connect
+
+
+double BidirectionalPathTracer::misWeight(const RenderView& camera, PathVertex* lightPath, PathVertex* cameraPath, const PathVertex& sampled,
+										  const int& s, const int& t) const
+{
+	// The camera path alone is the only way to see an emitter directly
+	if (s + t == 2) {
+		return 1.0;
+	}
+
+	// A new point on a light stands in for the first vertex of the light path
+	PathVertex firstLight;
+	if (s == 1) {
+		firstLight = lightPath[0];
+		lightPath[0] = sampled;
+	}
+
+	PathVertex* qs = s > 0 ? &lightPath[s - 1] : nullptr;
+	PathVertex* pt = &cameraPath[t - 1];
+	PathVertex* qsMinus = s > 1 ? &lightPath[s - 2] : nullptr;
+	PathVertex* ptMinus = t > 1 ? &cameraPath[t - 2] : nullptr;
+
+	// Densities of the vertices next to the connection as seen from the other side
+	double ptReverse = s > 0 ? pdf(camera, *qs, qsMinus, *pt) : pdfLightOrigin(*pt);
+	double ptMinusReverse = 0.0, qsReverse = 0.0, qsMinusReverse = 0.0;
+
+	if (ptMinus != nullptr) {
+		ptMinusReverse = s > 0 ? pdf(camera, *pt, qs, *ptMinus) : pdfEmission(*pt, *ptMinus);
+	}
+	if (qs != nullptr) {
+		qsReverse = pdf(camera, *pt, ptMinus, *qs);
+	}
+	if (qsMinus != nullptr) {
+		qsMinusReverse = pdf(camera, *qs, pt, *qsMinus);
+	}
+
+	bool ptDeltaSaved = pt->delta;
+	double ptSaved = pt->pdfReverse;
+	pt->delta = false;
+	pt->pdfReverse = ptReverse;
+
+	double ptMinusSaved = 0.0;
+	if (ptMinus != nullptr) {
+		ptMinusSaved = ptMinus->pdfReverse;
+		ptMinus->pdfReverse = ptMinusReverse;
+	}
+
+	bool qsDeltaSaved = false;
+	double qsSaved = 0.0;
+	if (qs != nullptr) {
+		qsDeltaSaved = qs->delta;
+		qsSaved = qs->pdfReverse;
+		qs->delta = false;
+		qs->pdfReverse = qsReverse;
+	}
+
+	double qsMinusSaved = 0.0;
+	if (qsMinus != nullptr) {
+		qsMinusSaved = qsMinus->pdfReverse;
+		qsMinus->pdfReverse = qsMinusReverse;
+	}
+
+	// Ratios of the density of every other strategy to that of this one, squared for the
+	// power heuristic. Strategies that would connect at a mirror or dielectric are impossible.
+	double sum = 0.0;
+	double ratio = 1.0;
+
+	for (int i = t - 1; i > 0; i--) {
+
+		double r = remapZero(cameraPath[i].pdfReverse) / remapZero(cameraPath[i].pdfForward);
+		ratio *= r * r;
+
+		if (!cameraPath[i].delta && !cameraPath[i - 1].delta) {
+			sum += ratio;
+		}
+	}
+
+	ratio = 1.0;
+
+	for (int i = s - 1; i >= 0; i--) {
+
+		double r = remapZero(lightPath[i].pdfReverse) / remapZero(lightPath[i].pdfForward);
+		ratio *= r * r;
+
+		bool deltaBefore = i > 0 ? lightPath[i - 1].delta : isDeltaLight(lightPath[0]);
+
+		if (!lightPath[i].delta && !deltaBefore) {
+			sum += ratio;
+		}
+	}
+
+	// Put everything back for the next connection
+	pt->delta = ptDeltaSaved;
+	pt->pdfReverse = ptSaved;
+
+	if (ptMinus != nullptr) {
+		ptMinus->pdfReverse = ptMinusSaved;
+	}
+	if (qs != nullptr) {
+		qs->delta = qsDeltaSaved;
+		qs->pdfReverse = qsSaved;
+	}
+	if (qsMinus != nullptr) {
+		qsMinus->pdfReverse = qsMinusSaved;
+	}
+	if (s == 1) {
+		lightPath[0] = firstLight;
+	}
+
+	return 1.0 / (1.0 + sum);
+
+} // end misWeight
+
+
+bool BidirectionalPathTracer::sampleLight(RandomSequence& random, PathVertex& vertex) const
+{
+	if (distribution.empty()) {
+		return false;
+	}
+
+	double probability;
+	int index = distribution.sample(random.next(), probability);
+	const Source& source = sources[index];
+
+	vertex.type = LIGHT_VERTEX;
+	vertex.source = index;
+	vertex.delta = false;
+	vertex.pdfReverse = 0.0;
+
+	if (source.emitter != nullptr) {
+
+		if (!source.emitter->samplePoint(random.next2(), 0.0, vertex.point, vertex.normal)) {
+			return false;
+		}
+
+		vertex.pdfForward = probability / source.emitter->getSurfaceArea();
+	}
+	else {
+		vertex.point = source.light->lightPosition;
+		vertex.normal = dvec3(0.0);
+		vertex.pdfForward = probability;
+	}
+
+	vertex.throughput = color(dvec3(1.0 / vertex.pdfForward), 1.0);
+
+	return true;
+
+} // end sampleLight
+
+
+color BidirectionalPathTracer::evaluate(const RenderView& camera, const PathVertex& vertex, const PathVertex* previous, const PathVertex& next) const
+{
+	dvec3 direction = glm::normalize(next.point - vertex.point);
+
+	switch (vertex.type) {
+
+	case CAMERA_VERTEX: {
+		double directionPdf;
+		return color(dvec3(getImportance(camera, direction, directionPdf)), 1.0);
+	}
+	case LIGHT_VERTEX:
+		return getEmission(vertex, direction);
+
+	default:
+		return scatter(vertex, glm::normalize(previous->point - vertex.point), direction);
+	}
+
+} // end evaluate
+
+
+double BidirectionalPathTracer::pdf(const RenderView& camera, const PathVertex& vertex, const PathVertex* previous, const PathVertex& next) const
+{
+	dvec3 direction = glm::normalize(next.point - vertex.point);
+	double directionPdf = 0.0;
+
+	switch (vertex.type) {
+
+	case CAMERA_VERTEX:
+		getImportance(camera, direction, directionPdf);
+		break;
+
+	case LIGHT_VERTEX:
+		directionPdf = emissionPdf(vertex, direction);
+		break;
+
+	default:
+		directionPdf = scatterPdf(vertex, glm::normalize(previous->point - vertex.point), direction);
+		break;
+	}
+
+	return toArea(directionPdf, vertex, next);
+
+} // end pdf
+
+
+double BidirectionalPathTracer::pdfLightOrigin(const PathVertex& vertex) const
+{
+	if (vertex.type == LIGHT_VERTEX) {
+
+		const Source& source = sources[vertex.source];
+		double probability = distribution.getProbability(vertex.source);
+
+		return source.emitter != nullptr ? probability / source.emitter->getSurfaceArea() : probability;
+	}
+
+	// Emitters are chosen by power and points on them by area, so the density of a point only
+	// depends on how brightly it glows
+	if (vertex.type == SURFACE_VERTEX && vertex.rayStatus == ENTERING && totalPower > 0.0) {
+		return PI * luminance(vertex.material.getEmisive()) / totalPower;
+	}
+
+	return 0.0;
+
+} // end pdfLightOrigin
+
+
+double BidirectionalPathTracer::pdfEmission(const PathVertex& vertex, const PathVertex& next) const
+{
+	dvec3 direction = glm::normalize(next.point - vertex.point);
+
+	return toArea(glm::max(glm::dot(vertex.normal, direction), 0.0) / PI, vertex, next);
+
+} // end pdfEmission
+
+
+color BidirectionalPathTracer::getEmission(const PathVertex& vertex, const dvec3& direction) const
+{
+	color black(0.0, 0.0, 0.0, 0.0);
+
+	if (vertex.type == LIGHT_VERTEX && sources[vertex.source].light != nullptr) {
+
+		const Source& source = sources[vertex.source];
+
+		// Intensity that lights a surface one unit away as brightly as the Phong model does
+		color intensity = PI * source.light->diffuseLightColor;
+
+		if (source.spot != nullptr) {
+
+			double cosine = glm::dot(direction, source.spot->spotDirection);
+			double cutOff = source.spot->cutOffCosineRadians;
+
+			if (cosine <= cutOff) {
+				return black;
+			}
+
+			intensity *= 1.0 - (1.0 - cosine) / (1.0 - cutOff);
+		}
+
+		return intensity;
+	}
+
+	// Emissive surfaces glow on the outside only
+	if (glm::dot(vertex.normal, direction) <= 0.0 || (vertex.type == SURFACE_VERTEX && vertex.rayStatus != ENTERING)) {
+		return black;
+	}
+
+	if (vertex.type == LIGHT_VERTEX) {
+		return sources[vertex.source].emitter->material.getEmisive();
+	}
+
+	return vertex.material.getEmisive();
+
+} // end getEmission
+
+
+double BidirectionalPathTracer::emissionPdf(const PathVertex& vertex, const dvec3& direction) const
+{
+	const Source& source = sources[vertex.source];
+
+	if (source.emitter != nullptr) {
+		return glm::max(glm::dot(vertex.normal, direction), 0.0) / PI;
+	}
+
+	if (source.spot != nullptr) {
+
+		double cutOff = source.spot->cutOffCosineRadians;
+
+		return glm::dot(direction, source.spot->spotDirection) > cutOff ? 1.0 / (TWO_PI * (1.0 - cutOff)) : 0.0;
+	}
+
+	return 1.0 / (2.0 * TWO_PI);
+
+} // end emissionPdf
+
+
+double BidirectionalPathTracer::getImportance(const RenderView& camera, const dvec3& direction, double& pdf) const
+{
+	pdf = 0.0;
+
+	double cosTheta = -glm::dot(direction, camera.w);
+	if (cosTheta <= 0.0) {
+		return 0.0;
+	}
+
+	// Where the direction crosses the projection plane
+	dvec3 onPlane = direction * (camera.distToPlane / cosTheta);
+	double x = glm::dot(onPlane, camera.u);
+	double y = glm::dot(onPlane, camera.v);
+
+	if (x < camera.leftLimit || x > camera.rightLimit || y < camera.bottomLimit || y > camera.topLimit) {
+		return 0.0;
+	}
+
+	// Area of the image on a plane one unit in front of the view point
+	double area = (camera.rightLimit - camera.leftLimit) * (camera.topLimit - camera.bottomLimit) /
+		(camera.distToPlane * camera.distToPlane);
+
+	double cosSquared = cosTheta * cosTheta;
+
+	pdf = 1.0 / (area * cosSquared * cosTheta);
+
+	return 1.0 / (area * cosSquared * cosSquared);
+
+} // end getImportance
+
+
+color BidirectionalPathTracer::scatter(const PathVertex& vertex, const dvec3& toPrevious, const dvec3& toNext) const
+{
+	const dvec3& normal = vertex.normal;
+
+	// Only the mirror and dielectric parts reach the far side
+	if (glm::dot(normal, toPrevious) <= 0.0 || glm::dot(normal, toNext) <= 0.0) {
+		return color(0.0, 0.0, 0.0, 0.0);
+	}
+
+	const Material& material = vertex.material;
+	LobeWeights weights = getLobeWeights(material, mirrorCutoff);
+
+	double reflectivity = material.shininess >= mirrorCutoff ? 0.0 : glm::max(material.reflectivity, 0.0);
+	color glossy = material.getSpecular() + color(dvec3(reflectivity), 0.0);
+
+	double lobe = glm::pow(glm::max(glm::dot(glm::reflect(-toPrevious, normal), toNext), 0.0), material.shininess);
+
+	return weights.scale * (material.getDiffuse() / PI + glossy * (material.shininess + 2.0) / TWO_PI * lobe);
+
+} // end scatter
+
+
+double BidirectionalPathTracer::scatterPdf(const PathVertex& vertex, const dvec3& toPrevious, const dvec3& toNext) const
+{
+	const dvec3& normal = vertex.normal;
+
+	double cosine = glm::dot(normal, toNext);
+
+	if (glm::dot(normal, toPrevious) <= 0.0 || cosine <= 0.0) {
+		return 0.0;
+	}
+
+	const Material& material = vertex.material;
+	LobeWeights weights = getLobeWeights(material, mirrorCutoff);
+
+	if (weights.diffuse + weights.glossy <= 0.0) {
+		return 0.0;
+	}
+
+	double lobe = glm::pow(glm::max(glm::dot(glm::reflect(-toPrevious, normal), toNext), 0.0), material.shininess);
+
+	return (weights.diffuse * cosine / PI + weights.glossy * (material.shininess + 1.0) / TWO_PI * lobe) / weights.total();
+
+} // end scatterPdf
+
+
+bool BidirectionalPathTracer::sampleScatter(const PathVertex& vertex, const dvec3& toPrevious, const bool& fromCamera, RandomSequence& random,
+											dvec3& direction, color& weight, double& pdfForward, double& pdfReverse, bool& delta) const
+{
+	const Material& material = vertex.material;
+	const dvec3& normal = vertex.normal;
+
+	LobeWeights weights = getLobeWeights(material, mirrorCutoff);
+	double total = weights.total();
+
+	if (total <= 0.0) {
+		return false;
+	}
+
+	double choice = random.next() * total;
+	dvec2 u = random.next2();
+
+	pdfForward = 0.0;
+	pdfReverse = 0.0;
+
+	if (choice < weights.diffuse + weights.glossy) {
+
+		if (choice < weights.diffuse) {
+
+			// Cosine weighted about the normal
+			double radius = sqrt(u.x);
+			double phi = TWO_PI * u.y;
+
+			direction = orthonormalBasis(normal) * dvec3(radius * cos(phi), radius * sin(phi), sqrt(glm::max(1.0 - u.x, 0.0)));
+		}
+		else {
+
+			// Phong lobe about the mirror direction
+			double cosAlpha = glm::pow(u.x, 1.0 / (material.shininess + 1.0));
+			double sinAlpha = sqrt(glm::max(1.0 - cosAlpha * cosAlpha, 0.0));
+			double phi = TWO_PI * u.y;
+
+			direction = orthonormalBasis(glm::reflect(-toPrevious, normal)) * dvec3(cos(phi) * sinAlpha, sin(phi) * sinAlpha, cosAlpha);
+		}
+
+		double cosine = glm::dot(direction, normal);
+
+		pdfForward = scatterPdf(vertex, toPrevious, direction);
+
+		if (cosine <= 0.0 || pdfForward <= 0.0) {
+			return false;
+		}
+
+		pdfReverse = scatterPdf(vertex, direction, toPrevious);
+		weight = scatter(vertex, toPrevious, direction) * cosine / pdfForward;
+		delta = false;
+
+		return true;
+	}
+
+	// Mirror and dielectric parts are chosen with probability equal to their share of the total,
+	// which cancels their weight
+	delta = true;
+	weight = color(dvec3(total), 1.0);
+
+	if (choice < weights.diffuse + weights.glossy + weights.mirror) {
+
+		direction = glm::reflect(-toPrevious, normal);
+		return true;
+	}
+
+	// Same Fresnel split as traceDielectric
+	double indexOfRefraction = material.indexOfRefraction;
+	double eta = vertex.rayStatus == ENTERING ? 1.0 / indexOfRefraction : indexOfRefraction;
+
+	double cosIncident = glm::dot(toPrevious, normal);
+	double sinSquaredTransmitted = eta * eta * (1.0 - cosIncident * cosIncident);
+
+	if (sinSquaredTransmitted >= 1.0) {
+		direction = glm::reflect(-toPrevious, normal);
+		return true;
+	}
+
+	double r0 = (1.0 - indexOfRefraction) / (1.0 + indexOfRefraction);
+	r0 *= r0;
+
+	double cosine = vertex.rayStatus == ENTERING ? cosIncident : sqrt(1.0 - sinSquaredTransmitted);
+	double reflectance = r0 + (1.0 - r0) * glm::pow(1.0 - cosine, 5.0);
+
+	if (u.x < reflectance) {
+		direction = glm::reflect(-toPrevious, normal);
+		return true;
+	}
+
+	direction = glm::refract(-toPrevious, normal, eta);
+
+	// Radiance is compressed into a smaller solid angle as it enters a denser material
+	if (fromCamera) {
+		weight *= eta * eta;
+	}
+
+	return true;
+
+} // end sampleScatter
+
+
+bool BidirectionalPathTracer::isConnectible(const PathVertex& vertex) const
+{
+	if (vertex.type != SURFACE_VERTEX) {
+		return true;
+	}
+
+	LobeWeights weights = getLobeWeights(vertex.material, mirrorCutoff);
+
+	return weights.diffuse + weights.glossy > 0.0;
+
+} // end isConnectible
@@ -0,0 +1,392 @@
+#pragma once
+
+#include "AccumulationBuffer.h"
+#include "EmissiveLights.h"
+#include "LightSource.h"
+#include "RenderView.h"
+
+/**
+ * @enum	PATH_VERTEX_TYPE
+ *
+ * @brief	What a vertex of a path lies on.
+ */
+enum PATH_VERTEX_TYPE { CAMERA_VERTEX, LIGHT_VERTEX, SURFACE_VERTEX };
+
+/**
+ * @struct	PathVertex
+ *
+ * @brief	Vertex of a path traced from the camera or from a light. Densities are with respect
+ * 			to area at the vertex so that paths built from either end can be compared.
+ */
+struct PathVertex
+{
+	/** @brief	What the vertex lies on */
+	PATH_VERTEX_TYPE type = SURFACE_VERTEX;
+
+	/** @brief	Position of the vertex */
+	dvec3 point;
+
+	/** @brief	Unit surface normal on the side the path arrived from. Outward for emitters and the
+	viewing direction for the camera. Zero for lights without an area. */
+	dvec3 normal;
+
+	/** @brief	Product of the weights of the path up to the vertex */
+	color throughput;
+
+	/** @brief	Material of a surface vertex */
+	Material material;
+
+	/** @brief	Whether the path entered or left the surface at a surface vertex */
+	RAY_STATUS rayStatus = ENTERING;
+
+	/** @brief	Index of the light source of a light vertex */
+	int source = -1;
+
+	/** @brief	True if the path left the vertex by a mirror reflection or refraction, which
+	cannot be connected to */
+	bool delta = false;
+
+	/** @brief	Density with which the vertex was chosen by the path it belongs to */
+	double pdfForward = 0.0;
+
+	/** @brief	Density with which the path from the other end would have chosen the vertex */
+	double pdfReverse = 0.0;
+
+}; // end PathVertex struct
+
+
+/**
+ * @struct	BidirectionalFrame
+ *
+ * @brief	Samples of a view averaged over the frames in which neither the view nor the scene
+ * 			changed.
+ */
+struct BidirectionalFrame
+{
+	/** @brief	Camera that took the samples */
+	RenderView camera;
+
+	/** @brief	Extent of the scene when the samples were taken */
+	BoundingBox sceneBounds;
+
+	/** @brief	RayTracer::getSceneSignature when the samples were taken */
+	unsigned int sceneSignature = 0;
+
+	/** @brief	Sum of the samples of every pixel */
+	AccumulationBuffer film;
+
+	/** @brief	Number of samples taken in every pixel */
+	int sampleCount = 0;
+
+}; // end BidirectionalFrame struct
+
+
+/**
+ * @class	BidirectionalPathTracer
+ *
+ * @brief	Bidirectional path tracing (Veach 1997). For every pixel sample one path is traced
+ * 			from the camera and one from a light chosen by power, and every vertex of one is
+ * 			connected to every vertex of the other. Each connection is a different way of
+ * 			sampling the same path, and the power heuristic weighs them by how likely each way
+ * 			was to find it, so light reaching the camera by way of other surfaces or through
+ * 			glass is found by whichever strategy suits it. Connections to the camera itself
+ * 			(light tracing) land on other pixels and are splatted into the film.
+ *
+ * 			Surfaces reflect by a Lambertian lobe plus an energy normalized Phong lobe, and
+ * 			reflect or refract without blur by their mirror and dielectric parts. Point and spot
+ * 			lights fall off with the square of distance and emissive surfaces give off their
+ * 			emissive color in every direction above them. Ambient and directional light are left
+ * 			out, so images differ from the Whitted model used by the rest of the ray tracer.
+ *
+ * 			Path vertices live in arenas set aside for each rendering thread, so tracing a
+ * 			sample allocates nothing.
+ */
+class BidirectionalPathTracer
+{
+public:
+
+	/**
+	 * @fn	void BidirectionalPathTracer::build(const LightVector & lights, const std::vector<int> & activeLights, const EmissiveLights & emissiveLights, const double & mirrorCutoff, const int & maxBounces, const int & threadCount);
+	 *
+	 * @brief	Collects the light sources for the current frame and sizes the path arenas. Must
+	 * 			be called again whenever lights or surfaces change.
+	 *
+	 * @param	lights		  	Lights of the scene.
+	 * @param	activeLights  	Indices of the enabled lights.
+	 * @param	emissiveLights	Emissive surfaces of the scene.
+	 * @param	mirrorCutoff  	Shininess at or above which reflective surfaces are perfect mirrors.
+	 * @param	maxBounces	  	Most surfaces a path from the light to the camera may bounce off.
+	 * @param	threadCount   	Number of threads that render samples.
+	 */
+	void build(const LightVector & lights, const std::vector<int> & activeLights, const EmissiveLights & emissiveLights,
+			   const double & mirrorCutoff, const int & maxBounces, const int & threadCount);
+
+
+	/**
+	 * @fn	void BidirectionalPathTracer::renderSample(const BoundingVolumeHierarchy & accelerator, const RenderView & camera, const int & x, const int & y, const unsigned int & seed, const color & background, AccumulationBuffer & film);
+	 *
+	 * @brief	Traces one sample of a pixel and adds everything it finds to the film, including
+	 * 			light path connections that land on other pixels. May be called concurrently by
+	 * 			the threads of a ThreadPool.
+	 *
+	 * @param 		  	accelerator	Hierarchy containing the surfaces of the scene.
+	 * @param 		  	camera	   	Perspective view being rendered.
+	 * @param 		  	x		   	column of the pixel.
+	 * @param 		  	y		   	row of the pixel.
+	 * @param 		  	seed	   	Seed of the random numbers of the sample.
+	 * @param 		  	background 	Color of pixels whose view ray hits nothing.
+	 * @param [in,out]	film	   	Sums of the samples of every pixel.
+	 */
+	void renderSample(const BoundingVolumeHierarchy & accelerator, const RenderView & camera, const int & x, const int & y,
+					  const unsigned int & seed, const color & background, AccumulationBuffer & film);
+
+protected:
+
+	/**
+	 * @fn	int BidirectionalPathTracer::traceLightPath(const BoundingVolumeHierarchy & accelerator, RandomSequence & random, PathVertex * path) const;
+	 *
+	 * @brief	Traces a path from a light chosen by power.
+	 *
+	 * @returns	Number of vertices in the path, including the one on the light. Zero if there are
+	 * 			no lights.
+	 */
+	int traceLightPath(const BoundingVolumeHierarchy & accelerator, RandomSequence & random, PathVertex * path) const;
+
+
+	/**
+	 * @fn	int BidirectionalPathTracer::randomWalk(const BoundingVolumeHierarchy & accelerator, Ray ray, color throughput, double pdf, const bool & fromCamera, RandomSequence & random, PathVertex * path, const int & capacity) const;
+	 *
+	 * @brief	Extends a path by following a ray and scattering at every surface it hits.
+	 *
+	 * @param 		  	accelerator	Hierarchy containing the surfaces of the scene.
+	 * @param 		  	ray		   	Ray leaving the first vertex, which must already be set.
+	 * @param 		  	throughput 	Weight of the path after leaving the first vertex.
+	 * @param 		  	pdf		   	Density of the direction of the ray with respect to solid angle.
+	 * @param 		  	fromCamera 	True for paths from the camera. The radiance they gather is
+	 * 								scaled where they refract.
+	 * @param [in,out]	random	   	Source of random numbers.
+	 * @param [in,out]	path	   	Vertices of the path.
+	 * @param 		  	capacity   	Most vertices the path may have.
+	 *
+	 * @returns	Number of vertices in the path.
+	 */
+	int randomWalk(const BoundingVolumeHierarchy & accelerator, Ray ray, color throughput, double pdf,
+				   const bool & fromCamera, RandomSequence & random, PathVertex * path, const int & capacity) const;
+
+
+	/**
+	 * @fn	color BidirectionalPathTracer::connect(const BoundingVolumeHierarchy & accelerator, const RenderView & camera, PathVertex * lightPath, PathVertex * cameraPath, const int & s, const int & t, RandomSequence & random, int & pixelX, int & pixelY) const;
+	 *
+	 * @brief	Connects the first s vertices of the light path to the first t vertices of the
+	 * 			camera path and weighs the result against every other way of sampling the same
+	 * 			path. With one light vertex a new point on a light is chosen, and with one camera
+	 * 			vertex the light path is projected onto the image.
+	 *
+	 * @param [out]	pixelX	Column the connection lands on. Only set when t is one.
+	 * @param [out]	pixelY	Row the connection lands on. Only set when t is one.
+	 *
+	 * @returns	The weighted contribution. Black if the vertices cannot be connected.
+	 */
+	color connect(const BoundingVolumeHierarchy & accelerator, const RenderView & camera, PathVertex * lightPath,
+				  PathVertex * cameraPath, const int & s, const int & t, RandomSequence & random, int & pixelX, int & pixelY) const;
+
+
+	/**
+	 * @fn	double BidirectionalPathTracer::misWeight(const RenderView & camera, PathVertex * lightPath, PathVertex * cameraPath, const PathVertex & sampled, const int & s, const int & t) const;
+	 *
+	 * @brief	Power heuristic weight of a connection. The densities of the vertices next to the
+	 * 			connection are changed while the weight is computed and restored after.
+	 *
+	 * @param	sampled	Light vertex chosen by the connection when s is one.
+	 */
+	double misWeight(const RenderView & camera, PathVertex * lightPath, PathVertex * cameraPath, const PathVertex & sampled,
+					 const int & s, const int & t) const;
+
+
+	/**
+	 * @fn	bool BidirectionalPathTracer::sampleLight(RandomSequence & random, PathVertex & vertex) const;
+	 *
+	 * @brief	Chooses a light by power and a point on it.
+	 *
+	 * @param [in,out]	random	Source of random numbers.
+	 * @param [out]   	vertex	Light vertex. The throughput is one over the density of the point.
+	 *
+	 * @returns	False if there are no lights or no point could be chosen.
+	 */
+	bool sampleLight(RandomSequence & random, PathVertex & vertex) const;
+
+
+	/**
+	 * @fn	color BidirectionalPathTracer::evaluate(const RenderView & camera, const PathVertex & vertex, const PathVertex * previous, const PathVertex & next) const;
+	 *
+	 * @brief	Light scattered, emitted, or importance given off at a vertex toward the next one:
+	 * 			the BRDF of surfaces, the emitted radiance or intensity of lights, and the
+	 * 			importance of the camera.
+	 *
+	 * @param	previous	Vertex the path arrived from. nullptr for cameras and lights.
+	 */
+	color evaluate(const RenderView & camera, const PathVertex & vertex, const PathVertex * previous, const PathVertex & next) const;
+
+
+	/**
+	 * @fn	double BidirectionalPathTracer::pdf(const RenderView & camera, const PathVertex & vertex, const PathVertex * previous, const PathVertex & next) const;
+	 *
+	 * @brief	Density with respect to area with which a vertex chooses the next vertex.
+	 *
+	 * @param	previous	Vertex the path arrived from. nullptr for cameras and lights.
+	 */
+	double pdf(const RenderView & camera, const PathVertex & vertex, const PathVertex * previous, const PathVertex & next) const;
+
+
+	/**
+	 * @fn	double BidirectionalPathTracer::pdfLightOrigin(const PathVertex & vertex) const;
+	 *
+	 * @brief	Density with respect to area with which a light path starts at a vertex on a
+	 * 			light or an emissive surface.
+	 */
+	double pdfLightOrigin(const PathVertex & vertex) const;
+
+
+	/**
+	 * @fn	double BidirectionalPathTracer::pdfEmission(const PathVertex & vertex, const PathVertex & next) const;
+	 *
+	 * @brief	Density with respect to area with which light leaving a surface vertex that glows
+	 * 			reaches the next vertex.
+	 */
+	double pdfEmission(const PathVertex & vertex, const PathVertex & next) const;
+
+
+	/**
+	 * @fn	color BidirectionalPathTracer::getEmission(const PathVertex & vertex, const dvec3 & direction) const;
+	 *
+	 * @brief	Radiance given off by a surface vertex or light vertex in a direction. Intensity
+	 * 			for lights without an area.
+	 */
+	color getEmission(const PathVertex & vertex, const dvec3 & direction) const;
+
+
+	/**
+	 * @fn	double BidirectionalPathTracer::emissionPdf(const PathVertex & vertex, const dvec3 & direction) const;
+	 *
+	 * @brief	Density with respect to solid angle of the direction in which light leaves a light
+	 * 			vertex.
+	 */
+	double emissionPdf(const PathVertex & vertex, const dvec3 & direction) const;
+
+
+	/**
+	 * @fn	color BidirectionalPathTracer::getImportance(const RenderView & camera, const dvec3 & direction, double & pdf) const;
+	 *
+	 * @brief	Importance given off by the camera in a direction, normalized so that it
+	 * 			integrates to one over the image plane.
+	 *
+	 * @param 		  	camera   	The camera.
+	 * @param 		  	direction	Unit direction from the view point.
+	 * @param [out]	pdf		 	Density with respect to solid angle with which view rays
+	 * 							spread evenly over the image leave in the direction.
+	 *
+	 * @returns	The importance. Zero outside of the image.
+	 */
+	double getImportance(const RenderView & camera, const dvec3 & direction, double & pdf) const;
+
+
+	/**
+	 * @fn	color BidirectionalPathTracer::scatter(const PathVertex & vertex, const dvec3 & toPrevious, const dvec3 & toNext) const;
+	 *
+	 * @brief	BRDF of the Lambertian and Phong parts of the surface at a vertex.
+	 */
+	color scatter(const PathVertex & vertex, const dvec3 & toPrevious, const dvec3 & toNext) const;
+
+
+	/**
+	 * @fn	double BidirectionalPathTracer::scatterPdf(const PathVertex & vertex, const dvec3 & toPrevious, const dvec3 & toNext) const;
+	 *
+	 * @brief	Density with respect to solid angle with which sampleScatter chooses a direction
+	 * 			from the Lambertian and Phong parts of a surface.
+	 */
+	double scatterPdf(const PathVertex & vertex, const dvec3 & toPrevious, const dvec3 & toNext) const;
+
+
+	/**
+	 * @fn	bool BidirectionalPathTracer::sampleScatter(const PathVertex & vertex, const dvec3 & toPrevious, const bool & fromCamera, RandomSequence & random, dvec3 & direction, color & weight, double & pdfForward, double & pdfReverse, bool & delta) const;
+	 *
+	 * @brief	Chooses the direction in which a path leaves a surface vertex from one of the parts
+	 * 			of the surface, chosen in proportion to its reflectance.
+	 *
+	 * @param 		  	vertex	   	The vertex.
+	 * @param 		  	toPrevious 	Unit direction toward the vertex the path arrived from.
+	 * @param 		  	fromCamera 	True for paths from the camera.
+	 * @param [in,out]	random	   	Source of random numbers.
+	 * @param [out]   	direction  	Unit direction the path leaves in.
+	 * @param [out]   	weight	   	BRDF times cosine over density.
+	 * @param [out]   	pdfForward 	Density of the direction. Zero for mirror and dielectric
+	 * 								directions.
+	 * @param [out]   	pdfReverse 	Density of the opposite choice. Zero for mirror and
+	 * 								dielectric directions.
+	 * @param [out]   	delta	   	True if the direction was chosen by a mirror or dielectric.
+	 *
+	 * @returns	False if the path ends at the vertex.
+	 */
+	bool sampleScatter(const PathVertex & vertex, const dvec3 & toPrevious, const bool & fromCamera, RandomSequence & random,
+					   dvec3 & direction, color & weight, double & pdfForward, double & pdfReverse, bool & delta) const;
+
+
+	/** @returns	True if paths can be joined at a vertex. */
+	bool isConnectible(const PathVertex & vertex) const;
+
+	/** @returns	True if a vertex is on a light without an area, which paths cannot hit. */
+	bool isDeltaLight(const PathVertex & vertex) const
+	{
+		return vertex.type == LIGHT_VERTEX && sources[vertex.source].light != nullptr;
+	}
+
+	/**
+	 * @struct	Source
+	 *
+	 * @brief	A light or an emitter. Exactly one is set.
+	 */
+	struct Source
+	{
+		/** @brief	Point or spot light */
+		shared_ptr<PositionalLight> light;
+
+		/** @brief	Spot light, also set as light */
+		shared_ptr<SpotLight> spot;
+
+		/** @brief	Emissive surface. Owned by the surfaces of the scene. */
+		ImplicitSurface * emitter = nullptr;
+	};
+
+	/**
+	 * @struct	PathArena
+	 *
+	 * @brief	Vertices of the paths of the sample a thread is working on.
+	 */
+	struct PathArena
+	{
+		/** @brief	Vertices of the path from the light */
+		std::vector<PathVertex> lightPath;
+
+		/** @brief	Vertices of the path from the camera */
+		std::vector<PathVertex> cameraPath;
+	};
+
+	/** @brief	Lights followed by emitters */
+	std::vector<Source> sources;
+
+	/** @brief	Chooses sources in proportion to their power */
+	AliasTable distribution;
+
+	/** @brief	Sum of the powers of the sources */
+	double totalPower = 0.0;
+
+	/** @brief	Shininess at or above which reflective surfaces are perfect mirrors */
+	double mirrorCutoff = 128.0;
+
+	/** @brief	Most surfaces a path may bounce off */
+	int maxBounces = 5;
+
+	/** @brief	Path vertices of each rendering thread */
+	std::vector<PathArena> arenas;
+
+}; // end BidirectionalPathTracer class
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Defines.h"
+#include "Ray.h"
+
+/**
+ * @struct	BoundingBox
+ *
+ * @brief	Axis aligned bounding box. Used to bound surfaces in the bounding volume hierarchy.
+ * 			A default constructed box is empty. Surfaces that extend infinitely (planes and most
+ * 			quadrics) report an unbounded box.
+ */
+struct BoundingBox
+{
+	/** @brief	Corner of the box with the smallest x, y, and z values */
+	dvec3 minCorner = dvec3(INFINITY, INFINITY, INFINITY);
+
+	/** @brief	Corner of the box with the largest x, y, and z values */
+	dvec3 maxCorner = dvec3(-INFINITY, -INFINITY, -INFINITY);
+
+	BoundingBox() {}
+
+	BoundingBox(const dvec3 & minCorner, const dvec3 & maxCorner)
+		: minCorner(minCorner), maxCorner(maxCorner)
+	{
+	}
+
+	/**
+	 * @fn	static BoundingBox BoundingBox::unbounded()
+	 *
+	 * @brief	Box that contains all of space. Returned by surfaces that extend infinitely.
+	 *
+	 * @returns	The unbounded box.
+	 */
+	static BoundingBox unbounded()
+	{
+		return BoundingBox(dvec3(-INFINITY, -INFINITY, -INFINITY), dvec3(INFINITY, INFINITY, INFINITY));
+	}
+
+	/** @returns	True if no points have been added to the box. */
+	bool isEmpty() const { return minCorner.x > maxCorner.x; }
+
+	/** @returns	True if the box has a finite extent along every axis. */
+	bool isBounded() const
+	{
+		return !isEmpty() &&
+			glm::all(glm::lessThan(glm::abs(minCorner), dvec3(INFINITY))) &&
+			glm::all(glm::lessThan(glm::abs(maxCorner), dvec3(INFINITY)));
+	}
+
+	/** @brief	Grows the box to contain a point. */
+	void expand(const dvec3 & point)
+	{
+		minCorner = glm::min(minCorner, point);
+		maxCorner = glm::max(maxCorner, point);
+	}
+
+	/** @brief	Grows the box to contain another box. */
+	void expand(const BoundingBox & box)
+	{
+		minCorner = glm::min(minCorner, box.minCorner);
+		maxCorner = glm::max(maxCorner, box.maxCorner);
+	}
+
+	/** @returns	True if the box and another box share any points. */
+	bool overlaps(const BoundingBox & box) const
+	{
+		return glm::all(glm::lessThanEqual(minCorner, box.maxCorner)) &&
+			glm::all(glm::lessThanEqual(box.minCorner, maxCorner));
+	}
+
+	/**
+	 * @fn	BoundingBox BoundingBox::clip(const BoundingBox & region) const
+	 *
+	 * @brief	Part of the box that lies inside of another box.
+	 *
+	 * @param	region	The other box.
+	 *
+	 * @returns	The shared part. Empty if the boxes do not overlap.
+	 */
+	BoundingBox clip(const BoundingBox & region) const
+	{
+		if (!overlaps(region)) {
+			return BoundingBox();
+		}
+
+		return BoundingBox(glm::max(minCorner, region.minCorner), glm::min(maxCorner, region.maxCorner));
+	}
+
+	/** @returns	Center of the box. */
+	dvec3 centroid() const { return 0.5 * (minCorner + maxCorner); }
+
+	/** @returns	Surface area of the box. Zero for an empty box. */
+	double surfaceArea() const
+	{
+		if (isEmpty()) {
+			return 0.0;
+		}
+
+		dvec3 d = maxCorner - minCorner;
+
+		return 2.0 * (d.x * d.y + d.x * d.z + d.y * d.z);
+	}
+
+	/**
+	 * @fn	static BoundingBox BoundingBox::lerp(const BoundingBox & a, const BoundingBox & b, const double & s)
+	 *
+	 * @brief	Linearly interpolates the corners of two boxes. For surfaces that move linearly
+	 * 			between two boxes, the interpolated box bounds the surface at the intermediate time.
+	 *
+	 * @param	a	Box at s = 0.
+	 * @param	b	Box at s = 1.
+	 * @param	s	Interpolation parameter.
+	 *
+	 * @returns	The interpolated box.
+	 */
+	static BoundingBox lerp(const BoundingBox & a, const BoundingBox & b, const double & s)
+	{
+		return BoundingBox(glm::mix(a.minCorner, b.minCorner, s), glm::mix(a.maxCorner, b.maxCorner, s));
+	}
+
+	/**
+	 * @fn	bool BoundingBox::intersect(const dvec3 & origin, const dvec3 & inverseDirection, const double & tMax, double & tEntry) const
+	 *
+	 * @brief	Slab test of a ray against the box.
+	 *
+	 * @param 		  	origin		  	Origin of the ray.
+	 * @param 		  	inverseDirection	Component-wise reciprocal of the ray direction.
+	 * @param 		  	tMax		  	Hits beyond this parameter are ignored.
+	 * @param [out]	tEntry		  	Parameter at which the ray enters the box.
+	 *
+	 * @returns	True if the ray passes through the box between 0 and tMax.
+	 */
+	bool intersect(const dvec3 & origin, const dvec3 & inverseDirection, const double & tMax, double & tEntry) const
+	{
+		dvec3 t0 = (minCorner - origin) * inverseDirection;
+		dvec3 t1 = (maxCorner - origin) * inverseDirection;
+
+		dvec3 tNear = glm::min(t0, t1);
+		dvec3 tFar = glm::max(t0, t1);
+
+		tEntry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0));
+		double tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+
+		return tEntry <= tExit;
+	}
+
+}; // end BoundingBox struct
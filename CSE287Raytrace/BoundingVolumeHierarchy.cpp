@@ -0,0 +1,1151 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <queue>
+
+// Relative cost of visiting an interior node compared to intersecting a surface
+static const double TRAVERSAL_COST = 0.125;
+
+// Depth of the traversal stack. The builder keeps every tree shallow enough for it.
+static const int TRAVERSAL_STACK_SIZE = 64;
+
+// Deepest level a leaf may be built at, counting the root as level zero. A traversal holds at
+// most one entry per level plus the two children of the node it is at.
+static const int MAX_TREE_DEPTH = TRAVERSAL_STACK_SIZE - 2;
+
+// Spatial splits are tried when the sides of the best object split overlap by more than this
+// fraction of the area of the bounds of the whole scene
+static const double SPATIAL_SPLIT_OVERLAP = 1e-5;
+
+// Deepest node at which a spatial split is tried
+static const int MAX_SPATIAL_SPLIT_DEPTH = 48;
+
+// Fraction of the interior nodes removed and inserted again in each batch of the optimization
+static const double REINSERTION_BATCH_FRACTION = 0.01;
+
+// Number of batches in a row that may fail to lower the cost before the optimization stops
+static const int REINSERTION_PATIENCE = 3;
+
+
+void BoundingVolumeHierarchy::build(const SurfaceVector& surfaces)
+{
+	nodes.clear();
+	orderedSurfaces.clear();
+	orderedIds.clear();
+	hasDuplicates = false;
+	optimizationReport = OptimizationReport();
+	replicas.clear();
+	unboundedSurfaces.clear();
+	unboundedIds.clear();
+
+	std::vector<BuildReference> references;
+	references.reserve(surfaces.size());
+
+	for (int i = 0; i < (int)surfaces.size(); i++) {
+
+		// Surfaces that no ray can see are left out entirely
+		if (surfaces[i]->visibility == 0) {
+			continue;
+		}
+
+		BuildReference ref;
+		ref.surfaceIndex = i;
+		ref.visibility = surfaces[i]->visibility;
+		ref.openBounds = surfaces[i]->getBounds(0.0);
+		ref.closeBounds = surfaces[i]->getBounds(1.0);
+
+		if (ref.openBounds.isBounded() && ref.closeBounds.isBounded()) {
+
+			BoundingBox sweep = ref.openBounds;
+			sweep.expand(ref.closeBounds);
+			ref.centroid = sweep.centroid();
+
+			references.push_back(ref);
+		}
+		else {
+			unboundedSurfaces.push_back(surfaces[i]);
+			unboundedIds.push_back(i);
+		}
+	}
+
+	if (references.empty()) {
+		return;
+	}
+
+	nodes.reserve(2 * references.size());
+
+	int duplicateBudget = (int)(spatialSplitBudget * references.size());
+
+	// Overlaps are measured against the whole scene, so spatial splits are kept to the upper
+	// levels where large surfaces cross many others
+	BoundingBox sceneBounds;
+	for (const BuildReference& ref : references) {
+		sceneBounds.expand(ref.openBounds);
+	}
+	minSpatialOverlap = SPATIAL_SPLIT_OVERLAP * sceneBounds.surfaceArea();
+
+	// Index of the surface of each reference in leaf order. Split surfaces appear once per leaf.
+	std::vector<int> leafSurfaces;
+	leafSurfaces.reserve(references.size());
+
+	buildNode(references, surfaces, 0, duplicateBudget, leafSurfaces);
+
+	int root = 0;
+	if (optimizationTime > 0.0) {
+		optimize(root);
+	}
+
+	layOut(root);
+
+	orderedSurfaces.reserve(leafSurfaces.size());
+	for (int surfaceIndex : leafSurfaces) {
+		orderedSurfaces.push_back(surfaces[surfaceIndex]);
+	}
+	orderedIds = leafSurfaces;
+	hasDuplicates = leafSurfaces.size() > references.size();
+
+	// Each memory node gets a copy placed on it, so no thread traverses remote memory
+	replicas.clear();
+
+	int nodeCount = NumaMemory::getNodeCount();
+	if (replication && nodeCount > 1) {
+		for (int node = 0; node < nodeCount; node++) {
+			replicas.push_back(NodeArray(nodes.begin(), nodes.end(), NodeAllocator<BVHNode>(node)));
+		}
+	}
+
+} // end build
+
+
+int BoundingVolumeHierarchy::buildNode(std::vector<BuildReference>& references, const SurfaceVector& surfaces,
+									   const int& depth, int& duplicateBudget, std::vector<int>& leafSurfaces)
+{
+	int nodeIndex = (int)nodes.size();
+	nodes.push_back(BVHNode());
+
+	BoundingBox openBounds, closeBounds, centroidBounds;
+	unsigned int visibility = 0;
+	bool moving = false;
+	for (const BuildReference& ref : references) {
+		openBounds.expand(ref.openBounds);
+		closeBounds.expand(ref.closeBounds);
+		centroidBounds.expand(ref.centroid);
+		visibility |= ref.visibility;
+		moving = moving || ref.openBounds.minCorner != ref.closeBounds.minCorner ||
+			ref.openBounds.maxCorner != ref.closeBounds.maxCorner;
+	}
+
+	nodes[nodeIndex].openBounds = openBounds;
+	nodes[nodeIndex].closeBounds = closeBounds;
+	nodes[nodeIndex].visibility = visibility;
+
+	int count = (int)references.size();
+	double leafCost = (double)count;
+	double parentArea = motionArea(openBounds, closeBounds);
+
+	// Near the depth limit the references are split at the median, which builds the rest of the
+	// subtree in as few levels as it can be. Splits above this node left room for that.
+	int medianLevels = 0;
+	while ((1 << medianLevels) < count) {
+		medianLevels++;
+	}
+	bool depthLimited = depth + medianLevels >= MAX_TREE_DEPTH;
+
+	// Evaluate binned split candidates along every axis
+	double bestCost = INFINITY;
+	int bestAxis = -1;
+	int bestBin = -1;
+
+	// Overlap of the two sides of the best object split, at shutter open
+	BoundingBox bestOverlap;
+
+	for (int axis = 0; axis < 3 && count > 1; axis++) {
+
+		double axisMin = centroidBounds.minCorner[axis];
+		double axisExtent = centroidBounds.maxCorner[axis] - axisMin;
+
+		if (axisExtent <= 0.0) {
+			continue;
+		}
+
+		BoundingBox binOpen[SAH_BIN_COUNT], binClose[SAH_BIN_COUNT];
+		int binCount[SAH_BIN_COUNT] = { 0 };
+
+		for (const BuildReference& ref : references) {
+			int bin = glm::min((int)(SAH_BIN_COUNT * (ref.centroid[axis] - axisMin) / axisExtent), SAH_BIN_COUNT - 1);
+			binOpen[bin].expand(ref.openBounds);
+			binClose[bin].expand(ref.closeBounds);
+			binCount[bin]++;
+		}
+
+		// Sweep from the right to find the area and count to the right of each split
+		double rightArea[SAH_BIN_COUNT];
+		int rightCount[SAH_BIN_COUNT];
+		BoundingBox rightOpen[SAH_BIN_COUNT];
+		BoundingBox sweepOpen, sweepClose;
+		int sweepCount = 0;
+		for (int bin = SAH_BIN_COUNT - 1; bin > 0; bin--) {
+			sweepOpen.expand(binOpen[bin]);
+			sweepClose.expand(binClose[bin]);
+			sweepCount += binCount[bin];
+			rightArea[bin] = motionArea(sweepOpen, sweepClose);
+			rightCount[bin] = sweepCount;
+			rightOpen[bin] = sweepOpen;
+		}
+
+		sweepOpen = BoundingBox();
+		sweepClose = BoundingBox();
+		sweepCount = 0;
+		for (int bin = 0; bin < SAH_BIN_COUNT - 1; bin++) {
+			sweepOpen.expand(binOpen[bin]);
+			sweepClose.expand(binClose[bin]);
+			sweepCount += binCount[bin];
+
+			if (sweepCount == 0 || rightCount[bin + 1] == 0) {
+				continue;
+			}
+
+			double cost = TRAVERSAL_COST +
+				(motionArea(sweepOpen, sweepClose) * sweepCount + rightArea[bin + 1] * rightCount[bin + 1]) / parentArea;
+
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+				bestOverlap = sweepOpen.clip(rightOpen[bin + 1]);
+			}
+		}
+	}
+
+	// Spatial splits are only worth trying where the sides of the best object split overlap
+	// noticeably. Moving surfaces are never split, since clipping their boxes at shutter open
+	// and close separately does not bound them in between.
+	double spatialCost = INFINITY;
+	int spatialAxis = -1;
+	int spatialBin = -1;
+
+	bool trySpatial = duplicateBudget > 0 && count > 1 && !moving && !depthLimited && depth < MAX_SPATIAL_SPLIT_DEPTH &&
+		(bestAxis < 0 || (!bestOverlap.isEmpty() && bestOverlap.surfaceArea() > minSpatialOverlap));
+
+	for (int axis = 0; axis < 3 && trySpatial; axis++) {
+
+		double axisMin = openBounds.minCorner[axis];
+		double binWidth = (openBounds.maxCorner[axis] - axisMin) / SAH_BIN_COUNT;
+
+		if (binWidth <= 0.0) {
+			continue;
+		}
+
+		BoundingBox binBounds[SAH_BIN_COUNT];
+		int entries[SAH_BIN_COUNT] = { 0 };
+		int exits[SAH_BIN_COUNT] = { 0 };
+
+		for (const BuildReference& ref : references) {
+
+			int first = glm::clamp((int)((ref.openBounds.minCorner[axis] - axisMin) / binWidth), 0, SAH_BIN_COUNT - 1);
+			int last = glm::clamp((int)((ref.openBounds.maxCorner[axis] - axisMin) / binWidth), first, SAH_BIN_COUNT - 1);
+
+			// Each bin holds only the part of the surface that lies inside of it. The outer bins
+			// reach the sides of the node however the widths round.
+			for (int bin = first; bin <= last; bin++) {
+				double low = bin == 0 ? -INFINITY : axisMin + bin * binWidth;
+				double high = bin == SAH_BIN_COUNT - 1 ? INFINITY : axisMin + (bin + 1) * binWidth;
+				BoundingBox slab = getSlab(openBounds, axis, low, high);
+				binBounds[bin].expand(clipReference(ref, surfaces, slab));
+			}
+
+			entries[first]++;
+			exits[last]++;
+		}
+
+		double rightArea[SAH_BIN_COUNT];
+		int rightCount[SAH_BIN_COUNT];
+		BoundingBox sweep;
+		int sweepCount = 0;
+		for (int bin = SAH_BIN_COUNT - 1; bin > 0; bin--) {
+			sweep.expand(binBounds[bin]);
+			sweepCount += exits[bin];
+			rightArea[bin] = sweep.surfaceArea();
+			rightCount[bin] = sweepCount;
+		}
+
+		sweep = BoundingBox();
+		sweepCount = 0;
+		for (int bin = 0; bin < SAH_BIN_COUNT - 1; bin++) {
+			sweep.expand(binBounds[bin]);
+			sweepCount += entries[bin];
+
+			int leftCount = sweepCount;
+			int rightSideCount = rightCount[bin + 1];
+
+			if (leftCount == 0 || rightSideCount == 0 || leftCount + rightSideCount - count > duplicateBudget) {
+				continue;
+			}
+
+			double cost = TRAVERSAL_COST + (sweep.surfaceArea() * leftCount + rightArea[bin + 1] * rightSideCount) / parentArea;
+
+			if (cost < spatialCost) {
+				spatialCost = cost;
+				spatialAxis = axis;
+				spatialBin = bin;
+			}
+		}
+	}
+
+	// Make a leaf if splitting does not pay off and the leaf is small enough
+	if (count == 1 || (count <= maxLeafSize && leafCost <= glm::min(bestCost, spatialCost))) {
+
+		nodes[nodeIndex].offset = (int)leafSurfaces.size();
+		nodes[nodeIndex].surfaceCount = count;
+
+		for (const BuildReference& ref : references) {
+			leafSurfaces.push_back(ref.surfaceIndex);
+		}
+
+		return nodeIndex;
+	}
+
+	std::vector<BuildReference> left, right;
+
+	if (spatialCost < bestCost) {
+
+		double axisMin = openBounds.minCorner[spatialAxis];
+		double binWidth = (openBounds.maxCorner[spatialAxis] - axisMin) / SAH_BIN_COUNT;
+		double position = axisMin + (spatialBin + 1) * binWidth;
+
+		BoundingBox leftRegion = getSlab(openBounds, spatialAxis, -INFINITY, position);
+		BoundingBox rightRegion = getSlab(openBounds, spatialAxis, position, INFINITY);
+
+		for (const BuildReference& ref : references) {
+
+			if (ref.openBounds.maxCorner[spatialAxis] <= position) {
+				left.push_back(ref);
+			}
+			else if (ref.openBounds.minCorner[spatialAxis] >= position) {
+				right.push_back(ref);
+			}
+			else {
+
+				// The surface is split in two. Either part may turn out to be empty once clipped.
+				BuildReference parts[2] = { ref, ref };
+				parts[0].openBounds = parts[0].closeBounds = clipReference(ref, surfaces, leftRegion);
+				parts[1].openBounds = parts[1].closeBounds = clipReference(ref, surfaces, rightRegion);
+
+				if (!parts[0].openBounds.isEmpty()) {
+					parts[0].centroid = parts[0].openBounds.centroid();
+					left.push_back(parts[0]);
+				}
+				if (!parts[1].openBounds.isEmpty()) {
+					parts[1].centroid = parts[1].openBounds.centroid();
+					right.push_back(parts[1]);
+				}
+			}
+		}
+
+		duplicateBudget -= glm::max((int)(left.size() + right.size()) - count, 0);
+	}
+
+	// Fall back on an object split if a spatial split left one side empty
+	if (left.empty() || right.empty()) {
+
+		left.clear();
+		right.clear();
+
+		int middle;
+
+		if (depthLimited) {
+
+			// Split at the median along the axis the centroids spread farthest on
+			dvec3 extent = centroidBounds.maxCorner - centroidBounds.minCorner;
+			int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+			middle = count / 2;
+
+			std::nth_element(references.begin(), references.begin() + middle, references.end(),
+				[axis](const BuildReference& a, const BuildReference& b) {
+					return a.centroid[axis] < b.centroid[axis];
+				});
+		}
+		else if (bestAxis >= 0) {
+
+			double axisMin = centroidBounds.minCorner[bestAxis];
+			double axisExtent = centroidBounds.maxCorner[bestAxis] - axisMin;
+
+			auto split = std::partition(references.begin(), references.end(),
+				[&](const BuildReference& ref) {
+					int bin = glm::min((int)(SAH_BIN_COUNT * (ref.centroid[bestAxis] - axisMin) / axisExtent), SAH_BIN_COUNT - 1);
+					return bin <= bestBin;
+				});
+
+			middle = (int)(split - references.begin());
+		}
+		else {
+
+			// All centroids coincide. Split the range in half.
+			middle = count / 2;
+		}
+
+		left.assign(references.begin(), references.begin() + middle);
+		right.assign(references.begin() + middle, references.end());
+	}
+
+	// The references of this node are no longer needed while its subtrees are built
+	std::vector<BuildReference>().swap(references);
+
+	buildNode(left, surfaces, depth + 1, duplicateBudget, leafSurfaces);
+	int secondChild = buildNode(right, surfaces, depth + 1, duplicateBudget, leafSurfaces);
+
+	nodes[nodeIndex].firstChild = nodeIndex + 1;
+	nodes[nodeIndex].offset = secondChild;
+	nodes[nodeIndex].surfaceCount = 0;
+
+	return nodeIndex;
+
+} // end buildNode
+
+
+void BoundingVolumeHierarchy::optimize(int& root)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto deadline = start + std::chrono::duration<double>(optimizationTime);
+
+	int nodeCount = (int)nodes.size();
+
+	std::vector<int> parents(nodeCount, -1);
+	for (int i = 0; i < nodeCount; i++) {
+		if (!nodes[i].isLeaf()) {
+			parents[nodes[i].firstChild] = i;
+			parents[nodes[i].offset] = i;
+		}
+	}
+
+	auto area = [&](const int& node) { return motionArea(nodes[node].openBounds, nodes[node].closeBounds); };
+
+	// Replaces one child of a node with another node
+	auto replaceChild = [&](const int& parent, const int& oldChild, const int& newChild) {
+		if (nodes[parent].firstChild == oldChild) {
+			nodes[parent].firstChild = newChild;
+		}
+		else {
+			nodes[parent].offset = newChild;
+		}
+		parents[newChild] = parent;
+	};
+
+	double bestCost = getSAHCost();
+	NodeArray bestNodes = nodes;
+
+	optimizationReport.initialCost = bestCost;
+	int bestRoot = root;
+
+	int batchSize = glm::max((int)(REINSERTION_BATCH_FRACTION * nodeCount / 2), 1);
+	int failures = 0;
+
+	while (failures < REINSERTION_PATIENCE && std::chrono::steady_clock::now() < deadline) {
+
+		// Nodes that enclose a lot of space their children do not use come first (the combined
+		// measure of Bittner et al.)
+		std::vector<std::pair<double, int>> candidates;
+		for (int i = 0; i < nodeCount; i++) {
+
+			if (nodes[i].isLeaf() || i == root || parents[i] == root) {
+				continue;
+			}
+
+			double nodeArea = area(i);
+			double firstArea = area(nodes[i].firstChild);
+			double secondArea = area(nodes[i].offset);
+			double smallest = glm::max(glm::min(firstArea, secondArea), 1e-300);
+
+			double inefficiency = nodeArea * (2.0 * nodeArea / glm::max(firstArea + secondArea, 1e-300)) * (nodeArea / smallest);
+			candidates.push_back(std::make_pair(inefficiency, i));
+		}
+
+		if (candidates.empty()) {
+			break;
+		}
+
+		int batch = glm::min(batchSize, (int)candidates.size());
+		std::partial_sort(candidates.begin(), candidates.begin() + batch, candidates.end(),
+			[](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first > b.first; });
+
+		for (int c = 0; c < batch && std::chrono::steady_clock::now() < deadline; c++) {
+
+			int node = candidates[c].second;
+
+			// Earlier reinsertions may have moved the node next to the root
+			if (nodes[node].isLeaf() || node == root || parents[node] == root) {
+				continue;
+			}
+
+			// Take the node and its parent out, leaving its sibling in the place of the parent
+			int parent = parents[node];
+			int sibling = nodes[parent].firstChild == node ? nodes[parent].offset : nodes[parent].firstChild;
+			int grandparent = parents[parent];
+
+			replaceChild(grandparent, parent, sibling);
+			refit(grandparent, parents);
+
+			// The two freed nodes become the parents of the children where they go back in
+			int orphans[2] = { nodes[node].firstChild, nodes[node].offset };
+			int freed[2] = { node, parent };
+
+			if (area(orphans[1]) > area(orphans[0])) {
+				std::swap(orphans[0], orphans[1]);
+			}
+
+			for (int k = 0; k < 2; k++) {
+
+				int target = findBestSibling(root, orphans[k]);
+				int targetParent = parents[target];
+				int joined = freed[k];
+
+				nodes[joined].surfaceCount = 0;
+				nodes[joined].firstChild = target;
+				nodes[joined].offset = orphans[k];
+				parents[target] = joined;
+				parents[orphans[k]] = joined;
+
+				if (targetParent < 0) {
+					root = joined;
+					parents[joined] = -1;
+				}
+				else {
+					replaceChild(targetParent, target, joined);
+				}
+
+				refit(joined, parents);
+			}
+		}
+
+		// The root is not always the first node, so the cost is measured from it. Trees too deep
+		// for the traversal stack are never kept.
+		double cost = 0.0;
+		double rootArea = glm::max(area(root), 1e-300);
+		int maxDepth = 0;
+
+		std::vector<std::pair<int, int>> stack = { std::make_pair(root, 1) };
+		while (!stack.empty()) {
+
+			int node = stack.back().first;
+			int depth = stack.back().second;
+			stack.pop_back();
+
+			maxDepth = glm::max(maxDepth, depth);
+			cost += area(node) / rootArea * (nodes[node].isLeaf() ? nodes[node].surfaceCount : TRAVERSAL_COST);
+
+			if (!nodes[node].isLeaf()) {
+				stack.push_back(std::make_pair(nodes[node].firstChild, depth + 1));
+				stack.push_back(std::make_pair(nodes[node].offset, depth + 1));
+			}
+		}
+
+		if (cost < bestCost && maxDepth < TRAVERSAL_STACK_SIZE) {
+			bestCost = cost;
+			bestNodes = nodes;
+			bestRoot = root;
+			failures = 0;
+		}
+		else {
+			failures++;
+		}
+	}
+
+	nodes = bestNodes;
+	root = bestRoot;
+
+	optimizationReport.finalCost = bestCost;
+	optimizationReport.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+} // end optimize
+
+
+int BoundingVolumeHierarchy::findBestSibling(const int& root, const int& inserted) const
+{
+	const BVHNode& subtree = nodes[inserted];
+	double insertedArea = motionArea(subtree.openBounds, subtree.closeBounds);
+
+	// Nodes still to search with the area their ancestors would grow by
+	std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>, std::greater<std::pair<double, int>>> queue;
+	queue.push(std::make_pair(0.0, root));
+
+	double bestCost = INFINITY;
+	int best = root;
+
+	while (!queue.empty()) {
+
+		double induced = queue.top().first;
+		int node = queue.top().second;
+		queue.pop();
+
+		// Every node below grows the ancestors at least this much
+		if (induced + insertedArea >= bestCost) {
+			break;
+		}
+
+		BoundingBox open = nodes[node].openBounds, close = nodes[node].closeBounds;
+		double nodeArea = motionArea(open, close);
+
+		open.expand(subtree.openBounds);
+		close.expand(subtree.closeBounds);
+		double joinedArea = motionArea(open, close);
+
+		double cost = induced + joinedArea;
+		if (cost < bestCost) {
+			bestCost = cost;
+			best = node;
+		}
+
+		double childInduced = cost - nodeArea;
+		if (!nodes[node].isLeaf() && childInduced + insertedArea < bestCost) {
+			queue.push(std::make_pair(childInduced, nodes[node].firstChild));
+			queue.push(std::make_pair(childInduced, nodes[node].offset));
+		}
+	}
+
+	return best;
+
+} // end findBestSibling
+
+
+void BoundingVolumeHierarchy::refit(int node, const std::vector<int>& parents)
+{
+	while (node >= 0) {
+
+		const BVHNode& first = nodes[nodes[node].firstChild];
+		const BVHNode& second = nodes[nodes[node].offset];
+
+		BoundingBox open = first.openBounds, close = first.closeBounds;
+		open.expand(second.openBounds);
+		close.expand(second.closeBounds);
+
+		nodes[node].openBounds = open;
+		nodes[node].closeBounds = close;
+		nodes[node].visibility = first.visibility | second.visibility;
+
+		node = parents[node];
+	}
+
+} // end refit
+
+
+void BoundingVolumeHierarchy::layOut(const int& root)
+{
+	NodeArray laidOut;
+	laidOut.reserve(nodes.size());
+
+	// New index of every node
+	std::vector<int> placed(nodes.size(), -1);
+
+	placed[root] = 0;
+	laidOut.push_back(nodes[root]);
+
+	// Nodes whose children still have to be placed
+	std::vector<int> pending = { root };
+
+	while (!pending.empty()) {
+
+		int top = pending.back();
+		pending.pop_back();
+
+		// Levels below the node, breadth first, so that siblings are side by side
+		std::vector<int> level = { top };
+
+		for (int depth = 0; depth < TREELET_DEPTH && !level.empty(); depth++) {
+
+			std::vector<int> next;
+
+			for (int node : level) {
+
+				if (nodes[node].isLeaf()) {
+					continue;
+				}
+
+				for (int child : { nodes[node].firstChild, nodes[node].offset }) {
+					placed[child] = (int)laidOut.size();
+					laidOut.push_back(nodes[child]);
+					next.push_back(child);
+				}
+			}
+
+			level.swap(next);
+		}
+
+		// Treelets below the last level are placed in order, the first one next
+		for (int i = (int)level.size() - 1; i >= 0; i--) {
+			if (!nodes[level[i]].isLeaf()) {
+				pending.push_back(level[i]);
+			}
+		}
+	}
+
+	for (BVHNode& node : laidOut) {
+		if (!node.isLeaf()) {
+			node.firstChild = placed[node.firstChild];
+			node.offset = placed[node.offset];
+		}
+	}
+
+	nodes.swap(laidOut);
+
+} // end layOut
+
+
+BoundingBox BoundingVolumeHierarchy::getSlab(const BoundingBox& box, const int& axis, const double& low, const double& high)
+{
+	BoundingBox slab = box;
+	slab.minCorner[axis] = glm::max(slab.minCorner[axis], low);
+	slab.maxCorner[axis] = glm::min(slab.maxCorner[axis], high);
+
+	return slab;
+
+} // end getSlab
+
+
+BoundingBox BoundingVolumeHierarchy::clipReference(const BuildReference& ref, const SurfaceVector& surfaces,
+												   const BoundingBox& region)
+{
+	// The reference may already have been clipped by splits above this node
+	return surfaces[ref.surfaceIndex]->getClippedBounds(region.clip(ref.openBounds));
+
+} // end clipReference
+
+
+double BoundingVolumeHierarchy::getSAHCost() const
+{
+	if (nodes.empty()) {
+		return 0.0;
+	}
+
+	double rootArea = motionArea(nodes[0].openBounds, nodes[0].closeBounds);
+	double cost = 0.0;
+
+	for (const BVHNode& node : nodes) {
+
+		double area = rootArea > 0.0 ? motionArea(node.openBounds, node.closeBounds) / rootArea : 1.0;
+		cost += area * (node.isLeaf() ? node.surfaceCount : TRAVERSAL_COST);
+	}
+
+	return cost;
+
+} // end getSAHCost
+
+
+/**
+ * @fn	static void countHit(ObjectProfiler::ThreadCounts * counts, const int & surface)
+ *
+ * @brief	Records the closest hit of a ray in the counts of the thread that traced it.
+ *
+ * @param [in,out]	counts 	Counts of the thread. Null when profiling is off.
+ * @param 		  	surface	Surface hit. -1 if the ray missed.
+ */
+static void countHit(ObjectProfiler::ThreadCounts* counts, const int& surface)
+{
+	if (counts != nullptr) {
+
+		counts->lastHit = surface;
+
+		if (surface >= 0) {
+			counts->hits[surface]++;
+		}
+	}
+
+} // end countHit
+
+
+HitRecord BoundingVolumeHierarchy::findClosestIntersection(const Ray& ray) const
+{
+	HitRecord closestHit;
+	closestHit.t = INFINITY;
+
+	ObjectProfiler::ThreadCounts* counts = profiler != nullptr ? profiler->getThreadCounts() : nullptr;
+	int closestId = -1;
+
+	for (int i = 0; i < (int)unboundedSurfaces.size(); i++) {
+		if (unboundedSurfaces[i]->visibility & ray.type) {
+
+			if (counts != nullptr) {
+				counts->tests[unboundedIds[i]]++;
+			}
+
+			HitRecord hit = unboundedSurfaces[i]->findIntersect(ray, getOriginTerms(ray, unboundedIds[i]));
+			if (hit.t < closestHit.t) {
+				closestHit = hit;
+				closestId = unboundedIds[i];
+			}
+		}
+	}
+
+	if (nodes.empty()) {
+		countHit(counts, closestId);
+		return closestHit;
+	}
+
+	const BVHNode* nodeData = getLocalNodes();
+
+	dvec3 inverseDirection = 1.0 / ray.direct;
+
+	// Nodes waiting to be visited along with the distance at which the ray enters them
+	int stack[TRAVERSAL_STACK_SIZE];
+	double stackEntry[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+
+	double tRoot;
+	if ((nodeData[0].visibility & ray.type) &&
+		nodeData[0].getBounds(ray.time).intersect(ray.origin, inverseDirection, closestHit.t, tRoot)) {
+		stack[stackSize] = 0;
+		stackEntry[stackSize++] = tRoot;
+	}
+
+	while (stackSize > 0) {
+
+		stackSize--;
+
+		// Skip nodes that are farther away than an intersection found since they were pushed
+		if (stackEntry[stackSize] > closestHit.t) {
+			continue;
+		}
+
+		int nodeIndex = stack[stackSize];
+		const BVHNode& node = nodeData[nodeIndex];
+
+		if (node.isLeaf()) {
+
+			for (int i = node.offset; i < node.offset + node.surfaceCount; i++) {
+				if (orderedSurfaces[i]->visibility & ray.type) {
+
+					if (counts != nullptr) {
+						counts->tests[orderedIds[i]]++;
+					}
+
+					HitRecord hit = orderedSurfaces[i]->findIntersect(ray, getOriginTerms(ray, orderedIds[i]));
+					if (hit.t < closestHit.t) {
+						closestHit = hit;
+						closestId = orderedIds[i];
+					}
+				}
+			}
+		}
+		else {
+
+			// Visit the nearer child first so that farther subtrees can be pruned
+			int first = node.firstChild;
+			int second = node.offset;
+
+			double tFirst, tSecond;
+			bool hitFirst = (nodeData[first].visibility & ray.type) &&
+				nodeData[first].getBounds(ray.time).intersect(ray.origin, inverseDirection, closestHit.t, tFirst);
+			bool hitSecond = (nodeData[second].visibility & ray.type) &&
+				nodeData[second].getBounds(ray.time).intersect(ray.origin, inverseDirection, closestHit.t, tSecond);
+
+			if (hitFirst && hitSecond && tSecond < tFirst) {
+				std::swap(first, second);
+				std::swap(tFirst, tSecond);
+			}
+			if (hitSecond) {
+				stack[stackSize] = second;
+				stackEntry[stackSize++] = tSecond;
+			}
+			if (hitFirst) {
+				stack[stackSize] = first;
+				stackEntry[stackSize++] = tFirst;
+			}
+		}
+	}
+
+	countHit(counts, closestId);
+
+	return closestHit;
+
+} // end findClosestIntersection
+
+
+bool BoundingVolumeHierarchy::isOccluded(const Ray& ray, const double& maxDistance) const
+{
+	ObjectProfiler::ThreadCounts* counts = profiler != nullptr ? profiler->getThreadCounts() : nullptr;
+
+	for (int i = 0; i < (int)unboundedSurfaces.size(); i++) {
+		if (unboundedSurfaces[i]->visibility & ray.type) {
+
+			if (counts != nullptr) {
+				counts->tests[unboundedIds[i]]++;
+			}
+
+			if (unboundedSurfaces[i]->findIntersect(ray, getOriginTerms(ray, unboundedIds[i])).t < maxDistance) {
+				return true;
+			}
+		}
+	}
+
+	if (nodes.empty()) {
+		return false;
+	}
+
+	const BVHNode* nodeData = getLocalNodes();
+
+	dvec3 inverseDirection = 1.0 / ray.direct;
+
+	int stack[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+
+		int nodeIndex = stack[--stackSize];
+		const BVHNode& node = nodeData[nodeIndex];
+
+		double tEntry;
+		if (!(node.visibility & ray.type) ||
+			!node.getBounds(ray.time).intersect(ray.origin, inverseDirection, maxDistance, tEntry)) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+
+			for (int i = node.offset; i < node.offset + node.surfaceCount; i++) {
+				if (orderedSurfaces[i]->visibility & ray.type) {
+
+					if (counts != nullptr) {
+						counts->tests[orderedIds[i]]++;
+					}
+
+					if (orderedSurfaces[i]->findIntersect(ray, getOriginTerms(ray, orderedIds[i])).t < maxDistance) {
+						return true;
+					}
+				}
+			}
+		}
+		else {
+			stack[stackSize++] = node.offset;
+			stack[stackSize++] = node.firstChild;
+		}
+	}
+
+	return false;
+
+} // end isOccluded
+
+
+void BoundingVolumeHierarchy::findOccluded(const ShadowFrustum& frustum, Ray feeler, const std::vector<dvec3>& directions,
+										   const std::vector<double>& maxDistances, std::vector<char>& occluded) const
+{
+	int count = (int)directions.size();
+
+	// Indices of the feelers that are still being traced
+	std::vector<int> active;
+	active.reserve(count * TRAVERSAL_STACK_SIZE);
+
+	for (int i = 0; i < count; i++) {
+		if (!occluded[i]) {
+			active.push_back(i);
+		}
+	}
+
+	ObjectProfiler::ThreadCounts* counts = profiler != nullptr ? profiler->getThreadCounts() : nullptr;
+
+	for (int u = 0; u < (int)unboundedSurfaces.size(); u++) {
+
+		const auto& surface = unboundedSurfaces[u];
+
+		if (!(surface->visibility & feeler.type)) {
+			continue;
+		}
+
+		for (int i : active) {
+
+			if (occluded[i]) {
+				continue;
+			}
+
+			if (counts != nullptr) {
+				counts->tests[unboundedIds[u]]++;
+			}
+
+			feeler.direct = directions[i];
+			if (surface->findIntersect(feeler, getOriginTerms(feeler, unboundedIds[u])).t < maxDistances[i]) {
+				occluded[i] = 1;
+			}
+		}
+	}
+
+	if (nodes.empty()) {
+		return;
+	}
+
+	const BVHNode* nodeData = getLocalNodes();
+
+	std::vector<dvec3> inverseDirections(count);
+	for (int i = 0; i < count; i++) {
+		inverseDirections[i] = 1.0 / directions[i];
+	}
+
+	// Each stack entry is a node and the range of active feelers that reached it. Ranges are
+	// appended to active, and everything past the range of a popped entry belongs to
+	// subtrees that have already been finished.
+	int stack[TRAVERSAL_STACK_SIZE];
+	int stackBegin[TRAVERSAL_STACK_SIZE];
+	int stackEnd[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+
+	stack[stackSize] = 0;
+	stackBegin[stackSize] = 0;
+	stackEnd[stackSize] = (int)active.size();
+	stackSize++;
+
+	while (stackSize > 0) {
+
+		stackSize--;
+		int nodeIndex = stack[stackSize];
+		const BVHNode& node = nodeData[nodeIndex];
+		int begin = stackBegin[stackSize];
+		int end = stackEnd[stackSize];
+
+		active.resize(end);
+
+		if (!(node.visibility & feeler.type) || !frustum.overlaps(node.openBounds)) {
+			continue;
+		}
+
+		BoundingBox bounds = node.getBounds(feeler.time);
+
+		// Keep the feelers that are unblocked and pass through the node
+		for (int j = begin; j < end; j++) {
+
+			int i = active[j];
+			double tEntry;
+
+			if (!occluded[i] && bounds.intersect(feeler.origin, inverseDirections[i], maxDistances[i], tEntry)) {
+				active.push_back(i);
+			}
+		}
+
+		if ((int)active.size() == end) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+
+			for (int s = node.offset; s < node.offset + node.surfaceCount; s++) {
+
+				if (!(orderedSurfaces[s]->visibility & feeler.type)) {
+					continue;
+				}
+
+				for (int j = end; j < (int)active.size(); j++) {
+
+					int i = active[j];
+					if (occluded[i]) {
+						continue;
+					}
+
+					if (counts != nullptr) {
+						counts->tests[orderedIds[s]]++;
+					}
+
+					feeler.direct = directions[i];
+					if (orderedSurfaces[s]->findIntersect(feeler, getOriginTerms(feeler, orderedIds[s])).t < maxDistances[i]) {
+						occluded[i] = 1;
+					}
+				}
+			}
+		}
+		else {
+
+			int childEnd = (int)active.size();
+
+			stack[stackSize] = node.offset;
+			stackBegin[stackSize] = end;
+			stackEnd[stackSize] = childEnd;
+			stackSize++;
+
+			stack[stackSize] = node.firstChild;
+			stackBegin[stackSize] = end;
+			stackEnd[stackSize] = childEnd;
+			stackSize++;
+		}
+	}
+
+} // end findOccluded
+
+
+template <class Region>
+void BoundingVolumeHierarchy::gatherSurfacesIn(const Region& region, const unsigned int& rayTypes, const double& time,
+											   std::vector<ImplicitSurface*>& found) const
+{
+	for (auto& surface : unboundedSurfaces) {
+		if (surface->visibility & rayTypes) {
+			found.push_back(surface.get());
+		}
+	}
+
+	if (nodes.empty()) {
+		return;
+	}
+
+	const BVHNode* nodeData = getLocalNodes();
+
+	// Positions in orderedSurfaces of the surfaces found. Kept from call to call to avoid allocating.
+	static thread_local std::vector<int> slots;
+	slots.clear();
+
+	int stack[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+
+		int nodeIndex = stack[--stackSize];
+		const BVHNode& node = nodeData[nodeIndex];
+
+		if (!(node.visibility & rayTypes) || !region.overlaps(node.getBounds(time))) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+
+			for (int i = node.offset; i < node.offset + node.surfaceCount; i++) {
+				if ((orderedSurfaces[i]->visibility & rayTypes) && region.overlaps(orderedSurfaces[i]->getBounds(time))) {
+					slots.push_back(i);
+				}
+			}
+		}
+		else {
+			stack[stackSize++] = node.offset;
+			stack[stackSize++] = node.firstChild;
+		}
+	}
+
+	// A surface split between leaves is found once per leaf. Callers combine the occlusion of
+	// every surface found, so each must be listed once. Sorting by surface keeps the order the
+	// same from run to run.
+	if (hasDuplicates) {
+
+		std::sort(slots.begin(), slots.end(), [this](const int& a, const int& b) { return orderedIds[a] < orderedIds[b]; });
+
+		slots.erase(std::unique(slots.begin(), slots.end(), [this](const int& a, const int& b) {
+			return orderedIds[a] == orderedIds[b];
+		}), slots.end());
+	}
+
+	for (int slot : slots) {
+		found.push_back(orderedSurfaces[slot].get());
+	}
+
+} // end gatherSurfacesIn
+
+
+void BoundingVolumeHierarchy::gatherSurfaces(const BoundingBox& region, const unsigned int& rayTypes, const double& time,
+											 std::vector<ImplicitSurface*>& found) const
+{
+	gatherSurfacesIn(region, rayTypes, time, found);
+
+} // end gatherSurfaces
+
+
+void BoundingVolumeHierarchy::gatherSurfaces(const ShadowFrustum& region, const unsigned int& rayTypes, const double& time,
+											 std::vector<ImplicitSurface*>& found) const
+{
+	gatherSurfacesIn(region, rayTypes, time, found);
+
+} // end gatherSurfaces
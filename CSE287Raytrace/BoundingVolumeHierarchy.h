@@ -0,0 +1,522 @@
+#pragma once
+
+#include "ImplicitSurface.h"
+#include "BoundingBox.h"
+#include "NumaMemory.h"
+#include "ObjectProfiler.h"
+#include "ShadowFrustum.h"
+#include "ThreadPool.h"
+
+/**
+ * @struct	BVHNode
+ *
+ * @brief	Node of a flattened bounding volume hierarchy. Nodes store the bounds of their
+ * 			surfaces at shutter open and at shutter close. Because surfaces move linearly during
+ * 			the shutter interval, interpolating the two boxes gives tight bounds for a ray at any
+ * 			time. Static subtrees have identical open and close bounds.
+ *
+ * 			The root is the first node. Nodes are grouped into small treelets whose nodes are
+ * 			stored together, with the two children of every node next to each other.
+ */
+struct BVHNode
+{
+	/** @brief	Bounds of all surfaces below the node at shutter open (time 0) */
+	BoundingBox openBounds;
+
+	/** @brief	Bounds of all surfaces below the node at shutter close (time 1) */
+	BoundingBox closeBounds;
+
+	/** @brief	Index of the second child for interior nodes. Index of the first surface for leaves. */
+	int offset = 0;
+
+	/** @brief	Index of the first child for interior nodes */
+	int firstChild = 0;
+
+	/** @brief	Number of surfaces in a leaf. Zero for interior nodes. */
+	int surfaceCount = 0;
+
+	/** @brief	Union of the visibility bits of all surfaces below the node. Rays whose type is not
+	included are not able to hit anything in the subtree. */
+	unsigned int visibility = 0;
+
+	/** @returns	True if the node is a leaf. */
+	bool isLeaf() const { return surfaceCount > 0; }
+
+	/**
+	 * @fn	BoundingBox BVHNode::getBounds(const double & time) const
+	 *
+	 * @brief	Bounds of the node at a time within the shutter interval.
+	 *
+	 * @param	time	Time within the shutter interval. 0 at open and 1 at close.
+	 *
+	 * @returns	The interpolated bounds.
+	 */
+	BoundingBox getBounds(const double & time) const
+	{
+		return time == 0.0 ? openBounds : BoundingBox::lerp(openBounds, closeBounds, time);
+	}
+};
+
+
+/**
+ * @class	BoundingVolumeHierarchy
+ *
+ * @brief	Acceleration structure for ray/surface intersection testing. Bounded surfaces are
+ * 			organized into a binary tree of axis aligned boxes built with the surface area
+ * 			heuristic. Unbounded surfaces (planes and infinite quadrics) are kept in a separate
+ * 			list and checked against every ray. Subtrees that contain no surface visible to the
+ * 			type of a ray are skipped.
+ *
+ * 			Spatial splits (Stich et al. 2009) may optionally be used where large surfaces make
+ * 			the children of a node overlap. A spatial split divides a node at a plane and
+ * 			places a surface that crosses the plane on both sides, clipped to each, so the
+ * 			same surface may appear in more than one leaf.
+ */
+class BoundingVolumeHierarchy
+{
+public:
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::build(const SurfaceVector & surfaces);
+	 *
+	 * @brief	Builds the hierarchy for a set of surfaces. Any previous hierarchy is discarded.
+	 * 			Must be called again whenever surfaces are added, removed, or moved.
+	 *
+	 * @param	surfaces	Surfaces to be organized.
+	 */
+	void build(const SurfaceVector & surfaces);
+
+
+	/**
+	 * @fn	HitRecord BoundingVolumeHierarchy::findClosestIntersection(const Ray & ray) const;
+	 *
+	 * @brief	Finds the closest intersection of a ray with any surface in the hierarchy.
+	 *
+	 * @param	ray	Ray being checked for intersection.
+	 *
+	 * @returns	HitRecord for the closest intersection, or a HitRecord with t of INFINITY.
+	 */
+	HitRecord findClosestIntersection(const Ray & ray) const;
+
+
+	/**
+	 * @fn	bool BoundingVolumeHierarchy::isOccluded(const Ray & ray, const double & maxDistance) const;
+	 *
+	 * @brief	Checks whether any surface intersects a ray closer than a given distance. Stops at
+	 * 			the first such intersection. Used for shadow feelers.
+	 *
+	 * @param	ray		   	Ray being checked for intersection.
+	 * @param	maxDistance	Intersections at or beyond this distance are ignored.
+	 *
+	 * @returns	True if an intersection closer than maxDistance exists.
+	 */
+	bool isOccluded(const Ray & ray, const double & maxDistance) const;
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::findOccluded(const ShadowFrustum & frustum, Ray feeler, const std::vector<dvec3> & directions, const std::vector<double> & maxDistances, std::vector<char> & occluded) const;
+	 *
+	 * @brief	Packet version of isOccluded for feelers that share an origin. Each node is first
+	 * 			tested against a frustum that contains all of the feelers. Nodes inside the frustum
+	 * 			are then tested against each feeler that is still active, and only the feelers
+	 * 			that enter a node are carried down to its children.
+	 *
+	 * @param 		  	frustum			Cone containing every feeler.
+	 * @param 		  	feeler			Origin, type, and shared origin of the feelers.
+	 * @param 		  	directions  	Direction of each feeler.
+	 * @param 		  	maxDistances	Intersections at or beyond this distance are ignored.
+	 * @param [in,out]	occluded		Set to nonzero for each feeler that is blocked. Feelers that
+	 * 									are already nonzero are not traced.
+	 */
+	void findOccluded(const ShadowFrustum & frustum, Ray feeler, const std::vector<dvec3> & directions,
+					  const std::vector<double> & maxDistances, std::vector<char> & occluded) const;
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::gatherSurfaces(const BoundingBox & region, const unsigned int & rayTypes, const double & time, std::vector<ImplicitSurface *> & found) const;
+	 *
+	 * @brief	Range query. Collects every surface visible to the given ray types whose bounds
+	 * 			overlap a region of space. Subtrees outside the region are skipped. Unbounded
+	 * 			surfaces are always collected. A surface divided by spatial splits is only
+	 * 			collected if one of its clipped parts overlaps the region, so it may be left out
+	 * 			when its bounds reach the region but its shape does not.
+	 *
+	 * @param 		  	region  	Region being searched.
+	 * @param 		  	rayTypes	RAY_TYPE bits. Surfaces invisible to all of them are skipped.
+	 * @param 		  	time		Time within the shutter interval at which moving surfaces are
+	 * 								located.
+	 * @param [in,out]	found   	Surfaces in the region are appended.
+	 */
+	void gatherSurfaces(const BoundingBox & region, const unsigned int & rayTypes, const double & time,
+						std::vector<ImplicitSurface *> & found) const;
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::gatherSurfaces(const ShadowFrustum & region, const unsigned int & rayTypes, const double & time, std::vector<ImplicitSurface *> & found) const;
+	 *
+	 * @brief	Range query over a cone. Collects every surface visible to the given ray types
+	 * 			whose bounds may overlap the cone. Unbounded surfaces are always collected.
+	 *
+	 * @param 		  	region  	Cone being searched.
+	 * @param 		  	rayTypes	RAY_TYPE bits. Surfaces invisible to all of them are skipped.
+	 * @param 		  	time		Time within the shutter interval at which moving surfaces are
+	 * 								located.
+	 * @param [in,out]	found   	Surfaces in the cone are appended.
+	 */
+	void gatherSurfaces(const ShadowFrustum & region, const unsigned int & rayTypes, const double & time,
+						std::vector<ImplicitSurface *> & found) const;
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::setMaxLeafSize(const int & maxLeafSize)
+	 *
+	 * @brief	Sets the largest number of surfaces that will be placed in a single leaf. Takes
+	 * 			effect the next time the hierarchy is built.
+	 *
+	 * @param	maxLeafSize	Maximum number of surfaces per leaf.
+	 */
+	void setMaxLeafSize(const int & maxLeafSize) { this->maxLeafSize = glm::max(maxLeafSize, 1); }
+
+	/** @returns	The largest number of surfaces placed in a single leaf. */
+	int getMaxLeafSize() const { return maxLeafSize; }
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::setSpatialSplits(const double & duplicateBudget)
+	 *
+	 * @brief	Allows spatial splits, which lower the cost of traversal where surfaces overlap
+	 * 			at the price of more references. Takes effect the next time the hierarchy is
+	 * 			built.
+	 *
+	 * @param	duplicateBudget	Most extra references as a fraction of the number of bounded
+	 * 							surfaces. Zero or less turns spatial splits off.
+	 */
+	void setSpatialSplits(const double & duplicateBudget) { this->spatialSplitBudget = glm::max(duplicateBudget, 0.0); }
+
+
+	/**
+	 * @fn	double BoundingVolumeHierarchy::getSAHCost() const;
+	 *
+	 * @brief	Expected cost of tracing a ray through the hierarchy under the surface area
+	 * 			heuristic, in units of surface intersections. Lower is better. Used to compare
+	 * 			build settings.
+	 *
+	 * @returns	The cost. Zero if no surface is bounded.
+	 */
+	double getSAHCost() const;
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::setOptimizationTime(const double & seconds)
+	 *
+	 * @brief	Sets the time spent improving the hierarchy after each build by removing the
+	 * 			least efficient nodes and inserting their children again where the surface area
+	 * 			heuristic says they cost least (Bittner et al. 2013). Stops sooner once nothing
+	 * 			improves. Takes effect the next time the hierarchy is built.
+	 *
+	 * @param	seconds	Most time spent in seconds. Zero or less turns the optimization off.
+	 */
+	void setOptimizationTime(const double & seconds) { this->optimizationTime = glm::max(seconds, 0.0); }
+
+
+	/**
+	 * @struct	OptimizationReport
+	 *
+	 * @brief	What the optimization achieved on the last build. Both costs are in the units of
+	 * 			getSAHCost. Their ratio is the traversal speedup the surface area heuristic expects.
+	 */
+	struct OptimizationReport
+	{
+		/** @brief	Cost of the tree as it was built */
+		double initialCost = 0.0;
+
+		/** @brief	Cost of the tree the optimization kept */
+		double finalCost = 0.0;
+
+		/** @brief	Time spent optimizing in seconds */
+		double seconds = 0.0;
+
+		/** @returns	Expected traversal speedup gained per second spent optimizing, as a fraction.
+		Zero if the optimization did not run. */
+		double getSpeedupPerSecond() const
+		{
+			return seconds > 0.0 && finalCost > 0.0 ? (initialCost / finalCost - 1.0) / seconds : 0.0;
+		}
+	};
+
+
+	/** @returns	The result of the optimization on the last build. All zero if it was off. */
+	const OptimizationReport & getOptimizationReport() const { return optimizationReport; }
+
+
+	/** @returns	Number of references held by the leaves. More than the number of bounded
+	surfaces when spatial splits have split some of them. */
+	int getReferenceCount() const { return (int)orderedSurfaces.size(); }
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::setObjectProfiler(ObjectProfiler * profiler)
+	 *
+	 * @brief	Sets the profiler that intersection tests and closest hits are counted in,
+	 * 			attributed to surfaces by their index in the list the hierarchy was built from.
+	 * 			Null turns counting off.
+	 */
+	void setObjectProfiler(ObjectProfiler * profiler) { this->profiler = profiler; }
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::setOriginTerms(const OriginTerms * terms, const int & originCount)
+	 *
+	 * @brief	Sets the origin terms the caller found for each surface and shared ray origin. Rays
+	 * 			with a shared origin pass the terms of each surface they are tested against to
+	 * 			ImplicitSurface::findIntersect. The caller owns the terms and keeps them alive for
+	 * 			as long as they are set.
+	 *
+	 * @param	terms	   	Terms of shared origin o for the surface at index s of the list the
+	 * 						hierarchy was built from at terms[s * originCount + o]. Null for none.
+	 * @param	originCount	Number of shared origins.
+	 */
+	void setOriginTerms(const OriginTerms * terms, const int & originCount)
+	{
+		this->originTerms = terms;
+		this->originCount = terms != nullptr ? originCount : 0;
+	}
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::setReplication(const bool & enabled)
+	 *
+	 * @brief	Turns replication on or off. When on, and the machine has more than one memory
+	 * 			node, every build copies the nodes onto each memory node and each thread traverses
+	 * 			the copy on its own node. Surfaces are not copied. Takes effect the next time the
+	 * 			hierarchy is built.
+	 */
+	void setReplication(const bool & enabled) { this->replication = enabled; }
+
+
+	/** @returns	The bounds of all bounded surfaces at a time within the shutter interval. */
+	BoundingBox getBounds(const double & time = 0.0) const
+	{
+		return nodes.empty() ? BoundingBox() : nodes[0].getBounds(time);
+	}
+
+protected:
+
+	/**
+	 * @struct	BuildReference
+	 *
+	 * @brief	Bounds and centroid of a surface while the hierarchy is being built.
+	 */
+	struct BuildReference
+	{
+		/** @brief	Index of the surface in the vector passed to build */
+		int surfaceIndex;
+
+		/** @brief	Bounds at shutter open */
+		BoundingBox openBounds;
+
+		/** @brief	Bounds at shutter close */
+		BoundingBox closeBounds;
+
+		/** @brief	Center of the bounds over the whole shutter interval */
+		dvec3 centroid;
+
+		/** @brief	Kinds of rays that can see the surface */
+		unsigned int visibility;
+	};
+
+
+	/**
+	 * @fn	int BoundingVolumeHierarchy::buildNode(std::vector<BuildReference> & references, const SurfaceVector & surfaces, const int & depth, int & duplicateBudget, std::vector<int> & leafSurfaces);
+	 *
+	 * @brief	Recursively builds the subtree for a set of references. Chooses between the best
+	 * 			object split, the best spatial split, and a leaf by the surface area heuristic.
+	 *
+	 * @param [in,out]	references	  	References below the node. Released once split.
+	 * @param 		  	surfaces	  	Surfaces passed to build.
+	 * @param 		  	depth		  	Depth of the node.
+	 * @param [in,out]	duplicateBudget	Number of extra references spatial splits may still add.
+	 * @param [in,out]	leafSurfaces  	Surface index of each reference held by a leaf, in leaf
+	 * 									order. Leaves append to it.
+	 *
+	 * @returns	Index of the root node of the subtree.
+	 */
+	int buildNode(std::vector<BuildReference> & references, const SurfaceVector & surfaces, const int & depth,
+				  int & duplicateBudget, std::vector<int> & leafSurfaces);
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::optimize(int & root);
+	 *
+	 * @brief	Improves the tree by reinsertion for up to optimizationTime seconds. The root may
+	 * 			move away from the first node, so it is returned through root.
+	 *
+	 * @param [in,out]	root	Index of the root node.
+	 */
+	void optimize(int & root);
+
+
+	/**
+	 * @fn	int BoundingVolumeHierarchy::findBestSibling(const int & root, const int & inserted) const;
+	 *
+	 * @brief	Branch and bound search for the node that a subtree should be made the sibling of
+	 * 			to add the least area to the tree.
+	 *
+	 * @param	root	Index of the root node.
+	 * @param	inserted	Root of the subtree being inserted. Not in the tree.
+	 *
+	 * @returns	Index of the node.
+	 */
+	int findBestSibling(const int & root, const int & inserted) const;
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::refit(int node, const std::vector<int> & parents);
+	 *
+	 * @brief	Recomputes the bounds and visibility of an interior node and all of its ancestors.
+	 */
+	void refit(int node, const std::vector<int> & parents);
+
+
+	/**
+	 * @fn	void BoundingVolumeHierarchy::layOut(const int & root);
+	 *
+	 * @brief	Stores the nodes in treelet order. The root comes first. Below every node whose
+	 * 			children are not yet placed, the next TREELET_DEPTH levels are stored breadth
+	 * 			first, then the same is done below each node of the last of those levels. Rays
+	 * 			test both children of a node together and usually go on into the same treelet,
+	 * 			so they touch fewer cache lines than in depth first order.
+	 *
+	 * @param	root	Index of the root node.
+	 */
+	void layOut(const int & root);
+
+
+	/**
+	 * @fn	static BoundingBox BoundingVolumeHierarchy::getSlab(const BoundingBox & box, const int & axis, const double & low, const double & high);
+	 *
+	 * @brief	Part of a box between two positions along one axis.
+	 */
+	static BoundingBox getSlab(const BoundingBox & box, const int & axis, const double & low, const double & high);
+
+
+	/**
+	 * @fn	static BoundingBox BoundingVolumeHierarchy::clipReference(const BuildReference & ref, const SurfaceVector & surfaces, const BoundingBox & region);
+	 *
+	 * @brief	Bounds of the part of the surface of a reference inside of a region.
+	 */
+	static BoundingBox clipReference(const BuildReference & ref, const SurfaceVector & surfaces, const BoundingBox & region);
+
+
+	/**
+	 * @fn	template <class Region> void BoundingVolumeHierarchy::gatherSurfacesIn(const Region & region, const unsigned int & rayTypes, const double & time, std::vector<ImplicitSurface *> & found) const;
+	 *
+	 * @brief	Range query shared by the gatherSurfaces overloads. Region is any type with an
+	 * 			overlaps(const BoundingBox &) method.
+	 */
+	template <class Region>
+	void gatherSurfacesIn(const Region & region, const unsigned int & rayTypes, const double & time,
+						  std::vector<ImplicitSurface *> & found) const;
+
+
+	/**
+	 * @fn	static double BoundingVolumeHierarchy::motionArea(const BoundingBox & open, const BoundingBox & close)
+	 *
+	 * @brief	Surface area used by the surface area heuristic. The average of the areas at
+	 * 			shutter open and close estimates the area seen by a ray at a random time.
+	 */
+	static double motionArea(const BoundingBox & open, const BoundingBox & close)
+	{
+		return 0.5 * (open.surfaceArea() + close.surfaceArea());
+	}
+
+
+	/**
+	 * @fn	const BVHNode * BoundingVolumeHierarchy::getLocalNodes() const
+	 *
+	 * @brief	Nodes for the calling thread to traverse: the copy on its memory node if the
+	 * 			nodes are replicated, the only copy otherwise.
+	 */
+	const BVHNode * getLocalNodes() const
+	{
+		return replicas.empty() ? nodes.data() : replicas[ThreadPool::getThreadNode() % replicas.size()].data();
+	}
+
+
+	/**
+	 * @fn	const OriginTerms * BoundingVolumeHierarchy::getOriginTerms(const Ray & ray, const int & surfaceId) const
+	 *
+	 * @brief	Origin terms of a surface for the origin of a ray. Null if the origin is not shared
+	 * 			or no terms are set.
+	 *
+	 * @param	ray		 	The ray.
+	 * @param	surfaceId	Index of the surface in the list the hierarchy was built from.
+	 */
+	const OriginTerms * getOriginTerms(const Ray & ray, const int & surfaceId) const
+	{
+		return ray.sharedOrigin >= 0 && ray.sharedOrigin < originCount ? &originTerms[surfaceId * originCount + ray.sharedOrigin] : nullptr;
+	}
+
+
+	/** @brief	Array of nodes. Large arrays are backed by huge pages. */
+	typedef std::vector<BVHNode, NodeAllocator<BVHNode>> NodeArray;
+
+	/** @brief	Nodes of the hierarchy in treelet order. */
+	NodeArray nodes;
+
+	/** @brief	Copy of the nodes on each memory node. Empty unless replication is on and the
+	machine has more than one memory node. */
+	std::vector<NodeArray> replicas;
+
+	/** @brief	True to copy the nodes to every memory node after each build */
+	bool replication = false;
+
+	/** @brief	Bounded surfaces ordered so that the surfaces of each leaf are contiguous. Surfaces
+	split by spatial splits appear once for each leaf they are in. */
+	SurfaceVector orderedSurfaces;
+
+	/** @brief	Index in the list the hierarchy was built from of each of orderedSurfaces */
+	std::vector<int> orderedIds;
+
+	/** @brief	True if spatial splits put some surface in more than one leaf */
+	bool hasDuplicates = false;
+
+	/** @brief	Surfaces that cannot be bounded. Checked against every ray. */
+	SurfaceVector unboundedSurfaces;
+
+	/** @brief	Index in the list the hierarchy was built from of each of unboundedSurfaces */
+	std::vector<int> unboundedIds;
+
+	/** @brief	Profiler that tests and hits are counted in. Null when profiling is off. */
+	ObjectProfiler * profiler = nullptr;
+
+	/** @brief	Origin terms of each surface for each shared ray origin. Owned by the caller. */
+	const OriginTerms * originTerms = nullptr;
+
+	/** @brief	Number of shared origins in originTerms */
+	int originCount = 0;
+
+	/** @brief	Maximum number of surfaces per leaf */
+	int maxLeafSize = 2;
+
+	/** @brief	Most extra references added by spatial splits, as a fraction of the number of
+	bounded surfaces. Zero if spatial splits are off. */
+	double spatialSplitBudget = 0.0;
+
+	/** @brief	Most time in seconds spent optimizing the tree after each build */
+	double optimizationTime = 0.0;
+
+	/** @brief	Result of the optimization on the last build */
+	OptimizationReport optimizationReport;
+
+	/** @brief	Number of levels in each treelet of the node layout */
+	static const int TREELET_DEPTH = 3;
+
+	/** @brief	Area the sides of an object split must overlap by before a spatial split is tried.
+	Set for each build. */
+	double minSpatialOverlap = 0.0;
+
+	/** @brief	Number of bins used to evaluate split positions along each axis */
+	static const int SAH_BIN_COUNT = 12;
+
+}; // end BoundingVolumeHierarchy class
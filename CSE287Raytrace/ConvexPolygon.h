@@ -23,6 +23,9 @@ public:
 	 */
 	ConvexPolygon(std::vector<dvec3> vertices, color  material = color(1.0, 1.0, 1.0, 1.0));
 
+	/** @brief	Copies the polygon. */
+	virtual std::shared_ptr<ImplicitSurface> clone( ) const override { return std::make_shared<ConvexPolygon>( *this ); }
+
 	/**
 	 * @fn	virtual HitRecord ImplicitSurface::findClosestIntersection(const struct Ray & ray);
 	 *
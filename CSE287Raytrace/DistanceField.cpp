@@ -0,0 +1,392 @@
+#include "DistanceField.h"
+
+#include "Sampling.h"
+
+// Room left around the bounded surfaces on every side, as a fraction of the longest side of
+// their bounds. Surfaces can move this far before the region has to be placed again.
+static const double REGION_PADDING = 0.25;
+
+// Distance in voxels, beyond half of the diagonal of a brick, within which the center of a
+// brick must be to a surface for the brick to store its voxels
+static const double BAND_VOXELS = 2.0;
+
+// Distance in voxels from the shaded point at which marches start, so that the surface being
+// shaded does not hide the light from itself
+static const double START_VOXELS = 1.5;
+
+// Shortest step of a march in voxels
+static const double MIN_STEP_VOXELS = 0.5;
+
+// Most steps taken by a march toward a light
+static const int MAX_MARCH_STEPS = 64;
+
+// Number of points along the normal compared for ambient occlusion
+static const int OCCLUSION_STEPS = 5;
+
+/**
+ * @fn	static unsigned int getSignature(const ImplicitSurface & surface)
+ *
+ * @brief	Hashes the shape and position of a surface. The distances from a few fixed points
+ * 			pin down where a surface is even if it extends infinitely.
+ */
+static unsigned int getSignature(const ImplicitSurface & surface)
+{
+	static const dvec3 references[4] = { dvec3(0.0, 0.0, 0.0), dvec3(1.0, 0.0, 0.0), dvec3(0.0, 1.0, 0.0), dvec3(0.0, 0.0, 1.0) };
+
+	BoundingBox box = surface.getBounds();
+	unsigned int signature = hashPoint(dvec3(surface.visibility), DISTANCE_FIELD_STREAM);
+
+	if (box.isBounded()) {
+		signature = hashPoint(box.minCorner, DISTANCE_FIELD_STREAM, signature);
+		signature = hashPoint(box.maxCorner, DISTANCE_FIELD_STREAM, signature);
+	}
+
+	for (const dvec3& reference : references) {
+		signature = hashPoint(dvec3(surface.signedDistance(reference)), DISTANCE_FIELD_STREAM, signature);
+	}
+
+	return signature;
+}
+
+/**
+ * @fn	static bool hasDistance(const ImplicitSurface & surface)
+ *
+ * @brief	Checks whether a surface gives a signed distance anywhere. Surfaces that do not are
+ * 			left out of the field.
+ */
+static bool hasDistance(const ImplicitSurface & surface)
+{
+	return surface.signedDistance(dvec3(0.0)) != INFINITY || surface.signedDistance(dvec3(1.0, 1.0, 1.0)) != INFINITY;
+}
+
+/**
+ * @fn	static bool contains(const BoundingBox & outer, const BoundingBox & inner)
+ *
+ * @brief	Checks whether one box lies entirely within another.
+ */
+static bool contains(const BoundingBox & outer, const BoundingBox & inner)
+{
+	return glm::all(glm::lessThanEqual(outer.minCorner, inner.minCorner)) &&
+		glm::all(glm::lessThanEqual(inner.maxCorner, outer.maxCorner));
+}
+
+
+void DistanceField::update(const SurfaceVector& sceneSurfaces, const int& resolution, ThreadPool& threads)
+{
+	std::vector<shared_ptr<ImplicitSurface>> current;
+	std::vector<unsigned int> currentSignatures;
+	BoundingBox sceneBounds;
+
+	for (auto& surface : sceneSurfaces) {
+
+		// Surfaces that cast no shadows or have no distance are left out
+		if (!(surface->visibility & SHADOW_RAY) || !hasDistance(*surface)) {
+			continue;
+		}
+
+		BoundingBox box = surface->getBounds();
+		if (box.isBounded()) {
+			sceneBounds.expand(box);
+		}
+
+		current.push_back(surface);
+		currentSignatures.push_back(getSignature(*surface));
+	}
+
+	occupied = sceneBounds;
+
+	bool rebuildAll = resolution != this->resolution || current.size() != surfaces.size();
+
+	// Surfaces leaving the region move it
+	if (!sceneBounds.isEmpty() && (bounds.isEmpty() || !contains(bounds, sceneBounds))) {
+		place(sceneBounds, resolution);
+		rebuildAll = true;
+	}
+
+	// Where surfaces were and are now, for those that changed
+	std::vector<BoundingBox> changed;
+
+	for (int i = 0; i < (int)current.size() && !rebuildAll; i++) {
+
+		if (current[i] == surfaces[i] && currentSignatures[i] == signatures[i]) {
+			continue;
+		}
+
+		BoundingBox after = current[i]->getBounds();
+
+		// Moving an unbounded surface changes distances everywhere
+		if (!surfaceBounds[i].isBounded() || !after.isBounded()) {
+			rebuildAll = true;
+		}
+
+		changed.push_back(surfaceBounds[i]);
+		changed.push_back(after);
+	}
+
+	if (!rebuildAll && changed.empty()) {
+		return;
+	}
+
+	surfaces = current;
+	signatures = currentSignatures;
+	surfaceBounds.clear();
+	unbounded.clear();
+
+	for (int i = 0; i < (int)surfaces.size(); i++) {
+
+		surfaceBounds.push_back(surfaces[i]->getBounds());
+
+		if (!surfaceBounds[i].isBounded()) {
+			unbounded.push_back(i);
+		}
+	}
+
+	std::vector<int> all(surfaces.size());
+	for (int i = 0; i < (int)all.size(); i++) {
+		all[i] = i;
+	}
+
+	double halfDiagonal = 0.5 * sqrt(3.0) * BRICK_SIZE * voxelSize;
+	double band = halfDiagonal + BAND_VOXELS * voxelSize;
+
+	// Stored distances never exceed this, so surfaces farther from a brick can be skipped
+	double limit = halfDiagonal + band;
+
+	threads.parallelFor((int)bricks.size(), [&](int b) {
+
+		Brick& brick = bricks[b];
+		BoundingBox box = getBrickBounds(b);
+
+		// Every brick keeps its center distance current, since any change can make it smaller
+		double centerDistance = evaluate(box.centroid(), all, INFINITY);
+		brick.centerDistance = (float)centerDistance;
+
+		if (glm::abs(centerDistance) > band) {
+			std::vector<float>().swap(brick.samples);
+			return;
+		}
+
+		BoundingBox reach(box.minCorner - dvec3(limit), box.maxCorner + dvec3(limit));
+		bool dirty = rebuildAll || brick.samples.empty();
+
+		for (const BoundingBox& region : changed) {
+			dirty = dirty || region.overlaps(reach);
+		}
+
+		if (!dirty) {
+			return;
+		}
+
+		std::vector<int> candidates;
+		for (int i = 0; i < (int)surfaces.size(); i++) {
+			if (!surfaceBounds[i].isBounded() || surfaceBounds[i].overlaps(reach)) {
+				candidates.push_back(i);
+			}
+		}
+
+		const int side = BRICK_SIZE + 1;
+		brick.samples.resize(side * side * side);
+
+		for (int z = 0; z < side; z++) {
+			for (int y = 0; y < side; y++) {
+				for (int x = 0; x < side; x++) {
+					dvec3 corner = box.minCorner + voxelSize * dvec3(x, y, z);
+					brick.samples[x + side * (y + side * z)] = (float)evaluate(corner, candidates, limit);
+				}
+			}
+		}
+	});
+
+} // end update
+
+
+double DistanceField::getDistance(const dvec3& point) const
+{
+	double distance = INFINITY;
+
+	if (!bricks.empty()) {
+
+		double brickWidth = BRICK_SIZE * voxelSize;
+		dvec3 local = (point - bounds.minCorner) / brickWidth;
+
+		int cell[3];
+		bool inside = true;
+
+		for (int axis = 0; axis < 3; axis++) {
+			cell[axis] = (int)floor(local[axis]);
+			inside = inside && cell[axis] >= 0 && cell[axis] < brickCounts[axis];
+		}
+
+		if (inside) {
+
+			const Brick& brick = bricks[cell[0] + brickCounts[0] * (cell[1] + brickCounts[1] * cell[2])];
+			dvec3 brickCorner = bounds.minCorner + brickWidth * dvec3(cell[0], cell[1], cell[2]);
+
+			// Far from every surface the distance changes no faster than the point moves
+			if (brick.samples.empty()) {
+
+				double offset = glm::length(point - (brickCorner + dvec3(0.5 * brickWidth)));
+
+				return brick.centerDistance > 0.0f ? brick.centerDistance - offset : brick.centerDistance + offset;
+			}
+
+			dvec3 voxel = glm::clamp((point - brickCorner) / voxelSize, 0.0, (double)BRICK_SIZE);
+
+			int x = glm::min((int)voxel.x, BRICK_SIZE - 1);
+			int y = glm::min((int)voxel.y, BRICK_SIZE - 1);
+			int z = glm::min((int)voxel.z, BRICK_SIZE - 1);
+			dvec3 f = voxel - dvec3(x, y, z);
+
+			const int side = BRICK_SIZE + 1;
+			const float* s = &brick.samples[x + side * (y + side * z)];
+
+			double c00 = glm::mix((double)s[0], (double)s[1], f.x);
+			double c10 = glm::mix((double)s[side], (double)s[side + 1], f.x);
+			double c01 = glm::mix((double)s[side * side], (double)s[side * side + 1], f.x);
+			double c11 = glm::mix((double)s[side * side + side], (double)s[side * side + side + 1], f.x);
+
+			return glm::mix(glm::mix(c00, c10, f.y), glm::mix(c01, c11, f.y), f.z);
+		}
+
+		// The bounded surfaces all lie inside of their own bounds, which are well inside of the
+		// region, so this stays clear of zero as marches leave the region
+		dvec3 outside = glm::max(glm::max(occupied.minCorner - point, point - occupied.maxCorner), dvec3(0.0));
+		distance = glm::length(outside);
+	}
+
+	for (int i : unbounded) {
+		distance = glm::min(distance, surfaces[i]->signedDistance(point));
+	}
+
+	return distance;
+
+} // end getDistance
+
+
+double DistanceField::lightVisibility(const dvec3& point, const dvec3& lightPosition, const double& lightRadius,
+									  double& occluderDistance) const
+{
+	occluderDistance = INFINITY;
+
+	dvec3 toLight = lightPosition - point;
+	double distance = glm::length(toLight);
+
+	if (distance <= lightRadius) {
+		return 1.0;
+	}
+
+	dvec3 direction = toLight / distance;
+	double tanAngle = lightRadius / sqrt(distance * distance - lightRadius * lightRadius);
+	double end = distance - lightRadius;
+
+	double visibility = 1.0;
+	double t = START_VOXELS * voxelSize;
+
+	for (int step = 0; step < MAX_MARCH_STEPS && t < end; step++) {
+
+		double d = getDistance(point + t * direction);
+
+		// Where the closest surface cuts the cross section of the cone, in radii of the section
+		double edge = d / (t * tanAngle);
+
+		if (edge < 1.0) {
+
+			double s = glm::max(edge, -1.0);
+
+			// Part of a disk on the far side of a chord at that offset from the center
+			double fraction = 0.5 + (s * sqrt(1.0 - s * s) + asin(s)) / PI;
+
+			if (fraction < visibility) {
+				visibility = fraction;
+				occluderDistance = t;
+			}
+
+			if (visibility <= 0.0) {
+				break;
+			}
+		}
+
+		t += glm::max(glm::abs(d), MIN_STEP_VOXELS * voxelSize);
+	}
+
+	return visibility;
+
+} // end lightVisibility
+
+
+double DistanceField::ambientOcclusion(const dvec3& point, const dvec3& normal, const double& maxDistance) const
+{
+	double occlusion = 0.0;
+	double total = 0.0;
+	double weight = 1.0;
+
+	for (int step = 1; step <= OCCLUSION_STEPS; step++) {
+
+		double t = maxDistance * step / OCCLUSION_STEPS;
+		double d = getDistance(point + t * normal);
+
+		// Nothing is closer than the distance already traveled if the surface is open
+		occlusion += weight * glm::clamp((t - d) / t, 0.0, 1.0);
+		total += weight;
+		weight *= 0.5;
+	}
+
+	return 1.0 - occlusion / total;
+
+} // end ambientOcclusion
+
+
+void DistanceField::place(const BoundingBox& sceneBounds, const int& resolution)
+{
+	this->resolution = resolution;
+
+	dvec3 extent = sceneBounds.maxCorner - sceneBounds.minCorner;
+	double longest = glm::max(extent.x, glm::max(extent.y, extent.z));
+
+	dvec3 padding(glm::max(REGION_PADDING * longest, EPSILON));
+	bounds = BoundingBox(sceneBounds.minCorner - padding, sceneBounds.maxCorner + padding);
+
+	extent = bounds.maxCorner - bounds.minCorner;
+	longest = glm::max(extent.x, glm::max(extent.y, extent.z));
+
+	voxelSize = longest / glm::max(resolution, BRICK_SIZE);
+
+	// Whole bricks cover the region, so its far corner moves out a little
+	double brickWidth = BRICK_SIZE * voxelSize;
+
+	for (int axis = 0; axis < 3; axis++) {
+		brickCounts[axis] = glm::max((int)ceil(extent[axis] / brickWidth), 1);
+	}
+
+	bounds.maxCorner = bounds.minCorner + brickWidth * dvec3(brickCounts[0], brickCounts[1], brickCounts[2]);
+
+	bricks.assign(brickCounts[0] * brickCounts[1] * brickCounts[2], Brick());
+
+} // end place
+
+
+double DistanceField::evaluate(const dvec3& point, const std::vector<int>& candidates, const double& limit) const
+{
+	double distance = limit;
+
+	for (int i : candidates) {
+		distance = glm::min(distance, surfaces[i]->signedDistance(point));
+	}
+
+	return glm::max(distance, -limit);
+
+} // end evaluate
+
+
+BoundingBox DistanceField::getBrickBounds(const int& brick) const
+{
+	int x = brick % brickCounts[0];
+	int y = (brick / brickCounts[0]) % brickCounts[1];
+	int z = brick / (brickCounts[0] * brickCounts[1]);
+
+	double brickWidth = BRICK_SIZE * voxelSize;
+	dvec3 corner = bounds.minCorner + brickWidth * dvec3(x, y, z);
+
+	return BoundingBox(corner, corner + dvec3(brickWidth));
+
+} // end getBrickBounds
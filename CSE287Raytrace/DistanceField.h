@@ -0,0 +1,182 @@
+#pragma once
+
+#include <vector>
+
+#include "ImplicitSurface.h"
+#include "ThreadPool.h"
+
+/**
+ * @class	DistanceField
+ *
+ * @brief	Signed distance to the closest surface of the scene, sampled on a sparse grid of
+ * 			bricks so that soft shadows and ambient occlusion can be estimated from a few
+ * 			lookups rather than many rays. The region around the bounded surfaces is split into
+ * 			bricks of BRICK_SIZE voxels on a side. Bricks close to a surface store the distance
+ * 			at the corners of each of their voxels and are interpolated trilinearly. Every
+ * 			other brick stores only the distance at its center, from which a lower bound on the
+ * 			distance anywhere in the brick follows. Outside of the region, the distance to the
+ * 			bounds of the bounded surfaces stands in for them and unbounded surfaces are evaluated
+ * 			directly.
+ *
+ * 			Distances come from ImplicitSurface::signedDistance and are computed on the
+ * 			rendering threads. Updates compare each surface with the last update and rebuild
+ * 			only the bricks near surfaces that moved, were added, or were removed. The field
+ * 			holds the surfaces at shutter open.
+ */
+class DistanceField
+{
+public:
+
+	/**
+	 * @fn	void DistanceField::update(const SurfaceVector & surfaces, const int & resolution, ThreadPool & threads);
+	 *
+	 * @brief	Brings the field up to date with the surfaces. Does nothing if no surface has
+	 * 			changed. The region is placed around the bounded surfaces with room to spare, and
+	 * 			only placed again, rebuilding every brick, when a surface leaves it.
+	 *
+	 * @param 		  	surfaces  	Surfaces of the scene. Those hidden from shadow feelers are left
+	 * 								out.
+	 * @param 		  	resolution	Number of voxels along the longest side of the region.
+	 * @param [in,out]	threads   	Threads the bricks are built on.
+	 */
+	void update(const SurfaceVector & surfaces, const int & resolution, ThreadPool & threads);
+
+
+	/**
+	 * @fn	double DistanceField::getDistance(const dvec3 & point) const;
+	 *
+	 * @brief	Looks up the signed distance from a point to the closest surface. Close to a
+	 * 			surface the value is interpolated. Farther away it may be less than the true
+	 * 			distance, but never more.
+	 *
+	 * @param	point	The point.
+	 *
+	 * @returns	The signed distance.
+	 */
+	double getDistance(const dvec3 & point) const;
+
+
+	/**
+	 * @fn	double DistanceField::lightVisibility(const dvec3 & point, const dvec3 & lightPosition, const double & lightRadius, double & occluderDistance) const;
+	 *
+	 * @brief	Estimates the fraction of a spherical light that can be seen from a point by
+	 * 			marching along the cone toward the light. Wherever a surface comes closer to the
+	 * 			axis of the cone than the cone is wide, the part of the light it hides is taken to
+	 * 			be the part of a disk cut off by a straight edge.
+	 *
+	 * @param 		  	point			 	Point being shaded.
+	 * @param 		  	lightPosition	 	Center of the light.
+	 * @param 		  	lightRadius		 	Radius of the light. Greater than zero.
+	 * @param [out]	occluderDistance	Distance along the cone to where the most light was
+	 * 									hidden. INFINITY if nothing hides the light.
+	 *
+	 * @returns	Visible fraction of the light from 0 to 1.
+	 */
+	double lightVisibility(const dvec3 & point, const dvec3 & lightPosition, const double & lightRadius,
+						   double & occluderDistance) const;
+
+
+	/**
+	 * @fn	double DistanceField::ambientOcclusion(const dvec3 & point, const dvec3 & normal, const double & maxDistance) const;
+	 *
+	 * @brief	Estimates the fraction of ambient light that reaches a point by comparing the
+	 * 			distance to the closest surface with the distance from the point at a few steps
+	 * 			along the normal. Nearer steps count for more.
+	 *
+	 * @param	point	   	Point being shaded.
+	 * @param	normal	   	Unit surface normal at the point.
+	 * @param	maxDistance	Distance of the last step. Surfaces farther away do not occlude.
+	 *
+	 * @returns	Unoccluded fraction from 0 to 1.
+	 */
+	double ambientOcclusion(const dvec3 & point, const dvec3 & normal, const double & maxDistance) const;
+
+
+	/** @returns	Width of a voxel. Details smaller than this are lost. */
+	double getVoxelSize() const { return voxelSize; }
+
+	/** @returns	Region covered by the bricks. Empty until a bounded surface is seen. */
+	const BoundingBox & getBounds() const { return bounds; }
+
+	/** @brief	Number of voxels along each side of a brick */
+	static const int BRICK_SIZE = 8;
+
+protected:
+
+	/**
+	 * @struct	Brick
+	 *
+	 * @brief	Cube of BRICK_SIZE voxels on a side.
+	 */
+	struct Brick
+	{
+		/** @brief	Distance at the center of the brick */
+		float centerDistance = 0.0f;
+
+		/** @brief	Distances at the corners of the voxels, ordered by x, then y, then z. Empty
+		for bricks far from every surface. */
+		std::vector<float> samples;
+	};
+
+	/**
+	 * @fn	void DistanceField::place(const BoundingBox & sceneBounds, const int & resolution);
+	 *
+	 * @brief	Sizes the region and the voxels around the bounded surfaces and empties every
+	 * 			brick.
+	 */
+	void place(const BoundingBox & sceneBounds, const int & resolution);
+
+
+	/**
+	 * @fn	double DistanceField::evaluate(const dvec3 & point, const std::vector<int> & candidates, const double & limit) const;
+	 *
+	 * @brief	Finds the signed distance from a point to the closest of some of the surfaces.
+	 *
+	 * @param	point	  	The point.
+	 * @param	candidates	Indices into the surfaces of the field.
+	 * @param	limit	  	Largest distance returned.
+	 *
+	 * @returns	The distance.
+	 */
+	double evaluate(const dvec3 & point, const std::vector<int> & candidates, const double & limit) const;
+
+
+	/**
+	 * @fn	BoundingBox DistanceField::getBrickBounds(const int & brick) const;
+	 *
+	 * @brief	Region covered by a brick.
+	 */
+	BoundingBox getBrickBounds(const int & brick) const;
+
+
+	/** @brief	Surfaces in the field as of the last update */
+	std::vector<shared_ptr<ImplicitSurface>> surfaces;
+
+	/** @brief	Hash of the shape and position of each surface as of the last update */
+	std::vector<unsigned int> signatures;
+
+	/** @brief	Bounds of each surface as of the last update */
+	std::vector<BoundingBox> surfaceBounds;
+
+	/** @brief	Indices of the surfaces that extend infinitely */
+	std::vector<int> unbounded;
+
+	/** @brief	Region covered by the bricks */
+	BoundingBox bounds;
+
+	/** @brief	Bounds of the bounded surfaces as of the last update */
+	BoundingBox occupied;
+
+	/** @brief	Width of a voxel */
+	double voxelSize = 0.0;
+
+	/** @brief	Number of bricks along each axis */
+	int brickCounts[3] = { 0, 0, 0 };
+
+	/** @brief	Bricks ordered by x, then y, then z */
+	std::vector<Brick> bricks;
+
+	/** @brief	Resolution the region was placed with */
+	int resolution = 0;
+
+}; // end DistanceField class
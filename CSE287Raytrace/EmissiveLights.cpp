@@ -0,0 +1,74 @@
+#include "EmissiveLights.h"
+
+
+void EmissiveLights::build(const SurfaceVector& surfaces)
+{
+	emitters.clear();
+
+	std::vector<double> powers;
+
+	for (auto& surface : surfaces) {
+
+		double area = surface->getSurfaceArea();
+		double radiance = luminance(surface->material.getEmisive());
+
+		// Infinite surfaces cannot be sampled and dark surfaces give off nothing
+		if (area < INFINITY && radiance > 0.0) {
+			emitters.push_back(surface.get());
+			powers.push_back(radiance * area);
+		}
+	}
+
+	distribution.build(powers);
+
+} // end build
+
+
+color EmissiveLights::sampleIllumination(const BoundingVolumeHierarchy& accelerator, const HitRecord& hit, const dvec3& eyeVector,
+										 const double& time, const int& samples, RandomSequence& random) const
+{
+	color total(0.0, 0.0, 0.0, 0.0);
+
+	if (emitters.empty() || samples <= 0) {
+		return total;
+	}
+
+	const Material& material = hit.material;
+
+	for (int sample = 0; sample < samples; sample++) {
+
+		double choiceProbability;
+		int emitter = distribution.sample(random.next(), choiceProbability);
+
+		dvec3 direction;
+		double distance, pdf;
+
+		if (!emitters[emitter]->sampleDirection(hit.interceptPoint, random.next2(), time, direction, distance, pdf)) {
+			continue;
+		}
+
+		// Light arriving from behind the surface is not reflected
+		double cosine = glm::dot(direction, hit.surfaceNormal);
+		if (cosine <= 0.0) {
+			continue;
+		}
+
+		Ray feeler(hit.interceptPoint + EPSILON * hit.surfaceNormal, direction, SHADOW_RAY);
+		feeler.time = time;
+
+		if (accelerator.isOccluded(feeler, distance - EPSILON)) {
+			continue;
+		}
+
+		dvec3 reflectVec = glm::reflect(-direction, hit.surfaceNormal);
+
+		color reflectance = cosine * material.getDiffuse(hit.uv) +
+			glm::pow(glm::max(glm::dot(reflectVec, eyeVector), 0.0), material.shininess) * material.getSpecular(hit.uv);
+
+		// Lambertian normalization of the emitted radiance
+		total += emitters[emitter]->material.getEmisive() * reflectance / (PI * choiceProbability * pdf);
+	}
+
+	return total / (double)samples;
+
+} // end sampleIllumination
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "AliasTable.h"
+#include "BoundingVolumeHierarchy.h"
+#include "Sampling.h"
+
+/**
+ * @class	EmissiveLights
+ *
+ * @brief	Treats surfaces with an emissive material as light sources. Emitters are chosen with
+ * 			probability proportional to the power they give off, and a direction toward the
+ * 			chosen emitter is sampled by the surface itself (by solid angle for spheres).
+ * 			Because every sample lands on the emitter, the weight of a sample is bounded by the
+ * 			radiance of the emitter times the solid angle it covers.
+ */
+class EmissiveLights
+{
+public:
+
+	/**
+	 * @fn	void EmissiveLights::build(const SurfaceVector & surfaces);
+	 *
+	 * @brief	Collects the emissive surfaces with a finite area and builds the distribution used
+	 * 			to choose between them. Must be called again whenever surfaces change.
+	 *
+	 * @param	surfaces	Surfaces of the scene.
+	 */
+	void build(const SurfaceVector & surfaces);
+
+
+	/**
+	 * @fn	color EmissiveLights::sampleIllumination(const BoundingVolumeHierarchy & accelerator, const HitRecord & hit, const dvec3 & eyeVector, const double & time, const int & samples, RandomSequence & random) const;
+	 *
+	 * @brief	Estimates the diffuse and specular reflection of the light given off by all
+	 * 			emitters at a point of intersection. Each sample chooses an emitter and a direction
+	 * 			toward it and traces a shadow feeler.
+	 *
+	 * @param 		  	accelerator	Hierarchy containing the surfaces of the scene.
+	 * @param 		  	hit		   	Point of intersection being shaded.
+	 * @param 		  	eyeVector  	Unit vector from the point toward the viewer.
+	 * @param 		  	time	   	Time within the shutter interval.
+	 * @param 		  	samples	   	Number of samples.
+	 * @param [in,out]	random	   	Source of random numbers.
+	 *
+	 * @returns	The reflected light.
+	 */
+	color sampleIllumination(const BoundingVolumeHierarchy & accelerator, const HitRecord & hit, const dvec3 & eyeVector,
+							 const double & time, const int & samples, RandomSequence & random) const;
+
+
+	/** @returns	True if the scene contains no emitters that can light other surfaces. */
+	bool empty() const { return emitters.empty(); }
+
+	/** @returns	Number of emitters. */
+	int size() const { return (int)emitters.size(); }
+
+	/** @returns	One of the emitters. */
+	ImplicitSurface * getEmitter(const int & emitter) const { return emitters[emitter]; }
+
+	/** @returns	Power given off by one of the emitters (luminance of its radiance times its area). */
+	double getPower(const int & emitter) const { return distribution.getProbability(emitter) * distribution.getTotalWeight(); }
+
+protected:
+
+	/** @brief	Emissive surfaces with a finite area. Owned by the surfaces of the scene. */
+	std::vector<ImplicitSurface *> emitters;
+
+	/** @brief	Chooses emitters in proportion to their power */
+	AliasTable distribution;
+
+}; // end EmissiveLights class
@@ -0,0 +1,377 @@
+#include "GuidingField.h"
+
+// Share of the energy of a directional distribution above which a quadrant is subdivided
+static const double QUADRANT_SPLIT_FRACTION = 0.01;
+
+// Deepest level of the directional quadtrees
+static const int MAX_QUADTREE_DEPTH = 16;
+
+// Samples a leaf of the octree must receive in one pass before it is split
+static const long long CELL_SPLIT_SAMPLES = 4000;
+
+// Deepest level of the octree
+static const int MAX_OCTREE_DEPTH = 12;
+
+/**
+ * @fn	static int quadrant(dvec2 & position)
+ *
+ * @brief	Finds the quadrant of a node containing a position given relative to the node, and
+ * 			changes the position to be relative to the quadrant.
+ */
+static int quadrant(dvec2 & position)
+{
+	int q = (position.x >= 0.5 ? 1 : 0) | (position.y >= 0.5 ? 2 : 0);
+	position = 2.0 * position - dvec2(q & 1, q >> 1);
+
+	return q;
+}
+
+
+DirectionalTree::DirectionalTree()
+	: nodes(1)
+{
+}
+
+
+dvec2 DirectionalTree::toSquare(const dvec3& direction)
+{
+	double phi = atan2(direction.y, direction.x);
+	if (phi < 0.0) {
+		phi += TWO_PI;
+	}
+
+	return glm::clamp(dvec2(0.5 * (direction.z + 1.0), phi / TWO_PI), 0.0, 1.0 - 1e-12);
+
+} // end toSquare
+
+
+dvec3 DirectionalTree::toDirection(const dvec2& square)
+{
+	double cosTheta = 2.0 * square.x - 1.0;
+	double sinTheta = sqrt(glm::max(1.0 - cosTheta * cosTheta, 0.0));
+	double phi = TWO_PI * square.y;
+
+	return dvec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+
+} // end toDirection
+
+
+dvec3 DirectionalTree::sample(dvec2 u, double& pdf) const
+{
+	// Density with respect to area on the square
+	pdf = 1.0;
+
+	dvec2 origin(0.0, 0.0);
+	double size = 1.0;
+
+	int node = 0;
+
+	while (true) {
+
+		const Node& current = nodes[node];
+		double total = current.sums[0] + current.sums[1] + current.sums[2] + current.sums[3];
+
+		// Nothing was recorded below here so the rest of the node is uniform
+		if (total <= 0.0) {
+			break;
+		}
+
+		// Choose a quadrant with the first number and rescale it for reuse
+		int q = 0;
+		double cumulative = 0.0;
+		while (q < 3 && u.x * total >= cumulative + current.sums[q]) {
+			cumulative += current.sums[q];
+			q++;
+		}
+
+		u.x = glm::clamp((u.x * total - cumulative) / current.sums[q], 0.0, 1.0 - 1e-12);
+		pdf *= 4.0 * current.sums[q] / total;
+
+		size *= 0.5;
+		origin += size * dvec2(q & 1, q >> 1);
+
+		if (current.children[q] == 0) {
+			break;
+		}
+
+		node = current.children[q];
+	}
+
+	pdf /= 4.0 * PI;
+
+	return toDirection(origin + size * u);
+
+} // end sample
+
+
+double DirectionalTree::pdf(const dvec3& direction) const
+{
+	dvec2 position = toSquare(direction);
+	double density = 1.0;
+
+	int node = 0;
+
+	while (true) {
+
+		const Node& current = nodes[node];
+		double total = current.sums[0] + current.sums[1] + current.sums[2] + current.sums[3];
+
+		if (total <= 0.0) {
+			break;
+		}
+
+		int q = quadrant(position);
+		density *= 4.0 * current.sums[q] / total;
+
+		if (current.children[q] == 0) {
+			break;
+		}
+
+		node = current.children[q];
+	}
+
+	return density / (4.0 * PI);
+
+} // end pdf
+
+
+DirectionalTree DirectionalTree::refined(const double& fraction, const int& maxDepth) const
+{
+	DirectionalTree tree;
+	tree.nodes.clear();
+
+	tree.addRefinedNode(*this, 0, nodes[0].sums, fraction * getTotal(), 1, maxDepth);
+
+	return tree;
+
+} // end refined
+
+
+int DirectionalTree::addRefinedNode(const DirectionalTree& source, const int& sourceNode, const double* energy,
+									const double& threshold, const int& depth, const int& maxDepth)
+{
+	int index = (int)nodes.size();
+	nodes.push_back(Node());
+
+	for (int q = 0; q < 4; q++) {
+		nodes[index].sums[q] = energy[q];
+	}
+
+	for (int q = 0; q < 4; q++) {
+
+		if (depth >= maxDepth || energy[q] <= threshold) {
+			continue;
+		}
+
+		int sourceChild = sourceNode >= 0 ? source.nodes[sourceNode].children[q] : 0;
+
+		// Spread the energy evenly where the source is not subdivided
+		double childEnergy[4];
+		for (int i = 0; i < 4; i++) {
+			childEnergy[i] = sourceChild != 0 ? source.nodes[sourceChild].sums[i] : 0.25 * energy[q];
+		}
+
+		int child = addRefinedNode(source, sourceChild != 0 ? sourceChild : -1, childEnergy, threshold, depth + 1, maxDepth);
+		nodes[index].children[q] = child;
+	}
+
+	return index;
+
+} // end addRefinedNode
+
+
+void GuidingField::Cell::startRecording()
+{
+	int count = 4 * (int)recording.nodes.size();
+
+	recorded.reset(new std::atomic<double>[count]);
+	for (int i = 0; i < count; i++) {
+		recorded[i].store(0.0, std::memory_order_relaxed);
+	}
+
+	samples.store(0, std::memory_order_relaxed);
+
+} // end startRecording
+
+
+void GuidingField::reset(const BoundingBox& bounds)
+{
+	this->bounds = bounds;
+
+	nodes.assign(1, SpatialNode());
+	nodes[0].cell = 0;
+
+	cells.clear();
+	cells.emplace_back(new Cell());
+	cells[0]->startRecording();
+
+	passCount = 0;
+
+} // end reset
+
+
+GuidingField::Cell* GuidingField::findCell(const dvec3& point) const
+{
+	if (nodes.empty()) {
+		return nullptr;
+	}
+
+	dvec3 minCorner = bounds.minCorner;
+	dvec3 maxCorner = bounds.maxCorner;
+
+	dvec3 p = glm::clamp(point, minCorner, maxCorner);
+
+	int node = 0;
+
+	while (nodes[node].firstChild >= 0) {
+
+		dvec3 center = 0.5 * (minCorner + maxCorner);
+		int child = 0;
+
+		for (int axis = 0; axis < 3; axis++) {
+
+			if (p[axis] >= center[axis]) {
+				child |= 1 << axis;
+				minCorner[axis] = center[axis];
+			}
+			else {
+				maxCorner[axis] = center[axis];
+			}
+		}
+
+		node = nodes[node].firstChild + child;
+	}
+
+	return cells[nodes[node].cell].get();
+
+} // end findCell
+
+
+const DirectionalTree* GuidingField::getDistribution(const dvec3& point) const
+{
+	Cell* cell = findCell(point);
+
+	if (cell == nullptr || cell->sampling.getTotal() <= 0.0) {
+		return nullptr;
+	}
+
+	return &cell->sampling;
+
+} // end getDistribution
+
+
+void GuidingField::record(const dvec3& point, const dvec3& direction, const double& value)
+{
+	Cell* cell = findCell(point);
+
+	if (cell == nullptr || !(value > 0.0) || value == INFINITY) {
+		return;
+	}
+
+	const DirectionalTree& tree = cell->recording;
+	dvec2 position = DirectionalTree::toSquare(direction);
+
+	// Only the finest quadrant is updated so that threads rarely touch the same counter. The
+	// sums of the nodes above are added up at the end of the pass.
+	int node = 0;
+	int q = quadrant(position);
+
+	while (tree.nodes[node].children[q] != 0) {
+		node = tree.nodes[node].children[q];
+		q = quadrant(position);
+	}
+
+	atomicAdd(cell->recorded[4 * node + q], value);
+
+	cell->samples.fetch_add(1, std::memory_order_relaxed);
+
+} // end record
+
+
+void GuidingField::finishPass()
+{
+	// Leaves that are split are replaced by their children at the end
+	std::vector<int> leaves;
+
+	for (int i = 0; i < (int)nodes.size(); i++) {
+		if (nodes[i].firstChild < 0) {
+			leaves.push_back(i);
+		}
+	}
+
+	for (int leaf : leaves) {
+
+		Cell& cell = *cells[nodes[leaf].cell];
+		long long samples = cell.samples.load(std::memory_order_relaxed);
+
+		// What was recorded becomes the distribution that is sampled
+		if (samples > 0) {
+
+			// The recording tree starts out holding what earlier passes learned, so the new energy
+			// is added to it
+			DirectionalTree learned = cell.recording;
+
+			// Children always come after their parent, so sums can be gathered from the back
+			for (int i = (int)learned.nodes.size() - 1; i >= 0; i--) {
+
+				DirectionalTree::Node& node = learned.nodes[i];
+
+				for (int q = 0; q < 4; q++) {
+
+					if (node.children[q] != 0) {
+						const DirectionalTree::Node& child = learned.nodes[node.children[q]];
+						node.sums[q] = child.sums[0] + child.sums[1] + child.sums[2] + child.sums[3];
+					}
+					else {
+						node.sums[q] += cell.recorded[4 * i + q].load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+			if (learned.getTotal() > 0.0) {
+				cell.sampling = learned;
+				cell.recording = learned.refined(QUADRANT_SPLIT_FRACTION, MAX_QUADTREE_DEPTH);
+			}
+		}
+
+		cell.startRecording();
+
+		if (samples < CELL_SPLIT_SAMPLES || cell.depth >= MAX_OCTREE_DEPTH) {
+			continue;
+		}
+
+		// Split the leaf. Each child starts from what the parent learned.
+		int firstChild = (int)nodes.size();
+
+		for (int child = 0; child < 8; child++) {
+
+			std::unique_ptr<Cell> childCell(new Cell());
+			childCell->sampling = cell.sampling;
+			childCell->recording = cell.recording;
+
+			// Each child covers about an eighth of what the parent learned from
+			for (DirectionalTree::Node& node : childCell->recording.nodes) {
+				for (double& sum : node.sums) {
+					sum /= 8.0;
+				}
+			}
+
+			childCell->depth = cell.depth + 1;
+			childCell->startRecording();
+
+			SpatialNode node;
+			node.cell = (int)cells.size();
+
+			cells.push_back(std::move(childCell));
+			nodes.push_back(node);
+		}
+
+		cells[nodes[leaf].cell].reset();
+
+		nodes[leaf].firstChild = firstChild;
+		nodes[leaf].cell = -1;
+	}
+
+	passCount++;
+
+} // end finishPass
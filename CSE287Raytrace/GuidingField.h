@@ -0,0 +1,267 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "BoundingBox.h"
+#include "Sampling.h"
+#include "ThreadPool.h"
+
+/**
+ * @class	DirectionalTree
+ *
+ * @brief	Piecewise constant distribution over the sphere of directions stored as a quadtree
+ * 			over the unit square. The square maps to the sphere by the area preserving
+ * 			cylindrical projection (cosine of the polar angle about z, azimuth), so every cell of
+ * 			a level covers the same solid angle. Each node holds the energy of its four
+ * 			quadrants including everything below them, and quadrants holding much of the energy
+ * 			are subdivided further so that small, bright sources get small cells.
+ */
+class DirectionalTree
+{
+public:
+
+	/**
+	 * @fn	DirectionalTree::DirectionalTree();
+	 *
+	 * @brief	Creates a tree with a single node and no energy. Sampling it is uniform.
+	 */
+	DirectionalTree();
+
+
+	/**
+	 * @fn	dvec3 DirectionalTree::sample(dvec2 u, double & pdf) const;
+	 *
+	 * @brief	Chooses a direction in proportion to the energy of the cells.
+	 *
+	 * @param 		  	u  	Two uniform random numbers in [0, 1).
+	 * @param [out]	pdf	Probability density of the direction with respect to solid angle.
+	 *
+	 * @returns	The unit direction.
+	 */
+	dvec3 sample(dvec2 u, double & pdf) const;
+
+
+	/**
+	 * @fn	double DirectionalTree::pdf(const dvec3 & direction) const;
+	 *
+	 * @brief	Probability density with which sample chooses a direction.
+	 *
+	 * @param	direction	Unit direction.
+	 *
+	 * @returns	The density with respect to solid angle.
+	 */
+	double pdf(const dvec3 & direction) const;
+
+
+	/**
+	 * @fn	DirectionalTree DirectionalTree::refined(const double & fraction, const int & maxDepth) const;
+	 *
+	 * @brief	Builds a tree whose quadrants are subdivided wherever they hold more than a
+	 * 			fraction of the energy of this tree. Quadrants deeper than this tree get an equal
+	 * 			share of the energy of the quadrant they lie in.
+	 *
+	 * @param	fraction	Share of the total energy above which quadrants are subdivided.
+	 * @param	maxDepth	Deepest level of subdivision.
+	 *
+	 * @returns	The new tree.
+	 */
+	DirectionalTree refined(const double & fraction, const int & maxDepth) const;
+
+
+	/**
+	 * @fn	static dvec2 DirectionalTree::toSquare(const dvec3 & direction);
+	 *
+	 * @brief	Maps a unit direction to the unit square.
+	 */
+	static dvec2 toSquare(const dvec3 & direction);
+
+
+	/**
+	 * @fn	static dvec3 DirectionalTree::toDirection(const dvec2 & square);
+	 *
+	 * @brief	Maps a point of the unit square to a unit direction.
+	 */
+	static dvec3 toDirection(const dvec2 & square);
+
+
+	/** @returns	Total energy of the tree. */
+	double getTotal() const { return nodes[0].sums[0] + nodes[0].sums[1] + nodes[0].sums[2] + nodes[0].sums[3]; }
+
+	/**
+	 * @struct	Node
+	 *
+	 * @brief	Node of the quadtree. Quadrant q covers the half of the node with x >= 1/2 if
+	 * 			bit 0 of q is set and the half with y >= 1/2 if bit 1 is set.
+	 */
+	struct Node
+	{
+		/** @brief	Energy of each quadrant */
+		double sums[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+		/** @brief	Node that subdivides each quadrant. 0 for quadrants that are not subdivided. */
+		int children[4] = { 0, 0, 0, 0 };
+	};
+
+	/** @brief	Nodes of the tree. The root is first. */
+	std::vector<Node> nodes;
+
+protected:
+
+	/**
+	 * @fn	int DirectionalTree::addRefinedNode(const DirectionalTree & source, const int & sourceNode, const double * energy, const double & threshold, const int & depth, const int & maxDepth);
+	 *
+	 * @brief	Adds a node and the nodes below it to a tree built by refined.
+	 *
+	 * @param	source	  	Tree being refined.
+	 * @param	sourceNode	Node of the source covering the same region. -1 if the source is not
+	 * 						subdivided this far.
+	 * @param	energy	  	Energy of each quadrant of the new node.
+	 * @param	threshold 	Energy above which quadrants are subdivided.
+	 * @param	depth	  	Level of the new node.
+	 * @param	maxDepth  	Deepest level of subdivision.
+	 *
+	 * @returns	Index of the new node.
+	 */
+	int addRefinedNode(const DirectionalTree & source, const int & sourceNode, const double * energy,
+					   const double & threshold, const int & depth, const int & maxDepth);
+
+}; // end DirectionalTree class
+
+
+/**
+ * @class	GuidingField
+ *
+ * @brief	Learned distribution of the light arriving at points of the scene from each direction,
+ * 			used to guide reflected rays toward the directions that carry the most light (path
+ * 			guiding as in "Practical Path Guiding", Müller et al. 2017). An octree over the scene
+ * 			holds a directional distribution in each leaf.
+ *
+ * 			Training works in passes. During a pass every traced sample records the light it
+ * 			found in the leaf it started from without taking any lock, while sampling reads the
+ * 			distributions learned in the previous pass. finishPass, called between passes by a
+ * 			single thread, makes the recorded distributions the ones sampled, refines the
+ * 			quadtrees around the bright directions, and splits leaves that received many
+ * 			samples.
+ */
+class GuidingField
+{
+public:
+
+	/**
+	 * @fn	void GuidingField::reset(const BoundingBox & bounds);
+	 *
+	 * @brief	Forgets everything learned and starts over with a single leaf.
+	 *
+	 * @param	bounds	Region covered by the octree. Points outside of it use the nearest leaf.
+	 */
+	void reset(const BoundingBox & bounds);
+
+
+	/**
+	 * @fn	const DirectionalTree * GuidingField::getDistribution(const dvec3 & point) const;
+	 *
+	 * @brief	Finds the learned distribution of the light arriving at a point.
+	 *
+	 * @param	point	The point.
+	 *
+	 * @returns	The distribution, or nullptr if nothing has been learned there yet.
+	 */
+	const DirectionalTree * getDistribution(const dvec3 & point) const;
+
+
+	/**
+	 * @fn	void GuidingField::record(const dvec3 & point, const dvec3 & direction, const double & value);
+	 *
+	 * @brief	Records light that arrived at a point. May be called concurrently by the
+	 * 			rendering threads.
+	 *
+	 * @param	point	 	Point the light arrived at.
+	 * @param	direction	Unit direction from the point toward where the light came from.
+	 * @param	value	 	Luminance of the light divided by the density with which the direction
+	 * 						was chosen.
+	 */
+	void record(const dvec3 & point, const dvec3 & direction, const double & value);
+
+
+	/**
+	 * @fn	void GuidingField::finishPass();
+	 *
+	 * @brief	Ends a training pass. Must not be called while other threads are recording or
+	 * 			sampling.
+	 */
+	void finishPass();
+
+
+	/** @returns	Number of passes finished since the field was reset. */
+	unsigned int getPassCount() const { return passCount; }
+
+	/** @returns	Region covered by the octree. */
+	const BoundingBox & getBounds() const { return bounds; }
+
+protected:
+
+	/**
+	 * @struct	Cell
+	 *
+	 * @brief	Leaf of the octree.
+	 */
+	struct Cell
+	{
+		/** @brief	Distribution learned in earlier passes */
+		DirectionalTree sampling;
+
+		/** @brief	Layout of the distribution being recorded */
+		DirectionalTree recording;
+
+		/** @brief	Energy recorded for each quadrant of each node of the recording tree */
+		std::unique_ptr<std::atomic<double>[]> recorded;
+
+		/** @brief	Number of samples recorded in the current pass */
+		std::atomic<long long> samples{ 0 };
+
+		/** @brief	Depth of the leaf in the octree */
+		int depth = 0;
+
+		/** @brief	Clears the recorded energy for a new recording tree. */
+		void startRecording();
+	};
+
+	/**
+	 * @struct	SpatialNode
+	 *
+	 * @brief	Node of the octree. Either a leaf with a cell or an interior node with eight
+	 * 			children stored together. Child i covers the upper half of the node along x, y,
+	 * 			and z if bits 0, 1, and 2 of i are set.
+	 */
+	struct SpatialNode
+	{
+		/** @brief	Index of the first child. -1 for leaves. */
+		int firstChild = -1;
+
+		/** @brief	Index of the cell of a leaf */
+		int cell = -1;
+	};
+
+	/**
+	 * @fn	Cell * GuidingField::findCell(const dvec3 & point) const;
+	 *
+	 * @brief	Finds the leaf containing a point.
+	 *
+	 * @returns	The cell of the leaf. nullptr if the field has not been reset.
+	 */
+	Cell * findCell(const dvec3 & point) const;
+
+	/** @brief	Region covered by the octree */
+	BoundingBox bounds;
+
+	/** @brief	Nodes of the octree. The root is first. */
+	std::vector<SpatialNode> nodes;
+
+	/** @brief	Cells of the leaves */
+	std::vector<std::unique_ptr<Cell>> cells;
+
+	/** @brief	Number of passes finished since the field was reset */
+	unsigned int passCount = 0;
+
+}; // end GuidingField class
@@ -2,10 +2,32 @@
 
 #include "HitRecord.h"
 #include "Ray.h"
+#include "BoundingBox.h"
 #include "Material.h"
 #include "TextureCoordinateFunctions.h"
 
 
+/**
+ * @struct	OriginTerms
+ *
+ * @brief	Parts of the intersection calculation of a surface that depend only on the origin of
+ * 			the ray. Each kind of surface decides which of the members it uses. Renderers cache
+ * 			them for the origins that many rays share.
+ */
+struct OriginTerms
+{
+	/** @brief	Ray origin relative to the surface */
+	dvec3 offset;
+
+	/** @brief	Term that is dotted with the ray direction */
+	dvec3 gradient;
+
+	/** @brief	Term that does not depend on the ray direction */
+	double constant;
+
+}; // end OriginTerms struct
+
+
 /**
  * @class	ImplicitSurface
  *
@@ -35,14 +57,134 @@ public:
 	 * 			closest point of intersection if one exits. Returns a HitRecord
 	 * 			 with the t parameter set to INFINITY if there is no intersection.
 	 *
-	 * @param	ray	Ray being check for intersection.
+	 * @param	ray		   	Ray being check for intersection.
+	 * @param	originTerms	(Optional) Terms calculateSharedOriginTerms found for the origin of the
+	 * 						ray, or null to calculate them.
 	 *
 	 * @returns	HitRecord containing properties of the intersection if found.
 	 *
 	 */
-	virtual HitRecord findIntersect(const struct Ray & ray);
+	virtual HitRecord findIntersect(const struct Ray & ray, const OriginTerms * originTerms = nullptr);
+
+	/**
+	 * @fn	virtual void ImplicitSurface::calculateSharedOriginTerms(const dvec3 & origin, OriginTerms & terms) const;
+	 *
+	 * @brief	Finds the parts of the intersection calculation that depend only on the ray origin,
+	 * 			for an origin that is shared by many rays (the view point and positional lights).
+	 * 			The renderer keeps the terms and passes them back to findIntersect for every ray
+	 * 			from that origin, so they must be found again whenever the origin or the surface
+	 * 			moves. The surface itself is left unchanged.
+	 *
+	 * @param 		  	origin	The shared ray origin.
+	 * @param [out]	terms 	The terms.
+	 */
+	virtual void calculateSharedOriginTerms(const dvec3 & origin, OriginTerms & terms) const {}
+
+	/**
+	 * @fn	virtual BoundingBox ImplicitSurface::getBounds(const double & time = 0.0) const;
+	 *
+	 * @brief	Gets an axis aligned box that contains the surface at a given time. Surfaces that
+	 * 			extend infinitely return BoundingBox::unbounded() and are not placed in the
+	 * 			bounding volume hierarchy.
+	 *
+	 * @param	time	(Optional) Time within the shutter interval. 0 at open and 1 at close.
+	 *
+	 * @returns	The bounds of the surface.
+	 */
+	virtual BoundingBox getBounds(const double & time = 0.0) const { return BoundingBox::unbounded(); }
+
+	/**
+	 * @fn	virtual BoundingBox ImplicitSurface::getClippedBounds(const BoundingBox & region) const;
+	 *
+	 * @brief	Gets a box around the part of the surface at shutter open that lies inside of a
+	 * 			region. Used by the bounding volume hierarchy to split a surface between the two
+	 * 			sides of a node. The default clips the bounds of the whole surface, which is always
+	 * 			safe. Surfaces may return something tighter.
+	 *
+	 * @param	region	Region of space the surface is clipped to.
+	 *
+	 * @returns	Bounds of the clipped surface. Empty if none of it is inside of the region.
+	 */
+	virtual BoundingBox getClippedBounds(const BoundingBox & region) const { return getBounds(0.0).clip(region); }
+
+	/**
+	 * @fn	virtual double ImplicitSurface::getSurfaceArea() const;
+	 *
+	 * @brief	Gets the area of the surface. Emissive surfaces with a finite area light the rest of
+	 * 			the scene and must implement sampleDirection. Surfaces that extend infinitely
+	 * 			return INFINITY.
+	 *
+	 * @returns	The area of the surface.
+	 */
+	virtual double getSurfaceArea() const { return INFINITY; }
+
+	/**
+	 * @fn	virtual bool ImplicitSurface::sampleDirection(const dvec3 & point, const dvec2 & u, const double & time, dvec3 & direction, double & distance, double & pdf) const;
+	 *
+	 * @brief	Chooses a direction from a point toward the surface. Used to gather the light
+	 * 			given off by emissive surfaces.
+	 *
+	 * @param 		  	point	 	Point being shaded.
+	 * @param 		  	u		 	Two uniform random numbers in [0, 1).
+	 * @param 		  	time	 	Time within the shutter interval.
+	 * @param [out]	direction	Unit direction from the point to the surface.
+	 * @param [out]	distance 	Distance along the direction to the surface.
+	 * @param [out]	pdf		 	Probability density of the direction with respect to solid angle.
+	 *
+	 * @returns	False if no direction toward the surface could be chosen.
+	 */
+	virtual bool sampleDirection(const dvec3 & point, const dvec2 & u, const double & time,
+								 dvec3 & direction, double & distance, double & pdf) const { return false; }
+
+	/**
+	 * @fn	virtual bool ImplicitSurface::samplePoint(const dvec2 & u, const double & time, dvec3 & point, dvec3 & normal) const;
+	 *
+	 * @brief	Chooses a point uniformly by area on the surface. Used to start paths of light at
+	 * 			emissive surfaces.
+	 *
+	 * @param 		  	u	  	Two uniform random numbers in [0, 1).
+	 * @param 		  	time  	Time within the shutter interval.
+	 * @param [out]	point 	The point.
+	 * @param [out]	normal	Unit normal pointing out of the surface at the point.
+	 *
+	 * @returns	False if the surface cannot be sampled.
+	 */
+	virtual bool samplePoint(const dvec2 & u, const double & time, dvec3 & point, dvec3 & normal) const { return false; }
+
+	/**
+	 * @fn	virtual double ImplicitSurface::signedDistance(const dvec3 & point, const double & time = 0.0) const;
+	 *
+	 * @brief	Distance from a point to the closest point of the surface, negative inside of it.
+	 * 			Used to build the distance field for approximate soft shadows and ambient
+	 * 			occlusion. The value may be less than the true distance but never more, so that
+	 * 			marching by it cannot step through the surface.
+	 *
+	 * @param	point	The point.
+	 * @param	time 	(Optional) Time within the shutter interval.
+	 *
+	 * @returns	The signed distance. INFINITY for surfaces that are left out of the field.
+	 */
+	virtual double signedDistance(const dvec3 & point, const double & time = 0.0) const { return INFINITY; }
+
+	/**
+	 * @fn	virtual std::shared_ptr<ImplicitSurface> ImplicitSurface::clone() const;
+	 *
+	 * @brief	Copies the surface, keeping its type. Used to change a surface in a new version of
+	 * 			a scene without changing the versions that are still being rendered.
+	 *
+	 * @returns	The copy.
+	 */
+	virtual std::shared_ptr<ImplicitSurface> clone() const { return std::make_shared<ImplicitSurface>(*this); }
 
 	/** @brief	Material properties of the surface. */
 	Material material;
+
+	/**
+	 * @brief	Kinds of rays that can see the surface as a combination of RAY_TYPE bits. Clearing
+	 * 			SHADOW_RAY for surfaces that never shade anything relevant (ground planes,
+	 * 			background geometry) keeps shadow feelers from testing them. Clearing VIEW_RAY or
+	 * 			SECONDARY_RAY hides the surface from the camera or from reflections.
+	 */
+	unsigned int visibility = ALL_RAY_TYPES;
 };
 
@@ -11,7 +11,7 @@ ImplicitSurface::ImplicitSurface( const Material & mat )
 {
 }
 
-HitRecord ImplicitSurface::findIntersect( const Ray & ray )
+HitRecord ImplicitSurface::findIntersect( const Ray & ray, const OriginTerms * originTerms )
 {
 	HitRecord hitRecord;
 	hitRecord.t = INFINITY;
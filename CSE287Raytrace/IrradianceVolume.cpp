@@ -0,0 +1,255 @@
+#include "IrradianceVolume.h"
+
+// Times the whole grid is traced after a change, so light that bounces more than once settles
+static const int SETTLING_PASSES = 3;
+
+// Share of the rays of a probe that may hit the back of a surface before the probe is taken to
+// be buried inside it
+static const double BACK_FACE_FRACTION = 0.25;
+
+// Distance a shading point is moved along its normal before the probes are looked up, as a
+// fraction of the smallest spacing of the probes. Keeps surfaces from shadowing themselves.
+static const double NORMAL_BIAS = 0.1;
+
+// Farthest distance recorded by a probe as a multiple of the diagonal of a cell of the grid
+static const double MAX_DISTANCE_SCALE = 1.5;
+
+/**
+ * @fn	static void shBasis(const dvec3 & direction, double basis[9])
+ *
+ * @brief	Evaluates the real spherical harmonics of the first three bands in a unit direction.
+ * 			The first entry is band zero, the next three band one, and the last five band two.
+ */
+static void shBasis(const dvec3 & direction, double basis[9])
+{
+	const double x = direction.x, y = direction.y, z = direction.z;
+
+	basis[0] = 0.282095;
+
+	basis[1] = 0.488603 * y;
+	basis[2] = 0.488603 * z;
+	basis[3] = 0.488603 * x;
+
+	basis[4] = 1.092548 * x * y;
+	basis[5] = 1.092548 * y * z;
+	basis[6] = 0.315392 * (3.0 * z * z - 1.0);
+	basis[7] = 1.092548 * x * z;
+	basis[8] = 0.546274 * (x * x - y * y);
+}
+
+
+void IrradianceVolume::reset(const BoundingBox& bounds, const int& resolution)
+{
+	this->bounds = bounds;
+	this->resolution = glm::max(resolution, 2);
+
+	// Flat boxes still get a grid that can be divided by
+	spacing = glm::max((bounds.maxCorner - bounds.minCorner) / (this->resolution - 1.0), dvec3(EPSILON));
+	maxDistance = MAX_DISTANCE_SCALE * glm::length(spacing);
+
+	probes.assign(this->resolution * this->resolution * this->resolution, IrradianceProbe());
+
+	cursor = 0;
+	duePasses = SETTLING_PASSES;
+
+} // end reset
+
+
+void IrradianceVolume::invalidate()
+{
+	cursor = 0;
+	duePasses = SETTLING_PASSES;
+
+} // end invalidate
+
+
+std::vector<int> IrradianceVolume::takeDueProbes(const int& budget)
+{
+	std::vector<int> due;
+
+	while (duePasses > 0 && (int)due.size() < budget) {
+
+		due.push_back(cursor++);
+
+		// A probe is traced at most once per call so that each pass sees the one before
+		if (cursor == (int)probes.size()) {
+			cursor = 0;
+			duePasses--;
+			break;
+		}
+	}
+
+	return due;
+
+} // end takeDueProbes
+
+
+IrradianceProbe IrradianceVolume::project(const std::vector<dvec3>& directions, const std::vector<color>& radiance,
+										  const std::vector<double>& distances, const std::vector<char>& backFaces)
+{
+	IrradianceProbe probe;
+
+	int count = (int)directions.size();
+	if (count == 0) {
+		return probe;
+	}
+
+	// Every ray stands for an equal share of the sphere
+	double share = 4.0 * PI / count;
+	int backFaceCount = 0;
+
+	for (int i = 0; i < count; i++) {
+
+		double basis[9];
+		shBasis(directions[i], basis);
+
+		// The back of a surface gives off nothing a probe outside of it should see
+		dvec3 light = backFaces[i] ? dvec3(0.0) : dvec3(radiance[i]);
+		if (backFaces[i]) {
+			backFaceCount++;
+		}
+
+		for (int c = 0; c < 9; c++) {
+			probe.irradiance[c] += share * basis[c] * light;
+		}
+
+		for (int c = 0; c < 4; c++) {
+			probe.meanDistance[c] += share * basis[c] * distances[i];
+			probe.meanSquaredDistance[c] += share * basis[c] * distances[i] * distances[i];
+		}
+	}
+
+	// Convolving with the cosine lobe scales each band (Ramamoorthi and Hanrahan 2001). The
+	// distances are averaged over the lobe, so their bands are divided by its integral.
+	for (int c = 0; c < 9; c++) {
+		probe.irradiance[c] *= c == 0 ? PI : c < 4 ? 2.0 * PI / 3.0 : PI / 4.0;
+	}
+
+	for (int c = 1; c < 4; c++) {
+		probe.meanDistance[c] *= 2.0 / 3.0;
+		probe.meanSquaredDistance[c] *= 2.0 / 3.0;
+	}
+
+	probe.traced = true;
+	probe.active = backFaceCount <= BACK_FACE_FRACTION * count;
+
+	return probe;
+
+} // end project
+
+
+bool IrradianceVolume::getIrradiance(const dvec3& point, const dvec3& normal, color& irradiance) const
+{
+	if (probes.empty()) {
+		return false;
+	}
+
+	double minSpacing = glm::min(spacing.x, glm::min(spacing.y, spacing.z));
+	dvec3 biased = point + NORMAL_BIAS * minSpacing * normal;
+
+	// Cell of the grid containing the point and where the point lies within it
+	dvec3 grid = glm::clamp((biased - bounds.minCorner) / spacing, 0.0, resolution - 1.0);
+	int base[3];
+	dvec3 fraction;
+
+	for (int axis = 0; axis < 3; axis++) {
+		base[axis] = glm::min((int)grid[axis], resolution - 2);
+		fraction[axis] = grid[axis] - base[axis];
+	}
+
+	double normalBasis[9];
+	shBasis(normal, normalBasis);
+
+	dvec3 total(0.0);
+	double totalWeight = 0.0;
+
+	for (int corner = 0; corner < 8; corner++) {
+
+		int offset[3] = { corner & 1, (corner >> 1) & 1, (corner >> 2) & 1 };
+		int index = (base[0] + offset[0]) + resolution * ((base[1] + offset[1]) + resolution * (base[2] + offset[2]));
+
+		const IrradianceProbe& probe = probes[index];
+
+		if (!probe.traced || !probe.active) {
+			continue;
+		}
+
+		dvec3 toPoint = biased - getProbePosition(index);
+		double distance = glm::length(toPoint);
+		dvec3 direction = distance > 0.0 ? toPoint / distance : normal;
+
+		// Probes behind the surface see little of the light arriving at it
+		double facing = 0.5 * (1.0 - glm::dot(direction, normal));
+		double weight = facing * facing + 0.2;
+
+		double basis[9];
+		shBasis(direction, basis);
+
+		double mean = 0.0, meanSquared = 0.0;
+		for (int c = 0; c < 4; c++) {
+			mean += probe.meanDistance[c] * basis[c];
+			meanSquared += probe.meanSquaredDistance[c] * basis[c];
+		}
+
+		// Chebyshev's inequality bounds the chance that the point can be seen from the probe
+		// when it lies beyond the surfaces the probe usually sees in its direction
+		if (distance > mean) {
+
+			double variance = glm::abs(meanSquared - mean * mean);
+			double excess = distance - mean;
+			double chebyshev = variance / (variance + excess * excess);
+
+			weight *= chebyshev * chebyshev * chebyshev;
+		}
+
+		// A probe that seems hidden still counts for a little, so corners hidden from every
+		// probe are not black
+		weight = glm::max(weight, 1e-6);
+
+		for (int axis = 0; axis < 3; axis++) {
+			weight *= offset[axis] != 0 ? fraction[axis] : 1.0 - fraction[axis];
+		}
+
+		dvec3 light(0.0);
+		for (int c = 0; c < 9; c++) {
+			light += normalBasis[c] * probe.irradiance[c];
+		}
+
+		total += weight * glm::max(light, dvec3(0.0));
+		totalWeight += weight;
+	}
+
+	if (totalWeight <= 0.0) {
+		return false;
+	}
+
+	irradiance = color(total / totalWeight, 1.0);
+
+	return true;
+
+} // end getIrradiance
+
+
+dvec3 IrradianceVolume::getRayDirection(const int& ray, const int& rayCount)
+{
+	// Each ray turns by the golden angle and steps down in z by an equal area
+	const double goldenAngle = PI * (3.0 - sqrt(5.0));
+
+	double z = 1.0 - (2.0 * ray + 1.0) / rayCount;
+	double radius = sqrt(glm::max(1.0 - z * z, 0.0));
+	double phi = goldenAngle * ray;
+
+	return dvec3(radius * cos(phi), radius * sin(phi), z);
+
+} // end getRayDirection
+
+
+dvec3 IrradianceVolume::getProbePosition(const int& probe) const
+{
+	int x = probe % resolution;
+	int y = (probe / resolution) % resolution;
+	int z = probe / (resolution * resolution);
+
+	return bounds.minCorner + spacing * dvec3(x, y, z);
+
+} // end getProbePosition
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <vector>
+
+#include "BoundingBox.h"
+#include "Sampling.h"
+
+/**
+ * @struct	IrradianceProbe
+ *
+ * @brief	Light arriving at one point of space from every direction, stored as low order
+ * 			spherical harmonics, and how far a ray travels from the point in every direction.
+ */
+struct IrradianceProbe
+{
+	/** @brief	Irradiance on a surface facing each direction as second order spherical
+	harmonics. The cosine lobe is already applied to the coefficients. */
+	dvec3 irradiance[9];
+
+	/** @brief	Mean distance to the closest surface as first order spherical harmonics,
+	averaged over the cosine lobe about each direction */
+	double meanDistance[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+	/** @brief	Mean squared distance to the closest surface, stored like meanDistance */
+	double meanSquaredDistance[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+	/** @brief	True once the probe has been traced */
+	bool traced = false;
+
+	/** @brief	False for probes buried inside surfaces, whose rays mostly hit the back of
+	something. They are left out when shading. */
+	bool active = true;
+};
+
+
+/**
+ * @class	IrradianceVolume
+ *
+ * @brief	Grid of irradiance probes over a box, used as the indirect diffuse light of points
+ * 			inside the box (in the style of "Dynamic Diffuse Global Illumination with Ray-Traced
+ * 			Irradiance Fields", Majercik et al. 2019). Shading blends the eight probes around a
+ * 			point with trilinear weights, leaving out probes that face away from the surface or
+ * 			that the stored distances say are hidden from the point, so light does not leak
+ * 			through walls.
+ *
+ * 			The volume does not trace rays itself. The ray tracer asks for the probes that are
+ * 			due, traces and shades rays from them, projects the results with project, and hands
+ * 			the new probes to store once no thread is shading. Probes are only due after
+ * 			invalidate is called for a change of the scene. Since the rays of a probe are shaded
+ * 			with the probes traced before, the volume is traced a few times over after every
+ * 			change so that light bouncing more than once settles.
+ */
+class IrradianceVolume
+{
+public:
+
+	/**
+	 * @fn	void IrradianceVolume::reset(const BoundingBox & bounds, const int & resolution);
+	 *
+	 * @brief	Places a new grid of untraced probes and makes all of them due.
+	 *
+	 * @param	bounds	  	Box the corners of the grid lie on.
+	 * @param	resolution	Number of probes along each axis. At least two.
+	 */
+	void reset(const BoundingBox & bounds, const int & resolution);
+
+
+	/**
+	 * @fn	void IrradianceVolume::invalidate();
+	 *
+	 * @brief	Makes every probe due again after a change of the scene. Probes keep their old
+	 * 			light until they are traced again.
+	 */
+	void invalidate();
+
+
+	/**
+	 * @fn	std::vector<int> IrradianceVolume::takeDueProbes(const int & budget);
+	 *
+	 * @brief	Chooses the next probes to trace, going through the grid in order.
+	 *
+	 * @param	budget	Most probes returned.
+	 *
+	 * @returns	Indices of the probes. Empty once nothing is due.
+	 */
+	std::vector<int> takeDueProbes(const int & budget);
+
+
+	/**
+	 * @fn	static IrradianceProbe IrradianceVolume::project(const std::vector<dvec3> & directions, const std::vector<color> & radiance, const std::vector<double> & distances, const std::vector<char> & backFaces);
+	 *
+	 * @brief	Builds a probe from rays traced from its position in directions spread evenly over
+	 * 			the sphere.
+	 *
+	 * @param	directions	Unit direction of each ray.
+	 * @param	radiance  	Light arriving along each ray.
+	 * @param	distances 	Distance each ray traveled, no more than getMaxDistance.
+	 * @param	backFaces 	Nonzero for rays that hit the back of a surface.
+	 *
+	 * @returns	The probe.
+	 */
+	static IrradianceProbe project(const std::vector<dvec3> & directions, const std::vector<color> & radiance,
+								   const std::vector<double> & distances, const std::vector<char> & backFaces);
+
+
+	/**
+	 * @fn	void IrradianceVolume::store(const int & probe, const IrradianceProbe & traced);
+	 *
+	 * @brief	Replaces a probe. Must not be called while other threads are shading.
+	 */
+	void store(const int & probe, const IrradianceProbe & traced) { probes[probe] = traced; }
+
+
+	/**
+	 * @fn	bool IrradianceVolume::getIrradiance(const dvec3 & point, const dvec3 & normal, color & irradiance) const;
+	 *
+	 * @brief	Interpolates the irradiance of a surface from the probes around it. Points outside
+	 * 			of the box use the probes on its closest face.
+	 *
+	 * @param 		  	point	  	Point on the surface.
+	 * @param 		  	normal	  	Unit normal of the surface at the point.
+	 * @param [out]	irradiance	Light arriving at the surface per unit area.
+	 *
+	 * @returns	False if none of the probes around the point have been traced.
+	 */
+	bool getIrradiance(const dvec3 & point, const dvec3 & normal, color & irradiance) const;
+
+
+	/**
+	 * @fn	static dvec3 IrradianceVolume::getRayDirection(const int & ray, const int & rayCount);
+	 *
+	 * @brief	Direction of a ray of a probe. The directions of a probe form a spherical
+	 * 			Fibonacci set, which covers the sphere evenly for any number of rays.
+	 *
+	 * @param	ray	 	Index of the ray.
+	 * @param	rayCount	Number of rays traced from the probe.
+	 *
+	 * @returns	The unit direction.
+	 */
+	static dvec3 getRayDirection(const int & ray, const int & rayCount);
+
+
+	/** @returns	Position of a probe. */
+	dvec3 getProbePosition(const int & probe) const;
+
+	/** @returns	Distance recorded for rays that hit nothing or hit something farther away. */
+	double getMaxDistance() const { return maxDistance; }
+
+	/** @returns	Number of probes in the grid. Zero until reset. */
+	int getProbeCount() const { return (int)probes.size(); }
+
+	/** @returns	Box the corners of the grid lie on. */
+	const BoundingBox & getBounds() const { return bounds; }
+
+protected:
+
+	/** @brief	Box the corners of the grid lie on */
+	BoundingBox bounds;
+
+	/** @brief	Number of probes along each axis */
+	int resolution = 0;
+
+	/** @brief	Distance between neighboring probes along each axis */
+	dvec3 spacing;
+
+	/** @brief	Distance recorded for rays that travel farther */
+	double maxDistance = 0.0;
+
+	/** @brief	Probes ordered by x, then y, then z */
+	std::vector<IrradianceProbe> probes;
+
+	/** @brief	Next probe to trace */
+	int cursor = 0;
+
+	/** @brief	Number of times the whole grid is still to be traced */
+	int duePasses = 0;
+
+}; // end IrradianceVolume class
@@ -14,11 +14,21 @@ const color LIGHT_BLUE(0.784, 0.784, 1.0, 1.0);
 
 // Raytracer
 RayTracer rayTrace(frameBuffer, LIGHT_BLUE );
-// Light sources in the scene
-shared_ptr<LightSource> ambientLight;
-shared_ptr<PositionalLight> lightPos;
-shared_ptr<DirectionalLight> lightDir;
-shared_ptr<SpotLight> lightspt;
+// Scene rendered by the ray tracer. Edited by publishing new versions so that an edit never
+// changes a scene that is being rendered.
+SceneVersions sceneVersions;
+
+// Index of each light source in the lights of the scene
+const int POSITIONAL_LIGHT = 0;
+const int DIRECTIONAL_LIGHT = 1;
+const int AMBIENT_LIGHT = 2;
+const int SPOT_LIGHT = 3;
+
+// Moment the program started, for reporting the time to the first frame
+std::chrono::steady_clock::time_point programStart;
+
+// Set when the first frame was rendered during startup and has not been shown yet
+bool firstFrameRendered = false;
 
 //*********** END OF GLOBAL DECLARATIONS **********//
 
@@ -35,12 +45,25 @@ static void RenderSceneCB()
 	// Clear the color buffer
 	//frameBuffer.clearColorAndDepthBuffers( ); // Not necessary for ray tracing
 
-	// Ray trace the scene to determine the color of all the pixels in the scene
-	rayTrace.raytraceScene( );
+	// Ray trace the scene to determine the color of all the pixels in the scene. The first
+	// frame is already rendered by the time the window appears.
+	if (firstFrameRendered) {
+		firstFrameRendered = false;
+	}
+	else {
+		rayTrace.raytraceScene( );
+	}
 
 	// Display the color buffer
 	frameBuffer.showColorBuffer();
 
+	static bool firstFrameShown = false;
+	if (!firstFrameShown) {
+		firstFrameShown = true;
+		cout << "Time to first frame: "
+			<< std::chrono::duration<double>(std::chrono::steady_clock::now() - programStart).count() << " sec." << endl;
+	}
+
 	// Calculate and display time required to render scene.
 	int frameEndTime = glutGet( GLUT_ELAPSED_TIME ); // Get end time
 
@@ -63,6 +86,14 @@ static void RenderSceneCB()
  */
 static void ResizeCB(int width, int height)
 {
+	// Keep the first frame if it was rendered at the size the window opened with
+	if (firstFrameRendered && width == frameBuffer.getWindowWidth() && height == frameBuffer.getWindowHeight()) {
+		glutPostRedisplay();
+		return;
+	}
+
+	firstFrameRendered = false;
+
 	// Size the color buffer to match the window size.
 	frameBuffer.setFrameBufferSize( width, height );
 
@@ -118,19 +149,19 @@ static void KeyboardCB(unsigned char key, int x, int y)
 		break;
 	case( 'a' ):
 		// Toggle light on and off
-		ambientLight->enabled = (ambientLight->enabled) ? false : true;
+		toggleLight( AMBIENT_LIGHT );
 		break;
 	case( 'p' ):
 		// Toggle light on and off
-		lightPos->enabled = ( lightPos->enabled ) ? false : true;
+		toggleLight( POSITIONAL_LIGHT );
 		break;
 	case( 'd' ):
 		// Toggle light on and off
-		lightDir->enabled = ( lightDir->enabled ) ? false : true;
+		toggleLight( DIRECTIONAL_LIGHT );
 		break;
 	case( 's' ):
 		// Toggle light on and off
-		lightspt->enabled = ( lightspt->enabled ) ? false : true;
+		toggleLight( SPOT_LIGHT );
 		break;
 	default:
 		std::cout << key << " key pressed." << std::endl;
@@ -141,6 +172,23 @@ static void KeyboardCB(unsigned char key, int x, int y)
 } // end KeyboardCB
 
 
+/**
+ * @fn	static void toggleLight(const int & index)
+ *
+ * @brief	Turns a light on or off in a new version of the scene.
+ *
+ * @param	index	Index of the light in the lights of the scene.
+ */
+static void toggleLight(const int & index)
+{
+	sceneVersions.edit([index](SceneVersions::Edit & edit) {
+		shared_ptr<LightSource> light = edit.modifyLight<LightSource>(index);
+		light->enabled = !light->enabled;
+	});
+
+} // end toggleLight
+
+
 /**
  * @fn	static void SpecialKeysCB(int key, int x, int y)
  *
@@ -186,8 +234,8 @@ static void animate()
  * @fn	void buildScene()
  *
  * @brief	Builds the scene by dynamically allocating ImplicitShape
- * 			objects and Light objects. and adding them to the raytracer 
- * 			surfaces vector.
+ * 			objects and Light objects. and publishing them as the first 
+ * 			version of the scene rendered by the raytracer.
  * 			
  */
 void buildScene()
@@ -207,21 +255,30 @@ void buildScene()
 	shared_ptr<Sphere> blueBall = make_shared<Sphere>(dvec3(-3.0, -1.0, -10.0), 1.5, BLUE);
 
 	shared_ptr<Plane> yellow = make_shared<Plane>(dvec3(0.0f, -2.0f, 0.0f), glm::normalize(dvec3(0.0f, 1.0f, 0.0f)), color(0.5f, 0.3f, 0.0f, 1.0f));
-	rayTrace.surfaces.push_back(yellow);
-	rayTrace.surfaces.push_back(redBall);
-	rayTrace.surfaces.push_back(greenBall);
-	rayTrace.surfaces.push_back(blueBall);
 
-	// Create light sources and add them to the scene.
+	// Every light is above the ground plane so it cannot shadow anything. Keep shadow feelers from testing it.
+	yellow->visibility = VIEW_RAY | SECONDARY_RAY;
+
+	// Create light sources. They are added to the scene in the order of their indices.
 	shared_ptr<LightSource> ambientLight = make_shared<LightSource>(color(0.15, 0.15, 0.15, 1.0));
 	shared_ptr<PositionalLight> lightPos = make_shared<PositionalLight>(dvec3(-10.0, 10.0, 10.0), color(1.0, 1.0, 1.0, 1));
 	shared_ptr<DirectionalLight> lightDir = make_shared<DirectionalLight>(dvec3(1, 1, 1), color(0.75, 0.75, 0.75, 1));
 	shared_ptr<SpotLight> lightspt = make_shared<SpotLight>(dvec3(0, 10, -30), dvec3(0, 1, 0), 0.5, color(0.65, 0.65, 0.65, 1));
 
-	rayTrace.lights.push_back(lightPos);
-	rayTrace.lights.push_back(lightDir);
-	rayTrace.lights.push_back(ambientLight);
-	rayTrace.lights.push_back(lightspt);
+	sceneVersions.edit([&](SceneVersions::Edit & edit) {
+
+		edit.surfaces.push_back(yellow);
+		edit.surfaces.push_back(redBall);
+		edit.surfaces.push_back(greenBall);
+		edit.surfaces.push_back(blueBall);
+
+		edit.lights.push_back(lightPos);
+		edit.lights.push_back(lightDir);
+		edit.lights.push_back(ambientLight);
+		edit.lights.push_back(lightspt);
+	});
+
+	rayTrace.setSceneVersions(&sceneVersions);
 }
 
 
@@ -243,6 +300,25 @@ void buildScene()
 
 int main(int argc, char** argv)
 {
+	programStart = std::chrono::steady_clock::now();
+
+	// Set the color to which pixels will be cleared if there is no intersection.
+	rayTrace.setDefaultColor(color(.5, .5, .75, 1));
+
+	// Startup stages that do not need the window run while it is created. The first frame is
+	// rendered at the size the window is asked for, and shown when the window first appears.
+	TaskGraph startup;
+
+	int scene = startup.add("build scene", buildScene);
+
+	startup.add("render first frame", [] {
+		rayTrace.calculatePerspectiveViewingParameters(45.0);
+		rayTrace.raytraceScene();
+		firstFrameRendered = true;
+	}, { scene });
+
+	startup.start();
+
 	// freeGlut and Window initialization ***********************
 
     // Pass any applicable command line arguments to GLUT. These arguments
@@ -268,9 +344,6 @@ int main(int argc, char** argv)
 	// Set red, green, blue, and alpha to which the color buffer is cleared.
 	frameBuffer.setClearColor( BLACK );
 
-	// Set the color to which pixels will be cleared if there is no intersection.
-	rayTrace.setDefaultColor(color(.5, .5, .75, 1));
-
 	// Callbacks for window redisplay and other events
 	glutDisplayFunc(RenderSceneCB);		
 	glutReshapeFunc(ResizeCB);
@@ -278,8 +351,11 @@ int main(int argc, char** argv)
 	glutSpecialFunc(SpecialKeysCB);
 	//glutIdleFunc( animate );
 
-	// Create the objects and light sources.
-	buildScene();
+	// Callbacks change the scene and the frame buffer, so startup must be finished before
+	// any of them run
+	startup.wait();
+
+	cout << "Startup:" << endl << startup.getReport();
 
 	// Enter the GLUT main loop. Control will not return until the window is closed.
     glutMainLoop();
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <time.h> 
+#include <chrono>
 
 #include "RayTracer.h"
 #include "Sphere.h"
+#include "TaskGraph.h"
 
 // Acts as the display function for the window. 
 static void RenderSceneCB();
@@ -16,6 +18,9 @@ static void ResizeCB(int width, int height);
 // program. Allows lights to be individually turned on and off.
 static void KeyboardCB(unsigned char key, int x, int y);
 
+// Turns a light on or off in a new version of the scene.
+static void toggleLight(const int & index);
+
 // Responds to presses of the arrow keys
 static void SpecialKeysCB(int key, int x, int y);
 
@@ -41,6 +41,14 @@ struct LightSource
 
 	virtual double getLightDistance(dvec3 position) { return 0.0; }
 
+	/**
+	 * @fn	virtual shared_ptr<LightSource> clone() const
+	 *
+	 * @brief	Copies the light, keeping its type. Used to change a light in a new version of a
+	 * 			scene without changing the versions that are still being rendered.
+	 */
+	virtual shared_ptr<LightSource> clone() const { return make_shared<LightSource>(*this); }
+
 
 	/** @brief	Ambient color and intensity of the light.*/
 	color ambientLightColor = BLACK;
@@ -79,6 +87,9 @@ struct PositionalLight : public LightSource
 		: LightSource(lightColor), lightPosition(position)
 	{}
 
+	/** @brief	Copies the light. */
+	virtual shared_ptr<LightSource> clone() const override { return make_shared<PositionalLight>(*this); }
+
 	/**
 	 * @fn	virtual color getLocalIllumination(const glm::dvec3 & eyeVector, HitRecord & closestHit)
 	 *
@@ -125,6 +136,39 @@ struct PositionalLight : public LightSource
 }; // end PositionalLight struct
 
 
+/**
+ * @struct	SphericalLight
+ *
+ * @brief	Positional light that gives off light from the surface of a sphere rather than from
+ * 			a single point. Shading is the same as for a positional light at the center. With
+ * 			analytic visibility turned on, points that see only part of the sphere are in soft
+ * 			shadow. Otherwise the light casts the hard shadows of its center.
+ */
+struct SphericalLight : public PositionalLight
+{
+	/**
+	 * @fn	SphericalLight(glm::dvec3 position, double radius, const color & lightColor)
+	 *
+	 * @brief	Constructor
+	 *
+	 * @param	position  	The position of the center of the light relative to World
+	 * 						coordinates.
+	 * @param	radius	  	Radius of the light.
+	 * @param	lightColor	Ambient and diffuse color of the light.
+	 */
+	SphericalLight(glm::dvec3 position, double radius, const color& lightColor)
+		: PositionalLight(position, lightColor), radius(radius)
+	{}
+
+	/** @brief	Copies the light. */
+	virtual shared_ptr<LightSource> clone() const override { return make_shared<SphericalLight>(*this); }
+
+	/** @brief	Radius of the sphere that gives off the light. */
+	double radius;
+
+}; // end SphericalLight struct
+
+
 /**
  * @struct	DirectionalLight
  *
@@ -139,6 +183,9 @@ struct DirectionalLight : public LightSource
 		: LightSource(lightColor), lightDirection(glm::normalize(direction))
 	{}
 
+	/** @brief	Copies the light. */
+	virtual shared_ptr<LightSource> clone() const override { return make_shared<DirectionalLight>(*this); }
+
 
 	/**
 	 * @fn	virtual color getLocalIllumination(const glm::dvec3 & eyeVector, HitRecord & closestHit)
@@ -196,6 +243,9 @@ struct SpotLight : public PositionalLight
 	{
 	}
 
+	/** @brief	Copies the light. */
+	virtual shared_ptr<LightSource> clone() const override { return make_shared<SpotLight>(*this); }
+
 
 	virtual color getLocalIllumination(const dvec3& eyeVector, const dvec3& position,
 		const dvec3& normal, const Material& material,
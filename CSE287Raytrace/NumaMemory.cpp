@@ -0,0 +1,261 @@
+#include "NumaMemory.h"
+
+#include <atomic>
+#include <string>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <cctype>
+#include <dirent.h>
+#include <fstream>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#endif
+
+
+int NumaMemory::getNodeCount()
+{
+	// The topology does not change while the program runs
+	static const int nodeCount = [] {
+
+		int count = 1;
+
+#if defined(_WIN32)
+
+		ULONG highestNode = 0;
+		if (GetNumaHighestNodeNumber(&highestNode)) {
+			count = (int)highestNode + 1;
+		}
+
+#elif defined(__linux__)
+
+		DIR* directory = opendir("/sys/devices/system/node");
+
+		if (directory != nullptr) {
+
+			int found = 0;
+			dirent* entry;
+
+			while ((entry = readdir(directory)) != nullptr) {
+				std::string name = entry->d_name;
+				if (name.compare(0, 4, "node") == 0 && name.size() > 4 && isdigit((unsigned char)name[4])) {
+					found++;
+				}
+			}
+
+			closedir(directory);
+
+			if (found > 0) {
+				count = found;
+			}
+		}
+
+#endif
+
+		return count;
+	}();
+
+	return nodeCount;
+
+} // end getNodeCount
+
+
+int NumaMemory::getCurrentNode()
+{
+	if (getNodeCount() == 1) {
+		return 0;
+	}
+
+#if defined(_WIN32)
+
+	PROCESSOR_NUMBER processor;
+	GetCurrentProcessorNumberEx(&processor);
+
+	USHORT node = 0;
+	if (GetNumaProcessorNodeEx(&processor, &node)) {
+		return (int)node;
+	}
+
+#elif defined(__linux__)
+
+	unsigned int cpu = 0, node = 0;
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+		return (int)node;
+	}
+
+#endif
+
+	return 0;
+
+} // end getCurrentNode
+
+
+bool NumaMemory::pinThread(const int& node)
+{
+	if (node < 0 || node >= getNodeCount()) {
+		return false;
+	}
+
+#if defined(_WIN32)
+
+	GROUP_AFFINITY affinity = {};
+	if (!GetNumaNodeProcessorMaskEx((USHORT)node, &affinity)) {
+		return false;
+	}
+
+	return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+
+#elif defined(__linux__)
+
+	// The processors of a node are listed as ranges, such as 0-7,16-23
+	std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+	std::string list;
+
+	if (!std::getline(file, list)) {
+		return false;
+	}
+
+	cpu_set_t processors;
+	CPU_ZERO(&processors);
+
+	size_t position = 0;
+	while (position < list.size()) {
+
+		size_t end = list.find(',', position);
+		if (end == std::string::npos) {
+			end = list.size();
+		}
+
+		std::string range = list.substr(position, end - position);
+		size_t dash = range.find('-');
+
+		int first = std::stoi(range);
+		int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+		for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+			CPU_SET(cpu, &processors);
+		}
+
+		position = end + 1;
+	}
+
+	return sched_setaffinity(0, sizeof(processors), &processors) == 0;
+
+#else
+
+	return false;
+
+#endif
+
+} // end pinThread
+
+
+void* NumaMemory::allocate(const size_t& bytes, const int& node)
+{
+	bool placed = node >= 0 && getNodeCount() > 1;
+
+#if defined(_WIN32)
+
+	// Large pages need the "lock pages in memory" privilege. It is checked and turned on once,
+	// and large pages are not asked for again after the first refusal, so allocations without
+	// them do not pay for a failed request each time.
+	static const SIZE_T largePage = [] {
+
+		HANDLE token;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+			return (SIZE_T)0;
+		}
+
+		TOKEN_PRIVILEGES privileges;
+		privileges.PrivilegeCount = 1;
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+		// The privilege is only turned on if the account holds it
+		bool enabled = LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+			AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+			GetLastError() == ERROR_SUCCESS;
+
+		CloseHandle(token);
+
+		return enabled ? GetLargePageMinimum() : (SIZE_T)0;
+	}();
+
+	static std::atomic<bool> largePagesRefused{ false };
+
+	void* block = nullptr;
+
+	if (largePage > 0 && !largePagesRefused.load(std::memory_order_relaxed)) {
+
+		SIZE_T rounded = (bytes + largePage - 1) / largePage * largePage;
+		DWORD type = MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES;
+
+		block = placed ? VirtualAllocExNuma(GetCurrentProcess(), nullptr, rounded, type, PAGE_READWRITE, (DWORD)node)
+			: VirtualAlloc(nullptr, rounded, type, PAGE_READWRITE);
+
+		if (block == nullptr) {
+			largePagesRefused.store(true, std::memory_order_relaxed);
+		}
+	}
+
+	if (block == nullptr) {
+		block = placed ? VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, (DWORD)node)
+			: VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+
+	if (block == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return block;
+
+#elif defined(__linux__)
+
+	void* block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (block == MAP_FAILED) {
+		throw std::bad_alloc();
+	}
+
+	// Transparent huge pages back the block if the system has them turned on for advised memory
+	madvise(block, bytes, MADV_HUGEPAGE);
+
+	// Nothing has been touched yet, so every page lands on the preferred node
+	if (placed) {
+		unsigned long mask[4] = { 0, 0, 0, 0 };
+		if (node < (int)(8 * sizeof(mask))) {
+			mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+			syscall(SYS_mbind, block, bytes, MPOL_PREFERRED, mask, 8 * sizeof(mask), 0);
+		}
+	}
+
+	return block;
+
+#else
+
+	return ::operator new(bytes);
+
+#endif
+
+} // end allocate
+
+
+void NumaMemory::release(void* block, const size_t& bytes)
+{
+	if (block == nullptr) {
+		return;
+	}
+
+#if defined(_WIN32)
+	VirtualFree(block, 0, MEM_RELEASE);
+#elif defined(__linux__)
+	munmap(block, bytes);
+#else
+	::operator delete(block);
+#endif
+
+} // end release
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+/**
+ * @class	NumaMemory
+ *
+ * @brief	Placement of memory and threads on machines with more than one memory node. On such
+ * 			machines memory is fastest to reach from the processors of the node it lives on, and
+ * 			by default it lives on the node of the thread that first touched it. Also backs large
+ * 			blocks with huge pages where the system allows it, so that walking them misses the
+ * 			translation lookaside buffer less often.
+ *
+ * 			Implemented on Windows and Linux. Elsewhere the machine is treated as a single node
+ * 			and large blocks come from the ordinary heap.
+ */
+class NumaMemory
+{
+public:
+
+	/** @brief	Smallest block worth backing with huge pages: one 2 MB page */
+	static const size_t LARGE_BLOCK = 2 * 1024 * 1024;
+
+
+	/** @returns	Number of memory nodes in the machine. 1 where it cannot be found. */
+	static int getNodeCount();
+
+
+	/** @returns	Memory node of the processor running the calling thread. 0 where it cannot be found. */
+	static int getCurrentNode();
+
+
+	/**
+	 * @fn	static bool NumaMemory::pinThread(const int & node);
+	 *
+	 * @brief	Restricts the calling thread to the processors of a memory node.
+	 *
+	 * @param	node	The node.
+	 *
+	 * @returns	False if the thread could not be pinned.
+	 */
+	static bool pinThread(const int & node);
+
+
+	/**
+	 * @fn	static void * NumaMemory::allocate(const size_t & bytes, const int & node = -1);
+	 *
+	 * @brief	Allocates a large block directly from the operating system, asking for huge pages
+	 * 			and for the memory to be placed on a node. Where the system refuses huge pages,
+	 * 			later blocks do not ask for them again.
+	 *
+	 * @param	bytes	Size of the block.
+	 * @param	node 	(Optional) Node to place the block on. Negative leaves placement to the
+	 * 					system, which puts each page on the node of the thread that first touches it.
+	 *
+	 * @returns	The block, aligned to a page. Throws std::bad_alloc if none is available.
+	 */
+	static void * allocate(const size_t & bytes, const int & node = -1);
+
+
+	/**
+	 * @fn	static void NumaMemory::release(void * block, const size_t & bytes);
+	 *
+	 * @brief	Frees a block returned by allocate.
+	 *
+	 * @param	block	The block.
+	 * @param	bytes	Size the block was allocated with.
+	 */
+	static void release(void * block, const size_t & bytes);
+
+}; // end NumaMemory class
+
+
+/**
+ * @class	NodeAllocator
+ *
+ * @brief	Allocator for standard containers that takes arrays of at least LARGE_BLOCK bytes from
+ * 			NumaMemory, on a given memory node and backed by huge pages, and smaller ones from
+ * 			the heap.
+ */
+template <class T>
+class NodeAllocator
+{
+public:
+
+	typedef T value_type;
+
+	/**
+	 * @fn	NodeAllocator::NodeAllocator(const int & node = -1)
+	 *
+	 * @brief	Constructor.
+	 *
+	 * @param	node	(Optional) Node that large arrays are placed on. Negative leaves placement to
+	 * 					the system.
+	 */
+	NodeAllocator(const int & node = -1) : node(node) {}
+
+	template <class U>
+	NodeAllocator(const NodeAllocator<U> & other) : node(other.node) {}
+
+	T * allocate(size_t count)
+	{
+		size_t bytes = count * sizeof(T);
+
+		if (bytes >= NumaMemory::LARGE_BLOCK) {
+			return static_cast<T *>(NumaMemory::allocate(bytes, node));
+		}
+
+		return static_cast<T *>(::operator new(bytes));
+	}
+
+	void deallocate(T * block, size_t count)
+	{
+		size_t bytes = count * sizeof(T);
+
+		if (bytes >= NumaMemory::LARGE_BLOCK) {
+			NumaMemory::release(block, bytes);
+		}
+		else {
+			::operator delete(block);
+		}
+	}
+
+	template <class U>
+	bool operator==(const NodeAllocator<U> & other) const { return node == other.node; }
+
+	template <class U>
+	bool operator!=(const NodeAllocator<U> & other) const { return node != other.node; }
+
+	/** @brief	Node that large arrays are placed on */
+	int node;
+
+}; // end NodeAllocator class
@@ -0,0 +1,145 @@
+#include "ObjectProfiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "ThreadPool.h"
+
+
+void ObjectProfiler::reset(const int& threadCount, const int& surfaceCount, const int& lightCount)
+{
+	this->surfaceCount = surfaceCount;
+	this->lightCount = lightCount;
+
+	threads.resize(threadCount);
+
+	for (ThreadCounts& thread : threads) {
+
+		thread.tests.assign(surfaceCount, 0);
+		thread.hits.assign(surfaceCount, 0);
+		thread.shadingSeconds.assign(surfaceCount, 0.0);
+		thread.shadowRays.assign(lightCount, 0);
+		thread.blockedRays.assign(lightCount, 0);
+		thread.lastHit = -1;
+		thread.shadedSeconds = 0.0;
+	}
+
+} // end reset
+
+
+ObjectProfiler::ThreadCounts* ObjectProfiler::getThreadCounts()
+{
+	int index = ThreadPool::getThreadIndex();
+
+	return index < (int)threads.size() ? &threads[index] : nullptr;
+
+} // end getThreadCounts
+
+
+void ObjectProfiler::countShadowRays(const int& light, const long long& traced, const long long& blocked)
+{
+	ThreadCounts* counts = getThreadCounts();
+
+	if (counts != nullptr && light < lightCount) {
+		counts->shadowRays[light] += traced;
+		counts->blockedRays[light] += blocked;
+	}
+
+} // end countShadowRays
+
+
+std::string ObjectProfiler::getReport(const int& maxRows) const
+{
+	// Merge the counts of every thread
+	ThreadCounts total;
+	total.tests.assign(surfaceCount, 0);
+	total.hits.assign(surfaceCount, 0);
+	total.shadingSeconds.assign(surfaceCount, 0.0);
+	total.shadowRays.assign(lightCount, 0);
+	total.blockedRays.assign(lightCount, 0);
+
+	long long allTests = 0;
+	double allShading = 0.0;
+
+	for (const ThreadCounts& thread : threads) {
+
+		for (int s = 0; s < surfaceCount; s++) {
+			total.tests[s] += thread.tests[s];
+			total.hits[s] += thread.hits[s];
+			total.shadingSeconds[s] += thread.shadingSeconds[s];
+			allTests += thread.tests[s];
+			allShading += thread.shadingSeconds[s];
+		}
+
+		for (int l = 0; l < lightCount; l++) {
+			total.shadowRays[l] += thread.shadowRays[l];
+			total.blockedRays[l] += thread.blockedRays[l];
+		}
+	}
+
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(1);
+
+	// Indices of the objects with the largest values, largest first
+	auto rank = [&](int count, auto value) {
+
+		std::vector<int> order(count);
+		for (int i = 0; i < count; i++) {
+			order[i] = i;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return value(a) > value(b); });
+		order.resize(std::min(count, std::max(maxRows, 0)));
+
+		return order;
+	};
+
+	report << "Surfaces by intersection tests\n";
+	report << std::setw(10) << "surface" << std::setw(14) << "tests" << std::setw(9) << "share"
+		<< std::setw(12) << "hits" << std::setw(10) << "hit rate" << '\n';
+
+	for (int s : rank(surfaceCount, [&](int i) { return (double)total.tests[i]; })) {
+
+		if (total.tests[s] == 0) {
+			break;
+		}
+
+		report << std::setw(10) << s << std::setw(14) << total.tests[s]
+			<< std::setw(8) << 100.0 * total.tests[s] / allTests << '%'
+			<< std::setw(12) << total.hits[s]
+			<< std::setw(9) << 100.0 * total.hits[s] / total.tests[s] << "%\n";
+	}
+
+	report << "Surfaces by shading time\n";
+	report << std::setw(10) << "surface" << std::setw(14) << "ms" << std::setw(9) << "share"
+		<< std::setw(12) << "hits" << std::setw(10) << "us/hit" << '\n';
+
+	for (int s : rank(surfaceCount, [&](int i) { return total.shadingSeconds[i]; })) {
+
+		if (total.hits[s] == 0) {
+			break;
+		}
+
+		report << std::setw(10) << s << std::setw(14) << 1000.0 * total.shadingSeconds[s]
+			<< std::setw(8) << (allShading > 0.0 ? 100.0 * total.shadingSeconds[s] / allShading : 0.0) << '%'
+			<< std::setw(12) << total.hits[s]
+			<< std::setw(10) << std::setprecision(2) << 1.0e6 * total.shadingSeconds[s] / total.hits[s] << std::setprecision(1) << '\n';
+	}
+
+	report << "Lights by shadow rays\n";
+	report << std::setw(10) << "light" << std::setw(14) << "rays" << std::setw(9) << "blocked" << '\n';
+
+	for (int l : rank(lightCount, [&](int i) { return (double)total.shadowRays[i]; })) {
+
+		if (total.shadowRays[l] == 0) {
+			break;
+		}
+
+		report << std::setw(10) << l << std::setw(14) << total.shadowRays[l]
+			<< std::setw(8) << 100.0 * total.blockedRays[l] / total.shadowRays[l] << "%\n";
+	}
+
+	return report.str();
+
+} // end getReport
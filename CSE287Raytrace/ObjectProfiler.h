@@ -0,0 +1,159 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @class	ObjectProfiler
+ *
+ * @brief	Attributes the cost of a frame to individual surfaces and lights: intersection tests
+ * 			and closest hits of each surface, time spent shading each surface, and shadow rays
+ * 			traced toward each light along with how many were blocked. Surfaces and lights are
+ * 			identified by their index in the ray tracer's lists.
+ *
+ * 			Every thread counts into arrays of its own, so counting takes no locks. The arrays are
+ * 			merged when the report is made.
+ */
+class ObjectProfiler
+{
+public:
+
+	/**
+	 * @struct	ThreadCounts
+	 *
+	 * @brief	Counts of one thread, indexed by surface or light.
+	 */
+	struct ThreadCounts
+	{
+		/** @brief	Intersection tests of each surface, closest hit and occlusion alike */
+		std::vector<long long> tests;
+
+		/** @brief	Number of times each surface was the closest hit */
+		std::vector<long long> hits;
+
+		/** @brief	Seconds spent shading each surface, not counting nested shading */
+		std::vector<double> shadingSeconds;
+
+		/** @brief	Shadow rays traced toward each light */
+		std::vector<long long> shadowRays;
+
+		/** @brief	Shadow rays toward each light that were blocked */
+		std::vector<long long> blockedRays;
+
+		/** @brief	Surface of the last closest hit found by this thread. -1 if it missed. */
+		int lastHit = -1;
+
+		/** @brief	Shading time recorded by this thread so far. Used to leave nested shading out. */
+		double shadedSeconds = 0.0;
+	};
+
+
+	/**
+	 * @fn	void ObjectProfiler::reset(const int & threadCount, const int & surfaceCount, const int & lightCount);
+	 *
+	 * @brief	Clears the counts at the start of a frame. Must not be called while other threads
+	 * 			are counting.
+	 *
+	 * @param	threadCount 	Number of threads that may count.
+	 * @param	surfaceCount	Number of surfaces in the scene.
+	 * @param	lightCount  	Number of lights in the scene.
+	 */
+	void reset(const int & threadCount, const int & surfaceCount, const int & lightCount);
+
+
+	/**
+	 * @fn	ThreadCounts * ObjectProfiler::getThreadCounts();
+	 *
+	 * @brief	Counts of the calling thread. Looked up once per query rather than once per test.
+	 *
+	 * @returns	The counts. Null for threads that were not counted by reset.
+	 */
+	ThreadCounts * getThreadCounts();
+
+
+	/**
+	 * @fn	void ObjectProfiler::countShadowRays(const int & light, const long long & traced, const long long & blocked);
+	 *
+	 * @brief	Records shadow rays traced toward a light by the calling thread.
+	 */
+	void countShadowRays(const int & light, const long long & traced, const long long & blocked);
+
+
+	/**
+	 * @fn	std::string ObjectProfiler::getReport(const int & maxRows = 10) const;
+	 *
+	 * @brief	Merges the counts of every thread and ranks the objects: surfaces by intersection
+	 * 			tests, surfaces by shading time, and lights by shadow rays. Surfaces near the top
+	 * 			of the first table are the ones that most deserve tighter bounds or a visibility
+	 * 			mask.
+	 *
+	 * @param	maxRows	(Optional) Most objects listed in each table.
+	 *
+	 * @returns	The report.
+	 */
+	std::string getReport(const int & maxRows = 10) const;
+
+protected:
+
+	/** @brief	Counts of each thread */
+	std::vector<ThreadCounts> threads;
+
+	/** @brief	Number of surfaces counted */
+	int surfaceCount = 0;
+
+	/** @brief	Number of lights counted */
+	int lightCount = 0;
+
+}; // end ObjectProfiler class
+
+
+/**
+ * @class	ShadingTimer
+ *
+ * @brief	Adds the time from its construction to its destruction to the shading time of a
+ * 			surface, less any time recorded for other surfaces shaded in between, such as those
+ * 			seen in a reflection. Does nothing if given no counts.
+ */
+class ShadingTimer
+{
+public:
+
+	ShadingTimer(ObjectProfiler::ThreadCounts * counts, const int & surface)
+		: counts(counts), surface(surface)
+	{
+		if (counts != nullptr && surface >= 0) {
+			start = std::chrono::steady_clock::now();
+			shadedAtStart = counts->shadedSeconds;
+		}
+	}
+
+	~ShadingTimer()
+	{
+		if (counts != nullptr && surface >= 0) {
+
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			counts->shadingSeconds[surface] += seconds - (counts->shadedSeconds - shadedAtStart);
+			counts->shadedSeconds = shadedAtStart + seconds;
+		}
+	}
+
+	ShadingTimer(const ShadingTimer &) = delete;
+	ShadingTimer & operator=(const ShadingTimer &) = delete;
+
+protected:
+
+	/** @brief	Counts of the shading thread. Null when profiling is off. */
+	ObjectProfiler::ThreadCounts * counts;
+
+	/** @brief	Surface being shaded */
+	int surface;
+
+	/** @brief	Moment shading started */
+	std::chrono::steady_clock::time_point start;
+
+	/** @brief	Shading time of the thread when shading started */
+	double shadedAtStart = 0.0;
+
+}; // end ShadingTimer class
@@ -0,0 +1,318 @@
+#include "PerformanceCounters.h"
+
+#include <iomanip>
+#include <sstream>
+
+#include "ThreadPool.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Names of the phases and the events in the report
+static const char* PHASE_NAMES[PHASE_COUNT] = { "setup", "intersection", "shadow", "shading", "resolve" };
+static const char* EVENT_NAMES[PerformanceCounters::EVENT_COUNT] = { "cycles", "instructions", "L1D miss/ray", "LLC miss/ray", "branch miss/ray" };
+
+// Indices of the events whose columns are computed differently
+static const int CYCLES_EVENT = 0;
+static const int INSTRUCTIONS_EVENT = 1;
+
+
+PerformanceCounters::~PerformanceCounters()
+{
+	closeCounters();
+
+} // end ~PerformanceCounters
+
+
+void PerformanceCounters::reset(const int& threadCount)
+{
+	if ((int)threads.size() != threadCount) {
+
+		// Counters are tied to the threads that opened them, so they are opened again
+		closeCounters();
+		threads = std::vector<ThreadCounters>(threadCount);
+	}
+
+	for (ThreadCounters& thread : threads) {
+
+		thread.phases.clear();
+		thread.rays = 0;
+
+		for (Reading& total : thread.totals) {
+			total = Reading();
+		}
+	}
+
+} // end reset
+
+
+void PerformanceCounters::enter(const RENDER_PHASE& phase)
+{
+	int index = ThreadPool::getThreadIndex();
+	if (index >= (int)threads.size()) {
+		return;
+	}
+
+	ThreadCounters& thread = threads[index];
+
+	if (!thread.opened) {
+		open(thread);
+	}
+
+	charge(thread);
+	thread.phases.push_back(phase);
+
+} // end enter
+
+
+void PerformanceCounters::leave()
+{
+	int index = ThreadPool::getThreadIndex();
+	if (index >= (int)threads.size() || threads[index].phases.empty()) {
+		return;
+	}
+
+	ThreadCounters& thread = threads[index];
+
+	charge(thread);
+	thread.phases.pop_back();
+
+} // end leave
+
+
+void PerformanceCounters::addRays(const long long& count)
+{
+	int index = ThreadPool::getThreadIndex();
+	if (index < (int)threads.size()) {
+		threads[index].rays += count;
+	}
+
+} // end addRays
+
+
+bool PerformanceCounters::hasHardwareCounters() const
+{
+	for (const ThreadCounters& thread : threads) {
+		if (thread.events[CYCLES_EVENT] >= 0) {
+			return true;
+		}
+	}
+
+	return false;
+
+} // end hasHardwareCounters
+
+
+std::string PerformanceCounters::getReport() const
+{
+	Reading totals[PHASE_COUNT];
+	long long rays = 0;
+
+	// An event is reported only if every thread that opened counters has it
+	bool available[EVENT_COUNT];
+	bool anyOpened = false;
+
+	for (int e = 0; e < EVENT_COUNT; e++) {
+		available[e] = true;
+	}
+
+	for (const ThreadCounters& thread : threads) {
+
+		for (int p = 0; p < PHASE_COUNT; p++) {
+			totals[p].seconds += thread.totals[p].seconds;
+			for (int e = 0; e < EVENT_COUNT; e++) {
+				totals[p].events[e] += thread.totals[p].events[e];
+			}
+		}
+
+		rays += thread.rays;
+
+		if (thread.opened) {
+			anyOpened = true;
+			for (int e = 0; e < EVENT_COUNT; e++) {
+				available[e] = available[e] && thread.events[e] >= 0;
+			}
+		}
+	}
+
+	for (int e = 0; e < EVENT_COUNT; e++) {
+		available[e] = available[e] && anyOpened;
+	}
+
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(3);
+
+	report << std::setw(14) << "phase" << std::setw(12) << "ms";
+	for (int e = 0; e < EVENT_COUNT; e++) {
+		if (available[e]) {
+			report << std::setw(18) << EVENT_NAMES[e];
+		}
+	}
+	if (available[CYCLES_EVENT] && available[INSTRUCTIONS_EVENT]) {
+		report << std::setw(8) << "IPC";
+	}
+	report << '\n';
+
+	double perRay = rays > 0 ? 1.0 / rays : 0.0;
+
+	for (int p = 0; p < PHASE_COUNT; p++) {
+
+		report << std::setw(14) << PHASE_NAMES[p] << std::setw(12) << 1000.0 * totals[p].seconds;
+
+		for (int e = 0; e < EVENT_COUNT; e++) {
+			if (!available[e]) {
+				continue;
+			}
+
+			// Cycles and instructions are totals. Misses are per view ray.
+			if (e == CYCLES_EVENT || e == INSTRUCTIONS_EVENT) {
+				report << std::setw(18) << totals[p].events[e];
+			}
+			else {
+				report << std::setw(18) << totals[p].events[e] * perRay;
+			}
+		}
+
+		if (available[CYCLES_EVENT] && available[INSTRUCTIONS_EVENT]) {
+			double cycles = (double)totals[p].events[CYCLES_EVENT];
+			report << std::setw(8) << (cycles > 0.0 ? totals[p].events[INSTRUCTIONS_EVENT] / cycles : 0.0);
+		}
+
+		report << '\n';
+	}
+
+	report << rays << " view rays";
+	if (!hasHardwareCounters()) {
+		report << ", hardware counters unavailable, times only";
+	}
+	report << '\n';
+
+	return report.str();
+
+} // end getReport
+
+
+void PerformanceCounters::open(ThreadCounters& thread)
+{
+	thread.opened = true;
+
+#if defined(__linux__)
+
+	struct EventType { unsigned int type; unsigned long long config; };
+
+	static const EventType eventTypes[EVENT_COUNT] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+	};
+
+	int leader = -1;
+
+	for (int e = 0; e < EVENT_COUNT; e++) {
+
+		perf_event_attr attributes = {};
+		attributes.size = sizeof(attributes);
+		attributes.type = eventTypes[e].type;
+		attributes.config = eventTypes[e].config;
+		attributes.read_format = PERF_FORMAT_GROUP;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.disabled = leader < 0 ? 1 : 0;
+
+		// Counts the calling thread on whatever processor it runs on
+		int fd = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0);
+
+		// Without cycles nothing else is trusted, since IPC needs them
+		if (e == CYCLES_EVENT && fd < 0) {
+			return;
+		}
+
+		thread.events[e] = fd;
+		if (leader < 0) {
+			leader = fd;
+		}
+	}
+
+	ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+#endif
+
+	thread.last = read(thread);
+
+} // end open
+
+
+void PerformanceCounters::closeCounters()
+{
+#if defined(__linux__)
+	for (ThreadCounters& thread : threads) {
+		for (int& fd : thread.events) {
+			if (fd >= 0) {
+				close(fd);
+				fd = -1;
+			}
+		}
+		thread.opened = false;
+	}
+#endif
+
+} // end closeCounters
+
+
+PerformanceCounters::Reading PerformanceCounters::read(const ThreadCounters& thread) const
+{
+	Reading reading;
+	reading.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+#if defined(__linux__)
+
+	if (thread.events[CYCLES_EVENT] < 0) {
+		return reading;
+	}
+
+	// The group is read at once: the number of events, then the value of each in the order
+	// they were opened
+	unsigned long long values[EVENT_COUNT + 1] = { 0 };
+
+	if (::read(thread.events[CYCLES_EVENT], values, sizeof(values)) <= 0) {
+		return reading;
+	}
+
+	int slot = 1;
+	for (int e = 0; e < EVENT_COUNT && slot <= (int)values[0]; e++) {
+		if (thread.events[e] >= 0) {
+			reading.events[e] = values[slot++];
+		}
+	}
+
+#endif
+
+	return reading;
+
+} // end read
+
+
+void PerformanceCounters::charge(ThreadCounters& thread)
+{
+	Reading now = read(thread);
+
+	if (!thread.phases.empty()) {
+
+		Reading& total = thread.totals[thread.phases.back()];
+
+		total.seconds += now.seconds - thread.last.seconds;
+		for (int e = 0; e < EVENT_COUNT; e++) {
+			total.events[e] += now.events[e] - thread.last.events[e];
+		}
+	}
+
+	thread.last = now;
+
+} // end charge
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @enum	RENDER_PHASE
+ *
+ * @brief	Parts of a frame that performance counters are attributed to.
+ * 			SETUP_PHASE covers the work done once per frame before any rays are traced.
+ * 			INTERSECTION_PHASE covers finding the closest hits of batches of rays, traversal
+ * 			and surface tests together. SHADOW_PHASE covers shadow packets. SHADING_PHASE
+ * 			covers shading the hits, including texture lookups and the rays traced one at a
+ * 			time while shading. RESOLVE_PHASE covers writing colors to the frame buffer.
+ */
+enum RENDER_PHASE { SETUP_PHASE = 0, INTERSECTION_PHASE, SHADOW_PHASE, SHADING_PHASE, RESOLVE_PHASE, PHASE_COUNT };
+
+
+/**
+ * @class	PerformanceCounters
+ *
+ * @brief	Hardware performance counters read around the phases of a frame. On Linux each
+ * 			rendering thread opens a group of counters for itself with perf_event_open: cycles,
+ * 			instructions, L1 data cache read misses, last level cache misses, and branch misses.
+ * 			Where the counters cannot be opened (other systems, containers, or a restrictive
+ * 			perf_event_paranoid setting) only the time of each phase is recorded.
+ *
+ * 			Phases nest. Entering a phase pauses the one it is entered from, so every cycle is
+ * 			counted toward exactly one phase. Reading the counters takes a system call, so phases
+ * 			are entered around batches of work rather than single rays.
+ */
+class PerformanceCounters
+{
+public:
+
+	/** @brief	Number of hardware events counted */
+	static const int EVENT_COUNT = 5;
+
+	~PerformanceCounters();
+
+
+	/**
+	 * @fn	void PerformanceCounters::reset(const int & threadCount);
+	 *
+	 * @brief	Clears the totals at the start of a frame. Must not be called while other threads
+	 * 			are in a phase. Counters already opened by a thread stay open.
+	 *
+	 * @param	threadCount	Number of threads that may enter phases.
+	 */
+	void reset(const int & threadCount);
+
+
+	/**
+	 * @fn	void PerformanceCounters::enter(const RENDER_PHASE & phase);
+	 *
+	 * @brief	Starts counting toward a phase on the calling thread, pausing the phase it was in.
+	 * 			The first call on a thread opens its counters.
+	 */
+	void enter(const RENDER_PHASE & phase);
+
+
+	/**
+	 * @fn	void PerformanceCounters::leave();
+	 *
+	 * @brief	Stops counting toward the phase last entered on the calling thread and resumes
+	 * 			the phase it was entered from.
+	 */
+	void leave();
+
+
+	/**
+	 * @fn	void PerformanceCounters::addRays(const long long & count);
+	 *
+	 * @brief	Adds to the number of view rays the counts are divided by in the report.
+	 */
+	void addRays(const long long & count);
+
+
+	/** @returns	True if any thread was able to open its hardware counters. */
+	bool hasHardwareCounters() const;
+
+
+	/**
+	 * @fn	std::string PerformanceCounters::getReport() const;
+	 *
+	 * @brief	Formats the totals since the last reset as a table with one row per phase: time,
+	 * 			cycles, instructions per cycle, and misses of each kind per view ray. Columns of
+	 * 			counters that could not be opened are left out.
+	 *
+	 * @returns	The report.
+	 */
+	std::string getReport() const;
+
+protected:
+
+	/**
+	 * @struct	Reading
+	 *
+	 * @brief	Time and counter values at one moment, or the difference of two such moments.
+	 */
+	struct Reading
+	{
+		double seconds = 0.0;
+		unsigned long long events[EVENT_COUNT] = { 0, 0, 0, 0, 0 };
+	};
+
+	/**
+	 * @struct	ThreadCounters
+	 *
+	 * @brief	Counters and totals of one thread. Only ever touched by that thread while
+	 * 			rendering.
+	 */
+	struct ThreadCounters
+	{
+		/** @brief	True once the thread has tried to open its counters */
+		bool opened = false;
+
+		/** @brief	File descriptor of each event. -1 for events that could not be opened. The
+		first open event leads the group. */
+		int events[EVENT_COUNT] = { -1, -1, -1, -1, -1 };
+
+		/** @brief	Phases entered and not yet left, innermost last */
+		std::vector<RENDER_PHASE> phases;
+
+		/** @brief	Reading taken at the last change of phase */
+		Reading last;
+
+		/** @brief	Totals of each phase since the last reset */
+		Reading totals[PHASE_COUNT];
+
+		/** @brief	View rays counted since the last reset */
+		long long rays = 0;
+
+		/** @brief	Keeps the counters of neighboring threads off of the same cache line */
+		char padding[64];
+	};
+
+	/**
+	 * @fn	void PerformanceCounters::open(ThreadCounters & thread);
+	 *
+	 * @brief	Opens the counters of the calling thread.
+	 */
+	void open(ThreadCounters & thread);
+
+
+	/**
+	 * @fn	void PerformanceCounters::closeCounters();
+	 *
+	 * @brief	Closes the counters opened by every thread.
+	 */
+	void closeCounters();
+
+
+	/**
+	 * @fn	Reading PerformanceCounters::read(const ThreadCounters & thread) const;
+	 *
+	 * @brief	Reads the time and the counters of the calling thread.
+	 */
+	Reading read(const ThreadCounters & thread) const;
+
+
+	/**
+	 * @fn	void PerformanceCounters::charge(ThreadCounters & thread);
+	 *
+	 * @brief	Adds everything counted since the last change of phase to the current phase.
+	 */
+	void charge(ThreadCounters & thread);
+
+
+	/** @brief	Counters of each thread */
+	std::vector<ThreadCounters> threads;
+
+	/** @brief	Moment times are measured from */
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+}; // end PerformanceCounters class
+
+
+/**
+ * @class	PhaseScope
+ *
+ * @brief	Enters a phase when constructed and leaves it when destroyed. Does nothing if given
+ * 			no counters, so it costs a branch when profiling is off.
+ */
+class PhaseScope
+{
+public:
+
+	PhaseScope(PerformanceCounters * counters, const RENDER_PHASE & phase)
+		: counters(counters)
+	{
+		if (counters != nullptr) {
+			counters->enter(phase);
+		}
+	}
+
+	~PhaseScope()
+	{
+		if (counters != nullptr) {
+			counters->leave();
+		}
+	}
+
+	PhaseScope(const PhaseScope &) = delete;
+	PhaseScope & operator=(const PhaseScope &) = delete;
+
+protected:
+
+	/** @brief	Counters the phase is entered in. Null when profiling is off. */
+	PerformanceCounters * counters;
+
+}; // end PhaseScope class
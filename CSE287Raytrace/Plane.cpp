@@ -16,13 +16,27 @@ Plane::Plane(std::vector<dvec3> vertices, const color & material)
 }
 
 
-HitRecord Plane::findIntersect( const Ray & ray )
+HitRecord Plane::findIntersect( const Ray & ray, const OriginTerms * originTerms )
 {
 	HitRecord hitRecord;
 
 	double denominator = glm::dot(ray.direct, n);
 	if (denominator < 0) {
-		double t = glm::dot(a - ray.origin, n) / denominator;
+		double numerator;
+		if (originTerms != nullptr) {
+			numerator = originTerms->constant;
+		}
+		else {
+			numerator = glm::dot(a - ray.origin, n);
+		}
+
+		double t = numerator / denominator;
+
+		// The plane is behind the start of the ray
+		if (t < ray.tMin) {
+			return hitRecord;
+		}
+
 		hitRecord.surfaceNormal = n;
 		hitRecord.interceptPoint = ray.origin + t * ray.direct;
 		hitRecord.t = t;
@@ -36,3 +50,9 @@ HitRecord Plane::findIntersect( const Ray & ray )
 
 } // end findClosestIntersection
 
+
+void Plane::calculateSharedOriginTerms( const dvec3 & origin, OriginTerms & terms ) const
+{
+	terms.constant = glm::dot(a - origin, n);
+
+} // end calculateSharedOriginTerms
@@ -23,6 +23,9 @@ class Plane : public ImplicitSurface
 
 	Plane(std::vector<dvec3> vertices, const color & material);
 
+	/** @brief	Copies the plane. */
+	virtual std::shared_ptr<ImplicitSurface> clone( ) const override { return std::make_shared<Plane>( *this ); }
+
 	/**
 	 * @fn	virtual HitRecord Plane::findClosestIntersection( const Ray & ray );
 	 *
@@ -30,11 +33,39 @@ class Plane : public ImplicitSurface
 	 * 			intersection if one exits. Returns a HitRecord with the t parameter set to INFINITY
 	 * 			if there is no intersection.
 	 *
-	 * @param	ray	- Origin of the ray being check for intersetion.
+	 * @param	ray		   	- Origin of the ray being check for intersetion.
+	 * @param	originTerms	(Optional) Cached terms for the origin of the ray, or null.
 	 *
 	 * @returns	HitRecord containing information about the point of intersection.							
 	 */
-	virtual HitRecord findIntersect( const Ray & ray ) override;
+	virtual HitRecord findIntersect( const Ray & ray, const OriginTerms * originTerms = nullptr ) override;
+
+	/**
+	 * @fn	virtual void Plane::calculateSharedOriginTerms( const dvec3 & origin, OriginTerms & terms ) const override;
+	 *
+	 * @brief	Finds the numerator of the intersection equation, dot(a - origin, n), for a shared
+	 * 			ray origin. It is kept in OriginTerms::constant.
+	 *
+	 * @param 		  	origin	The shared ray origin.
+	 * @param [out]	terms 	The terms.
+	 */
+	virtual void calculateSharedOriginTerms( const dvec3 & origin, OriginTerms & terms ) const override;
+
+	/**
+	 * @fn	virtual double Plane::signedDistance( const dvec3 & point, const double & time = 0.0 ) const override
+	 *
+	 * @brief	Distance from a point to the plane. Everything behind the plane counts as inside
+	 * 			of it, as rays cannot reach the plane from there.
+	 *
+	 * @param	point	The point.
+	 * @param	time 	(Optional) Not used. Planes do not move.
+	 *
+	 * @returns	Height of the point above the plane along its normal.
+	 */
+	virtual double signedDistance( const dvec3 & point, const double & time = 0.0 ) const override
+	{
+		return glm::dot(point - a, n);
+	}
 
 	/** @brief	Point on the plane */
 	dvec3 a;
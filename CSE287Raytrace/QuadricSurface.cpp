@@ -43,11 +43,25 @@ QuadricSurface::QuadricSurface( const dvec3 & position, const color & mat )
 }
 
 
-HitRecord QuadricSurface::findIntersect( const Ray & ray )
+HitRecord QuadricSurface::findIntersect( const Ray & ray, const OriginTerms * originTerms )
 {
 	HitRecord hitRecord; 
 
-	dvec3 Ro = ray.origin - center;
+	bool moving = motion != dvec3( 0.0, 0.0, 0.0 );
+
+	// Position of the center when the ray samples the scene
+	dvec3 rayCenter = moving ? getCenter( ray.time ) : center;
+
+	// Use the cached origin terms if the ray starts at a shared origin
+	OriginTerms terms;
+	if (!moving && originTerms != nullptr) {
+		terms = *originTerms;
+	}
+	else {
+		terms = calculateOriginTerms(ray.origin, rayCenter);
+	}
+
+	const dvec3 & Ro = terms.offset;
 	dvec3 Rd = ray.direct;
 
 	// After substituting the parametric form of the ray, Ro + t* Rd, into the 
@@ -57,15 +71,9 @@ HitRecord QuadricSurface::findIntersect( const Ray & ray )
 	double Aq = A * (Rd.x*Rd.x) + B * (Rd.y*Rd.y) + C * (Rd.z*Rd.z) + 
 			   D * (Rd.x * Rd.y) + E * (Rd.x * Rd.z) + F * (Rd.y * Rd.z);
 
-	double Bq = (2 * A * Ro.x*Rd.x) + (2 * B * Ro.y*Rd.y) + (2 * C * Ro.z*Rd.z) +
-			   D * (Ro.x * Rd.y + Ro.y * Rd.x) + 
-			   E * (Ro.x * Rd.z + Ro.z * Rd.x) + 
-			   F * (Ro.y * Rd.z + Ro.z * Rd.y) +
-			   G * Rd.x + H * Rd.y + I * Rd.z;
+	double Bq = glm::dot(Rd, terms.gradient);
 
-	double Cq = A * (Ro.x * Ro.x) + B * (Ro.y * Ro.y) + C * (Ro.z * Ro.z) +
-			   D * (Ro.x * Ro.y) + E * (Ro.x * Ro.z) + F * (Ro.y * Ro.z) +
-			   G * Ro.x + H * Ro.y + I * Ro.z + J; 
+	double Cq = terms.constant;
 	
 	// The quadratic equation in the form (-Bq +/- sqrt(Bq*Bq-4 * Aq * Cq))/(2*Aq) is 
 	// used to solve for the parameter t..
@@ -92,7 +100,7 @@ HitRecord QuadricSurface::findIntersect( const Ray & ray )
 
 			// Is closest point of intersection on the ray or on the negative side of 
 			// Ro on a geometric line described by Ro + t* Rd?
-			if (t0 > 0) {
+			if (t0 > ray.tMin) {
 
 				t = t0;
 			}
@@ -103,7 +111,7 @@ HitRecord QuadricSurface::findIntersect( const Ray & ray )
 			}
 		}
 
-		if (t < 0) {
+		if (t < ray.tMin) {
 			// Set parameter, t, in the hit record to indicate "no intersection."
 			hitRecord.t = INFINITY;
 			return hitRecord;
@@ -120,11 +128,14 @@ HitRecord QuadricSurface::findIntersect( const Ray & ray )
 		Rn.z = 2 * C * Ri.z + E * Ri.x + F * Ri.y + I;
 
 		// Check if the intersection with the inside or back of the surface
-		if (glm::dot(Rn, Rd) > 0) { Rn = -Rn; }
+		if (glm::dot(Rn, Rd) > 0) {
+			Rn = -Rn;
+			hitRecord.rayStatus = LEAVING;
+		}
 
 		// Set hit record information about the intersetion.
 		hitRecord.t = t;
-		hitRecord.interceptPoint = Ri + center;
+		hitRecord.interceptPoint = Ri + rayCenter;
 		hitRecord.surfaceNormal = normalize( Rn );
 		hitRecord.material = material;
 
@@ -144,3 +155,58 @@ HitRecord QuadricSurface::findIntersect( const Ray & ray )
 
 } // end findClosestIntersection
 
+
+void QuadricSurface::calculateSharedOriginTerms( const dvec3 & origin, OriginTerms & terms ) const
+{
+	terms = calculateOriginTerms( origin, center );
+
+} // end calculateSharedOriginTerms
+
+
+double QuadricSurface::signedDistance( const dvec3 & point, const double & time ) const
+{
+	dvec3 p = point - getCenter( time );
+
+	double value = A * p.x * p.x + B * p.y * p.y + C * p.z * p.z + D * p.x * p.y + E * p.x * p.z + F * p.y * p.z +
+		G * p.x + H * p.y + I * p.z + J;
+
+	dvec3 gradient;
+	gradient.x = 2 * A * p.x + D * p.y + E * p.z + G;
+	gradient.y = 2 * B * p.y + D * p.x + F * p.z + H;
+	gradient.z = 2 * C * p.z + E * p.x + F * p.y + I;
+
+	double length = glm::length( gradient );
+
+	// The gradient vanishes only far from the surface, such as on the axis of a cylinder
+	if( length <= EPSILON ) {
+		return value < 0.0 ? -INFINITY : INFINITY;
+	}
+
+	return value / length;
+
+} // end signedDistance
+
+
+OriginTerms QuadricSurface::calculateOriginTerms( const dvec3 & origin, const dvec3 & surfaceCenter ) const
+{
+	OriginTerms terms;
+
+	dvec3 Ro = origin - surfaceCenter;
+	terms.offset = Ro;
+
+	// Bq = (2 * A * Ro.x*Rd.x) + (2 * B * Ro.y*Rd.y) + (2 * C * Ro.z*Rd.z) +
+	//		D * (Ro.x * Rd.y + Ro.y * Rd.x) + E * (Ro.x * Rd.z + Ro.z * Rd.x) + 
+	//		F * (Ro.y * Rd.z + Ro.z * Rd.y) + G * Rd.x + H * Rd.y + I * Rd.z
+	// Collecting the terms multiplied by each component of Rd gives the
+	// gradient of the quadric at Ro.
+	terms.gradient.x = 2 * A * Ro.x + D * Ro.y + E * Ro.z + G;
+	terms.gradient.y = 2 * B * Ro.y + D * Ro.x + F * Ro.z + H;
+	terms.gradient.z = 2 * C * Ro.z + E * Ro.x + F * Ro.y + I;
+
+	terms.constant = A * (Ro.x * Ro.x) + B * (Ro.y * Ro.y) + C * (Ro.z * Ro.z) +
+			   D * (Ro.x * Ro.y) + E * (Ro.x * Ro.z) + F * (Ro.y * Ro.z) +
+			   G * Ro.x + H * Ro.y + I * Ro.z + J; 
+
+	return terms;
+
+} // end calculateOriginTerms
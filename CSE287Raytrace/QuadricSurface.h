@@ -25,6 +25,9 @@ public:
 	 */
 	QuadricSurface(const glm::dvec3 & position, const color & mat);
 
+	/** @brief	Copies the surface. */
+	virtual std::shared_ptr<ImplicitSurface> clone( ) const override { return std::make_shared<QuadricSurface>( *this ); }
+
 	/**
 	 * @fn	virtual HitRecord QuadricSurface::findClosestIntersection( const Ray & ray );
 	 *
@@ -33,14 +36,73 @@ public:
 	 * 			HitRecord with the t parameter set to INFINITY if there 
 	 * 			is no intersection.
 	 *
-	 * @param	ray	- The ray being check for intersection.
+	 * @param	ray		   	- The ray being check for intersection.
+	 * @param	originTerms	(Optional) Cached terms for the origin of the ray, or null. Not used by
+	 * 						a moving surface.
 	 *
 	 * @returns	The found intersection.
 	 */
-	virtual HitRecord findIntersect( const Ray & ray );
+	virtual HitRecord findIntersect( const Ray & ray, const OriginTerms * originTerms = nullptr );
+
+	/**
+	 * @fn	virtual void QuadricSurface::calculateSharedOriginTerms( const dvec3 & origin, OriginTerms & terms ) const override;
+	 *
+	 * @brief	Finds Ro, Cq, and the gradient of the quadric at Ro for a shared ray origin. Bq
+	 * 			reduces to a dot product of the ray direction with the gradient.
+	 *
+	 * @param 		  	origin	The shared ray origin.
+	 * @param [out]	terms 	The terms.
+	 */
+	virtual void calculateSharedOriginTerms( const dvec3 & origin, OriginTerms & terms ) const override;
+
+	/**
+	 * @fn	virtual double QuadricSurface::signedDistance( const dvec3 & point, const double & time = 0.0 ) const override;
+	 *
+	 * @brief	Estimates the distance from a point to the surface as the value of the quadric
+	 * 			equation over the length of its gradient, the distance to the closest point of
+	 * 			the surface if it were flat. Exact close to the surface. Farther outside of the
+	 * 			cylinder the constructor sets up it is too small, which keeps marching safe.
+	 *
+	 * @param	point	The point.
+	 * @param	time 	(Optional) Time within the shutter interval.
+	 *
+	 * @returns	The estimated signed distance.
+	 */
+	virtual double signedDistance( const dvec3 & point, const double & time = 0.0 ) const override;
+
+	/**
+	 * @fn	dvec3 QuadricSurface::getCenter( const double & time ) const
+	 *
+	 * @brief	Position of the center of the surface at a time within the shutter interval.
+	 *
+	 * @param	time	Time within the shutter interval. 0 at open and 1 at close.
+	 *
+	 * @returns	xyz location of the center at that time.
+	 */
+	dvec3 getCenter( const double & time ) const { return center + time * motion; }
+
+	/**
+	 * @brief	Displacement of the center between shutter open and shutter close. The surface
+	 * 			is translated linearly from center to center + motion. Zero for a static surface.
+	 */
+	dvec3 motion = dvec3( 0.0, 0.0, 0.0 );
 
 	protected:
 
+	/**
+	 * @fn	OriginTerms QuadricSurface::calculateOriginTerms( const dvec3 & origin, const dvec3 & surfaceCenter ) const;
+	 *
+	 * @brief	Finds the origin dependent intersection terms for a ray origin. OriginTerms::offset
+	 * 			holds Ro, OriginTerms::gradient the partial derivatives of the quadric equation at
+	 * 			Ro, and OriginTerms::constant the constant term Cq of the quadratic in t.
+	 *
+	 * @param	origin		 	The ray origin.
+	 * @param	surfaceCenter	Center of the surface at the time of the ray.
+	 *
+	 * @returns	The origin terms.
+	 */
+	OriginTerms calculateOriginTerms( const dvec3 & origin, const dvec3 & surfaceCenter ) const;
+
 	/**
 	 * @property	double A, B, C, D, E, F, G, H, I, J
 	 *
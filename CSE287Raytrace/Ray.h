@@ -2,6 +2,20 @@
 
 #include "Defines.h"
 
+/** @brief	Value of Ray::sharedOrigin for rays whose origin is not shared with a batch of other rays. */
+const int NO_SHARED_ORIGIN = -1;
+
+/**
+ * @enum	RAY_TYPE
+ *
+ * @brief	Kinds of rays. The values are bits so that a surface can list the kinds of rays that
+ * 			are able to see it in ImplicitSurface::visibility.
+ */
+enum RAY_TYPE { VIEW_RAY = 1, SHADOW_RAY = 2, SECONDARY_RAY = 4 };
+
+/** @brief	Visibility of a surface that is seen by every kind of ray. */
+const unsigned int ALL_RAY_TYPES = VIEW_RAY | SHADOW_RAY | SECONDARY_RAY;
+
 /**
  * @struct	Ray
  *
@@ -18,8 +32,35 @@ struct Ray
 	dvec3 direct;
 
 
-	Ray( const dvec3 &rayOrigin = dvec3( 0.0, 0.0, 0.0 ), const dvec3 &rayDirection = dvec3( 0.0, 0.0, -1.0 )/*, RayType rayType = VIEW*/ ) :
-		origin( rayOrigin ), direct( glm::normalize( rayDirection ) )
+	/**
+	 * @brief	Index of the shared origin (view point or light position) that this ray starts at.
+	 * 			Surfaces use it to look up intersection terms that depend only on the origin and
+	 * 			were cached before rendering. NO_SHARED_ORIGIN if the origin is not shared.
+	 */
+	int sharedOrigin = NO_SHARED_ORIGIN;
+
+
+	/**
+	 * @brief	Time at which the ray samples the scene. 0 at shutter open and 1 at shutter close.
+	 * 			Moving surfaces are intersected at their position at this time.
+	 */
+	double time = 0.0;
+
+
+	/**
+	 * @brief	Intersections closer to the origin than this parameter are ignored. Rays that are
+	 * 			cast from the mirror image of the view point start behind the mirror and use it to
+	 * 			skip everything before the mirror.
+	 */
+	double tMin = 0.0;
+
+
+	/** @brief	Kind of ray. Only surfaces whose visibility includes the type are intersected. */
+	RAY_TYPE type;
+
+
+	Ray( const dvec3 &rayOrigin = dvec3( 0.0, 0.0, 0.0 ), const dvec3 &rayDirection = dvec3( 0.0, 0.0, -1.0 ), RAY_TYPE rayType = VIEW_RAY ) :
+		origin( rayOrigin ), direct( glm::normalize( rayDirection ) ), type( rayType )
 	{
 	}
 
@@ -1,84 +1,1000 @@
 #include "RayTracer.h"
 
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+
+// Shadow result for a light whose feeler has not been traced yet
+static const signed char SHADOW_UNKNOWN = -1;
+
+// Width and height of the blocks of pixels whose shadow feelers are grouped into packets
+static const int SHADOW_PACKET_BLOCK = 8;
+
+// Radius in pixels within which neighboring reservoirs are merged
+static const double RESERVOIR_NEIGHBOR_RADIUS = 16.0;
+
+// Most candidates a reservoir kept from the previous frame may stand for, relative to the
+// candidates drawn in the current frame. Keeps stale history from dominating.
+static const double RESERVOIR_HISTORY_LIMIT = 20.0;
+
+// Share of the glossy reflection rays drawn from the learned field where it has learned something
+static const double GUIDED_FRACTION = 0.5;
+
+// Candidate tile sizes, leaf sizes, and shadow packet sizes tried by the autotuner
+static const int TUNING_TILE_SIZES[] = { 8, 16, 32, 64, 128 };
+static const int TUNING_LEAF_SIZES[] = { 1, 2, 4, 8 };
+static const int TUNING_PACKET_SIZES[] = { 16, 32, 64, 128, 256 };
+
+// Number of times the calibration region is rendered for each candidate. The fastest counts.
+static const int TUNING_RUNS = 2;
+
+// Distance in voxels of the distance field within which an occluder is checked with a shadow feeler
+static const double CONTACT_VOXELS = 2.0;
+
+/**
+ * @fn	static bool isSimilarSurface(const dvec3 & point, const dvec3 & normal, const dvec3 & otherPoint, const dvec3 & otherNormal, const double & viewDistance)
+ *
+ * @brief	Checks whether the reservoir of another pixel or frame was built for a surface close
+ * 			enough to the one at a point to be reused there: the normals must nearly agree and
+ * 			the other point must lie near the tangent plane of the point.
+ */
+static bool isSimilarSurface(const dvec3 & point, const dvec3 & normal, const dvec3 & otherPoint, const dvec3 & otherNormal,
+							 const double & viewDistance)
+{
+	return glm::dot(normal, otherNormal) > 0.9 && glm::abs(glm::dot(otherPoint - point, normal)) < 0.05 * viewDistance;
+}
+
+/**
+ * @fn	static double pixelOffset(const int & x, const int & y)
+ *
+ * @brief	Hashes pixel coordinates to a repeatable offset in [0, 1). Used to shift the
+ * 			stratified time samples of each pixel so that neighboring pixels do not sample the
+ * 			same instants.
+ */
+static double pixelOffset(const int & x, const int & y)
+{
+	unsigned int h = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u;
+	h ^= h >> 13;
+	h *= 0x5bd1e995u;
+	h ^= h >> 15;
+
+	return (h & 0xFFFFFF) / (double)0x1000000;
+}
+
+
+RayTracer::RayTracer(FrameBuffer& cBuffer, color defaultColor)
+	:colorBuffer(cBuffer), defaultColor(defaultColor), view(&cBuffer), recursionDepth(2)
+{
+
+}
+
+
+void RayTracer::setCameraFrame(const dvec3& viewPosition, const dvec3& viewingDirection, dvec3 up)
+{
+	view.setCameraFrame(viewPosition, viewingDirection, up);
+
+} // end setCameraFrame
+
+
+void RayTracer::calculatePerspectiveViewingParameters(const double& verticalFieldOfViewDegrees)
+{
+	view.calculatePerspectiveViewingParameters(verticalFieldOfViewDegrees);
+
+} // end calculatePerspectiveViewingParameters
+
+
+void RayTracer::calculateOrthographicViewingParameters(const double& viewPlaneHeight)
+{
+	view.calculateOrthographicViewingParameters(viewPlaneHeight);
+
+} // end calculateOrthographicViewingParameters
+
+
+void RayTracer::raytraceScene()
+{
+	std::vector<RenderView> views = { view };
+
+	raytraceViews(views);
+
+} // end raytraceScene
+
+
+AsyncTask<bool> RayTracer::raytraceSceneAsync(CancellationToken cancellation, std::function<void(int, int)> tileProgress)
+{
+	co_await schedule(renderThreads, NORMAL_PRIORITY);
+
+	// Suspends rather than blocks while another render of this ray tracer runs, since that
+	// render may be running on this very thread further down the stack
+	AsyncMutex::Guard lock = co_await asyncRenderMutex.lock();
+
+	if (cancellation.isCancelled()) {
+		co_return false;
+	}
+
+	std::vector<RenderView> views = { view };
+
+	renderFrame(views, &cancellation, tileProgress);
+
+	co_return !cancellation.isCancelled();
+
+} // end raytraceSceneAsync
+
+
+void RayTracer::raytraceViews(std::vector<RenderView>& views, const CancellationToken* cancellation,
+							  const std::function<void(int, int)>& tileProgress)
+{
+	renderFrameLocked(views, cancellation, tileProgress).get();
+
+} // end raytraceViews
+
+
+AsyncTask<void> RayTracer::renderFrameLocked(std::vector<RenderView>& views, const CancellationToken* cancellation,
+											 const std::function<void(int, int)>& tileProgress)
+{
+	AsyncMutex::Guard lock = co_await asyncRenderMutex.lock();
+
+	renderFrame(views, cancellation, tileProgress);
+
+} // end renderFrameLocked
+
+
+void RayTracer::renderFrame(std::vector<RenderView>& views, const CancellationToken* cancellation,
+							const std::function<void(int, int)>& tileProgress)
+{
+	// The frame holds references to the surfaces and lights, so the version only needs to stay
+	// pinned while its lists are copied
+	if (sceneVersions != nullptr) {
+		SceneVersions::Pin scene(*sceneVersions);
+		surfaces = scene->surfaces;
+		lights = scene->lights;
+	}
+
+	if (performanceCounting) {
+		performanceCounters.reset(renderThreads.getThreadCount());
+	}
+
+	if (objectProfiling) {
+		objectProfiler.reset(renderThreads.getThreadCount(), (int)surfaces.size(), (int)lights.size());
+	}
+
+	{
+		PhaseScope phase(getPerformanceCounters(), SETUP_PHASE);
+
+		prepareFrame(views);
+
+		if (autotuning) {
+
+			// Trial renders are not part of the frame
+			bool counting = performanceCounting;
+			bool profiling = objectProfiling;
+			performanceCounting = false;
+			setObjectProfiling(false);
+
+			autotune(views);
+
+			performanceCounting = counting;
+			setObjectProfiling(profiling);
+		}
+
+		// Probes are traced before any view so that every view is lit the same way
+		if (irradianceProbes) {
+			updateIrradianceVolume();
+		}
+	}
+
+	if (bidirectional) {
+
+		// Light paths need a view point to connect to, so orthographic views are ray traced
+		std::vector<RenderView> tiledViews;
+
+		for (int i = 0; i < (int)views.size(); i++) {
+			if (views[i].renderPerspectiveView) {
+				renderBidirectionalView(views[i], i);
+			}
+			else {
+				tiledViews.push_back(views[i]);
+			}
+		}
+
+		renderTiles(tiledViews, cancellation, tileProgress);
+	}
+	// Reservoirs are merged with those of neighboring pixels, so whole views are rendered a pass at a time
+	else if (reservoirResampling && motionBlurSamples <= 1) {
+
+		for (int i = 0; i < (int)views.size(); i++) {
+			renderReservoirView(views[i], i);
+		}
+
+		reservoirFrameCount++;
+	}
+	else {
+		renderTiles(views, cancellation, tileProgress);
+	}
+
+	// What this frame recorded guides the next one
+	if (pathGuiding) {
+		guidingField.finishPass();
+	}
+
+	frameCount++;
+
+} // end renderFrame
+
+
+void RayTracer::renderTiles(std::vector<RenderView>& views, const CancellationToken* cancellation,
+							const std::function<void(int, int)>& tileProgress)
+{
+	// Split every view into tiles so that all views are rendered by the same threads
+	struct Tile { int view, xBegin, yBegin, xEnd, yEnd; };
+	std::vector<Tile> tiles;
+
+	for (int i = 0; i < (int)views.size(); i++) {
+
+		int width = views[i].frameBuffer->getWindowWidth();
+		int height = views[i].frameBuffer->getWindowHeight();
+
+		for (int y = 0; y < height; y += tileSize) {
+			for (int x = 0; x < width; x += tileSize) {
+				tiles.push_back({ i, x, y, glm::min(x + tileSize, width), glm::min(y + tileSize, height) });
+			}
+		}
+	}
+
+	int tileCount = (int)tiles.size();
+	std::atomic<int> finishedTiles{ 0 };
+
+	renderThreads.parallelFor(tileCount, [&](int i) {
+
+		// Remaining tiles are skipped once the render is cancelled
+		if (cancellation != nullptr && cancellation->isCancelled()) {
+			return;
+		}
+
+		const Tile& tile = tiles[i];
+		renderTile(views[tile.view], tile.xBegin, tile.yBegin, tile.xEnd, tile.yEnd);
+
+		if (tileProgress) {
+			tileProgress(finishedTiles.fetch_add(1) + 1, tileCount);
+		}
+	});
+
+} // end renderTiles
+
+
+void RayTracer::renderTile(const RenderView& renderView, const int& xBegin, const int& yBegin, const int& xEnd, const int& yEnd)
+{
+	if ((shadowPackets || planarMirrors) && motionBlurSamples <= 1) {
+
+		// Visit the pixels in small square blocks so that consecutive feelers in a packet
+		// go to nearby points and fit in a narrow cone
+		std::vector<glm::ivec2> pixels;
+
+		for (int by = yBegin; by < yEnd; by += SHADOW_PACKET_BLOCK) {
+			for (int bx = xBegin; bx < xEnd; bx += SHADOW_PACKET_BLOCK) {
+				for (int y = by; y < glm::min(by + SHADOW_PACKET_BLOCK, yEnd); y++) {
+					for (int x = bx; x < glm::min(bx + SHADOW_PACKET_BLOCK, xEnd); x++) {
+						pixels.push_back(glm::ivec2(x, y));
+					}
+				}
+			}
+		}
+
+		std::vector<Ray> rays(pixels.size());
+		for (size_t i = 0; i < pixels.size(); i++) {
+			rays[i] = renderView.getViewRay(pixels[i].x, pixels[i].y);
+		}
+
+		if (performanceCounting) {
+			performanceCounters.addRays((long long)rays.size());
+		}
+
+		std::vector<color> colors;
+		traceRays(rays, recursionDepth, colors);
+
+		PhaseScope phase(getPerformanceCounters(), RESOLVE_PHASE);
+
+		for (size_t i = 0; i < pixels.size(); i++) {
+			renderView.frameBuffer->setPixel(pixels[i].x, pixels[i].y, colors[i]);
+		}
+
+		return;
+	}
+
+	// Rays traced one at a time cannot be split into phases without reading the counters for every ray
+	if (performanceCounting) {
+		performanceCounters.addRays((long long)(xEnd - xBegin) * (yEnd - yBegin) * glm::max(motionBlurSamples, 1));
+	}
+
+	PhaseScope phase(getPerformanceCounters(), SHADING_PHASE);
+
+	// Iterate through each and every pixel in the tile
+	for (int y = yBegin; y < yEnd; y++) {
+		for (int x = xBegin; x < xEnd; x++) {
+
+			Ray vr = renderView.getViewRay(x, y);
+
+			color vrColor;
+
+			if (motionBlurSamples <= 1) {
+				vrColor = traceRay(vr, recursionDepth);
+			}
+			else {
+
+				// Stratify the samples over the shutter interval
+				double offset = pixelOffset(x, y);
+				vrColor = color(0.0, 0.0, 0.0, 0.0);
+
+				for (int sample = 0; sample < motionBlurSamples; sample++) {
+					vr.time = (sample + offset) / motionBlurSamples;
+					vrColor += traceRay(vr, recursionDepth);
+				}
+
+				vrColor /= (double)motionBlurSamples;
+			}
+
+			renderView.frameBuffer->setPixel(x, y, vrColor);
+		}
+	}
+
+} // end renderTile
+
+
+void RayTracer::renderReservoirView(const RenderView& renderView, const int& viewIndex)
+{
+	int width = renderView.frameBuffer->getWindowWidth();
+	int height = renderView.frameBuffer->getWindowHeight();
+	int count = width * height;
+
+	std::vector<Ray> rays(count);
+	std::vector<HitRecord> hits(count);
+	std::vector<Reservoir> reservoirs(count);
+
+	if ((int)reservoirHistory.size() <= viewIndex) {
+		reservoirHistory.resize(viewIndex + 1);
+	}
+
+	ReservoirFrame& history = reservoirHistory[viewIndex];
+
+	bool useHistory = reservoirTemporalReuse && history.width == width && history.height == height &&
+		history.sourceCount == reservoirLighting.size();
+
+	// New candidates, merged with the reservoir of the pixel that saw the same point last frame
+	renderThreads.parallelFor(height, [&](int y) {
+
+		for (int x = 0; x < width; x++) {
+
+			int i = y * width + x;
+
+			rays[i] = renderView.getViewRay(x, y);
+			hits[i] = findClosestIntersection(rays[i]);
+
+			const HitRecord& hit = hits[i];
+			if (hit.t == INFINITY) {
+				continue;
+			}
+
+			dvec3 eyeVector = -rays[i].direct;
+			RandomSequence random(hashPoint(hit.interceptPoint, RESERVOIR_STREAM, reservoirFrameCount));
+
+			reservoirs[i] = reservoirLighting.sampleCandidates(hit, eyeVector, rays[i].time, reservoirCandidates, random);
+
+			int previousX, previousY;
+
+			if (useHistory && history.camera.projectPoint(hit.interceptPoint, previousX, previousY)) {
+
+				int previous = previousY * width + previousX;
+
+				if (isSimilarSurface(hit.interceptPoint, hit.surfaceNormal, history.points[previous], history.normals[previous], hit.t)) {
+					reservoirLighting.combine(reservoirs[i], history.reservoirs[previous], hit, eyeVector, random,
+						RESERVOIR_HISTORY_LIMIT * reservoirCandidates);
+				}
+			}
+		}
+	});
+
+	// Merge in the reservoirs of nearby pixels that see a similar surface
+	std::vector<Reservoir> resampled(count);
+
+	renderThreads.parallelFor(height, [&](int y) {
+
+		for (int x = 0; x < width; x++) {
+
+			int i = y * width + x;
+
+			const HitRecord& hit = hits[i];
+			if (hit.t == INFINITY) {
+				continue;
+			}
+
+			dvec3 eyeVector = -rays[i].direct;
+			RandomSequence random(hashPoint(hit.interceptPoint, SPATIAL_REUSE_STREAM, reservoirFrameCount));
+
+			resampled[i] = reservoirs[i];
+
+			for (int n = 0; n < reservoirNeighbors; n++) {
+
+				// Uniform point in the disk around the pixel
+				dvec2 u = random.next2();
+				double radius = RESERVOIR_NEIGHBOR_RADIUS * sqrt(u.x);
+				int neighborX = x + (int)glm::round(radius * cos(TWO_PI * u.y));
+				int neighborY = y + (int)glm::round(radius * sin(TWO_PI * u.y));
+
+				if (neighborX < 0 || neighborY < 0 || neighborX >= width || neighborY >= height ||
+					(neighborX == x && neighborY == y)) {
+					continue;
+				}
+
+				int neighbor = neighborY * width + neighborX;
+
+				if (hits[neighbor].t == INFINITY ||
+					!isSimilarSurface(hit.interceptPoint, hit.surfaceNormal, hits[neighbor].interceptPoint, hits[neighbor].surfaceNormal, hit.t)) {
+					continue;
+				}
+
+				reservoirLighting.combine(resampled[i], reservoirs[neighbor], hit, eyeVector, random);
+			}
+		}
+	});
+
+	history.points.resize(count);
+	history.normals.resize(count);
+
+	// One shadow feeler per pixel toward the chosen sample
+	renderThreads.parallelFor(height, [&](int y) {
+
+		for (int x = 0; x < width; x++) {
+
+			int i = y * width + x;
+
+			const HitRecord& hit = hits[i];
+			if (hit.t == INFINITY) {
+				renderView.frameBuffer->setPixel(x, y, defaultColor);
+				resampled[i] = Reservoir();
+				continue;
+			}
+
+			Reservoir& reservoir = resampled[i];
+			color directLight(0.0, 0.0, 0.0, 0.0);
+
+			// Hidden samples stay in the reservoir. Dropping them before reuse darkens the image
+			// a little more every frame.
+			if (reservoir.weight > 0.0) {
+
+				double visibility = getSampleVisibility(reservoir.sample, hit, rays[i].time);
+
+				if (visibility > 0.0) {
+					directLight = visibility * reservoir.weight * reservoirLighting.evaluate(reservoir.sample, hit, -rays[i].direct);
+				}
+			}
+
+			renderView.frameBuffer->setPixel(x, y, shadeHit(rays[i], hit, recursionDepth, nullptr, nullptr, &directLight));
+
+			history.points[i] = hit.interceptPoint;
+			history.normals[i] = hit.surfaceNormal;
+		}
+	});
+
+	history.camera = renderView;
+	history.width = width;
+	history.height = height;
+	history.sourceCount = reservoirLighting.size();
+	history.reservoirs.swap(resampled);
+
+} // end renderReservoirView
+
+
+void RayTracer::renderBidirectionalView(const RenderView& renderView, const int& viewIndex)
+{
+	int width = renderView.frameBuffer->getWindowWidth();
+	int height = renderView.frameBuffer->getWindowHeight();
+
+	if ((int)bidirectionalFrames.size() <= viewIndex) {
+		bidirectionalFrames.resize(viewIndex + 1);
+	}
+
+	BidirectionalFrame& frame = bidirectionalFrames[viewIndex];
+	BoundingBox sceneBounds = getSceneBounds();
+	unsigned int sceneSignature = getSceneSignature();
+
+	// Start over whenever the view or the scene has changed, including a light being turned on
+	// or off or a material being changed, since old samples would otherwise fade out only slowly
+	if (frame.film.getWidth() != width || frame.film.getHeight() != height || !frame.camera.matches(renderView) ||
+		frame.sceneBounds.minCorner != sceneBounds.minCorner || frame.sceneBounds.maxCorner != sceneBounds.maxCorner ||
+		frame.sceneSignature != sceneSignature) {
+
+		frame.camera = renderView;
+		frame.sceneBounds = sceneBounds;
+		frame.sceneSignature = sceneSignature;
+		frame.film.setBufferSize(width, height);
+		frame.sampleCount = 0;
+	}
+
+	renderThreads.parallelFor(height, [&](int y) {
+
+		for (int x = 0; x < width; x++) {
+
+			unsigned int seed = hashPoint(dvec3(x, y, viewIndex), BIDIRECTIONAL_STREAM, frame.sampleCount);
+			bidirectionalTracer.renderSample(accelerator, renderView, x, y, seed, defaultColor, frame.film);
+		}
+	});
+
+	frame.sampleCount++;
+	frame.film.resolve(*renderView.frameBuffer, 1.0 / frame.sampleCount);
+
+} // end renderBidirectionalView
+
+
+BoundingBox RayTracer::getSceneBounds() const
+{
+	BoundingBox sceneBounds;
+
+	for (auto& surface : surfaces) {
+
+		BoundingBox bounds = surface->getBounds();
+		if (bounds.isBounded()) {
+			sceneBounds.expand(bounds);
+		}
+	}
+
+	return sceneBounds;
+
+} // end getSceneBounds
+
+
+void RayTracer::updateIrradianceVolume()
+{
+	unsigned int signature = getSceneSignature();
+
+	if (irradianceVolume.getProbeCount() == 0) {
+
+		BoundingBox sceneBounds = getSceneBounds();
+
+		// There is nothing to place the grid around
+		if (sceneBounds.isEmpty()) {
+			return;
+		}
+
+		irradianceVolume.reset(sceneBounds, probeResolution);
+		probeSceneSignature = signature;
+	}
+	else if (signature != probeSceneSignature) {
+
+		irradianceVolume.invalidate();
+		probeSceneSignature = signature;
+	}
+
+	std::vector<int> due = irradianceVolume.takeDueProbes(probeBudget);
+	std::vector<IrradianceProbe> traced(due.size());
+
+	double maxDistance = irradianceVolume.getMaxDistance();
+
+	renderThreads.parallelFor((int)due.size(), [&](int i) {
+
+		dvec3 position = irradianceVolume.getProbePosition(due[i]);
+
+		// Every update turns the rays of a probe a different way so neighboring probes and
+		// successive updates do not miss the same small features
+		RandomSequence random(hashPoint(position, PROBE_STREAM, probeUpdateCount));
+		dvec2 u = random.next2();
+
+		double z = 1.0 - 2.0 * u.x;
+		double radius = sqrt(glm::max(1.0 - z * z, 0.0));
+		dmat3 rotation = orthonormalBasis(dvec3(radius * cos(TWO_PI * u.y), radius * sin(TWO_PI * u.y), z));
+
+		std::vector<dvec3> directions(probeRays);
+		std::vector<color> radiance(probeRays, color(0.0, 0.0, 0.0, 1.0));
+		std::vector<double> distances(probeRays, maxDistance);
+		std::vector<char> backFaces(probeRays, 0);
+
+		for (int ray = 0; ray < probeRays; ray++) {
+
+			directions[ray] = rotation * IrradianceVolume::getRayDirection(ray, probeRays);
+
+			Ray probeRay(position, directions[ray], SECONDARY_RAY);
+			HitRecord hit = accelerator.findClosestIntersection(probeRay);
+
+			if (hit.t == INFINITY) {
+				radiance[ray] = defaultColor;
+				continue;
+			}
+
+			distances[ray] = glm::min(hit.t, maxDistance);
+
+			// Planes are hit from either side without turning their normal around
+			if (hit.rayStatus == LEAVING || glm::dot(hit.surfaceNormal, probeRay.direct) > 0.0) {
+				backFaces[ray] = 1;
+				continue;
+			}
+
+			// The hit is lit by the probes traced before, adding a bounce every time around
+			radiance[ray] = shadeHit(probeRay, hit, 0);
+		}
+
+		traced[i] = IrradianceVolume::project(directions, radiance, distances, backFaces);
+	});
+
+	// No thread is shading, so the new probes can be stored
+	for (int i = 0; i < (int)due.size(); i++) {
+		irradianceVolume.store(due[i], traced[i]);
+	}
+
+	probeUpdateCount++;
+
+} // end updateIrradianceVolume
+
+
+void RayTracer::autotune(std::vector<RenderView>& views)
+{
+	std::string sceneKey = getTuningKey(views);
+
+	if (sceneKey == tunedSceneKey) {
+		return;
+	}
+
+	RenderSettings settings;
+
+	if (!tuningCache.find(sceneKey, settings)) {
+
+		settings = tuneSettings(views);
+
+		tuningCache.store(sceneKey, settings);
+		tuningCache.save();
+	}
+
+	applySettings(settings);
+	tunedSceneKey = sceneKey;
+
+} // end autotune
+
+
+RenderSettings RayTracer::tuneSettings(std::vector<RenderView>& views)
+{
+	RenderSettings best = getRenderSettings();
+	double bestRate = 0.0;
+
+	// Tries each value of one setting with the best values found so far for the others
+	auto search = [&](int RenderSettings::* setting, const int* candidates, const int& count) {
+
+		RenderSettings trial = best;
+
+		for (int i = 0; i < count; i++) {
+
+			trial.*setting = candidates[i];
+			applySettings(trial);
+
+			double rate = measureRaysPerSecond(views);
+			if (rate > bestRate) {
+				bestRate = rate;
+				best = trial;
+			}
+		}
+
+		applySettings(best);
+	};
+
+	search(&RenderSettings::tileSize, TUNING_TILE_SIZES, sizeof(TUNING_TILE_SIZES) / sizeof(int));
+	search(&RenderSettings::maxLeafSize, TUNING_LEAF_SIZES, sizeof(TUNING_LEAF_SIZES) / sizeof(int));
+
+	// Packets are only traced without motion blur
+	if (shadowPackets && motionBlurSamples <= 1) {
+		search(&RenderSettings::shadowPacketSize, TUNING_PACKET_SIZES, sizeof(TUNING_PACKET_SIZES) / sizeof(int));
+	}
+
+	return best;
+
+} // end tuneSettings
+
+
+double RayTracer::measureRaysPerSecond(std::vector<RenderView>& views)
+{
+	// The middle of every view, half as wide and high, split into tiles as for a frame
+	struct Tile { int view, xBegin, yBegin, xEnd, yEnd; };
+	std::vector<Tile> tiles;
+	long long rays = 0;
+
+	for (int i = 0; i < (int)views.size(); i++) {
+
+		int width = views[i].frameBuffer->getWindowWidth();
+		int height = views[i].frameBuffer->getWindowHeight();
+
+		int xBegin = width / 4, xEnd = glm::max(xBegin + 1, 3 * width / 4);
+		int yBegin = height / 4, yEnd = glm::max(yBegin + 1, 3 * height / 4);
+
+		for (int y = yBegin; y < yEnd; y += tileSize) {
+			for (int x = xBegin; x < xEnd; x += tileSize) {
+				tiles.push_back({ i, x, y, glm::min(x + tileSize, xEnd), glm::min(y + tileSize, yEnd) });
+			}
+		}
+
+		rays += (long long)(xEnd - xBegin) * (yEnd - yBegin) * glm::max(motionBlurSamples, 1);
+	}
+
+	double bestSeconds = INFINITY;
+
+	for (int run = 0; run < TUNING_RUNS; run++) {
+
+		auto start = std::chrono::steady_clock::now();
+
+		renderThreads.parallelFor((int)tiles.size(), [&](int i) {
+			const Tile& tile = tiles[i];
+			renderTile(views[tile.view], tile.xBegin, tile.yBegin, tile.xEnd, tile.yEnd);
+		});
+
+		bestSeconds = glm::min(bestSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	return rays / glm::max(bestSeconds, 1e-9);
 
-RayTracer::RayTracer(FrameBuffer& cBuffer, color defaultColor)
-	:colorBuffer(cBuffer), defaultColor(defaultColor), recursionDepth(2)
+} // end measureRaysPerSecond
+
+
+void RayTracer::applySettings(const RenderSettings& settings)
 {
+	setTileSize(settings.tileSize);
+	shadowPacketSize = glm::max(settings.shadowPacketSize, 1);
 
-}
+	if (settings.maxLeafSize != accelerator.getMaxLeafSize()) {
+		accelerator.setMaxLeafSize(settings.maxLeafSize);
+		accelerator.build(surfaces);
+	}
 
+} // end applySettings
 
-void RayTracer::setCameraFrame(const dvec3& viewPosition, const dvec3& viewingDirection, dvec3 up)
+
+std::string RayTracer::getTuningKey(const std::vector<RenderView>& views) const
 {
-	// TODO
-	eye = viewPosition;
+	int boundedCount = 0;
+	for (auto& surface : surfaces) {
+		if (surface->getBounds().isBounded()) {
+			boundedCount++;
+		}
+	}
 
-	w = glm::normalize(-viewingDirection);//backward
-	u = glm::normalize(glm::cross(up, w));
-	v = glm::normalize(glm::cross(w, u));
-} // end setCameraFrame
+	unsigned int key = hashPoint(dvec3(surfaces.size(), boundedCount, activeLights.size()), TUNING_STREAM);
+
+	for (const RenderView& renderView : views) {
+		key = hashPoint(dvec3(renderView.frameBuffer->getWindowWidth(), renderView.frameBuffer->getWindowHeight(),
+			renderView.renderPerspectiveView), TUNING_STREAM, key);
+	}
 
+	key = hashPoint(dvec3(recursionDepth, motionBlurSamples, renderThreads.getThreadCount()), TUNING_STREAM, key);
+	key = hashPoint(dvec3(shadowPackets, planarMirrors, analyticVisibility), TUNING_STREAM, key);
+	key = hashPoint(dvec3(distanceFieldShading, emissiveSamples, irradianceProbes), TUNING_STREAM, key);
 
-void RayTracer::calculatePerspectiveViewingParameters(const double& verticalFieldOfViewDegrees)
+	std::ostringstream text;
+	text << std::hex << key;
+
+	return text.str();
+
+} // end getTuningKey
+
+
+unsigned int RayTracer::getSurfaceSignature()
 {
-	// TODO
-	nx = (double)colorBuffer.getWindowWidth();
-	ny = (double)colorBuffer.getWindowHeight();
+	unsigned int signature = hashPoint(dvec3((double)surfaces.size()), PROBE_STREAM);
 
-	topLimit = 1.0;
-	bottomLimit = -topLimit;
+	for (auto& surface : surfaces) {
 
-	distToPlane = topLimit / (glm::tan(glm::radians(verticalFieldOfViewDegrees) / 2.0));
+		BoundingBox openBounds = surface->getBounds(0.0);
+		BoundingBox closeBounds = surface->getBounds(1.0);
+		const Material& material = surface->material;
 
-	rightLimit = topLimit * (nx / ny);
+		// Planes have no finite bounds, so their placement is hashed instead
+		shared_ptr<Plane> plane = std::dynamic_pointer_cast<Plane>(surface);
+		if (plane != nullptr) {
+			openBounds = closeBounds = BoundingBox(plane->a, plane->a + plane->n);
+		}
 
-	leftLimit = -rightLimit;
+		// The accelerator holds on to the surfaces themselves, so a surface replaced by an equal
+		// copy still counts as a change
+		double address = (double)(uintptr_t)surface.get();
+
+		signature = hashPoint(dvec3(address, surface->visibility, 0.0), PROBE_STREAM, signature);
+		signature = hashPoint(openBounds.minCorner, PROBE_STREAM, signature);
+		signature = hashPoint(openBounds.maxCorner, PROBE_STREAM, signature);
+		signature = hashPoint(closeBounds.minCorner, PROBE_STREAM, signature);
+		signature = hashPoint(closeBounds.maxCorner, PROBE_STREAM, signature);
+		signature = hashPoint(dvec3(material.getDiffuse()), PROBE_STREAM, signature);
+		signature = hashPoint(dvec3(material.getSpecular()), PROBE_STREAM, signature);
+		signature = hashPoint(dvec3(material.getEmisive()), PROBE_STREAM, signature);
+		signature = hashPoint(dvec3(material.reflectivity, material.transparency, material.shininess), PROBE_STREAM, signature);
+	}
 
-	renderPerspectiveView = true; // generate perspective view rays
+	return signature;
 
-} // end calculatePerspectiveViewingParameters
+} // end getSurfaceSignature
 
 
-void RayTracer::calculateOrthographicViewingParameters(const double& viewPlaneHeight)
+unsigned int RayTracer::getSceneSignature()
 {
-	topLimit = fabs(viewPlaneHeight) / 2.0;
+	unsigned int signature = hashPoint(dvec3(defaultColor), PROBE_STREAM, getSurfaceSignature());
 
-	rightLimit = topLimit * ((double)colorBuffer.getWindowWidth() / colorBuffer.getWindowHeight()); // Set r based on aspect ratio and height of plane
+	for (int i : activeLights) {
 
-	// Make view plane symetrical about the viewing direction
-	leftLimit = -rightLimit;
-	bottomLimit = -topLimit;
+		auto& light = lights[i];
+		dvec3 origin(0.0, 0.0, 0.0);
 
-	// Calculate the distance between pixels in the horizontal and vertical directions
-	nx = (double)colorBuffer.getWindowWidth();
-	ny = (double)colorBuffer.getWindowHeight();
+		signature = hashPoint(dvec3(light->ambientLightColor), PROBE_STREAM, signature);
+		signature = hashPoint(dvec3(light->diffuseLightColor), PROBE_STREAM, signature);
+		signature = hashPoint(dvec3(light->specularLightColor), PROBE_STREAM, signature);
+		signature = hashPoint(light->getLightVector(origin), PROBE_STREAM, signature);
+		signature = hashPoint(dvec3(light->getLightDistance(origin)), PROBE_STREAM, signature);
 
-	distToPlane = 0.0; // Rays start on the view plane
+		shared_ptr<SpotLight> spot = std::dynamic_pointer_cast<SpotLight>(light);
+		if (spot != nullptr) {
+			signature = hashPoint(spot->spotDirection, PROBE_STREAM, signature);
+			signature = hashPoint(dvec3(spot->cutOffCosineRadians), PROBE_STREAM, signature);
+		}
+	}
 
-	renderPerspectiveView = false; // generate orthographic view rays
+	return signature;
 
-} // end calculateOrthographicViewingParameters
+} // end getSceneSignature
 
 
-void RayTracer::raytraceScene()
+double RayTracer::getSampleVisibility(const LightSample& sample, const HitRecord& hit, const double& time)
 {
-	// Iterate through each and every pixel in the rendering window
-	// TODO
-	Ray vr;
-	for (int y = 0; y < colorBuffer.getWindowHeight(); y++) {
-		for (int x = 0; x < colorBuffer.getWindowWidth(); x++) {
+	int light = reservoirLighting.getLightIndex(sample);
+
+	if (light >= 0) {
+		return getLightVisibility(light, hit.interceptPoint, time);
+	}
+
+	dvec3 toSample = sample.position - hit.interceptPoint;
+	double distance = glm::length(toSample);
+
+	Ray feeler(hit.interceptPoint + EPSILON * hit.surfaceNormal, toSample / distance, SHADOW_RAY);
+	feeler.time = time;
 
-			if (renderPerspectiveView) {
-				vr = getPerspectiveViewRay(x, y);
+	return accelerator.isOccluded(feeler, distance - EPSILON) ? 0.0 : 1.0;
+
+} // end getSampleVisibility
+
+
+void RayTracer::traceRays(const std::vector<Ray>& rays, int recursionLevel, std::vector<color>& colors)
+{
+	int count = (int)rays.size();
+
+	// Find all of the intersections first, noting the surface hit when profiling
+	std::vector<HitRecord> hits(count);
+	ObjectProfiler::ThreadCounts* counts = getObjectCounts();
+	std::vector<int> hitSurfaces(counts != nullptr ? count : 0, -1);
+	{
+		PhaseScope phase(getPerformanceCounters(), INTERSECTION_PHASE);
+
+		for (int i = 0; i < count; i++) {
+			hits[i] = findClosestIntersection(rays[i]);
+
+			if (counts != nullptr) {
+				hitSurfaces[i] = counts->lastHit;
 			}
-			else {
-				vr = getOrthoViewRay(x, y);
+		}
+	}
+
+	// Shadow feelers toward lights with a position are traced together
+	std::vector<signed char> occlusion(count * lights.size(), SHADOW_UNKNOWN);
+	if (shadowPackets && !analyticVisibility) {
+		PhaseScope phase(getPerformanceCounters(), SHADOW_PHASE);
+		traceShadowPackets(hits, occlusion);
+	}
+
+	// Reflections off planar mirrors form a view from the mirrored view point
+	std::vector<Ray> mirrorRays;
+	std::vector<int> mirrorIndices(count, -1);
+
+	if (planarMirrors && recursionLevel > 0) {
+
+		Ray mirrorRay;
+		for (int i = 0; i < count; i++) {
+			if (hits[i].t < INFINITY && getMirrorRay(rays[i], hits[i], mirrorRay)) {
+				mirrorIndices[i] = (int)mirrorRays.size();
+				mirrorRays.push_back(mirrorRay);
 			}
-			color vrColor = traceRay(vr, recursionDepth);
-			colorBuffer.setPixel(x, y, vrColor);
 		}
 	}
-} // end raytraceScene
+
+	std::vector<color> reflections;
+	if (!mirrorRays.empty()) {
+		traceRays(mirrorRays, recursionLevel - 1, reflections);
+	}
+
+	colors.assign(count, defaultColor);
+
+	PhaseScope phase(getPerformanceCounters(), SHADING_PHASE);
+
+	for (int i = 0; i < count; i++) {
+
+		if (hits[i].t < INFINITY) {
+			ShadingTimer timer(counts, counts != nullptr ? hitSurfaces[i] : -1);
+			colors[i] = shadeHit(rays[i], hits[i], recursionLevel, &occlusion[i * lights.size()],
+								 mirrorIndices[i] >= 0 ? &reflections[mirrorIndices[i]] : nullptr);
+		}
+	}
+
+} // end traceRays
+
+
+bool RayTracer::getMirrorRay(const Ray& ray, const HitRecord& hit, Ray& mirrorRay) const
+{
+	if (hit.material.reflectivity <= 0.0 || !isMirror(hit.material) || ray.sharedOrigin == NO_SHARED_ORIGIN) {
+		return false;
+	}
+
+	for (const MirrorPlane& mirror : mirrors) {
+
+		if (ray.sharedOrigin >= (int)mirror.mirroredOriginSlots.size() ||
+			mirror.mirroredOriginSlots[ray.sharedOrigin] == NO_SHARED_ORIGIN) {
+			continue;
+		}
+
+		// Check that the point of intersection is on this plane
+		const Plane& plane = *mirror.plane;
+		if (hit.surfaceNormal != plane.n || glm::abs(glm::dot(hit.interceptPoint - plane.a, plane.n)) > EPSILON) {
+			continue;
+		}
+
+		int slot = mirror.mirroredOriginSlots[ray.sharedOrigin];
+		dvec3 toPoint = hit.interceptPoint - sharedOrigins[slot];
+
+		// Same line as the reflected ray. Everything behind the mirror is skipped.
+		mirrorRay = Ray(sharedOrigins[slot], toPoint, SECONDARY_RAY);
+		mirrorRay.sharedOrigin = slot;
+		mirrorRay.time = ray.time;
+		mirrorRay.tMin = glm::length(toPoint) + EPSILON;
+
+		return true;
+	}
+
+	return false;
+
+} // end getMirrorRay
+
+
+void RayTracer::traceShadowPackets(const std::vector<HitRecord>& hits, std::vector<signed char>& occlusion)
+{
+	int lightCount = (int)lights.size();
+
+	for (int light : activeLights) {
+
+		// Spherical lights are looked up in the distance field instead
+		if (lightOriginSlots[light] == NO_SHARED_ORIGIN || (distanceFieldShading && lightRadii[light] > 0.0)) {
+			continue;
+		}
+
+		ShadowPacket packet(sharedOrigins[lightOriginSlots[light]], lightOriginSlots[light]);
+
+		// Hits whose feelers are in the packet
+		std::vector<int> members;
+
+		for (int i = 0; i <= (int)hits.size(); i++) {
+
+			// Trace the packet when it is full or the hits have run out
+			if (i == (int)hits.size() || packet.size() == shadowPacketSize) {
+
+				packet.trace(accelerator);
+
+				int blocked = 0;
+				for (int j = 0; j < packet.size(); j++) {
+					occlusion[members[j] * lightCount + light] = packet.isOccluded(j) ? 1 : 0;
+					blocked += packet.isOccluded(j) ? 1 : 0;
+				}
+
+				if (objectProfiling) {
+					objectProfiler.countShadowRays(light, packet.size(), blocked);
+				}
+
+				packet.clear();
+				members.clear();
+			}
+
+			if (i < (int)hits.size() && hits[i].t < INFINITY) {
+				packet.addPoint(hits[i].interceptPoint);
+				members.push_back(i);
+			}
+		}
+	}
+
+} // end traceShadowPackets
 
 
 color RayTracer::traceRay(const Ray& ray, int recursionLevel)
@@ -90,40 +1006,257 @@ color RayTracer::traceRay(const Ray& ray, int recursionLevel)
 	//check if an intersection occurred
 	if (closesHit.t < INFINITY) {
 
-		color totalColor = closesHit.material.getEmisive();
+		ObjectProfiler::ThreadCounts* counts = getObjectCounts();
+		ShadingTimer timer(counts, counts != nullptr ? counts->lastHit : -1);
+
+		return shadeHit(ray, closesHit, recursionLevel);
+	}
+	else {
+		return defaultColor;
+	}
+
+} // end traceRay
+
+
+color RayTracer::shadeHit(const Ray& ray, const HitRecord& closesHit, int recursionLevel, const signed char* lightOcclusion,
+						  const color* reflection, const color* directLight)
+{
+	color totalColor = closesHit.material.getEmisive();
+
+	// Light bounced off other surfaces, which takes the place of the ambient part of the lights
+	color indirectLight;
+	bool probeLit = irradianceProbes &&
+		irradianceVolume.getIrradiance(closesHit.interceptPoint, closesHit.surfaceNormal, indirectLight);
+
+	// Fraction of the ambient light that is not blocked by nearby spheres
+	double ambientVisibility = probeLit ? 0.0 : 1.0;
+	if (!probeLit && ambientOcclusionDistance > 0.0 && distanceFieldShading) {
+		ambientVisibility = distanceField.ambientOcclusion(closesHit.interceptPoint, closesHit.surfaceNormal,
+			ambientOcclusionDistance);
+	}
+	else if (!probeLit && ambientOcclusionDistance > 0.0) {
+		ambientVisibility = AnalyticVisibility::ambientOcclusion(accelerator, closesHit.interceptPoint,
+			closesHit.surfaceNormal, ambientOcclusionDistance, ray.time);
+	}
+
+	if (directLight != nullptr) {
+
+		// The estimate covers everything but the ambient part of each light
+		for (int i : activeLights) {
+			totalColor += ambientVisibility * lights[i]->ambientLightColor * closesHit.material.getAmbient(closesHit.uv);
+		}
+
+		totalColor += *directLight;
+	}
+	else {
 
-		for (auto& light : lights) {
+		for (int i : activeLights) {
 
-			//double d = light->getLightDistance(closesHit.interceptPoint);
+			auto& light = lights[i];
 
-			//dvec3 shadowFeeler = light->getLightVector(closesHit.interceptPoint);
+			double visibility;
+			if (lightOcclusion != nullptr && lightOcclusion[i] != SHADOW_UNKNOWN) {
+				visibility = lightOcclusion[i] != 0 ? 0.0 : 1.0;
+			}
+			else {
+				visibility = getLightVisibility(i, closesHit.interceptPoint, ray.time);
+			}
 
-			//HitRecord shadowHit = findClosestIntersection(Ray(closesHit.interceptPoint, shadowFeeler));
+			color ambient = light->ambientLightColor * closesHit.material.getAmbient(closesHit.uv);
+			color lightColor;
 
-			//double attenuation = 0;
+			if (visibility <= 0.0) {
 
-			
-			//if (shadowFeeler != dvec3(0.0, 0.0, 0.0)) {
-				totalColor += light->getLocalIllumination(-ray.direct, closesHit.interceptPoint,
+				// Only the ambient portion of the light reaches the point
+				lightColor = ambient;
+			}
+			else {
+				lightColor = light->getLocalIllumination(-ray.direct, closesHit.interceptPoint,
 					closesHit.surfaceNormal, closesHit.material, closesHit.uv);
-			//}
 
+				// Part of the light is hidden
+				if (visibility < 1.0) {
+					lightColor = glm::mix(ambient, lightColor, visibility);
+				}
+			}
+
+			if (ambientVisibility < 1.0) {
+				lightColor -= (1.0 - ambientVisibility) * ambient;
+			}
+
+			totalColor += lightColor;
+
+		}
+
+		// Light given off by glowing surfaces
+		if (emissiveSamples > 0 && !emissiveLights.empty()) {
+
+			RandomSequence random(hashPoint(closesHit.interceptPoint, EMISSIVE_STREAM, recursionLevel));
+
+			totalColor += emissiveLights.sampleIllumination(accelerator, closesHit, -ray.direct, ray.time,
+				emissiveSamples, random);
+		}
+	}
+
+	if (probeLit) {
+		totalColor += closesHit.material.getDiffuse(closesHit.uv) * indirectLight / PI;
+	}
+
+	// Add light reflected from other surfaces in the mirror direction
+	if (reflection != nullptr) {
+
+		totalColor += closesHit.material.reflectivity * *reflection;
+	}
+	else if (recursionLevel > 0 && closesHit.material.reflectivity > 0.0) {
+
+		totalColor += closesHit.material.reflectivity * traceReflection(ray, closesHit, recursionLevel);
+	}
+
+	// Light passing through or reflected by glass replaces part of the surface color
+	if (recursionLevel > 0 && closesHit.material.transparency > 0.0) {
+
+		totalColor = (1.0 - closesHit.material.transparency) * totalColor +
+			closesHit.material.transparency * traceDielectric(ray, closesHit, recursionLevel);
+	}
+
+	return totalColor;
+
+} // end shadeHit
+
+
+color RayTracer::traceReflection(const Ray& ray, const HitRecord& hit, int recursionLevel)
+{
+	const dvec3& normal = hit.surfaceNormal;
+	dvec3 mirrorDirection = glm::reflect(ray.direct, normal);
+
+	if (isMirror(hit.material)) {
+
+		Ray reflectRay(hit.interceptPoint + EPSILON * normal, mirrorDirection, SECONDARY_RAY);
+		reflectRay.time = ray.time;
+
+		return traceRay(reflectRay, recursionLevel - 1);
+	}
+
+	// Only view rays spread into several rays so the count does not grow with each bounce
+	int samples = ray.type == VIEW_RAY ? glossySamples : 1;
+	double exponent = 1.0 / (hit.material.shininess + 1.0);
+
+	dmat3 lobe = orthonormalBasis(mirrorDirection);
+
+	// Part of the rays follow the light learned in earlier frames
+	const DirectionalTree* guide = pathGuiding ? guidingField.getDistribution(hit.interceptPoint) : nullptr;
+	double guidedFraction = guide != nullptr ? GUIDED_FRACTION : 0.0;
+
+	// While guiding, every pass takes fresh directions. A field evaluated with the same samples
+	// it learned from darkens the image.
+	unsigned int sequence = recursionLevel;
+	if (pathGuiding) {
+		sequence += 256u * guidingField.getPassCount();
+	}
+
+	RandomSequence random(hashPoint(hit.interceptPoint, GLOSSY_STREAM, sequence));
+	dvec2 rotation = random.next2();
+
+	color total(0.0, 0.0, 0.0, 0.0);
+
+	for (int i = 0; i < samples; i++) {
+
+		dvec2 u = hammersley(i, samples, rotation);
+		dvec3 direction;
+
+		if (u.x < guidedFraction) {
+
+			double guidePdf;
+			direction = guide->sample(dvec2(u.x / guidedFraction, u.y), guidePdf);
+		}
+		else {
+
+			// Direction distributed in proportion to cos^shininess of its angle to the mirror direction
+			double cosAlpha = glm::pow((u.x - guidedFraction) / (1.0 - guidedFraction), exponent);
+			double sinAlpha = sqrt(glm::max(1.0 - cosAlpha * cosAlpha, 0.0));
+			double phi = TWO_PI * u.y;
+
+			direction = lobe * dvec3(cos(phi) * sinAlpha, sin(phi) * sinAlpha, cosAlpha);
+		}
+
+		// Directions below the surface carry no light
+		if (glm::dot(direction, normal) <= 0.0) {
+			continue;
+		}
+
+		Ray reflectRay(hit.interceptPoint + EPSILON * normal, direction, SECONDARY_RAY);
+		reflectRay.time = ray.time;
+
+		color reflected = traceRay(reflectRay, recursionLevel - 1);
+
+		if (pathGuiding) {
+
+			// Density of the Phong lobe and of the mixture the direction was drawn from
+			double lobePdf = (hit.material.shininess + 1.0) / TWO_PI *
+				glm::pow(glm::max(glm::dot(direction, mirrorDirection), 0.0), hit.material.shininess);
+			double mixturePdf = guidedFraction * (guide != nullptr ? guide->pdf(direction) : 0.0) +
+				(1.0 - guidedFraction) * lobePdf;
+
+			guidingField.record(hit.interceptPoint, direction, luminance(reflected) / mixturePdf);
+
+			reflected *= lobePdf / mixturePdf;
 		}
 
-		//dvec3 reflectDirection = glm::reflect(ray.direct, closesHit.surfaceNormal);
+		total += reflected;
+	}
+
+	return total / (double)samples;
+
+} // end traceReflection
+
+
+color RayTracer::traceDielectric(const Ray& ray, const HitRecord& hit, int recursionLevel)
+{
+	// The normal faces the incoming ray. Leaving rays go from the material back into air.
+	const dvec3& normal = hit.surfaceNormal;
+	double indexOfRefraction = hit.material.indexOfRefraction;
+	double eta = hit.rayStatus == ENTERING ? 1.0 / indexOfRefraction : indexOfRefraction;
+
+	double cosIncident = -glm::dot(ray.direct, normal);
+	double sinSquaredTransmitted = eta * eta * (1.0 - cosIncident * cosIncident);
+
+	Ray reflectRay(hit.interceptPoint + EPSILON * normal, glm::reflect(ray.direct, normal), SECONDARY_RAY);
+	reflectRay.time = ray.time;
 
-		//Ray reflectRay(closesHit.interceptPoint + EPSILON * closesHit.surfaceNormal, reflectDirection);
+	// Total internal reflection
+	if (sinSquaredTransmitted >= 1.0) {
+		return traceRay(reflectRay, recursionLevel - 1);
+	}
+
+	// Schlick's approximation of the Fresnel reflectance using the angle on the air side
+	double r0 = (1.0 - indexOfRefraction) / (1.0 + indexOfRefraction);
+	r0 *= r0;
+
+	double cosine = hit.rayStatus == ENTERING ? cosIncident : sqrt(1.0 - sinSquaredTransmitted);
+	double reflectance = r0 + (1.0 - r0) * glm::pow(1.0 - cosine, 5.0);
+
+	Ray refractRay(hit.interceptPoint - EPSILON * normal, glm::refract(ray.direct, normal, eta), SECONDARY_RAY);
+	refractRay.time = ray.time;
 
-		//totalColor += traceRay(reflectRay, recursionLevel - 1);
+	if (dielectricSplit && ray.type == VIEW_RAY) {
 
-		return totalColor;
-		//return closesHit.material.getDiffuse();
+		return reflectance * traceRay(reflectRay, recursionLevel - 1) +
+			(1.0 - reflectance) * traceRay(refractRay, recursionLevel - 1);
+	}
+
+	// Follow one branch chosen in proportion to its weight, so the weights cancel. The choice
+	// changes from frame to frame, so a pixel does not take the same branch in every frame.
+	unsigned int index = hashPoint(dvec3(frameCount, recursionLevel, 0.0), DIELECTRIC_STREAM);
+	RandomSequence random(hashPoint(hit.interceptPoint, DIELECTRIC_STREAM, index));
+
+	if (random.next() < reflectance) {
+		return traceRay(reflectRay, recursionLevel - 1);
 	}
 	else {
-		return defaultColor;
+		return traceRay(refractRay, recursionLevel - 1);
 	}
 
-} // end traceRay
+} // end traceDielectric
 
 
 
@@ -131,64 +1264,210 @@ color RayTracer::traceRay(const Ray& ray, int recursionLevel)
 
 HitRecord RayTracer::findClosestIntersection(const Ray& ray)
 {
-	HitRecord closestHit;
-	closestHit.t = INFINITY;
-
 	// Check if the ray intersects any surfaces in the scene
 	// TODO
-	for (auto& surfaces : this->surfaces) {
-		HitRecord temp = surfaces->findIntersect(ray);
-		if (temp.t < closestHit.t) {
-			closestHit = temp;
-		}
-	}
-	return closestHit;
+	return accelerator.findClosestIntersection(ray);
 
 } // end findIntersection
 
 
-Ray RayTracer::getOrthoViewRay(const int& x, const int& y)
+bool RayTracer::inShadow(const int& lightIndex, const dvec3& point, const double& time)
 {
-	Ray orthoViewRay;
+	shared_ptr<LightSource> & light = lights[lightIndex];
+
+	dvec3 shadowFeeler = light->getLightVector(point);
+
+	// Ambient light has no direction and cannot be blocked
+	if (shadowFeeler == dvec3(0.0, 0.0, 0.0)) {
+		return false;
+	}
+
+	double distToLight = light->getLightDistance(point);
+	bool blocked;
 
-	dvec2 uv = getImagePlaneCoordinates(x, y);
+	if (lightOriginSlots[lightIndex] != NO_SHARED_ORIGIN) {
 
-	orthoViewRay.origin = eye + uv.x * u + uv.y * v;
-	orthoViewRay.direct = glm::normalize(-w);
+		// Cast the feeler from the light toward the point so that it starts at a shared origin
+		Ray shadowRay(sharedOrigins[lightOriginSlots[lightIndex]], -shadowFeeler, SHADOW_RAY);
+		shadowRay.sharedOrigin = lightOriginSlots[lightIndex];
+		shadowRay.time = time;
 
-	return orthoViewRay;
+		blocked = accelerator.isOccluded(shadowRay, distToLight - EPSILON);
+	}
+	else {
+
+		Ray shadowRay(point + EPSILON * shadowFeeler, shadowFeeler, SHADOW_RAY);
+		shadowRay.time = time;
+
+		blocked = accelerator.isOccluded(shadowRay, distToLight);
+	}
+
+	if (objectProfiling) {
+		objectProfiler.countShadowRays(lightIndex, 1, blocked ? 1 : 0);
+	}
+
+	return blocked;
 
-} // end getOrthoViewRay
+} // end inShadow
 
 
-Ray RayTracer::getPerspectiveViewRay(const int& x, const int& y)
+double RayTracer::getLightVisibility(const int& lightIndex, const dvec3& point, const double& time)
 {
-	Ray perspectiveViewRay;
+	if (analyticVisibility && lightOriginSlots[lightIndex] != NO_SHARED_ORIGIN) {
 
-	// TODO
-	perspectiveViewRay.origin = eye;
+		return AnalyticVisibility::lightVisibility(accelerator, point, sharedOrigins[lightOriginSlots[lightIndex]],
+			lightRadii[lightIndex], time);
+	}
 
-	dvec2 uv = getImagePlaneCoordinates(x, y);
+	if (distanceFieldShading && lightRadii[lightIndex] > 0.0 && !distanceField.getBounds().isEmpty()) {
 
-	perspectiveViewRay.direct = glm::normalize(distToPlane * (-w) + uv.x * u + uv.y * v);
+		double occluderDistance;
+		double visibility = distanceField.lightVisibility(point, sharedOrigins[lightOriginSlots[lightIndex]],
+			lightRadii[lightIndex], occluderDistance);
+
+		// The field blurs surfaces that touch the point, so their shadows are traced
+		if (occluderDistance >= CONTACT_VOXELS * distanceField.getVoxelSize()) {
+			return visibility;
+		}
+	}
 
-	return perspectiveViewRay;
+	return inShadow(lightIndex, point, time) ? 0.0 : 1.0;
 
-} // end getPerspectiveViewRay
+} // end getLightVisibility
 
 
-dvec2 RayTracer::getImagePlaneCoordinates(const int& x, const int& y)
+void RayTracer::prepareFrame(std::vector<RenderView>& views)
 {
-	dvec2 s;
+	// The accelerator and the emissive surfaces are only built again when the surfaces change.
+	// They do not depend on each other, so they are built while the rest of the frame is set up.
+	TaskGroup builds(renderThreads);
 
-	// TODO
-	s.x = (x + 0.5) * ((rightLimit - leftLimit) / nx) + leftLimit;
-	s.y = (y + 0.5) * ((topLimit - bottomLimit) / ny) + bottomLimit;
+	unsigned int surfaceSignature = getSurfaceSignature();
+
+	if (acceleratorStale || surfaceSignature != acceleratorSignature) {
+
+		builds.run([this] { accelerator.build(surfaces); }, HIGH_PRIORITY);
+		builds.run([this] { emissiveLights.build(surfaces); }, HIGH_PRIORITY);
+
+		acceleratorSignature = surfaceSignature;
+		acceleratorStale = false;
+	}
+
+	// Lights that are turned off are skipped by every view
+	activeLights.clear();
+	for (int i = 0; i < (int)lights.size(); i++) {
+		if (lights[i]->enabled) {
+			activeLights.push_back(i);
+		}
+	}
+
+	builds.wait();
+
+	if (reservoirResampling) {
+		reservoirLighting.build(lights, activeLights, emissiveLights, emissiveSamples > 0);
+	}
+
+	if (bidirectional) {
+		bidirectionalTracer.build(lights, activeLights, emissiveLights, glossyMirrorCutoff, bidirectionalBounces,
+			renderThreads.getThreadCount());
+	}
+
+	// The guiding field covers the bounded surfaces and the view points
+	if (pathGuiding) {
+
+		BoundingBox sceneBounds = getSceneBounds();
+
+		for (RenderView& renderView : views) {
+			sceneBounds.expand(renderView.eye);
+		}
+
+		if (sceneBounds.minCorner != guidingField.getBounds().minCorner || sceneBounds.maxCorner != guidingField.getBounds().maxCorner) {
+			guidingField.reset(sceneBounds);
+		}
+	}
+
+	sharedOrigins.clear();
+	lightOriginSlots.assign(lights.size(), NO_SHARED_ORIGIN);
+	lightRadii.assign(lights.size(), 0.0);
+
+	// Every perspective view ray starts at the view point of its view
+	for (RenderView& renderView : views) {
+		if (renderView.renderPerspectiveView) {
+			renderView.eyeOriginSlot = (int)sharedOrigins.size();
+			sharedOrigins.push_back(renderView.eye);
+		}
+		else {
+			renderView.eyeOriginSlot = NO_SHARED_ORIGIN;
+		}
+	}
+
+	// Reflections of view rays off planar mirrors start at the mirror image of the view point
+	mirrors.clear();
+
+	int viewOriginCount = (int)sharedOrigins.size();
+
+	for (auto& surface : surfaces) {
+
+		shared_ptr<Plane> plane = std::dynamic_pointer_cast<Plane>(surface);
+
+		if (plane == nullptr || plane->material.reflectivity <= 0.0) {
+			continue;
+		}
+
+		MirrorPlane mirror;
+		mirror.plane = plane;
+		mirror.mirroredOriginSlots.assign(viewOriginCount, NO_SHARED_ORIGIN);
+
+		for (int slot = 0; slot < viewOriginCount; slot++) {
+
+			double height = glm::dot(sharedOrigins[slot] - plane->a, plane->n);
+
+			// View rays from behind the plane never hit it
+			if (height > 0.0) {
+				dvec3 mirroredOrigin = sharedOrigins[slot] - 2.0 * height * plane->n;
 
+				mirror.mirroredOriginSlots[slot] = (int)sharedOrigins.size();
+				sharedOrigins.push_back(mirroredOrigin);
+			}
+		}
+
+		mirrors.push_back(mirror);
+	}
+
+	// Shadow feelers for positional and spot lights start at the light
+	for (int i : activeLights) {
+
+		shared_ptr<PositionalLight> positional = std::dynamic_pointer_cast<PositionalLight>(lights[i]);
+
+		if (positional != nullptr) {
+			lightOriginSlots[i] = (int)sharedOrigins.size();
+			sharedOrigins.push_back(positional->lightPosition);
+
+			shared_ptr<SphericalLight> spherical = std::dynamic_pointer_cast<SphericalLight>(lights[i]);
+			if (spherical != nullptr) {
+				lightRadii[i] = spherical->radius;
+			}
+		}
+	}
+
+	// The terms are kept here rather than in the surfaces, which versions of a scene and the
+	// renderers reading them share
+	int originCount = (int)sharedOrigins.size();
+	sharedOriginTerms.resize(surfaces.size() * originCount);
 
-	return s;
+	renderThreads.parallelFor((int)surfaces.size(), [&](int i) {
+		for (int origin = 0; origin < originCount; origin++) {
+			surfaces[i]->calculateSharedOriginTerms(sharedOrigins[origin], sharedOriginTerms[i * originCount + origin]);
+		}
+	}, HIGH_PRIORITY);
+
+	accelerator.setOriginTerms(sharedOriginTerms.data(), originCount);
+
+	if (distanceFieldShading) {
+		distanceField.update(surfaces, distanceFieldResolution, renderThreads);
+	}
 
-} // end getImagePlaneCoordinates
+} // end prepareFrame
 
 
 
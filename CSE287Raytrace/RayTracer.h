@@ -4,6 +4,22 @@
 #include "LightSource.h"
 #include "HitRecord.h"
 #include "ImplicitSurface.h"
+#include "Plane.h"
+#include "AnalyticVisibility.h"
+#include "BidirectionalPathTracer.h"
+#include "BoundingVolumeHierarchy.h"
+#include "EmissiveLights.h"
+#include "GuidingField.h"
+#include "DistanceField.h"
+#include "IrradianceVolume.h"
+#include "RenderView.h"
+#include "ReservoirLighting.h"
+#include "SceneVersions.h"
+#include "ShadowPacket.h"
+#include "PerformanceCounters.h"
+#include "AsyncTask.h"
+#include "ThreadPool.h"
+#include "TuningCache.h"
 #include "Ray.h"
 
 /**
@@ -33,11 +49,57 @@ class RayTracer
 	 *
 	 * @brief	Ray traces a scene containing a number of surfaces and light sources. Sets every
 	 * 			pixel in the rendering window. Pixels that are not associated with a ray/surface
-	 * 			intersection are set to a default color.
+	 * 			intersection are set to a default color. Waits for any other render by this ray
+	 * 			tracer to finish first.
 	 */
 	void raytraceScene( );
 
 
+	/**
+	 * @fn	AsyncTask<bool> RayTracer::raytraceSceneAsync( CancellationToken cancellation = CancellationToken(), std::function<void(int, int)> tileProgress = nullptr );
+	 *
+	 * @brief	Ray traces the scene on the shared thread pool, like raytraceScene, and returns at
+	 * 			once. Asynchronous renders by the same ray tracer run one at a time, in the order
+	 * 			they reach the pool, and synchronous renders wait their turn with them. A render
+	 * 			waiting for the one before it is suspended and holds no thread. The frame buffer must
+	 * 			not be changed until the render has finished, and neither may surfaces and lights
+	 * 			unless the scene is rendered from SceneVersions, whose edits may be published at
+	 * 			any time and show up in the next frame.
+	 *
+	 * @param	cancellation	(Optional) Checked before each tile is started. Tiles already
+	 * 							started are finished, so the frame buffer is left partly rendered.
+	 * 							Modes that render whole views at a time, such as bidirectional
+	 * 							and reservoir rendering, are only checked before they start.
+	 * @param	tileProgress	(Optional) Called with the number of tiles finished and the total
+	 * 							each time a tile is finished. Called by the rendering threads, so
+	 * 							it must be safe to call from several at once.
+	 *
+	 * @returns	A task that yields false if the render was cancelled before it finished.
+	 */
+	AsyncTask<bool> raytraceSceneAsync( CancellationToken cancellation = CancellationToken(),
+										std::function<void(int, int)> tileProgress = nullptr );
+
+
+	/**
+	 * @fn	void RayTracer::raytraceViews( std::vector<RenderView> & views, const CancellationToken * cancellation = nullptr, const std::function<void(int, int)> & tileProgress = nullptr );
+	 *
+	 * @brief	Ray traces several views of the scene, such as a stereo pair or the faces of a
+	 * 			cube map, in a single pass. The bounding volume hierarchy, the cached origin terms
+	 * 			of the lights, and the list of enabled lights are prepared once and shared by all
+	 * 			views. Tiles of every view are rendered by one pool of threads. Waits for any other
+	 * 			render by this ray tracer to finish first, running queued pool tasks meanwhile, so
+	 * 			it must not be called by a pool task while an asynchronous render is under way.
+	 *
+	 * @param [in,out]	views			Views to be rendered. Each is rendered into its own frame buffer.
+	 * @param 		  	cancellation	(Optional) Checked before each tile is started. Null if the
+	 * 									render cannot be cancelled.
+	 * @param 		  	tileProgress	(Optional) Called with the number of tiles finished and the
+	 * 									total each time a tile is finished.
+	 */
+	void raytraceViews( std::vector<RenderView> & views, const CancellationToken * cancellation = nullptr,
+						const std::function<void(int, int)> & tileProgress = nullptr );
+
+
 	/**
 	 * @fn	void RayTracer::setCameraFrame(const dvec3 & viewPosition, const dvec3 & viewingDirection, dvec3 up);
 	 *
@@ -99,6 +161,408 @@ class RayTracer
 	void setRecursionDepth( const int & recursionDepth ) { this->recursionDepth = recursionDepth; }
 
 
+	/**
+	 * @fn	void RayTracer::setMotionBlurSamples( const int & samples )
+	 *
+	 * @brief	Sets the number of rays traced per pixel at different times within the shutter
+	 * 			interval. The rays are stratified over the interval and their colors averaged to
+	 * 			blur moving surfaces. Values of one or less trace a single ray at shutter open.
+	 *
+	 * @param	samples	Number of time samples per pixel.
+	 */
+	void setMotionBlurSamples( const int & samples ) { this->motionBlurSamples = glm::max(samples, 1); }
+
+
+	/**
+	 * @fn	void RayTracer::setTileSize( const int & tileSize )
+	 *
+	 * @brief	Sets the width and height in pixels of the square tiles that are handed out to the
+	 * 			rendering threads.
+	 *
+	 * @param	tileSize	Width and height of a tile in pixels.
+	 */
+	void setTileSize( const int & tileSize ) { this->tileSize = glm::max(tileSize, 1); }
+
+
+	/**
+	 * @fn	void RayTracer::setSpatialSplits( const double & duplicateBudget )
+	 *
+	 * @brief	Lets the bounding volume hierarchy split large surfaces between nodes where that
+	 * 			lowers the cost of traversal. Takes effect at the next frame.
+	 *
+	 * @param	duplicateBudget	Most extra references as a fraction of the number of bounded
+	 * 							surfaces. Zero turns spatial splits off.
+	 */
+	void setSpatialSplits( const double & duplicateBudget )
+	{
+		accelerator.setSpatialSplits(duplicateBudget);
+		acceleratorStale = true;
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setHierarchyOptimization( const double & seconds )
+	 *
+	 * @brief	Sets the time spent improving the bounding volume hierarchy each time it is built,
+	 * 			which happens at the start of a frame when the surfaces have changed. Worth it for
+	 * 			scenes with many surfaces that are rendered with many rays per frame.
+	 *
+	 * @param	seconds	Most time spent in seconds. Zero turns the optimization off.
+	 */
+	void setHierarchyOptimization( const double & seconds )
+	{
+		accelerator.setOptimizationTime(seconds);
+		acceleratorStale = true;
+	}
+
+
+	/** @returns	Costs of the bounding volume hierarchy before and after it was last optimized and
+	the time that took. */
+	const BoundingVolumeHierarchy::OptimizationReport & getHierarchyOptimizationReport() const
+	{
+		return accelerator.getOptimizationReport();
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setNodeReplication( const bool & enabled )
+	 *
+	 * @brief	Turns replication of the bounding volume hierarchy on or off. On machines with
+	 * 			more than one memory node, each node then keeps its own copy of the hierarchy, so
+	 * 			rendering threads, which are spread over the nodes, never traverse remote memory.
+	 * 			Has no effect on machines with a single memory node.
+	 *
+	 * @param	enabled	True to replicate the hierarchy.
+	 */
+	void setNodeReplication( const bool & enabled )
+	{
+		accelerator.setReplication(enabled);
+		acceleratorStale = true;
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setSceneVersions( SceneVersions * versions )
+	 *
+	 * @brief	Renders a scene that may be edited while it is being rendered. At the start of each
+	 * 			frame the current version is pinned and its lists are copied into surfaces and
+	 * 			lights, which hold on to its surfaces and lights for the rest of the frame. Edits
+	 * 			published while a frame renders show up in the next one.
+	 *
+	 * @param	versions	The versioned scene, which must outlive its use here. Null renders
+	 * 						surfaces and lights as they are.
+	 */
+	void setSceneVersions( SceneVersions * versions ) { sceneVersions = versions; }
+
+
+	/**
+	 * @fn	void RayTracer::setAutotuning( const bool & enabled, const std::string & cachePath = "RayTracerTuning.txt" )
+	 *
+	 * @brief	Turns autotuning on or off. When on, the first frame of each kind of scene renders
+	 * 			the middle of every view a few times over with candidate tile, leaf, and shadow
+	 * 			packet sizes, keeps the settings that trace the most rays per second, and records
+	 * 			them in a file by scene and processor so later runs start tuned. The settings
+	 * 			stay in effect until the kind of scene changes, which moving surfaces alone do not
+	 * 			cause.
+	 *
+	 * @param	enabled  	True to tune the settings.
+	 * @param	cachePath	(Optional) File the tuned settings are kept in.
+	 */
+	void setAutotuning( const bool & enabled, const std::string & cachePath = "RayTracerTuning.txt" )
+	{
+		this->autotuning = enabled;
+		this->tunedSceneKey.clear();
+
+		if (enabled) {
+			tuningCache.load(cachePath);
+		}
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setPerformanceCounters( const bool & enabled )
+	 *
+	 * @brief	Turns performance counting on or off. When on, each frame reads the hardware
+	 * 			counters of every rendering thread around setup, intersection, shadow, shading,
+	 * 			and resolve, falling back to times alone where the counters cannot be opened.
+	 * 			Phases are separated only when view rays are traced in batches, that is with
+	 * 			shadow packets or planar mirrors on. Otherwise tiles count as shading. Trial
+	 * 			renders of the autotuner are not counted.
+	 *
+	 * @param	enabled	True to count.
+	 */
+	void setPerformanceCounters( const bool & enabled ) { this->performanceCounting = enabled; }
+
+
+	/**
+	 * @fn	std::string RayTracer::getPerformanceReport() const
+	 *
+	 * @brief	Time, cycles, instructions per cycle, and cache and branch misses per view ray of
+	 * 			each phase of the last frame rendered with performance counting on.
+	 *
+	 * @returns	The report as a table with a row per phase.
+	 */
+	std::string getPerformanceReport() const { return performanceCounters.getReport(); }
+
+
+	/**
+	 * @fn	void RayTracer::setObjectProfiling( const bool & enabled )
+	 *
+	 * @brief	Turns object profiling on or off. When on, each frame counts the intersection tests
+	 * 			and closest hits of every surface, the time spent shading it, and the shadow rays
+	 * 			traced toward every light, so that the objects that cost the most can be found.
+	 * 			Trial renders of the autotuner are not counted.
+	 *
+	 * @param	enabled	True to profile.
+	 */
+	void setObjectProfiling( const bool & enabled )
+	{
+		this->objectProfiling = enabled;
+		accelerator.setObjectProfiler(getObjectProfiler());
+	}
+
+
+	/**
+	 * @fn	std::string RayTracer::getObjectReport( const int & maxRows = 10 ) const
+	 *
+	 * @brief	Surfaces ranked by intersection tests and by shading time, and lights ranked by
+	 * 			shadow rays, over the last frame rendered with object profiling on. Surfaces and
+	 * 			lights are identified by their index in surfaces and lights.
+	 *
+	 * @param	maxRows	(Optional) Most objects listed in each ranking.
+	 *
+	 * @returns	The report.
+	 */
+	std::string getObjectReport( const int & maxRows = 10 ) const { return objectProfiler.getReport(maxRows); }
+
+
+	/** @returns	Tile, leaf, and shadow packet sizes currently in effect. */
+	RenderSettings getRenderSettings() const
+	{
+		RenderSettings settings;
+		settings.tileSize = tileSize;
+		settings.maxLeafSize = accelerator.getMaxLeafSize();
+		settings.shadowPacketSize = shadowPacketSize;
+
+		return settings;
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setShadowPackets( const bool & enabled, const int & packetSize = 64 )
+	 *
+	 * @brief	Turns shadow packets on or off. When on, the shadow feelers for the view rays of a
+	 * 			tile are gathered per positional or spot light and traced as packets that cull the
+	 * 			bounding volume hierarchy once against a cone anchored at the light. Packets are
+	 * 			not used while motion blur is on.
+	 *
+	 * @param	enabled   	True to trace shadow feelers in packets.
+	 * @param	packetSize	(Optional) Maximum number of feelers in a packet.
+	 */
+	void setShadowPackets( const bool & enabled, const int & packetSize = 64 )
+	{
+		this->shadowPackets = enabled;
+		this->shadowPacketSize = glm::max(packetSize, 1);
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setPlanarMirrors( const bool & enabled )
+	 *
+	 * @brief	Turns the planar mirror shortcut on or off. When on, reflections of view rays off
+	 * 			reflective planes are traced as a view from the mirror image of the view point.
+	 * 			Those rays share an origin and are traced together in the same way as the view
+	 * 			rays of a tile. Only used while motion blur is off.
+	 *
+	 * @param	enabled	True to trace planar reflections from the mirrored view point.
+	 */
+	void setPlanarMirrors( const bool & enabled ) { this->planarMirrors = enabled; }
+
+
+	/**
+	 * @fn	void RayTracer::setAnalyticVisibility( const bool & enabled )
+	 *
+	 * @brief	Turns analytic visibility on or off. When on, shadows from positional, spot, and
+	 * 			spherical lights are estimated from the cones that sphere occluders subtend
+	 * 			instead of being traced with shadow feelers. Spherical lights cast soft shadows.
+	 * 			Surfaces other than spheres still cast hard shadows.
+	 *
+	 * @param	enabled	True to estimate shadows analytically.
+	 */
+	void setAnalyticVisibility( const bool & enabled ) { this->analyticVisibility = enabled; }
+
+
+	/**
+	 * @fn	void RayTracer::setAmbientOcclusion( const double & maxDistance )
+	 *
+	 * @brief	Turns analytic ambient occlusion by spheres on or off. Ambient light reaching a
+	 * 			point is reduced by the spheres within maxDistance of it.
+	 *
+	 * @param	maxDistance	Range of the occlusion. Zero or less turns it off.
+	 */
+	void setAmbientOcclusion( const double & maxDistance ) { this->ambientOcclusionDistance = maxDistance; }
+
+
+	/**
+	 * @fn	void RayTracer::setDistanceField( const bool & enabled, const int & resolution = 128 )
+	 *
+	 * @brief	Turns distance field shading on or off. When on, soft shadows from spherical lights
+	 * 			and ambient occlusion are estimated by marching through a sparse distance field
+	 * 			of the surfaces instead of from sphere occluders alone, so every kind of surface
+	 * 			casts soft shadows. The field is brought up to date at the start of each frame,
+	 * 			rebuilding only the parts near surfaces that changed. Shadows from point lights,
+	 * 			and shadows cast by surfaces closer to the shaded point than a couple of voxels,
+	 * 			are still traced with shadow feelers.
+	 *
+	 * @param	enabled   	True to shade with the distance field.
+	 * @param	resolution	(Optional) Number of voxels along the longest side of the field.
+	 */
+	void setDistanceField( const bool & enabled, const int & resolution = 128 )
+	{
+		this->distanceFieldShading = enabled;
+		this->distanceFieldResolution = glm::max(resolution, DistanceField::BRICK_SIZE);
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setEmissiveSamples( const int & samples )
+	 *
+	 * @brief	Sets the number of samples of the light given off by emissive surfaces that are
+	 * 			taken at each point of intersection. Zero keeps emissive surfaces from lighting
+	 * 			anything but themselves.
+	 *
+	 * @param	samples	Number of emitter samples per point.
+	 */
+	void setEmissiveSamples( const int & samples ) { this->emissiveSamples = glm::max(samples, 0); }
+
+
+	/**
+	 * @fn	void RayTracer::setDielectricSplit( const bool & splitFirstBounce )
+	 *
+	 * @brief	Controls how rays that hit transparent surfaces continue. By default one of the
+	 * 			reflected and refracted rays is chosen at random with a probability equal to its
+	 * 			Fresnel weight, so the number of rays grows linearly with the recursion depth. The
+	 * 			choice changes from frame to frame, so glass converges when frames are averaged.
+	 * 			When splitFirstBounce is true, view rays trace both branches weighted by the
+	 * 			Fresnel equations, and only deeper bounces choose one at random.
+	 *
+	 * @param	splitFirstBounce	True to trace both branches where view rays hit glass.
+	 */
+	void setDielectricSplit( const bool & splitFirstBounce ) { this->dielectricSplit = splitFirstBounce; }
+
+
+	/**
+	 * @fn	void RayTracer::setGlossyReflections( const int & samples, const double & mirrorCutoff = 128.0 )
+	 *
+	 * @brief	Sets how reflections off surfaces with a low shininess are blurred. Reflected rays
+	 * 			are importance sampled from the Phong lobe around the mirror direction, so every
+	 * 			ray has the same weight. View rays trace the given number of reflected rays
+	 * 			spread with a Hammersley set. Deeper bounces trace one.
+	 *
+	 * @param	samples			Number of reflected rays where view rays hit a glossy surface.
+	 * 							Zero treats every reflective surface as a mirror.
+	 * @param	mirrorCutoff	(Optional) Shininess at or above which a surface is treated as a
+	 * 							perfect mirror and traces a single ray.
+	 */
+	void setGlossyReflections( const int & samples, const double & mirrorCutoff = 128.0 )
+	{
+		this->glossySamples = glm::max(samples, 0);
+		this->glossyMirrorCutoff = mirrorCutoff;
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setReservoirResampling( const bool & enabled, const int & candidates = 32, const int & neighbors = 4, const bool & temporalReuse = true )
+	 *
+	 * @brief	Turns reservoir resampling of the direct light at view ray hits on or off. When on,
+	 * 			each pixel resamples many unshadowed candidates from the positional lights and
+	 * 			emissive surfaces down to one, merges in the reservoirs of nearby pixels and of
+	 * 			the same surface in the previous frame, and traces a single shadow feeler toward
+	 * 			the chosen sample. Views are then rendered a pass at a time rather than by tiles.
+	 * 			Reflections and refractions are lit as before. Only used while motion blur is off.
+	 *
+	 * @param	enabled		 	True to light view ray hits by reservoir resampling.
+	 * @param	candidates	 	(Optional) Number of candidates drawn at each pixel.
+	 * @param	neighbors	 	(Optional) Number of nearby pixels merged into each reservoir.
+	 * @param	temporalReuse	(Optional) True to merge in the reservoirs of the previous frame.
+	 */
+	void setReservoirResampling( const bool & enabled, const int & candidates = 32, const int & neighbors = 4,
+								 const bool & temporalReuse = true )
+	{
+		this->reservoirResampling = enabled;
+		this->reservoirCandidates = glm::max(candidates, 1);
+		this->reservoirNeighbors = glm::max(neighbors, 0);
+		this->reservoirTemporalReuse = temporalReuse;
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setPathGuiding( const bool & enabled )
+	 *
+	 * @brief	Turns path guiding of glossy reflections on or off. When on, every frame is also a
+	 * 			training pass: the light found by glossy reflection rays is recorded in a field
+	 * 			that is refined between frames, and later frames send part of their glossy rays
+	 * 			in the directions it has learned to be bright. Rays are weighted by the mixture of
+	 * 			the learned and Phong densities, so images stay unbiased. Turning guiding on
+	 * 			forgets anything learned before, as does a change in the extent of the scene.
+	 *
+	 * @param	enabled	True to guide glossy reflection rays.
+	 */
+	void setPathGuiding( const bool & enabled )
+	{
+		this->pathGuiding = enabled;
+		this->guidingField = GuidingField();
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setBidirectional( const bool & enabled, const int & maxBounces = 5 )
+	 *
+	 * @brief	Turns bidirectional path tracing of perspective views on or off. When on, every
+	 * 			frame adds one sample per pixel traced by BidirectionalPathTracer to samples kept
+	 * 			from earlier frames, and the image shows their average. Samples are thrown away
+	 * 			when the view moves or the extent of the scene changes. Orthographic views are
+	 * 			ray traced as before. Lighting is physically based rather than Whitted style,
+	 * 			so images differ in brightness from those of the ray tracer.
+	 *
+	 * @param	enabled   	True to render perspective views by bidirectional path tracing.
+	 * @param	maxBounces	(Optional) Most surfaces light may bounce off on its way to the camera.
+	 */
+	void setBidirectional( const bool & enabled, const int & maxBounces = 5 )
+	{
+		this->bidirectional = enabled;
+		this->bidirectionalBounces = glm::max(maxBounces, 1);
+		this->bidirectionalFrames.clear();
+	}
+
+
+	/**
+	 * @fn	void RayTracer::setIrradianceProbes( const bool & enabled, const int & resolution = 8, const int & raysPerProbe = 128, const int & probesPerFrame = 64 )
+	 *
+	 * @brief	Turns the irradiance probe volume on or off. When on, a grid of probes placed over
+	 * 			the bounded surfaces of the first frame records the light arriving from every
+	 * 			direction, and surfaces are lit by the probes around them in place of the
+	 * 			ambient part of the lights. Probes are traced again, a few per frame, whenever a
+	 * 			surface, material, or light changes, so objects that move through a still scene
+	 * 			pick up its bounced light without any rays of their own. The grid stays where it
+	 * 			was placed until probes are turned on again.
+	 *
+	 * @param	enabled		  	True to light surfaces with the probes.
+	 * @param	resolution	  	(Optional) Number of probes along each axis of the grid.
+	 * @param	raysPerProbe  	(Optional) Number of rays traced each time a probe is updated.
+	 * @param	probesPerFrame	(Optional) Most probes updated in a frame.
+	 */
+	void setIrradianceProbes( const bool & enabled, const int & resolution = 8, const int & raysPerProbe = 128,
+							  const int & probesPerFrame = 64 )
+	{
+		this->irradianceProbes = enabled;
+		this->probeResolution = glm::max(resolution, 2);
+		this->probeRays = glm::max(raysPerProbe, 1);
+		this->probeBudget = glm::max(probesPerFrame, 1);
+		this->irradianceVolume = IrradianceVolume();
+	}
+
+
 	/** @brief	List of the surfaces in the scene that is being ray traced */
 	SurfaceVector surfaces;
 
@@ -125,6 +589,71 @@ protected:
 	color traceRay( const Ray & ray, int recursionLevel = 0);
 
 
+	/**
+	 * @fn	color RayTracer::shadeHit( const Ray & ray, const HitRecord & closestHit, int recursionLevel, const signed char * lightOcclusion = nullptr, const color * reflection = nullptr, const color * directLight = nullptr );
+	 *
+	 * @brief	Calculates the color of a point of intersection from the interactions between the
+	 * 			intersected surface and the light sources in the scene and from any reflected rays.
+	 *
+	 * @param	ray			  	Ray that found the intersection.
+	 * @param	closestHit	  	The point of intersection.
+	 * @param	recursionLevel	Number of additional bounces that may still be traced.
+	 * @param	lightOcclusion	(Optional) Shadow results already found for the point, one per
+	 * 							light: 1 if blocked, 0 if not, or SHADOW_UNKNOWN. Feelers are
+	 * 							traced for unknown entries or if no results are given.
+	 * @param	reflection	  	(Optional) Color seen in the mirror direction if it has already
+	 * 							been traced.
+	 * @param	directLight	  	(Optional) Light from the positional lights and emitters that has
+	 * 							already been estimated, shadows included. Only the ambient part of
+	 * 							each light is then added.
+	 *
+	 * @returns	color for the point of intersection.
+	 */
+	color shadeHit( const Ray & ray, const HitRecord & closestHit, int recursionLevel, const signed char * lightOcclusion = nullptr,
+					const color * reflection = nullptr, const color * directLight = nullptr );
+
+
+	/**
+	 * @fn	color RayTracer::traceReflection( const Ray & ray, const HitRecord & hit, int recursionLevel );
+	 *
+	 * @brief	Traces the light reflected by a surface toward the origin of a ray. Mirrors trace
+	 * 			a single ray in the mirror direction. Glossy surfaces average rays sampled from
+	 * 			their Phong lobe.
+	 *
+	 * @param	ray			  	Ray that hit the surface.
+	 * @param	hit			  	Point of intersection on the reflective surface.
+	 * @param	recursionLevel	Number of additional bounces that may still be traced. Must be
+	 * 							greater than zero.
+	 *
+	 * @returns	Color arriving along the ray from the point by reflection.
+	 */
+	color traceReflection( const Ray & ray, const HitRecord & hit, int recursionLevel );
+
+
+	/** @returns	True if reflections off a material are traced as a single mirror ray. */
+	bool isMirror( const Material & material ) const
+	{
+		return glossySamples <= 0 || material.shininess >= glossyMirrorCutoff;
+	}
+
+
+	/**
+	 * @fn	color RayTracer::traceDielectric( const Ray & ray, const HitRecord & hit, int recursionLevel );
+	 *
+	 * @brief	Traces the light that reaches a point on a transparent surface by reflection and
+	 * 			refraction. Total internal reflection sends all of the light along the reflected
+	 * 			ray.
+	 *
+	 * @param	ray			  	Ray that hit the surface.
+	 * @param	hit			  	Point of intersection on the transparent surface.
+	 * @param	recursionLevel	Number of additional bounces that may still be traced. Must be
+	 * 							greater than zero.
+	 *
+	 * @returns	Color arriving along the ray from the point.
+	 */
+	color traceDielectric( const Ray & ray, const HitRecord & hit, int recursionLevel );
+
+
 	/**
 	 * @fn	HitRecord RayTracer::findIntersection( const Ray & ray);
 	 *
@@ -143,50 +672,298 @@ protected:
 
 
 	/**
-	 * @fn	Ray RayTracer::getOrthoViewRay( const int x, const int y);
+	 * @fn	bool RayTracer::inShadow( const int & lightIndex, const dvec3 & point, const double & time = 0.0 );
+	 *
+	 * @brief	Checks whether a point is hidden from one of the lights by a surface. Shadow
+	 * 			feelers for lights that have a position are cast from the light toward the point
+	 * 			so that all feelers for the light share an origin and can use cached origin terms.
+	 *
+	 * @param	lightIndex	Index of the light in the lights vector.
+	 * @param	point	  	Point being shaded.
+	 * @param	time	  	(Optional) Time within the shutter interval of the ray being shaded.
+	 *
+	 * @returns	True if a surface lies between the point and the light.
+	 */
+	bool inShadow( const int & lightIndex, const dvec3 & point, const double & time = 0.0 );
+
+
+	/**
+	 * @fn	double RayTracer::getLightVisibility( const int & lightIndex, const dvec3 & point, const double & time = 0.0 );
+	 *
+	 * @brief	Fraction of one of the lights that can be seen from a point. Estimated from the
+	 * 			sphere occluders when analytic visibility is on, or from the distance field for
+	 * 			spherical lights when it is on. Otherwise a shadow feeler is traced and the light
+	 * 			is either fully visible or hidden.
+	 *
+	 * @param	lightIndex	Index of the light in the lights vector.
+	 * @param	point	  	Point being shaded.
+	 * @param	time	  	(Optional) Time within the shutter interval of the ray being shaded.
+	 *
+	 * @returns	Visible fraction of the light from 0 to 1.
+	 */
+	double getLightVisibility( const int & lightIndex, const dvec3 & point, const double & time = 0.0 );
+
+
+	/**
+	 * @fn	AsyncTask<void> RayTracer::renderFrameLocked( std::vector<RenderView> & views, const CancellationToken * cancellation, const std::function<void(int, int)> & tileProgress );
+	 *
+	 * @brief	Renders a frame once it holds asyncRenderMutex. The arguments must outlive the task.
+	 *
+	 * @param [in,out]	views			Views to be rendered.
+	 * @param 		  	cancellation	Checked before each tile is started. May be null.
+	 * @param 		  	tileProgress	Called after each tile is finished. May be empty.
+	 */
+	AsyncTask<void> renderFrameLocked( std::vector<RenderView> & views, const CancellationToken * cancellation,
+									   const std::function<void(int, int)> & tileProgress );
+
+
+	/**
+	 * @fn	void RayTracer::renderFrame( std::vector<RenderView> & views, const CancellationToken * cancellation, const std::function<void(int, int)> & tileProgress );
+	 *
+	 * @brief	Renders a frame of several views. Called with asyncRenderMutex held.
+	 *
+	 * @param [in,out]	views			Views to be rendered.
+	 * @param 		  	cancellation	Checked before each tile is started. May be null.
+	 * @param 		  	tileProgress	Called after each tile is finished. May be empty.
+	 */
+	void renderFrame( std::vector<RenderView> & views, const CancellationToken * cancellation,
+					  const std::function<void(int, int)> & tileProgress );
+
+
+	/**
+	 * @fn	void RayTracer::prepareFrame( std::vector<RenderView> & views );
+	 *
+	 * @brief	Work done once per frame before any rays are traced and shared by every view:
+	 * 			rebuilds the bounding volume hierarchy and the emitter distribution if the surfaces
+	 * 			have changed, collects the enabled lights, and collects the ray origins shared by
+	 * 			many rays (the view point of every perspective view, its mirror image in every
+	 * 			reflective plane, and the position of every enabled positional light). The
+	 * 			intersection terms that depend only on those origins are found once per surface
+	 * 			and kept in a table for the frame, leaving the surfaces themselves unchanged.
+	 *
+	 * @param [in,out]	views	Views about to be rendered. Their eyeOriginSlot is assigned.
+	 */
+	void prepareFrame( std::vector<RenderView> & views );
+
+
+	/**
+	 * @fn	void RayTracer::renderTiles( std::vector<RenderView> & views, const CancellationToken * cancellation, const std::function<void(int, int)> & tileProgress );
+	 *
+	 * @brief	Splits every view into tiles and renders the tiles on the rendering threads.
+	 *
+	 * @param [in,out]	views			Views being rendered.
+	 * @param 		  	cancellation	Remaining tiles are skipped once it is cancelled. May be null.
+	 * @param 		  	tileProgress	Called after each tile is finished. May be empty.
+	 */
+	void renderTiles( std::vector<RenderView> & views, const CancellationToken * cancellation,
+					  const std::function<void(int, int)> & tileProgress );
+
+
+	/**
+	 * @fn	void RayTracer::renderTile( const RenderView & renderView, const int & xBegin, const int & yBegin, const int & xEnd, const int & yEnd );
+	 *
+	 * @brief	Traces the view rays for a rectangular block of pixels of one view and sets the
+	 * 			pixels in the frame buffer of the view. Called concurrently from the rendering
+	 * 			threads for different tiles.
+	 *
+	 * @param	renderView	View being rendered.
+	 * @param	xBegin	First column of the tile.
+	 * @param	yBegin	First row of the tile.
+	 * @param	xEnd  	One past the last column of the tile.
+	 * @param	yEnd  	One past the last row of the tile.
+	 */
+	void renderTile( const RenderView & renderView, const int & xBegin, const int & yBegin, const int & xEnd, const int & yEnd );
+
+
+	/**
+	 * @fn	void RayTracer::renderReservoirView( const RenderView & renderView, const int & viewIndex );
+	 *
+	 * @brief	Renders a whole view with reservoir resampling of the direct light. The first pass
+	 * 			finds the view ray hits and fills a reservoir per pixel from new candidates and the
+	 * 			previous frame. The second merges in nearby pixels. The third traces one shadow
+	 * 			feeler per pixel, shades, and keeps the reservoirs for the next frame.
+	 *
+	 * @param	renderView	View being rendered.
+	 * @param	viewIndex 	Index of the view. Selects the reservoirs kept from the previous frame.
+	 */
+	void renderReservoirView( const RenderView & renderView, const int & viewIndex );
+
+
+	/**
+	 * @fn	void RayTracer::renderBidirectionalView( const RenderView & renderView, const int & viewIndex );
+	 *
+	 * @brief	Adds one bidirectional path tracing sample to every pixel of a perspective view and
+	 * 			shows the average of the samples taken so far.
+	 *
+	 * @param	renderView	View to be rendered.
+	 * @param	viewIndex 	Index of the view, which selects the samples it adds to.
+	 */
+	void renderBidirectionalView( const RenderView & renderView, const int & viewIndex );
+
+
+	/**
+	 * @fn	void RayTracer::updateIrradianceVolume();
+	 *
+	 * @brief	Places the probe grid on the first call and invalidates it whenever the scene has
+	 * 			changed since the last call. Then traces the probes that are due, up to the
+	 * 			budget of a frame, on the rendering threads.
+	 */
+	void updateIrradianceVolume();
+
+
+	/**
+	 * @fn	void RayTracer::autotune( std::vector<RenderView> & views );
+	 *
+	 * @brief	Puts the settings tuned for the kind of scene being rendered into effect, tuning
+	 * 			them first if they are not in the tuning cache. Called after prepareFrame, and
+	 * 			rebuilds the bounding volume hierarchy if the leaf size changes.
+	 *
+	 * @param [in,out]	views	Views about to be rendered.
+	 */
+	void autotune( std::vector<RenderView> & views );
+
+
+	/**
+	 * @fn	RenderSettings RayTracer::tuneSettings( std::vector<RenderView> & views );
+	 *
+	 * @brief	Searches the candidate tile, leaf, and shadow packet sizes one at a time, keeping
+	 * 			the best value of each before moving on to the next.
+	 *
+	 * @param [in,out]	views	Views the calibration regions are rendered in.
+	 *
+	 * @returns	The fastest settings found.
+	 */
+	RenderSettings tuneSettings( std::vector<RenderView> & views );
+
+
+	/**
+	 * @fn	double RayTracer::measureRaysPerSecond( std::vector<RenderView> & views );
+	 *
+	 * @brief	Renders the calibration region in the middle of every view with the current
+	 * 			settings and times it. The best of a few runs is kept. The pixels rendered are
+	 * 			overwritten by the frame that follows.
+	 *
+	 * @param [in,out]	views	Views being rendered.
+	 *
+	 * @returns	View rays traced per second.
+	 */
+	double measureRaysPerSecond( std::vector<RenderView> & views );
+
+
+	/**
+	 * @fn	void RayTracer::applySettings( const RenderSettings & settings );
+	 *
+	 * @brief	Puts settings into effect, rebuilding the bounding volume hierarchy if the leaf size
+	 * 			changes.
+	 */
+	void applySettings( const RenderSettings & settings );
+
+
+	/**
+	 * @fn	std::string RayTracer::getTuningKey( const std::vector<RenderView> & views ) const;
+	 *
+	 * @brief	Describes the kind of scene being rendered: how many surfaces and lights there are,
+	 * 			the size of every view, the features that change how rays are traced, and the
+	 * 			number of threads. Surfaces and lights that move keep the same key.
+	 *
+	 * @param	views	Views about to be rendered.
+	 *
+	 * @returns	The key as a string of hexadecimal digits.
+	 */
+	std::string getTuningKey( const std::vector<RenderView> & views ) const;
+
+
+	/**
+	 * @fn	unsigned int RayTracer::getSurfaceSignature();
+	 *
+	 * @brief	Hashes what the accelerator and the emissive surfaces are built from: which surfaces
+	 * 			are in the scene, their extent at shutter open and close, the rays that see them,
+	 * 			and their colors.
+	 *
+	 * @returns	The hash. Equal for frames in which no surface changed.
+	 */
+	unsigned int getSurfaceSignature();
+
+
+	/**
+	 * @fn	unsigned int RayTracer::getSceneSignature();
 	 *
-	 * @brief	Gets the rayOrigin and rayDirection data members of the class based on row and column
-	 * 			of a specified pixel.These two data members together represent a parametric
-	 * 			description of a ray to be checked for intersection with objects in the scene. The
-	 * 			ray is calculated for a orthographic projection.
+	 * @brief	Hashes what the probes and the bidirectional film see of the scene: everything
+	 * 			getSurfaceSignature covers and the color, position, direction, and cone of every
+	 * 			enabled light.
 	 *
-	 * @param	x	column of a pixel in the rendering window.
-	 * @param	y	row of a pixel in the rendering window.
+	 * @returns	The hash. Equal for frames in which nothing changed.
+	 */
+	unsigned int getSceneSignature();
+
+
+	/**
+	 * @fn	BoundingBox RayTracer::getSceneBounds() const;
 	 *
-	 * @returns	The ortho view ray.
+	 * @brief	Finds the box around every surface of finite extent.
+	 *
+	 * @returns	The box. Empty if no surface is bounded.
 	 */
-	Ray getOrthoViewRay( const int & x, const int & y);
+	BoundingBox getSceneBounds() const;
 
 
 	/**
-	 * @fn	Ray RayTracer::getPerspectiveViewRay( const int x, const int y);
+	 * @fn	double RayTracer::getSampleVisibility( const LightSample & sample, const HitRecord & hit, const double & time );
+	 *
+	 * @brief	Fraction of a light sample that can be seen from a point. Lights are handled by
+	 * 			getLightVisibility. Points on emitters are tested with a shadow feeler.
 	 *
-	 * @brief	Gets the rayOrigin and rayDirection data members of the class 
-	 * 			based on row and column of a specified pixel.These two data members 
-	 * 			together represent a parametric description of a ray to be checked 
-	 * 			for intersection with objects in the scene. The ray is calculated 
-	 * 			for a perspective projection.
+	 * @param	sample	The sample.
+	 * @param	hit   	Point of intersection being shaded.
+	 * @param	time  	Time within the shutter interval of the ray being shaded.
 	 *
-	 * @param	x	column of a pixel in the rendering window.
-	 * @param	y	row of a pixel in the rendering window.
+	 * @returns	Visible fraction of the sample from 0 to 1.
+	 */
+	double getSampleVisibility( const LightSample & sample, const HitRecord & hit, const double & time );
+
+
+	/**
+	 * @fn	void RayTracer::traceRays( const std::vector<Ray> & rays, int recursionLevel, std::vector<color> & colors );
+	 *
+	 * @brief	Traces a group of coherent rays, such as the view rays of a tile, together. All
+	 * 			closest intersections are found first. Shadow feelers are then traced as packets,
+	 * 			and reflections off planar mirrors are gathered into a second group that is traced
+	 * 			the same way from the mirrored view point.
 	 *
-	 * @returns	The perspective view ray.
+	 * @param 		  	rays		  	Rays being traced.
+	 * @param 		  	recursionLevel	Number of additional bounces that may be traced.
+	 * @param [in,out]	colors		  	Set to the color of each ray.
 	 */
-	Ray getPerspectiveViewRay( const int & x, const int & y);
+	void traceRays( const std::vector<Ray> & rays, int recursionLevel, std::vector<color> & colors );
 
 
 	/**
-	 * @fn	dvec2 RayTracer::getImagePlaneCoordinates(const int x, const int y);
+	 * @fn	bool RayTracer::getMirrorRay( const Ray & ray, const HitRecord & hit, Ray & mirrorRay ) const;
+	 *
+	 * @brief	Finds the reflection of a ray off a planar mirror as a ray from the mirror image of
+	 * 			the origin of the ray. The ray starts behind the mirror and ignores everything
+	 * 			before it reaches the point of intersection.
 	 *
-	 * @brief	Finds the projection plane coordinates, u and v, for the pixel identified by the
-	 * 			input arguments.
+	 * @param 		  	ray		 	Ray that hit the surface.
+	 * @param 		  	hit		 	Point of intersection of the ray.
+	 * @param [out]	mirrorRay	The reflected ray.
+	 *
+	 * @returns	True if the ray started at a view point and hit a planar mirror.
+	 */
+	bool getMirrorRay( const Ray & ray, const HitRecord & hit, Ray & mirrorRay ) const;
+
+
+	/**
+	 * @fn	void RayTracer::traceShadowPackets( const std::vector<HitRecord> & hits, std::vector<signed char> & occlusion );
 	 *
-	 * @param	x	column of a pixel in the rendering window.
-	 * @param	y	row of a pixel in the rendering window.
+	 * @brief	Traces the shadow feelers from every enabled positional and spot light toward a
+	 * 			group of points of intersection as packets.
 	 *
-	 * @returns	two dimensional vector containing the projection plane coordinates.
+	 * @param 		  	hits	 	Points of intersection. Misses are skipped.
+	 * @param [in,out]	occlusion	Shadow results, lights.size() entries per hit. Entries of the
+	 * 							lights that were traced are set to 0 or 1.
 	 */
-	dvec2 getImagePlaneCoordinates(const int & x, const int & y);
+	void traceShadowPackets( const std::vector<HitRecord> & hits, std::vector<signed char> & occlusion );
 
 
 	/** @brief	Alias for an object that controls memory that stores a rgba color value f or every pixel. */
@@ -195,55 +972,209 @@ protected:
 	/** @brief	Color to which a pixel is set if there is no intersection for a traced pixel ray. */
 	color defaultColor;
 
-	/* View frame parameters */
+	/** @brief	View rendered by raytraceScene. Renders into colorBuffer. */
+	RenderView view;
 
-	/** @brief	position of the viewpoint */
-	dvec3 eye;
+	/** @brief	Max recursion depth */
+	int recursionDepth;
 
-	/** @brief	"right" direction relative to the viewing direction */
-	dvec3 u;
+	/** @brief	Number of rays per pixel spread over the shutter interval */
+	int motionBlurSamples = 1;
 
-	/** @brief	"up" direction relative to the viewing vector */
-	dvec3 v;
+	/** @brief	Bounding volume hierarchy over the surfaces. Rebuilt at the start of a frame when
+	the surfaces have changed. */
+	BoundingVolumeHierarchy accelerator;
 
-	/** @brief	"back" direction relative to the viewing vector. 
-	Camera looks in the negative w direction */
-	dvec3 w;
+	/** @brief	getSurfaceSignature when the accelerator and emissiveLights were last built */
+	unsigned int acceleratorSignature = 0;
 
-	/*  Projection plane parameters */
+	/** @brief	True if the accelerator must be built again whether or not the surfaces changed,
+	because one of its settings did */
+	bool acceleratorStale = true;
 
-	/** @brief	 Distance from center of projection plane to the right limit 
-	of the projection plane; measured relative to u (right) */
-	double rightLimit = 1.0;
+	/** @brief	Width and height in pixels of the tiles handed out to the rendering threads */
+	int tileSize = 32;
 
-	/** @brief	 Distance from center of projection plane to the left limit
-	of the projection plane; measured relative to u (right) */
-	double leftLimit = -1.0;
+	/** @brief	True to trace the shadow feelers of each tile as packets */
+	bool shadowPackets = true;
 
-	/** @brief	 Distance from center of projection plane to the top limit
-	of the projection plane; measured relative to v (up) */
-	double topLimit = 1.0;
+	/** @brief	Maximum number of feelers in a shadow packet */
+	int shadowPacketSize = 64;
 
-	/** @brief	 Distance from center of projection plane to the bottom limit
-	of the projection plane; measured relative to v (up) */
-	double bottomLimit = -1.0;
+	/** @brief	True to trace reflections off planar mirrors from the mirrored view point */
+	bool planarMirrors = true;
 
-	/* Rendering window parameters */
-	
-	/** @brief	Floating point width of the window in pixels */
-	double nx = 1.0;
+	/** @brief	True to estimate shadows cast by spheres from the cones they subtend */
+	bool analyticVisibility = false;
 
-	/** @brief	Floating point height of the window in pixel */
-	double ny = 1.0;
+	/** @brief	Range of analytic ambient occlusion. Off if zero or less. */
+	double ambientOcclusionDistance = 0.0;
 
-	/** @brief	Distance from the viewpoint to the projection plane */
-	double distToPlane = 1.0;
+	/** @brief	True to estimate soft shadows and ambient occlusion from the distance field */
+	bool distanceFieldShading = false;
 
-	/** @brief	True to generate rays for perspective viewing. Fall for orthographic viewing. */
-	bool renderPerspectiveView = true;
+	/** @brief	Number of voxels along the longest side of the distance field */
+	int distanceFieldResolution = 128;
 
-	/** @brief	Max recursion depth */
-	int recursionDepth;
+	/** @brief	Signed distance to the surfaces that cast shadows */
+	DistanceField distanceField;
+
+	/** @brief	Emissive surfaces that light the scene. Rebuilt along with the accelerator. */
+	EmissiveLights emissiveLights;
+
+	/** @brief	Number of emitter samples per point of intersection */
+	int emissiveSamples = 4;
+
+	/** @brief	True to trace both the reflected and refracted rays where view rays hit glass */
+	bool dielectricSplit = false;
+
+	/** @brief	Number of glossy reflection rays traced where view rays hit a glossy surface */
+	int glossySamples = 8;
+
+	/** @brief	Shininess at or above which reflective surfaces are treated as perfect mirrors */
+	double glossyMirrorCutoff = 128.0;
+
+	/** @brief	True to light view ray hits by reservoir resampling */
+	bool reservoirResampling = false;
+
+	/** @brief	Number of reservoir candidates drawn at each pixel */
+	int reservoirCandidates = 32;
+
+	/** @brief	Number of nearby pixels merged into each reservoir */
+	int reservoirNeighbors = 4;
+
+	/** @brief	True to merge in the reservoirs of the previous frame */
+	bool reservoirTemporalReuse = true;
+
+	/** @brief	Light sources sampled by the reservoirs. Rebuilt at the start of every frame. */
+	ReservoirLighting reservoirLighting;
+
+	/** @brief	Reservoirs kept from the previous frame, one per view */
+	std::vector<ReservoirFrame> reservoirHistory;
+
+	/** @brief	Number of frames rendered. Varies the random choices made at a point from frame to frame. */
+	unsigned int frameCount = 0;
+
+	/** @brief	Number of frames rendered with reservoir resampling. Varies the candidates of
+	pixels that see the same point in consecutive frames. */
+	unsigned int reservoirFrameCount = 0;
+
+	/** @brief	True to guide glossy reflection rays with the learned field */
+	bool pathGuiding = false;
+
+	/** @brief	Light arriving at points of the scene, learned from the glossy reflection rays of
+	earlier frames */
+	GuidingField guidingField;
+
+	/** @brief	True to render perspective views by bidirectional path tracing */
+	bool bidirectional = false;
+
+	/** @brief	Most surfaces light may bounce off in bidirectional path tracing */
+	int bidirectionalBounces = 5;
+
+	/** @brief	Light sources and path arenas of bidirectional path tracing. Rebuilt at the start
+	of every frame. */
+	BidirectionalPathTracer bidirectionalTracer;
+
+	/** @brief	Bidirectional samples taken so far, one entry per view */
+	std::vector<BidirectionalFrame> bidirectionalFrames;
+
+	/** @brief	True to light surfaces with the irradiance probe volume */
+	bool irradianceProbes = false;
+
+	/** @brief	Number of probes along each axis of the probe grid */
+	int probeResolution = 8;
+
+	/** @brief	Number of rays traced each time a probe is updated */
+	int probeRays = 128;
+
+	/** @brief	Most probes updated in a frame */
+	int probeBudget = 64;
+
+	/** @brief	Grid of irradiance probes */
+	IrradianceVolume irradianceVolume;
+
+	/** @brief	Hash of the scene the probes were last invalidated for */
+	unsigned int probeSceneSignature = 0;
+
+	/** @brief	Number of times probes have been traced. Varies the rotation of their rays. */
+	unsigned int probeUpdateCount = 0;
+
+	/** @brief	True to tune the tile, leaf, and shadow packet sizes for each kind of scene */
+	bool autotuning = false;
+
+	/** @brief	Settings tuned so far, by kind of scene and processor */
+	TuningCache tuningCache;
+
+	/** @brief	Key of the kind of scene the current settings were tuned for */
+	std::string tunedSceneKey;
+
+	/** @brief	Threads that render tiles and build per-frame structures, shared with the rest of the program */
+	ThreadPool & renderThreads = ThreadPool::getShared();
+
+	/** @brief	Versioned scene copied into surfaces and lights at the start of each frame. Null if none. */
+	SceneVersions * sceneVersions = nullptr;
+
+	/** @brief	Allows one render at a time, synchronous or not. Renders waiting for it are suspended. */
+	AsyncMutex asyncRenderMutex;
+
+	/** @brief	True to read performance counters around the phases of each frame */
+	bool performanceCounting = false;
+
+	/** @brief	Counters of the last frame rendered with performance counting on */
+	PerformanceCounters performanceCounters;
+
+	/** @returns	The performance counters if counting is on. Null otherwise. */
+	PerformanceCounters * getPerformanceCounters() { return performanceCounting ? &performanceCounters : nullptr; }
+
+	/** @brief	True to count the cost of each surface and light */
+	bool objectProfiling = false;
+
+	/** @brief	Costs of each surface and light in the last frame rendered with profiling on */
+	ObjectProfiler objectProfiler;
+
+	/** @returns	The object profiler if profiling is on. Null otherwise. */
+	ObjectProfiler * getObjectProfiler() { return objectProfiling ? &objectProfiler : nullptr; }
+
+	/** @returns	Object counts of the calling thread if profiling is on. Null otherwise. */
+	ObjectProfiler::ThreadCounts * getObjectCounts() { return objectProfiling ? objectProfiler.getThreadCounts() : nullptr; }
+
+	/* Shared ray origins */
+
+	/** @brief	Ray origins that are shared by batches of rays in the current frame */
+	std::vector<dvec3> sharedOrigins;
+
+	/** @brief	Origin terms of each surface for each of sharedOrigins, surface by surface */
+	std::vector<OriginTerms> sharedOriginTerms;
+
+	/** @brief	Index into sharedOrigins of the position of each light. NO_SHARED_ORIGIN for lights
+	without a position. */
+	std::vector<int> lightOriginSlots;
+
+	/** @brief	Radius of each spherical light. Zero for other lights. */
+	std::vector<double> lightRadii;
+
+	/** @brief	Indices of the lights that are enabled in the current frame */
+	std::vector<int> activeLights;
+
+	/**
+	 * @struct	MirrorPlane
+	 *
+	 * @brief	Reflective plane whose reflections of view rays are traced from the mirror image of
+	 * 			the view point.
+	 */
+	struct MirrorPlane
+	{
+		/** @brief	The reflective plane */
+		shared_ptr<Plane> plane;
+
+		/** @brief	Index into sharedOrigins of the mirror image of each view point, indexed by the
+		slot of the view point. NO_SHARED_ORIGIN if the view point is behind the plane. */
+		std::vector<int> mirroredOriginSlots;
+	};
+
+	/** @brief	Reflective planes of the current frame */
+	std::vector<MirrorPlane> mirrors;
 
 }; // end RayTracer class
 
@@ -0,0 +1,204 @@
+#include "RenderView.h"
+
+
+RenderView::RenderView(FrameBuffer * frameBuffer)
+	: frameBuffer(frameBuffer)
+{
+}
+
+
+void RenderView::setCameraFrame(const dvec3& viewPosition, const dvec3& viewingDirection, dvec3 up)
+{
+	eye = viewPosition;
+
+	w = glm::normalize(-viewingDirection);//backward
+	u = glm::normalize(glm::cross(up, w));
+	v = glm::normalize(glm::cross(w, u));
+
+} // end setCameraFrame
+
+
+void RenderView::calculatePerspectiveViewingParameters(const double& verticalFieldOfViewDegrees)
+{
+	nx = (double)frameBuffer->getWindowWidth();
+	ny = (double)frameBuffer->getWindowHeight();
+
+	topLimit = 1.0;
+	bottomLimit = -topLimit;
+
+	distToPlane = topLimit / (glm::tan(glm::radians(verticalFieldOfViewDegrees) / 2.0));
+
+	rightLimit = topLimit * (nx / ny);
+
+	leftLimit = -rightLimit;
+
+	renderPerspectiveView = true; // generate perspective view rays
+
+} // end calculatePerspectiveViewingParameters
+
+
+void RenderView::calculateOrthographicViewingParameters(const double& viewPlaneHeight)
+{
+	// Calculate the distance between pixels in the horizontal and vertical directions
+	nx = (double)frameBuffer->getWindowWidth();
+	ny = (double)frameBuffer->getWindowHeight();
+
+	topLimit = fabs(viewPlaneHeight) / 2.0;
+
+	rightLimit = topLimit * (nx / ny); // Set r based on aspect ratio and height of plane
+
+	// Make view plane symetrical about the viewing direction
+	leftLimit = -rightLimit;
+	bottomLimit = -topLimit;
+
+	distToPlane = 0.0; // Rays start on the view plane
+
+	renderPerspectiveView = false; // generate orthographic view rays
+
+} // end calculateOrthographicViewingParameters
+
+
+Ray RenderView::getViewRay(const int& x, const int& y) const
+{
+	if (renderPerspectiveView) {
+		return getPerspectiveViewRay(x, y);
+	}
+	else {
+		return getOrthoViewRay(x, y);
+	}
+
+} // end getViewRay
+
+
+Ray RenderView::getOrthoViewRay(const int& x, const int& y) const
+{
+	Ray orthoViewRay;
+
+	dvec2 uv = getImagePlaneCoordinates(x, y);
+
+	orthoViewRay.origin = eye + uv.x * u + uv.y * v;
+	orthoViewRay.direct = glm::normalize(-w);
+
+	return orthoViewRay;
+
+} // end getOrthoViewRay
+
+
+Ray RenderView::getPerspectiveViewRay(const int& x, const int& y) const
+{
+	Ray perspectiveViewRay;
+
+	perspectiveViewRay.origin = eye;
+
+	dvec2 uv = getImagePlaneCoordinates(x, y);
+
+	perspectiveViewRay.direct = glm::normalize(distToPlane * (-w) + uv.x * u + uv.y * v);
+
+	perspectiveViewRay.sharedOrigin = eyeOriginSlot;
+
+	return perspectiveViewRay;
+
+} // end getPerspectiveViewRay
+
+
+Ray RenderView::getSampleRay(const int& x, const int& y, const dvec2& offset) const
+{
+	// Same as getImagePlaneCoordinates with the offset in place of the pixel center
+	dvec2 s((x + offset.x) * ((rightLimit - leftLimit) / nx) + leftLimit,
+			(y + offset.y) * ((topLimit - bottomLimit) / ny) + bottomLimit);
+
+	Ray sampleRay;
+
+	if (renderPerspectiveView) {
+		sampleRay.origin = eye;
+		sampleRay.direct = glm::normalize(distToPlane * (-w) + s.x * u + s.y * v);
+		sampleRay.sharedOrigin = eyeOriginSlot;
+	}
+	else {
+		sampleRay.origin = eye + s.x * u + s.y * v;
+		sampleRay.direct = -w;
+	}
+
+	return sampleRay;
+
+} // end getSampleRay
+
+
+dvec2 RenderView::getImagePlaneCoordinates(const int& x, const int& y) const
+{
+	dvec2 s;
+
+	s.x = (x + 0.5) * ((rightLimit - leftLimit) / nx) + leftLimit;
+	s.y = (y + 0.5) * ((topLimit - bottomLimit) / ny) + bottomLimit;
+
+	return s;
+
+} // end getImagePlaneCoordinates
+
+
+bool RenderView::projectPoint(const dvec3& point, int& x, int& y) const
+{
+	dvec3 toPoint = point - eye;
+	dvec2 s(glm::dot(toPoint, u), glm::dot(toPoint, v));
+
+	if (renderPerspectiveView) {
+
+		double depth = -glm::dot(toPoint, w);
+
+		// Points behind the view point are not seen
+		if (depth <= 0.0) {
+			return false;
+		}
+
+		s *= distToPlane / depth;
+	}
+
+	// Invert getImagePlaneCoordinates
+	double column = (s.x - leftLimit) * nx / (rightLimit - leftLimit);
+	double row = (s.y - bottomLimit) * ny / (topLimit - bottomLimit);
+
+	if (column < 0.0 || row < 0.0 || column >= nx || row >= ny) {
+		return false;
+	}
+
+	x = (int)column;
+	y = (int)row;
+
+	return true;
+
+} // end projectPoint
+
+
+bool RenderView::matches(const RenderView& other) const
+{
+	return eye == other.eye && u == other.u && v == other.v && w == other.w &&
+		rightLimit == other.rightLimit && leftLimit == other.leftLimit &&
+		topLimit == other.topLimit && bottomLimit == other.bottomLimit &&
+		nx == other.nx && ny == other.ny && distToPlane == other.distToPlane &&
+		renderPerspectiveView == other.renderPerspectiveView;
+
+} // end matches
+
+
+std::vector<RenderView> RenderView::cubeMapViews(const dvec3& position, const std::vector<FrameBuffer*>& faces)
+{
+	// Viewing and up directions of the faces following the OpenGL cube map conventions
+	static const dvec3 directions[6] = { dvec3(1, 0, 0), dvec3(-1, 0, 0), dvec3(0, 1, 0),
+										 dvec3(0, -1, 0), dvec3(0, 0, 1), dvec3(0, 0, -1) };
+	static const dvec3 ups[6] = { dvec3(0, -1, 0), dvec3(0, -1, 0), dvec3(0, 0, 1),
+								  dvec3(0, 0, -1), dvec3(0, -1, 0), dvec3(0, -1, 0) };
+
+	std::vector<RenderView> views;
+
+	for (size_t i = 0; i < faces.size() && i < 6; i++) {
+
+		RenderView view(faces[i]);
+		view.setCameraFrame(position, directions[i], ups[i]);
+		view.calculatePerspectiveViewingParameters(90.0);
+
+		views.push_back(view);
+	}
+
+	return views;
+
+} // end cubeMapViews
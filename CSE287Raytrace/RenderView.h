@@ -0,0 +1,226 @@
+#pragma once
+
+#include "FrameBuffer.h"
+#include "Ray.h"
+
+/**
+ * @struct	RenderView
+ *
+ * @brief	Camera frame and projection parameters for one view of a scene together with the
+ * 			frame buffer the view is rendered into. Several views of the same scene (stereo
+ * 			pairs, cube map faces) can be rendered in a single pass with
+ * 			RayTracer::raytraceViews.
+ */
+struct RenderView
+{
+	/**
+	 * @fn	RenderView::RenderView(FrameBuffer * frameBuffer = nullptr);
+	 *
+	 * @brief	Constructor.
+	 *
+	 * @param [in,out]	frameBuffer	(Optional) Buffer into which the view will be rendered.
+	 */
+	RenderView(FrameBuffer * frameBuffer = nullptr);
+
+
+	/**
+	 * @fn	void RenderView::setCameraFrame(const dvec3 & viewPosition, const dvec3 & viewingDirection, dvec3 up);
+	 *
+	 * @brief	Sets the w, u, and v orthonormal basis vectors associated with the coordinate frame
+	 * 			that is tied to the viewing position and the eye data member.
+	 *
+	 * @param	viewPosition		xyz position of the view point.
+	 * @param	viewingDirection	vector that points in the viewing direction.
+	 * @param	up					approximation of the up vector (cannot be parallel to viewing
+	 * 								direction)
+	 */
+	void setCameraFrame(const dvec3 & viewPosition, const dvec3 & viewingDirection, dvec3 up);
+
+
+	/**
+	 * @fn	void RenderView::calculatePerspectiveViewingParameters(const double & verticalFieldOfViewDegrees = 45.0);
+	 *
+	 * @brief	Set topLimit, bottomLimit, rightLimit, leftLimit, distToPlane, nx, and ny based of
+	 * 			the specified vertical field of view and the size of the frame buffer.
+	 *
+	 * @param	verticalFieldOfViewDegrees	(Optional) - vertical field of view in degrees.
+	 */
+	void calculatePerspectiveViewingParameters(const double & verticalFieldOfViewDegrees = 45.0);
+
+
+	/**
+	 * @fn	void RenderView::calculateOrthographicViewingParameters(const double & viewPlaneHeight = 10.0);
+	 *
+	 * @brief	Set topLimit, bottomLimit, rightLimit, leftLimit, distToPlane, nx, and ny based the
+	 * 			height of the projection plane and the size of the frame buffer.
+	 *
+	 * @param	viewPlaneHeight	(Optional) - height of the projection plane.
+	 */
+	void calculateOrthographicViewingParameters(const double & viewPlaneHeight = 10.0);
+
+
+	/**
+	 * @fn	Ray RenderView::getViewRay(const int & x, const int & y) const;
+	 *
+	 * @brief	Gets the perspective or orthographic view ray for a pixel depending on how the
+	 * 			viewing parameters were last calculated.
+	 *
+	 * @param	x	column of a pixel in the frame buffer.
+	 * @param	y	row of a pixel in the frame buffer.
+	 *
+	 * @returns	The view ray.
+	 */
+	Ray getViewRay(const int & x, const int & y) const;
+
+
+	/**
+	 * @fn	Ray RenderView::getOrthoViewRay(const int & x, const int & y) const;
+	 *
+	 * @brief	Gets the orthographic view ray for a pixel.
+	 *
+	 * @param	x	column of a pixel in the frame buffer.
+	 * @param	y	row of a pixel in the frame buffer.
+	 *
+	 * @returns	The ortho view ray.
+	 */
+	Ray getOrthoViewRay(const int & x, const int & y) const;
+
+
+	/**
+	 * @fn	Ray RenderView::getPerspectiveViewRay(const int & x, const int & y) const;
+	 *
+	 * @brief	Gets the perspective view ray for a pixel. The ray is tagged with eyeOriginSlot so
+	 * 			that surfaces can use intersection terms cached for the view point.
+	 *
+	 * @param	x	column of a pixel in the frame buffer.
+	 * @param	y	row of a pixel in the frame buffer.
+	 *
+	 * @returns	The perspective view ray.
+	 */
+	Ray getPerspectiveViewRay(const int & x, const int & y) const;
+
+
+	/**
+	 * @fn	Ray RenderView::getSampleRay(const int & x, const int & y, const dvec2 & offset) const;
+	 *
+	 * @brief	Generates a view ray through any point of a pixel rather than its center. Used to
+	 * 			spread the samples of a pixel over its area.
+	 *
+	 * @param	x	  	column of a pixel in the frame buffer.
+	 * @param	y	  	row of a pixel in the frame buffer.
+	 * @param	offset	Position within the pixel in [0, 1). (0.5, 0.5) is the center.
+	 *
+	 * @returns	The view ray.
+	 */
+	Ray getSampleRay(const int & x, const int & y, const dvec2 & offset) const;
+
+
+	/**
+	 * @fn	dvec2 RenderView::getImagePlaneCoordinates(const int & x, const int & y) const;
+	 *
+	 * @brief	Finds the projection plane coordinates, u and v, for a pixel.
+	 *
+	 * @param	x	column of a pixel in the frame buffer.
+	 * @param	y	row of a pixel in the frame buffer.
+	 *
+	 * @returns	two dimensional vector containing the projection plane coordinates.
+	 */
+	dvec2 getImagePlaneCoordinates(const int & x, const int & y) const;
+
+
+	/**
+	 * @fn	bool RenderView::projectPoint(const dvec3 & point, int & x, int & y) const;
+	 *
+	 * @brief	Finds the pixel through which a point is seen. The inverse of getViewRay. Used to
+	 * 			find where a point was seen in an earlier frame.
+	 *
+	 * @param 		  	point	Position in world coordinates.
+	 * @param [out]	x	 	column of the pixel.
+	 * @param [out]	y	 	row of the pixel.
+	 *
+	 * @returns	True if the point is in front of the view and inside the window.
+	 */
+	bool projectPoint(const dvec3 & point, int & x, int & y) const;
+
+
+	/**
+	 * @fn	bool RenderView::matches(const RenderView & other) const;
+	 *
+	 * @brief	Checks whether another view sees the scene from the same place through the same
+	 * 			window, so that samples of one can be combined with samples of the other.
+	 *
+	 * @param	other	The other view.
+	 *
+	 * @returns	True if the view frames and projections are the same.
+	 */
+	bool matches(const RenderView & other) const;
+
+
+	/**
+	 * @fn	static std::vector<RenderView> RenderView::cubeMapViews(const dvec3 & position, const std::vector<FrameBuffer *> & faces);
+	 *
+	 * @brief	Creates the six 90 degree views of a cube map centered on a position. Faces are in
+	 * 			the order +x, -x, +y, -y, +z, -z.
+	 *
+	 * @param	position	Center of the cube map.
+	 * @param	faces   	Six square frame buffers, one per face.
+	 *
+	 * @returns	The views of the cube map faces.
+	 */
+	static std::vector<RenderView> cubeMapViews(const dvec3 & position, const std::vector<FrameBuffer *> & faces);
+
+
+	/** @brief	Buffer into which the view is rendered */
+	FrameBuffer * frameBuffer;
+
+	/* View frame parameters */
+
+	/** @brief	position of the viewpoint */
+	dvec3 eye;
+
+	/** @brief	"right" direction relative to the viewing direction */
+	dvec3 u = dvec3(1.0, 0.0, 0.0);
+
+	/** @brief	"up" direction relative to the viewing vector */
+	dvec3 v = dvec3(0.0, 1.0, 0.0);
+
+	/** @brief	"back" direction relative to the viewing vector.
+	Camera looks in the negative w direction */
+	dvec3 w = dvec3(0.0, 0.0, 1.0);
+
+	/*  Projection plane parameters */
+
+	/** @brief	 Distance from center of projection plane to the right limit
+	of the projection plane; measured relative to u (right) */
+	double rightLimit = 1.0;
+
+	/** @brief	 Distance from center of projection plane to the left limit
+	of the projection plane; measured relative to u (right) */
+	double leftLimit = -1.0;
+
+	/** @brief	 Distance from center of projection plane to the top limit
+	of the projection plane; measured relative to v (up) */
+	double topLimit = 1.0;
+
+	/** @brief	 Distance from center of projection plane to the bottom limit
+	of the projection plane; measured relative to v (up) */
+	double bottomLimit = -1.0;
+
+	/* Rendering window parameters */
+
+	/** @brief	Floating point width of the window in pixels */
+	double nx = 1.0;
+
+	/** @brief	Floating point height of the window in pixel */
+	double ny = 1.0;
+
+	/** @brief	Distance from the viewpoint to the projection plane */
+	double distToPlane = 1.0;
+
+	/** @brief	True to generate rays for perspective viewing. Fall for orthographic viewing. */
+	bool renderPerspectiveView = true;
+
+	/** @brief	Shared origin index of the view point. Assigned by the ray tracer each frame. */
+	int eyeOriginSlot = NO_SHARED_ORIGIN;
+
+}; // end RenderView struct
@@ -0,0 +1,164 @@
+#include "ReservoirLighting.h"
+
+
+void ReservoirLighting::build(const LightVector& lights, const std::vector<int>& activeLights,
+							  const EmissiveLights& emissiveLights, const bool& includeEmitters)
+{
+	sources.assign(lights.size(), Source());
+
+	std::vector<double> powers(lights.size(), 0.0);
+
+	// Ambient light reaches every point in full and directional lights are only ambient, so
+	// only lights with a position are sampled
+	for (int i : activeLights) {
+
+		if (std::dynamic_pointer_cast<PositionalLight>(lights[i]) != nullptr) {
+			sources[i].light = lights[i];
+			powers[i] = luminance(lights[i]->diffuseLightColor + lights[i]->specularLightColor);
+		}
+	}
+
+	if (includeEmitters) {
+
+		for (int i = 0; i < emissiveLights.size(); i++) {
+
+			Source source;
+			source.emitter = emissiveLights.getEmitter(i);
+
+			sources.push_back(source);
+			powers.push_back(emissiveLights.getPower(i));
+		}
+	}
+
+	distribution.build(powers);
+
+} // end build
+
+
+Reservoir ReservoirLighting::sampleCandidates(const HitRecord& hit, const dvec3& eyeVector, const double& time,
+											  const int& candidates, RandomSequence& random) const
+{
+	Reservoir reservoir;
+
+	if (empty()) {
+		return reservoir;
+	}
+
+	for (int i = 0; i < candidates; i++) {
+
+		reservoir.count += 1.0;
+
+		LightSample sample;
+		double pdf;
+		sample.source = distribution.sample(random.next(), pdf);
+
+		ImplicitSurface* emitter = sources[sample.source].emitter;
+
+		if (emitter != nullptr) {
+
+			// Choose a point on the emitter by the solid angle it covers
+			dvec3 direction;
+			double distance, directionPdf;
+
+			if (!emitter->sampleDirection(hit.interceptPoint, random.next2(), time, direction, distance, directionPdf)) {
+				continue;
+			}
+
+			Ray toEmitter(hit.interceptPoint, direction, SHADOW_RAY);
+			toEmitter.time = time;
+
+			HitRecord onEmitter = emitter->findIntersect(toEmitter);
+			if (onEmitter.t == INFINITY) {
+				continue;
+			}
+
+			sample.position = onEmitter.interceptPoint;
+			sample.normal = onEmitter.surfaceNormal;
+
+			double emitterCosine = -glm::dot(direction, sample.normal);
+			if (emitterCosine <= 0.0) {
+				continue;
+			}
+
+			// Density with respect to area on the emitter
+			pdf *= directionPdf * emitterCosine / (onEmitter.t * onEmitter.t);
+		}
+
+		double target = luminance(evaluate(sample, hit, eyeVector));
+
+		if (target > 0.0) {
+			reservoir.add(sample, target / pdf, target, random.next());
+		}
+	}
+
+	reservoir.finalize();
+
+	return reservoir;
+
+} // end sampleCandidates
+
+
+void ReservoirLighting::combine(Reservoir& reservoir, const Reservoir& other, const HitRecord& hit, const dvec3& eyeVector,
+								RandomSequence& random, const double& maxCount) const
+{
+	double count = glm::min(other.count, maxCount);
+
+	if (other.weight > 0.0) {
+
+		// The weight the other sample would have had if it had been drawn here
+		double target = luminance(evaluate(other.sample, hit, eyeVector));
+		reservoir.add(other.sample, target * other.weight * count, target, random.next());
+	}
+
+	reservoir.count += count;
+	reservoir.finalize();
+
+} // end combine
+
+
+color ReservoirLighting::evaluate(const LightSample& sample, const HitRecord& hit, const dvec3& eyeVector) const
+{
+	color black(0.0, 0.0, 0.0, 0.0);
+
+	if (sample.source < 0 || sample.source >= size()) {
+		return black;
+	}
+
+	const Source& source = sources[sample.source];
+	const Material& material = hit.material;
+
+	if (source.light != nullptr) {
+
+		// Ambient light does not depend on the sample and is added separately
+		color ambient = source.light->ambientLightColor * material.getAmbient(hit.uv);
+		color local = source.light->getLocalIllumination(eyeVector, hit.interceptPoint, hit.surfaceNormal, material, hit.uv);
+
+		return glm::max(local - ambient, black);
+	}
+
+	if (source.emitter != nullptr) {
+
+		dvec3 toSample = sample.position - hit.interceptPoint;
+		double distanceSquared = glm::dot(toSample, toSample);
+		dvec3 direction = toSample / sqrt(distanceSquared);
+
+		double cosine = glm::dot(direction, hit.surfaceNormal);
+		double emitterCosine = -glm::dot(direction, sample.normal);
+
+		// Neither surface can face away from the other
+		if (cosine <= 0.0 || emitterCosine <= 0.0) {
+			return black;
+		}
+
+		dvec3 reflectVec = glm::reflect(-direction, hit.surfaceNormal);
+
+		color reflectance = cosine * material.getDiffuse(hit.uv) +
+			glm::pow(glm::max(glm::dot(reflectVec, eyeVector), 0.0), material.shininess) * material.getSpecular(hit.uv);
+
+		// Same normalization as EmissiveLights, changed from solid angle to area
+		return source.emitter->material.getEmisive() * reflectance * emitterCosine / (PI * distanceSquared);
+	}
+
+	return black;
+
+} // end evaluate
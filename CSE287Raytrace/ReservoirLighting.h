@@ -0,0 +1,236 @@
+#pragma once
+
+#include "EmissiveLights.h"
+#include "LightSource.h"
+#include "RenderView.h"
+
+/**
+ * @struct	LightSample
+ *
+ * @brief	Place from which light may reach a point being shaded: one of the lights of the scene
+ * 			or a point on an emissive surface.
+ */
+struct LightSample
+{
+	/** @brief	Index of the source in ReservoirLighting. -1 if there is no sample. */
+	int source = -1;
+
+	/** @brief	Point on the emitter. Lights are evaluated at their current position instead. */
+	dvec3 position;
+
+	/** @brief	Unit normal of the emitter at the position. */
+	dvec3 normal;
+
+}; // end LightSample struct
+
+
+/**
+ * @struct	Reservoir
+ *
+ * @brief	Weighted reservoir that keeps one light sample out of a stream of candidates. Each
+ * 			candidate replaces the kept sample with probability equal to its share of the weights
+ * 			seen so far, so the kept sample is distributed roughly in proportion to the target
+ * 			function (the unshadowed light it delivers) without storing the stream.
+ */
+struct Reservoir
+{
+	/** @brief	The kept sample */
+	LightSample sample;
+
+	/** @brief	Sum of the resampling weights of every candidate */
+	double weightSum = 0.0;
+
+	/** @brief	Number of candidates the reservoir stands for */
+	double count = 0.0;
+
+	/** @brief	Target function of the kept sample at the point the reservoir belongs to */
+	double target = 0.0;
+
+	/** @brief	Weight that turns the light delivered by the kept sample into an estimate of the
+	light from every source. Set by finalize. */
+	double weight = 0.0;
+
+	/**
+	 * @fn	bool Reservoir::add(const LightSample & candidate, const double & resampleWeight, const double & candidateTarget, const double & u)
+	 *
+	 * @brief	Streams a candidate through the reservoir. Does not change the count.
+	 *
+	 * @param	candidate	   	The candidate.
+	 * @param	resampleWeight 	Resampling weight of the candidate.
+	 * @param	candidateTarget	Target function of the candidate.
+	 * @param	u			   	Uniform random number in [0, 1).
+	 *
+	 * @returns	True if the candidate was kept.
+	 */
+	bool add(const LightSample & candidate, const double & resampleWeight, const double & candidateTarget, const double & u)
+	{
+		weightSum += resampleWeight;
+
+		if (resampleWeight > 0.0 && u * weightSum < resampleWeight) {
+			sample = candidate;
+			target = candidateTarget;
+			return true;
+		}
+
+		return false;
+	}
+
+	/** @brief	Sets the weight of the kept sample from the candidates seen so far. */
+	void finalize()
+	{
+		weight = target > 0.0 && count > 0.0 ? weightSum / (count * target) : 0.0;
+	}
+
+}; // end Reservoir struct
+
+
+/**
+ * @struct	ReservoirFrame
+ *
+ * @brief	Reservoirs of every pixel of a view kept for reuse by the next frame, along with the
+ * 			surface each pixel saw and the camera that saw it.
+ */
+struct ReservoirFrame
+{
+	/** @brief	Camera of the frame */
+	RenderView camera;
+
+	/** @brief	Width of the frame in pixels. Zero if there is no frame. */
+	int width = 0;
+
+	/** @brief	Height of the frame in pixels */
+	int height = 0;
+
+	/** @brief	Number of light sources when the frame was rendered */
+	int sourceCount = 0;
+
+	/** @brief	Reservoir of each pixel */
+	std::vector<Reservoir> reservoirs;
+
+	/** @brief	Point of intersection of each pixel */
+	std::vector<dvec3> points;
+
+	/** @brief	Surface normal of each pixel */
+	std::vector<dvec3> normals;
+
+}; // end ReservoirFrame struct
+
+
+/**
+ * @class	ReservoirLighting
+ *
+ * @brief	Direct lighting by reservoir resampling (ReSTIR). Many cheap candidate samples of the
+ * 			lights and emissive surfaces are drawn at each point without shadow feelers and
+ * 			resampled down to one in proportion to the unshadowed light they deliver. Reservoirs
+ * 			of neighboring pixels and of the same surface in the previous frame are then merged in,
+ * 			so each pixel effectively chooses from thousands of candidates. Only the final sample
+ * 			is tested for visibility.
+ *
+ * 			The merge uses the simple (biased) combination: neighbors whose surfaces differ are
+ * 			rejected by normal and plane distance tests, and reused history is capped.
+ */
+class ReservoirLighting
+{
+public:
+
+	/**
+	 * @fn	void ReservoirLighting::build(const LightVector & lights, const std::vector<int> & activeLights, const EmissiveLights & emissiveLights, const bool & includeEmitters);
+	 *
+	 * @brief	Collects the sources for the current frame. Lights keep their index in the lights
+	 * 			vector and emitters follow, so samples kept from the previous frame still refer to
+	 * 			the same source. Must be called again whenever lights or surfaces change.
+	 *
+	 * @param	lights		   	Lights of the scene.
+	 * @param	activeLights   	Indices of the enabled lights.
+	 * @param	emissiveLights 	Emissive surfaces of the scene.
+	 * @param	includeEmitters	False to keep emissive surfaces from lighting other surfaces.
+	 */
+	void build(const LightVector & lights, const std::vector<int> & activeLights,
+			   const EmissiveLights & emissiveLights, const bool & includeEmitters);
+
+
+	/**
+	 * @fn	Reservoir ReservoirLighting::sampleCandidates(const HitRecord & hit, const dvec3 & eyeVector, const double & time, const int & candidates, RandomSequence & random) const;
+	 *
+	 * @brief	Draws candidates from the sources in proportion to their power and streams them
+	 * 			through a new reservoir.
+	 *
+	 * @param 		  	hit		  	Point of intersection being shaded.
+	 * @param 		  	eyeVector 	Unit vector from the point toward the viewer.
+	 * @param 		  	time	  	Time within the shutter interval.
+	 * @param 		  	candidates	Number of candidates.
+	 * @param [in,out]	random	  	Source of random numbers.
+	 *
+	 * @returns	The finalized reservoir.
+	 */
+	Reservoir sampleCandidates(const HitRecord & hit, const dvec3 & eyeVector, const double & time,
+							   const int & candidates, RandomSequence & random) const;
+
+
+	/**
+	 * @fn	void ReservoirLighting::combine(Reservoir & reservoir, const Reservoir & other, const HitRecord & hit, const dvec3 & eyeVector, RandomSequence & random, const double & maxCount = INFINITY) const;
+	 *
+	 * @brief	Merges the reservoir of another pixel or frame into the reservoir of a point. The
+	 * 			sample of the other reservoir is weighed by its target function at the point.
+	 *
+	 * @param [in,out]	reservoir	Reservoir of the point. Finalized again.
+	 * @param 		  	other	 	Reservoir being merged.
+	 * @param 		  	hit		 	Point of intersection being shaded.
+	 * @param 		  	eyeVector	Unit vector from the point toward the viewer.
+	 * @param [in,out]	random	 	Source of random numbers.
+	 * @param 		  	maxCount 	(Optional) Most candidates the other reservoir may stand for.
+	 */
+	void combine(Reservoir & reservoir, const Reservoir & other, const HitRecord & hit, const dvec3 & eyeVector,
+				 RandomSequence & random, const double & maxCount = INFINITY) const;
+
+
+	/**
+	 * @fn	color ReservoirLighting::evaluate(const LightSample & sample, const HitRecord & hit, const dvec3 & eyeVector) const;
+	 *
+	 * @brief	Light reflected toward the viewer from a sample, ignoring shadows. The ambient
+	 * 			part of lights is left out. For emitters this is per unit area of the emitter.
+	 *
+	 * @param	sample   	The sample.
+	 * @param	hit		 	Point of intersection being shaded.
+	 * @param	eyeVector	Unit vector from the point toward the viewer.
+	 *
+	 * @returns	The reflected light. Black if the sample is no longer a source.
+	 */
+	color evaluate(const LightSample & sample, const HitRecord & hit, const dvec3 & eyeVector) const;
+
+
+	/** @returns	Index in the lights vector of the light of a sample. -1 for emitters. */
+	int getLightIndex(const LightSample & sample) const
+	{
+		return sample.source >= 0 && sample.source < size() && sources[sample.source].light != nullptr ? sample.source : -1;
+	}
+
+	/** @returns	Number of sources, including lights that cannot be chosen. */
+	int size() const { return (int)sources.size(); }
+
+	/** @returns	True if no source can be chosen. */
+	bool empty() const { return distribution.empty(); }
+
+protected:
+
+	/**
+	 * @struct	Source
+	 *
+	 * @brief	A light or an emitter. Exactly one is set for sources that can be chosen.
+	 */
+	struct Source
+	{
+		/** @brief	Light with a position */
+		shared_ptr<LightSource> light;
+
+		/** @brief	Emissive surface. Owned by the surfaces of the scene. */
+		ImplicitSurface * emitter = nullptr;
+	};
+
+	/** @brief	Lights followed by emitters */
+	std::vector<Source> sources;
+
+	/** @brief	Chooses candidate sources in proportion to their power */
+	AliasTable distribution;
+
+}; // end ReservoirLighting class
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstring>
+
+#include "Defines.h"
+
+/**
+ * @struct	RandomSequence
+ *
+ * @brief	Small, fast pseudo random number generator (PCG32) for Monte Carlo sampling. Each
+ * 			shading point seeds its own sequence from its position so images are repeatable no
+ * 			matter which thread renders which tile.
+ */
+struct RandomSequence
+{
+	/** @brief	Internal state of the generator */
+	unsigned long long state;
+
+	/**
+	 * @fn	RandomSequence(const unsigned int & seed)
+	 *
+	 * @brief	Constructor
+	 *
+	 * @param	seed	Start of the sequence. Different seeds give unrelated sequences.
+	 */
+	RandomSequence(const unsigned int & seed)
+		: state(seed * 0x9E3779B97F4A7C15ull + 0x853C49E6748FEA9Bull)
+	{
+		nextInt();
+	}
+
+	/** @returns	The next 32 bit value of the sequence. */
+	unsigned int nextInt()
+	{
+		unsigned long long old = state;
+		state = old * 6364136223846793005ull + 1442695040888963407ull;
+
+		unsigned int shifted = (unsigned int)(((old >> 18u) ^ old) >> 27u);
+		unsigned int rotation = (unsigned int)(old >> 59u);
+
+		return (shifted >> rotation) | (shifted << ((32u - rotation) & 31u));
+	}
+
+	/** @returns	The next value of the sequence in [0, 1). */
+	double next() { return nextInt() * (1.0 / 4294967296.0); }
+
+	/** @returns	The next two values of the sequence in [0, 1). */
+	dvec2 next2() { double x = next(); return dvec2(x, next()); }
+
+}; // end RandomSequence struct
+
+
+/**
+ * @enum	SAMPLE_STREAM
+ *
+ * @brief	Kinds of random decisions made at a point. Each uses its own sequence so that
+ * 			decisions made at the same point are not correlated.
+ */
+enum SAMPLE_STREAM { EMISSIVE_STREAM = 1, DIELECTRIC_STREAM = 2, GLOSSY_STREAM = 3, RESERVOIR_STREAM = 4, SPATIAL_REUSE_STREAM = 5,
+					 BIDIRECTIONAL_STREAM = 6, PROBE_STREAM = 7, DISTANCE_FIELD_STREAM = 8, TUNING_STREAM = 9 };
+
+
+/**
+ * @fn	inline unsigned int hashPoint(const dvec3 & point, const SAMPLE_STREAM & stream, const unsigned int & index = 0)
+ *
+ * @brief	Hashes a position to a seed for a RandomSequence.
+ *
+ * @param	point 	Position being hashed.
+ * @param	stream	Kind of decision the sequence is used for.
+ * @param	index 	(Optional) Distinguishes several sequences of the same kind at the same
+ * 					position, such as different recursion levels.
+ *
+ * @returns	The hash.
+ */
+inline unsigned int hashPoint(const dvec3 & point, const SAMPLE_STREAM & stream, const unsigned int & index = 0)
+{
+	unsigned long long h = 0xCBF29CE484222325ull ^ ((unsigned long long)stream << 32) ^ index;
+
+	for (int i = 0; i < 3; i++) {
+
+		double value = point[i];
+		unsigned long long bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		h = (h ^ bits) * 0x100000001B3ull;
+		h ^= h >> 29;
+	}
+
+	return (unsigned int)(h ^ (h >> 32));
+}
+
+
+/**
+ * @fn	inline double radicalInverse(unsigned int bits)
+ *
+ * @brief	Van der Corput radical inverse in base 2. Mirrors the binary digits of an integer
+ * 			about the binary point.
+ *
+ * @param	bits	The integer.
+ *
+ * @returns	The radical inverse in [0, 1).
+ */
+inline double radicalInverse(unsigned int bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+
+	return bits * (1.0 / 4294967296.0);
+}
+
+
+/**
+ * @fn	inline dvec2 hammersley(const int & i, const int & count, const dvec2 & rotation)
+ *
+ * @brief	Point of a two dimensional Hammersley set. The points of a set cover the unit square
+ * 			more evenly than random points, so estimates converge faster. The set is shifted by
+ * 			a rotation (wrapping around the square) so that neighboring shading points do not use
+ * 			the same points.
+ *
+ * @param	i	   	Index of the point.
+ * @param	count  	Number of points in the set.
+ * @param	rotation	Shift applied to every point of the set.
+ *
+ * @returns	The point in [0, 1) x [0, 1).
+ */
+inline dvec2 hammersley(const int & i, const int & count, const dvec2 & rotation)
+{
+	return glm::fract(dvec2((i + 0.5) / count, radicalInverse((unsigned int)i)) + rotation);
+}
+
+
+/**
+ * @fn	inline dmat3 orthonormalBasis(const dvec3 & w)
+ *
+ * @brief	Builds a right handed orthonormal basis whose third axis is a given unit vector. Used
+ * 			to turn directions sampled around the z axis into world directions.
+ *
+ * @param	w	Unit vector that becomes the third axis.
+ *
+ * @returns	Matrix whose columns are the axes of the basis.
+ */
+inline dmat3 orthonormalBasis(const dvec3 & w)
+{
+	dvec3 helper = glm::abs(w.x) > 0.9 ? dvec3(0.0, 1.0, 0.0) : dvec3(1.0, 0.0, 0.0);
+	dvec3 u = glm::normalize(glm::cross(helper, w));
+	dvec3 v = glm::cross(w, u);
+
+	return dmat3(u, v, w);
+}
+
+
+/** @returns	Luminance of a color. Used to weigh colors by their brightness. */
+inline double luminance(const color & c)
+{
+	return 0.2126 * c.r + 0.7152 * c.g + 0.0722 * c.b;
+}
@@ -0,0 +1,177 @@
+#include "SceneVersions.h"
+
+#include <thread>
+
+
+SceneVersions::Pin::Pin(SceneVersions& versions)
+	: versions(versions), slot(versions.claimSlot())
+{
+	// The epoch is published before the version is read, so an edit that replaces the version
+	// after this point sees the slot and keeps the version
+	snapshot = versions.current.load();
+
+} // end Pin
+
+
+SceneVersions::Pin::~Pin()
+{
+	versions.releaseSlot(slot);
+
+} // end ~Pin
+
+
+SceneVersions::SceneVersions(const SurfaceVector& surfaces, const LightVector& lights)
+{
+	SceneSnapshot* first = new SceneSnapshot();
+	first->surfaces = surfaces;
+	first->lights = lights;
+
+	current.store(first);
+
+} // end SceneVersions
+
+
+SceneVersions::~SceneVersions()
+{
+	for (RetiredVersion& version : retired) {
+		delete version.snapshot;
+	}
+
+	delete current.load();
+
+} // end ~SceneVersions
+
+
+unsigned long long SceneVersions::edit(const std::function<void(Edit&)>& change)
+{
+	std::lock_guard<std::mutex> lock(editMutex);
+
+	SceneSnapshot* previous = current.load();
+
+	// Only the lists are copied. Surfaces and lights are copied when the change asks to modify them.
+	Edit edit;
+	edit.surfaces = previous->surfaces;
+	edit.lights = previous->lights;
+
+	change(edit);
+
+	SceneSnapshot* next = new SceneSnapshot();
+	next->surfaces = std::move(edit.surfaces);
+	next->lights = std::move(edit.lights);
+	next->version = previous->version + 1;
+
+	current.store(next);
+
+	// Readers pinned in this epoch or an earlier one may have read the previous version
+	retired.push_back({ previous, globalEpoch.fetch_add(1) });
+
+	reclaim();
+
+	return next->version;
+
+} // end edit
+
+
+int SceneVersions::getRetiredCount()
+{
+	std::lock_guard<std::mutex> lock(editMutex);
+
+	reclaim();
+
+	return (int)retired.size();
+
+} // end getRetiredCount
+
+
+std::atomic<unsigned long long>& SceneVersions::claimSlot()
+{
+	// Threads start looking at different slots so they rarely compete for one
+	int start = (int)(std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_READERS);
+
+	std::atomic<unsigned long long>* slot = findFreeSlot(start);
+
+	if (slot == nullptr) {
+
+		// Every slot is taken. Sleep until a pin is released rather than spinning. The count
+		// of waiters is raised before looking again, so a release that found no waiters freed
+		// its slot before this look.
+		waitingReaders++;
+
+		std::unique_lock<std::mutex> lock(slotMutex);
+
+		while ((slot = findFreeSlot(start)) == nullptr) {
+			slotFreed.wait(lock);
+		}
+
+		waitingReaders--;
+	}
+
+	return *slot;
+
+} // end claimSlot
+
+
+std::atomic<unsigned long long>* SceneVersions::findFreeSlot(const int & start)
+{
+	unsigned long long epoch = globalEpoch.load();
+
+	for (int k = 0; k < MAX_READERS; k++) {
+
+		std::atomic<unsigned long long>& slot = readers[(start + k) % MAX_READERS].epoch;
+
+		unsigned long long expected = 0;
+		if (slot.compare_exchange_strong(expected, epoch)) {
+			return &slot;
+		}
+	}
+
+	return nullptr;
+
+} // end findFreeSlot
+
+
+void SceneVersions::releaseSlot(std::atomic<unsigned long long>& slot)
+{
+	slot.store(0);
+
+	if (waitingReaders.load() > 0) {
+		std::lock_guard<std::mutex> lock(slotMutex);
+		slotFreed.notify_all();
+	}
+
+} // end releaseSlot
+
+
+void SceneVersions::reclaim()
+{
+	if (retired.empty()) {
+		return;
+	}
+
+	// Oldest epoch any reader is pinned in
+	unsigned long long oldestPinned = ~0ULL;
+
+	for (ReaderSlot& reader : readers) {
+
+		unsigned long long epoch = reader.epoch.load();
+
+		if (epoch != 0 && epoch < oldestPinned) {
+			oldestPinned = epoch;
+		}
+	}
+
+	size_t kept = 0;
+
+	for (RetiredVersion& version : retired) {
+
+		if (version.epoch < oldestPinned) {
+			delete version.snapshot;
+		}
+		else {
+			retired[kept++] = version;
+		}
+	}
+
+	retired.resize(kept);
+
+} // end reclaim
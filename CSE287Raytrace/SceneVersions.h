@@ -0,0 +1,297 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "ImplicitSurface.h"
+#include "LightSource.h"
+
+/**
+ * @struct	SceneSnapshot
+ *
+ * @brief	One published version of a scene. Neither the lists nor the surfaces and lights in
+ * 			them are changed once the version is published. Versions share every surface and
+ * 			light that an edit left alone.
+ */
+struct SceneSnapshot
+{
+	SurfaceVector surfaces;
+
+	LightVector lights;
+
+	/** @brief	Counts up by one with every edit */
+	unsigned long long version = 0;
+
+}; // end SceneSnapshot struct
+
+
+/**
+ * @class	SceneVersions
+ *
+ * @brief	Versioned scene that can be edited while it is being rendered. A render pins the
+ * 			current version and reads it without locks. An edit copies the lists of the current
+ * 			version, copies only the surfaces and lights it changes, and publishes the result
+ * 			as the next version, so renders already under way keep seeing the version they
+ * 			pinned. Edits wait for each other but never for renders.
+ *
+ * 			Versions that have been replaced are freed by epoch based reclamation: each one is
+ * 			retired with the epoch it was replaced in, and freed once no reader is pinned at
+ * 			that epoch or an earlier one. Surfaces and lights are shared between versions
+ * 			through their reference counts, so they are freed along with the last version
+ * 			that holds them.
+ */
+class SceneVersions
+{
+public:
+
+	/** @brief	Most readers that may have a version pinned at the same time. Further pins wait for one to be released. */
+	static const int MAX_READERS = 64;
+
+
+	/**
+	 * @class	Edit
+	 *
+	 * @brief	Changes made to a scene by one call to SceneVersions::edit. Surfaces and lights may
+	 * 			be added to and removed from the lists freely. Ones that are already in the scene
+	 * 			must be changed through modifySurface and modifyLight, which copy them first.
+	 */
+	class Edit
+	{
+	public:
+
+		/**
+		 * @fn	template <class T> std::shared_ptr<T> SceneVersions::Edit::modifySurface(const int & index)
+		 *
+		 * @brief	Gets a surface that may be changed. The first call for a surface replaces it with a
+		 * 			copy that only this edit refers to.
+		 *
+		 * @param	index	Index of the surface in surfaces.
+		 *
+		 * @returns	The copy, or null if the surface is not a T.
+		 */
+		template <class T>
+		std::shared_ptr<T> modifySurface(const int & index)
+		{
+			if (copies.count(surfaces[index].get()) == 0) {
+				surfaces[index] = surfaces[index]->clone();
+				copies.insert(surfaces[index].get());
+			}
+
+			return std::dynamic_pointer_cast<T>(surfaces[index]);
+		}
+
+
+		/**
+		 * @fn	template <class T> std::shared_ptr<T> SceneVersions::Edit::modifyLight(const int & index)
+		 *
+		 * @brief	Gets a light that may be changed. The first call for a light replaces it with a
+		 * 			copy that only this edit refers to.
+		 *
+		 * @param	index	Index of the light in lights.
+		 *
+		 * @returns	The copy, or null if the light is not a T.
+		 */
+		template <class T>
+		std::shared_ptr<T> modifyLight(const int & index)
+		{
+			if (copies.count(lights[index].get()) == 0) {
+				lights[index] = lights[index]->clone();
+				copies.insert(lights[index].get());
+			}
+
+			return std::dynamic_pointer_cast<T>(lights[index]);
+		}
+
+		/** @brief	Surfaces of the new version */
+		SurfaceVector surfaces;
+
+		/** @brief	Lights of the new version */
+		LightVector lights;
+
+	protected:
+
+		/** @brief	Copies made by this edit, which later calls may change in place */
+		std::unordered_set<const void *> copies;
+
+	}; // end Edit class
+
+
+	/**
+	 * @class	Pin
+	 *
+	 * @brief	Keeps the version that was current when it was created from being freed until it
+	 * 			is destroyed. Pinning and unpinning take no locks unless MAX_READERS pins are
+	 * 			already held, in which case pinning sleeps until one is released. A thread must
+	 * 			therefore not hold MAX_READERS pins itself while it takes another.
+	 */
+	class Pin
+	{
+	public:
+
+		/**
+		 * @fn	SceneVersions::Pin::Pin(SceneVersions & versions);
+		 *
+		 * @brief	Pins the current version.
+		 *
+		 * @param [in,out]	versions	The versioned scene.
+		 */
+		Pin(SceneVersions & versions);
+
+		/** @brief	Unpins the version. */
+		~Pin();
+
+		Pin(const Pin &) = delete;
+		Pin & operator=(const Pin &) = delete;
+
+		const SceneSnapshot & operator*() const { return *snapshot; }
+
+		const SceneSnapshot * operator->() const { return snapshot; }
+
+	protected:
+
+		/** @brief	The versioned scene the pin was taken from */
+		SceneVersions & versions;
+
+		/** @brief	Reader slot holding the epoch this pin was taken in */
+		std::atomic<unsigned long long> & slot;
+
+		/** @brief	The pinned version */
+		const SceneSnapshot * snapshot;
+
+	}; // end Pin class
+
+
+	/**
+	 * @fn	SceneVersions::SceneVersions(const SurfaceVector & surfaces = SurfaceVector(), const LightVector & lights = LightVector());
+	 *
+	 * @brief	Constructor. Publishes the first version.
+	 *
+	 * @param	surfaces	(Optional) Surfaces of the first version.
+	 * @param	lights  	(Optional) Lights of the first version.
+	 */
+	SceneVersions(const SurfaceVector & surfaces = SurfaceVector(), const LightVector & lights = LightVector());
+
+
+	/** @brief	Frees every version. Nothing may have a version pinned. */
+	~SceneVersions();
+
+	SceneVersions(const SceneVersions &) = delete;
+	SceneVersions & operator=(const SceneVersions &) = delete;
+
+
+	/**
+	 * @fn	unsigned long long SceneVersions::edit(const std::function<void(Edit &)> & change);
+	 *
+	 * @brief	Publishes a new version made by applying a change to the current one, then frees
+	 * 			the replaced versions that nothing has pinned anymore.
+	 *
+	 * @param	change	Function that makes the change. Receives the lists of the current version.
+	 *
+	 * @returns	The number of the new version.
+	 */
+	unsigned long long edit(const std::function<void(Edit &)> & change);
+
+
+	/** @returns	The number of the current version. */
+	unsigned long long getVersion() const { return current.load()->version; }
+
+
+	/** @returns	Number of replaced versions that are still pinned by some reader. */
+	int getRetiredCount();
+
+protected:
+
+	/**
+	 * @struct	ReaderSlot
+	 *
+	 * @brief	Epoch a reader pinned a version in, or zero if the slot is free. Each slot is on a
+	 * 			cache line of its own so that readers do not slow each other down.
+	 */
+	struct alignas(64) ReaderSlot
+	{
+		std::atomic<unsigned long long> epoch{ 0 };
+	};
+
+	/**
+	 * @struct	RetiredVersion
+	 *
+	 * @brief	Version that has been replaced and the epoch it was replaced in.
+	 */
+	struct RetiredVersion
+	{
+		SceneSnapshot * snapshot;
+		unsigned long long epoch;
+	};
+
+
+	/**
+	 * @fn	std::atomic<unsigned long long> & SceneVersions::claimSlot();
+	 *
+	 * @brief	Takes a free reader slot and records the current epoch in it. Sleeps until a
+	 * 			slot is released if every slot is taken.
+	 *
+	 * @returns	The slot.
+	 */
+	std::atomic<unsigned long long> & claimSlot();
+
+
+	/**
+	 * @fn	std::atomic<unsigned long long> * SceneVersions::findFreeSlot(const int & start);
+	 *
+	 * @brief	Looks at every reader slot once and takes the first free one, recording the
+	 * 			current epoch in it.
+	 *
+	 * @param	start	Index of the slot to look at first.
+	 *
+	 * @returns	The slot, or null if every slot is taken.
+	 */
+	std::atomic<unsigned long long> * findFreeSlot(const int & start);
+
+
+	/**
+	 * @fn	void SceneVersions::releaseSlot(std::atomic<unsigned long long> & slot);
+	 *
+	 * @brief	Frees a reader slot and wakes the readers waiting for one, if there are any.
+	 *
+	 * @param [in,out]	slot	The slot.
+	 */
+	void releaseSlot(std::atomic<unsigned long long> & slot);
+
+
+	/**
+	 * @fn	void SceneVersions::reclaim();
+	 *
+	 * @brief	Frees the retired versions that no reader can still be reading. Called with
+	 * 			editMutex held.
+	 */
+	void reclaim();
+
+	/** @brief	Version new renders pin */
+	std::atomic<SceneSnapshot *> current;
+
+	/** @brief	Advanced every time a version is replaced. Starts at one because zero marks a free slot. */
+	std::atomic<unsigned long long> globalEpoch{ 1 };
+
+	/** @brief	Epochs of the readers with a version pinned */
+	ReaderSlot readers[MAX_READERS];
+
+	/** @brief	Number of readers waiting for a slot to be released */
+	std::atomic<int> waitingReaders{ 0 };
+
+	/** @brief	Held by readers waiting for a slot and by releases that wake them */
+	std::mutex slotMutex;
+
+	/** @brief	Signalled when a slot is released while readers are waiting */
+	std::condition_variable slotFreed;
+
+	/** @brief	Lets one edit run at a time. Guards retired. */
+	std::mutex editMutex;
+
+	/** @brief	Replaced versions that may still be pinned */
+	std::vector<RetiredVersion> retired;
+
+}; // end SceneVersions class
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "BoundingBox.h"
+
+/**
+ * @struct	ShadowFrustum
+ *
+ * @brief	Cone that contains a group of shadow feelers leaving the same light. Used to cull the
+ * 			bounding volume hierarchy once for the whole group before the feelers are tested
+ * 			individually.
+ */
+struct ShadowFrustum
+{
+	/** @brief	Apex of the cone. The position of the light. */
+	dvec3 apex;
+
+	/** @brief	Unit axis of the cone */
+	dvec3 axis = dvec3(0.0, 0.0, -1.0);
+
+	/** @brief	Cosine of the angle between the axis and the side of the cone */
+	double cosHalfAngle = -1.0;
+
+	/** @brief	Sine of the angle between the axis and the side of the cone */
+	double sinHalfAngle = 0.0;
+
+	/** @brief	Distance from the apex to the farthest point any feeler reaches */
+	double maxDistance = 0.0;
+
+	/**
+	 * @fn	bool ShadowFrustum::overlaps(const BoundingBox & box) const
+	 *
+	 * @brief	Conservative test of a box against the cone. The box is replaced by its bounding
+	 * 			sphere, which is inside the cone if the angle to its center is less than the half
+	 * 			angle of the cone plus the angle the sphere subtends.
+	 *
+	 * @param	box	Box being tested.
+	 *
+	 * @returns	False only if no part of the box is inside the cone.
+	 */
+	bool overlaps(const BoundingBox & box) const
+	{
+		dvec3 toCenter = box.centroid() - apex;
+		double radius = 0.5 * glm::length(box.maxCorner - box.minCorner);
+		double distance = glm::length(toCenter);
+
+		if (distance <= radius) {
+			return true;
+		}
+
+		if (distance - radius > maxDistance) {
+			return false;
+		}
+
+		// Widen the cone by the angle subtended by the sphere
+		double sinSphere = radius / distance;
+		double cosSphere = sqrt(1.0 - sinSphere * sinSphere);
+
+		// The widened cone covers every direction
+		if (cosHalfAngle * sinSphere + sinHalfAngle * cosSphere < 0.0) {
+			return true;
+		}
+
+		double cosWidened = cosHalfAngle * cosSphere - sinHalfAngle * sinSphere;
+
+		return glm::dot(toCenter, axis) >= cosWidened * distance;
+	}
+
+}; // end ShadowFrustum struct
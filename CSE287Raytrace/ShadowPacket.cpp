@@ -0,0 +1,69 @@
+#include "ShadowPacket.h"
+
+
+ShadowPacket::ShadowPacket(const dvec3& lightPosition, const int& sharedOrigin)
+	: lightPosition(lightPosition), sharedOrigin(sharedOrigin)
+{
+}
+
+
+void ShadowPacket::clear()
+{
+	directions.clear();
+	distances.clear();
+	occluded.clear();
+
+} // end clear
+
+
+void ShadowPacket::addPoint(const dvec3& point)
+{
+	dvec3 toPoint = point - lightPosition;
+	double distance = glm::length(toPoint);
+
+	directions.push_back(toPoint / distance);
+	distances.push_back(distance - EPSILON);
+
+} // end addPoint
+
+
+void ShadowPacket::trace(const BoundingVolumeHierarchy& accelerator)
+{
+	int count = size();
+
+	occluded.assign(count, 0);
+
+	if (count == 0) {
+		return;
+	}
+
+	// Bound the feelers with a cone anchored at the light
+	ShadowFrustum frustum;
+	frustum.apex = lightPosition;
+
+	dvec3 axisSum(0.0, 0.0, 0.0);
+	for (int i = 0; i < count; i++) {
+		axisSum += directions[i];
+		frustum.maxDistance = glm::max(frustum.maxDistance, distances[i]);
+	}
+
+	// Feelers pointing in opposite directions leave only the distance test
+	if (glm::length(axisSum) > 0.0) {
+
+		frustum.axis = glm::normalize(axisSum);
+
+		double minCosine = 1.0;
+		for (int i = 0; i < count; i++) {
+			minCosine = glm::min(minCosine, glm::dot(directions[i], frustum.axis));
+		}
+
+		frustum.cosHalfAngle = glm::clamp(minCosine, -1.0, 1.0);
+		frustum.sinHalfAngle = sqrt(1.0 - frustum.cosHalfAngle * frustum.cosHalfAngle);
+	}
+
+	Ray feeler(lightPosition, frustum.axis, SHADOW_RAY);
+	feeler.sharedOrigin = sharedOrigin;
+
+	accelerator.findOccluded(frustum, feeler, directions, distances, occluded);
+
+} // end trace
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "BoundingVolumeHierarchy.h"
+
+/**
+ * @class	ShadowPacket
+ *
+ * @brief	Batch of shadow feelers cast from one light toward a group of points, usually the
+ * 			points of intersection of the view rays of a tile. All feelers start at the light, so
+ * 			they fit in a narrow cone. Nodes of the hierarchy outside the cone are rejected for
+ * 			the whole packet with a single test.
+ */
+class ShadowPacket
+{
+public:
+
+	/**
+	 * @fn	ShadowPacket::ShadowPacket(const dvec3 & lightPosition, const int & sharedOrigin);
+	 *
+	 * @brief	Constructor.
+	 *
+	 * @param	lightPosition	Position of the light. Origin of every feeler.
+	 * @param	sharedOrigin 	Shared origin index of the light position.
+	 */
+	ShadowPacket(const dvec3 & lightPosition, const int & sharedOrigin);
+
+
+	/**
+	 * @fn	void ShadowPacket::clear()
+	 *
+	 * @brief	Removes all feelers so the packet can be refilled.
+	 */
+	void clear();
+
+
+	/**
+	 * @fn	void ShadowPacket::addPoint(const dvec3 & point);
+	 *
+	 * @brief	Adds a feeler from the light toward a point being shaded.
+	 *
+	 * @param	point	The point being shaded.
+	 */
+	void addPoint(const dvec3 & point);
+
+
+	/**
+	 * @fn	void ShadowPacket::trace(const BoundingVolumeHierarchy & accelerator);
+	 *
+	 * @brief	Determines which of the points are hidden from the light.
+	 *
+	 * @param	accelerator	Hierarchy containing the surfaces of the scene.
+	 */
+	void trace(const BoundingVolumeHierarchy & accelerator);
+
+
+	/** @returns	Number of feelers in the packet. */
+	int size() const { return (int)directions.size(); }
+
+
+	/** @returns	True if the point of the i'th feeler is hidden from the light. Valid after trace. */
+	bool isOccluded(const int & i) const { return occluded[i] != 0; }
+
+protected:
+
+	/** @brief	Position of the light */
+	dvec3 lightPosition;
+
+	/** @brief	Shared origin index of the light position */
+	int sharedOrigin;
+
+	/** @brief	Unit direction of each feeler from the light toward its point */
+	std::vector<dvec3> directions;
+
+	/** @brief	Distance from the light to the point of each feeler, shortened by EPSILON so the
+	surface containing the point does not block it */
+	std::vector<double> distances;
+
+	/** @brief	Nonzero for feelers that are blocked */
+	std::vector<char> occluded;
+
+}; // end ShadowPacket class
@@ -1,4 +1,5 @@
 #include "Sphere.h"
+#include "Sampling.h"
 
 
 Sphere::Sphere(const dvec3 & position, double radius, const color & material)
@@ -7,13 +8,28 @@ Sphere::Sphere(const dvec3 & position, double radius, const color & material)
 }
 
 
-HitRecord Sphere::findIntersect( const Ray & ray )
+HitRecord Sphere::findIntersect( const Ray & ray, const OriginTerms * originTerms )
 {
 	HitRecord hitRecord;
 
-	double discriminant = pow(glm::dot(ray.direct, ray.origin - center), 2) - 
-						  dot(ray.direct, ray.direct) *
-						 (glm::dot(ray.origin - center, ray.origin - center) - radius * radius);
+	bool moving = motion != dvec3(0.0, 0.0, 0.0);
+
+	// Position of the center when the ray samples the scene
+	dvec3 rayCenter = moving ? getCenter(ray.time) : center;
+
+	// Use the cached origin terms if the ray starts at a shared origin
+	OriginTerms terms;
+	if (!moving && originTerms != nullptr) {
+		terms = *originTerms;
+	}
+	else {
+		terms = calculateOriginTerms(ray.origin, rayCenter);
+	}
+
+	double dd = dot(ray.direct, ray.direct);
+	double b = glm::dot(ray.direct, terms.offset);
+
+	double discriminant = b * b - dd * terms.constant;
 
 	if( discriminant >= 0 ) {
 
@@ -22,15 +38,14 @@ HitRecord Sphere::findIntersect( const Ray & ray )
 		if( discriminant > 0 ) {
 
 			// Two intercepts. Find and return the closest one.
-			double t1 = (glm::dot(-ray.direct, ray.origin - center) - sqrt(discriminant)) / 
-						dot(ray.direct, ray.direct);
-			double t2 = (glm::dot(-ray.direct, ray.origin - center) + sqrt(discriminant)) / 
-						dot(ray.direct, ray.direct);
+			double root = sqrt(discriminant);
+			double t1 = (-b - root) / dd;
+			double t2 = (-b + root) / dd;
 	
-			if (t1 < 0) {
+			if (t1 < ray.tMin) {
 				t1 = INFINITY;
 			}
-			if (t2 < 0) {
+			if (t2 < ray.tMin) {
 				t2 = INFINITY;
 			}
 
@@ -45,8 +60,8 @@ HitRecord Sphere::findIntersect( const Ray & ray )
 		}
 		else {
 			// One Intercept. Find and return the t for the single point of intersection.
-			t = glm::dot(-ray.direct, ray.origin - center) / dot(ray.direct, ray.direct);
-			if (t < 0) {
+			t = -b / dd;
+			if (t < ray.tMin) {
 				t = INFINITY;
 			}
 		}
@@ -59,7 +74,7 @@ HitRecord Sphere::findIntersect( const Ray & ray )
 		hitRecord.material = material;
 
 		// Calculate the normal vector for the point of intersection
-		dvec3 n = glm::normalize(hitRecord.interceptPoint - center);
+		dvec3 n = glm::normalize(hitRecord.interceptPoint - rayCenter);
 		
 		// Check for back face intersection
 		if (glm::dot(n, ray.direct) > 0) {
@@ -83,4 +98,118 @@ HitRecord Sphere::findIntersect( const Ray & ray )
 
 	return hitRecord;
 
-} // end checkIntercept
\ No newline at end of file
+} // end checkIntercept
+
+
+void Sphere::calculateSharedOriginTerms( const dvec3 & origin, OriginTerms & terms ) const
+{
+	terms = calculateOriginTerms(origin, center);
+
+} // end calculateSharedOriginTerms
+
+
+BoundingBox Sphere::getBounds( const double & time ) const
+{
+	dvec3 c = getCenter(time);
+	dvec3 r(radius, radius, radius);
+
+	return BoundingBox(c - r, c + r);
+
+} // end getBounds
+
+
+BoundingBox Sphere::getClippedBounds( const BoundingBox & region ) const
+{
+	BoundingBox clipped = getBounds(0.0).clip(region);
+
+	if (clipped.isEmpty()) {
+		return clipped;
+	}
+
+	dvec3 c = getCenter(0.0);
+
+	// Radius of the widest circle of the sphere within the range of the box along each axis
+	dvec3 sliceRadius;
+	for (int axis = 0; axis < 3; axis++) {
+
+		double offset = glm::max(glm::max(clipped.minCorner[axis] - c[axis], c[axis] - clipped.maxCorner[axis]), 0.0);
+		sliceRadius[axis] = sqrt(glm::max(radius * radius - offset * offset, 0.0));
+	}
+
+	for (int axis = 0; axis < 3; axis++) {
+
+		double reach = glm::min(sliceRadius[(axis + 1) % 3], sliceRadius[(axis + 2) % 3]);
+
+		clipped.minCorner[axis] = glm::max(clipped.minCorner[axis], c[axis] - reach);
+		clipped.maxCorner[axis] = glm::min(clipped.maxCorner[axis], c[axis] + reach);
+	}
+
+	// The region only held a corner of the box that the sphere does not reach
+	if (glm::any(glm::greaterThan(clipped.minCorner, clipped.maxCorner))) {
+		return BoundingBox();
+	}
+
+	return clipped;
+
+} // end getClippedBounds
+
+
+OriginTerms Sphere::calculateOriginTerms( const dvec3 & origin, const dvec3 & sphereCenter ) const
+{
+	OriginTerms terms;
+
+	terms.offset = origin - sphereCenter;
+	terms.constant = glm::dot(terms.offset, terms.offset) - radius * radius;
+
+	return terms;
+
+} // end calculateOriginTerms
+
+
+bool Sphere::sampleDirection( const dvec3 & point, const dvec2 & u, const double & time,
+							  dvec3 & direction, double & distance, double & pdf ) const
+{
+	dvec3 toCenter = getCenter(time) - point;
+	double distanceSquared = glm::dot(toCenter, toCenter);
+
+	// Points on or inside the sphere do not see it as a cone
+	if (distanceSquared <= (radius + EPSILON) * (radius + EPSILON)) {
+		return false;
+	}
+
+	double centerDistance = sqrt(distanceSquared);
+
+	// Cosine of the half angle of the cone that the sphere subtends
+	double cosMax = sqrt(glm::max(1.0 - radius * radius / distanceSquared, 0.0));
+
+	// Uniform direction within the cone around the z axis
+	double cosTheta = 1.0 - u.x * (1.0 - cosMax);
+	double sinTheta = sqrt(glm::max(1.0 - cosTheta * cosTheta, 0.0));
+	double phi = TWO_PI * u.y;
+
+	direction = orthonormalBasis(toCenter / centerDistance) * dvec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+
+	// Distance to the near intersection of the direction with the sphere
+	double projection = centerDistance * cosTheta;
+	distance = projection - sqrt(glm::max(radius * radius - distanceSquared * sinTheta * sinTheta, 0.0));
+
+	pdf = 1.0 / (TWO_PI * (1.0 - cosMax));
+
+	return true;
+
+} // end sampleDirection
+
+
+bool Sphere::samplePoint( const dvec2 & u, const double & time, dvec3 & point, dvec3 & normal ) const
+{
+	// Uniform on the sphere since equal steps in z cover equal areas
+	double z = 1.0 - 2.0 * u.x;
+	double r = sqrt(glm::max(1.0 - z * z, 0.0));
+	double phi = TWO_PI * u.y;
+
+	normal = dvec3(r * cos(phi), r * sin(phi), z);
+	point = getCenter(time) + radius * normal;
+
+	return true;
+
+} // end samplePoint
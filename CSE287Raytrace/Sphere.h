@@ -19,15 +19,92 @@ class Sphere : 	public ImplicitSurface
 			double radius = 1.0, 
 			const color & material = color(1.0, 1.0, 1.0, 1.0) );
 
+	/**
+	* Copies the sphere.
+	*/
+	virtual std::shared_ptr<ImplicitSurface> clone( ) const override { return std::make_shared<Sphere>( *this ); }
+
 	/**
 	* Checks a ray for intersection with the surface. Finds the closest point of intersection
 	* if one exits. Returns a HitRecord with the t parameter set to INFINITY if there is no
 	* intersection.
 	* @param rayOrigin - Origin of the ray being check for intersection
 	* @param rayDirection - Unit vector representation the direction of the ray.
+	* @param originTerms - Cached terms for the origin of the ray, or null. Not used by a moving sphere.
 	* returns HitRecord containing information about the point of intersection.
 	*/
-	virtual HitRecord findIntersect( const Ray & ray ) override;
+	virtual HitRecord findIntersect( const Ray & ray, const OriginTerms * originTerms = nullptr ) override;
+
+	/**
+	* Finds the vector from a shared origin to the center and its squared length less the
+	* squared radius.
+	* @param origin - The shared ray origin.
+	* @param terms - Receives the terms.
+	*/
+	virtual void calculateSharedOriginTerms( const dvec3 & origin, OriginTerms & terms ) const override;
+
+	/**
+	* Box around the sphere at its position at the given time.
+	* @param time - Time within the shutter interval. 0 at open and 1 at close.
+	* returns Bounds of the sphere.
+	*/
+	virtual BoundingBox getBounds( const double & time = 0.0 ) const override;
+
+	/**
+	* Box around the part of the sphere inside of a region. Where the region cuts the sphere
+	* off along one axis, the circles left are narrower along the other two.
+	* @param region - Region of space the sphere is clipped to.
+	* returns Bounds of the clipped sphere at shutter open.
+	*/
+	virtual BoundingBox getClippedBounds( const BoundingBox & region ) const override;
+
+	/**
+	* Area of the sphere.
+	* returns 4 PI radius squared.
+	*/
+	virtual double getSurfaceArea( ) const override { return 4.0 * PI * radius * radius; }
+
+	/**
+	* Chooses a direction uniformly from the cone of directions that hit the sphere, so
+	* every sample hits the sphere and the density is the same over its visible part.
+	* @param point - Point being shaded.
+	* @param u - Two uniform random numbers in [0, 1).
+	* @param time - Time within the shutter interval.
+	* @param direction - Set to the unit direction toward the sphere.
+	* @param distance - Set to the distance to the near side of the sphere.
+	* @param pdf - Set to one over the solid angle of the cone.
+	* returns False if the point is inside the sphere.
+	*/
+	virtual bool sampleDirection( const dvec3 & point, const dvec2 & u, const double & time,
+								  dvec3 & direction, double & distance, double & pdf ) const override;
+
+	/**
+	* Chooses a point uniformly by area on the sphere.
+	* @param u - Two uniform random numbers in [0, 1).
+	* @param time - Time within the shutter interval.
+	* @param point - Set to the point.
+	* @param normal - Set to the outward unit normal at the point.
+	* returns True.
+	*/
+	virtual bool samplePoint( const dvec2 & u, const double & time, dvec3 & point, dvec3 & normal ) const override;
+
+	/**
+	* Distance from a point to the sphere, negative inside of it.
+	* @param point - The point.
+	* @param time - Time within the shutter interval.
+	* returns Distance to the center less the radius.
+	*/
+	virtual double signedDistance( const dvec3 & point, const double & time = 0.0 ) const override
+	{
+		return glm::length(point - getCenter(time)) - radius;
+	}
+
+	/**
+	* Position of the center of the sphere at a time within the shutter interval.
+	* @param time - Time within the shutter interval. 0 at open and 1 at close.
+	* returns xyz location of the center at that time.
+	*/
+	dvec3 getCenter( const double & time ) const { return center + time * motion; }
 
 	/**
 	* Radius of the sphere
@@ -38,5 +115,20 @@ class Sphere : 	public ImplicitSurface
 	* xyz location of the center of the sphere
 	*/
 	dvec3 center;
+
+	/**
+	* Displacement of the center between shutter open and shutter close. The sphere
+	* moves linearly from center to center + motion. Zero for a static sphere.
+	*/
+	dvec3 motion = dvec3(0.0, 0.0, 0.0);
+
+	protected:
+
+	/**
+	* Finds the origin dependent intersection terms for a ray origin.
+	* @param origin - The ray origin.
+	* @param sphereCenter - Center of the sphere at the time of the ray.
+	*/
+	OriginTerms calculateOriginTerms( const dvec3 & origin, const dvec3 & sphereCenter ) const;
 };
 
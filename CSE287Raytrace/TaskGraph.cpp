@@ -0,0 +1,84 @@
+#include "TaskGraph.h"
+
+#include <iomanip>
+#include <sstream>
+
+
+int TaskGraph::add(const std::string& name, std::function<void()> work, const std::vector<int>& dependencies,
+				   const TASK_PRIORITY& priority)
+{
+	int index = (int)stages.size();
+
+	stages.push_back(std::unique_ptr<Stage>(new Stage()));
+
+	Stage& stage = *stages.back();
+	stage.name = name;
+	stage.work = std::move(work);
+	stage.priority = priority;
+	stage.dependencyCount = (int)dependencies.size();
+	stage.unfinishedDependencies = stage.dependencyCount;
+
+	for (int dependency : dependencies) {
+		stages[dependency]->successors.push_back(index);
+	}
+
+	return index;
+
+} // end add
+
+
+void TaskGraph::start()
+{
+	startTime = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < (int)stages.size(); i++) {
+		if (stages[i]->dependencyCount == 0) {
+			launch(i);
+		}
+	}
+
+} // end start
+
+
+void TaskGraph::wait()
+{
+	tasks.wait();
+
+} // end wait
+
+
+void TaskGraph::launch(const int& index)
+{
+	tasks.run([this, index] {
+
+		Stage& stage = *stages[index];
+
+		stage.startTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		stage.work();
+		stage.finishTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		// The last dependency of a stage to finish starts it
+		for (int successor : stage.successors) {
+			if (stages[successor]->unfinishedDependencies.fetch_sub(1) == 1) {
+				launch(successor);
+			}
+		}
+
+	}, stages[index]->priority);
+
+} // end launch
+
+
+std::string TaskGraph::getReport() const
+{
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(1);
+
+	for (const std::unique_ptr<Stage>& stage : stages) {
+		report << std::setw(24) << stage->name << std::setw(10) << 1000.0 * stage->startTime
+			<< " to " << std::setw(10) << 1000.0 * stage->finishTime << " ms\n";
+	}
+
+	return report.str();
+
+} // end getReport
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "ThreadPool.h"
+
+/**
+ * @class	TaskGraph
+ *
+ * @brief	Stages of work with dependencies between them, run on a ThreadPool. A stage starts as
+ * 			soon as every stage it depends on has finished, so independent stages overlap with
+ * 			each other and with whatever the thread that started the graph does until it waits.
+ * 			The time each stage starts and finishes is recorded for reporting.
+ */
+class TaskGraph
+{
+public:
+
+	/**
+	 * @fn	TaskGraph::TaskGraph(ThreadPool & pool = ThreadPool::getShared())
+	 *
+	 * @brief	Constructor.
+	 *
+	 * @param	pool	(Optional) Pool the stages are run by.
+	 */
+	TaskGraph(ThreadPool & pool = ThreadPool::getShared()) : tasks(pool) {}
+
+
+	/** @brief	Waits for the stages still running. */
+	~TaskGraph() { wait(); }
+
+
+	/**
+	 * @fn	int TaskGraph::add(const std::string & name, std::function<void()> work, const std::vector<int> & dependencies = {}, const TASK_PRIORITY & priority = HIGH_PRIORITY);
+	 *
+	 * @brief	Adds a stage. Stages must be added before the graph is started.
+	 *
+	 * @param	name			Name of the stage in the report.
+	 * @param	work			Function run by the stage.
+	 * @param	dependencies	(Optional) Stages that must finish before this one starts.
+	 * @param	priority		(Optional) Priority of the stage in the pool.
+	 *
+	 * @returns	Identifier of the stage, for use as a dependency of later stages.
+	 */
+	int add(const std::string & name, std::function<void()> work, const std::vector<int> & dependencies = {},
+			const TASK_PRIORITY & priority = HIGH_PRIORITY);
+
+
+	/**
+	 * @fn	void TaskGraph::start();
+	 *
+	 * @brief	Starts the stages that depend on nothing. Returns without waiting for them.
+	 */
+	void start();
+
+
+	/**
+	 * @fn	void TaskGraph::wait();
+	 *
+	 * @brief	Returns once every stage has finished, running queued work in the meantime.
+	 */
+	void wait();
+
+
+	/**
+	 * @fn	std::string TaskGraph::getReport() const;
+	 *
+	 * @brief	Lists when each stage started and finished, in milliseconds since start was called.
+	 * 			Must be called after wait.
+	 *
+	 * @returns	The report.
+	 */
+	std::string getReport() const;
+
+protected:
+
+	/**
+	 * @struct	Stage
+	 *
+	 * @brief	One stage of the graph.
+	 */
+	struct Stage
+	{
+		std::string name;
+		std::function<void()> work;
+		TASK_PRIORITY priority = HIGH_PRIORITY;
+
+		/** @brief	Stages that depend on this one */
+		std::vector<int> successors;
+
+		/** @brief	Number of stages this one depends on */
+		int dependencyCount = 0;
+
+		/** @brief	Number of stages this one depends on that have not yet finished */
+		std::atomic<int> unfinishedDependencies{ 0 };
+
+		/** @brief	Seconds from the start of the graph to the start and the end of the stage */
+		double startTime = 0.0, finishTime = 0.0;
+	};
+
+
+	/**
+	 * @fn	void TaskGraph::launch(const int & index);
+	 *
+	 * @brief	Queues a stage whose dependencies have all finished.
+	 */
+	void launch(const int & index);
+
+
+	/** @brief	Stages in the order they were added */
+	std::vector<std::unique_ptr<Stage>> stages;
+
+	/** @brief	Group the stages are run in */
+	TaskGroup tasks;
+
+	/** @brief	Moment start was called */
+	std::chrono::steady_clock::time_point startTime;
+
+}; // end TaskGraph class
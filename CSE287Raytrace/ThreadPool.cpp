@@ -0,0 +1,343 @@
+#include "ThreadPool.h"
+
+#include "NumaMemory.h"
+
+// Index of the current thread within the pool it belongs to
+static thread_local int currentThreadIndex = 0;
+
+// Pool the current thread is a worker of. Null for threads outside of any pool.
+static thread_local ThreadPool* currentPool = nullptr;
+
+// Memory node the current thread is pinned to. -1 until it is pinned or looked up.
+static thread_local int currentNode = -1;
+
+// Number of pieces parallelFor aims to give each thread when no grain size is given
+static const int PIECES_PER_THREAD = 8;
+
+
+ThreadPool::ThreadPool(const int& threadCount)
+{
+	int total = threadCount > 0 ? threadCount : (int)std::thread::hardware_concurrency();
+	total = glm::max(total, 1);
+
+	for (int i = 0; i < total; i++) {
+		queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+	}
+
+	for (int i = 1; i < total; i++) {
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+	}
+
+} // end ThreadPool
+
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+
+	workQueued.notify_all();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	// Without workers the tasks left over are run here
+	while (runOne()) {}
+
+} // end ~ThreadPool
+
+
+ThreadPool& ThreadPool::getShared()
+{
+	static ThreadPool shared;
+
+	return shared;
+
+} // end getShared
+
+
+void ThreadPool::parallelFor(const int& count, const std::function<void(int)>& body, const TASK_PRIORITY& priority,
+							 const int& grainSize)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	int grain = grainSize > 0 ? grainSize : glm::max(count / (PIECES_PER_THREAD * getThreadCount()), 1);
+
+	TaskGroup group(*this);
+	runRange(group, body, 0, count, grain, priority);
+	group.wait();
+
+} // end parallelFor
+
+
+void ThreadPool::runRange(TaskGroup& group, const std::function<void(int)>& body, int begin, int end,
+						  const int& grainSize, const TASK_PRIORITY& priority)
+{
+	while (begin < end) {
+
+		// Hand the upper half to an idle thread
+		if (end - begin > grainSize && isHungry()) {
+
+			int middle = begin + (end - begin) / 2;
+			int last = end;
+
+			group.run([this, &group, &body, middle, last, grainSize, priority] {
+				runRange(group, body, middle, last, grainSize, priority);
+			}, priority);
+
+			end = middle;
+			continue;
+		}
+
+		int stop = glm::min(begin + grainSize, end);
+		for (int i = begin; i < stop; i++) {
+			body(i);
+		}
+
+		begin = stop;
+	}
+
+} // end runRange
+
+
+int ThreadPool::getThreadIndex()
+{
+	return currentThreadIndex;
+
+} // end getThreadIndex
+
+
+int ThreadPool::getThreadNode()
+{
+	// Threads that are not pinned stay where they were first seen
+	if (currentNode < 0) {
+		currentNode = NumaMemory::getCurrentNode();
+	}
+
+	return currentNode;
+
+} // end getThreadNode
+
+
+void ThreadPool::push(Task&& task, const TASK_PRIORITY& priority)
+{
+	// Threads outside of the pool share the deque of the thread that created it
+	int index = currentPool == this ? currentThreadIndex : 0;
+	TaskQueue& queue = *queues[index];
+
+	// Counted before it is queued so the count never drops below zero when it is stolen at once
+	queuedTasks.fetch_add(1);
+
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks[priority].push_back(std::move(task));
+	}
+
+	// Counting the task before checking for sleepers means a worker about to sleep sees it. Only
+	// when every worker is busy are waiting threads woken to take it.
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+
+		if (sleepingWorkers == 0) {
+
+			if (sleepingWaiters > 0) {
+				waitersWoken.notify_all();
+			}
+			return;
+		}
+	}
+
+	workQueued.notify_one();
+
+} // end push
+
+
+bool ThreadPool::runOne()
+{
+	if (queuedTasks.load() == 0) {
+		return false;
+	}
+
+	int self = currentPool == this ? currentThreadIndex : 0;
+	int threadCount = getThreadCount();
+
+	Task task;
+	bool found = false;
+
+	for (int priority = 0; priority < PRIORITY_COUNT && !found; priority++) {
+
+		// Newest task of the calling thread first, then the oldest task of each other thread
+		for (int k = 0; k < threadCount && !found; k++) {
+
+			int victim = (self + k) % threadCount;
+			TaskQueue& queue = *queues[victim];
+			std::deque<Task>& tasks = queue.tasks[priority];
+
+			std::lock_guard<std::mutex> lock(queue.mutex);
+
+			if (tasks.empty()) {
+				continue;
+			}
+
+			if (victim == self) {
+				task = std::move(tasks.back());
+				tasks.pop_back();
+			}
+			else {
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+
+			found = true;
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	queuedTasks.fetch_sub(1);
+
+	try {
+		task.work();
+	}
+	catch (...) {
+
+		// Detached tasks have no group to hand the exception to
+		if (task.group == nullptr) {
+			throw;
+		}
+
+		std::lock_guard<std::mutex> lock(task.group->errorMutex);
+		if (!task.group->error) {
+			task.group->error = std::current_exception();
+		}
+	}
+
+	// The group may be destroyed as soon as the count reaches zero, so only the pool is touched after
+	if (task.group != nullptr && task.group->pending.fetch_sub(1) == 1) {
+		notifyWaiters();
+	}
+
+	return true;
+
+} // end runOne
+
+
+void ThreadPool::waitUntil(const std::function<bool()>& done)
+{
+	while (!done()) {
+
+		// Help with whatever is queued while the awaited work finishes elsewhere
+		if (runOne()) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+
+		sleepingWaiters++;
+		waitersWoken.wait(lock, [this, &done] { return queuedTasks.load() > 0 || done(); });
+		sleepingWaiters--;
+	}
+
+} // end waitUntil
+
+
+void ThreadPool::notifyWaiters()
+{
+	std::lock_guard<std::mutex> lock(sleepMutex);
+
+	if (sleepingWaiters > 0) {
+		waitersWoken.notify_all();
+	}
+
+} // end notifyWaiters
+
+
+void ThreadPool::spawn(std::function<void()> work, const TASK_PRIORITY& priority)
+{
+	Task task;
+	task.work = std::move(work);
+
+	push(std::move(task), priority);
+
+} // end spawn
+
+
+void ThreadPool::workerLoop(const int& threadIndex)
+{
+	currentThreadIndex = threadIndex;
+	currentPool = this;
+
+	// Workers are spread evenly over the memory nodes and kept there, so the memory they touch
+	// stays close to them
+	int nodeCount = NumaMemory::getNodeCount();
+	if (nodeCount > 1) {
+
+		int node = threadIndex * nodeCount / getThreadCount();
+
+		if (NumaMemory::pinThread(node)) {
+			currentNode = node;
+		}
+	}
+
+	while (true) {
+
+		if (runOne()) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+
+		sleepingWorkers++;
+		workQueued.wait(lock, [this] { return stopping || queuedTasks.load() > 0; });
+		sleepingWorkers--;
+
+		if (stopping && queuedTasks.load() == 0) {
+			return;
+		}
+	}
+
+} // end workerLoop
+
+
+void TaskGroup::run(std::function<void()> work, const TASK_PRIORITY& priority)
+{
+	pending.fetch_add(1);
+
+	ThreadPool::Task task;
+	task.work = std::move(work);
+	task.group = this;
+
+	pool.push(std::move(task), priority);
+
+} // end run
+
+
+void TaskGroup::wait()
+{
+	join();
+
+	std::exception_ptr thrown;
+	{
+		std::lock_guard<std::mutex> lock(errorMutex);
+		std::swap(thrown, error);
+	}
+
+	if (thrown) {
+		std::rethrow_exception(thrown);
+	}
+
+} // end wait
+
+
+void TaskGroup::join()
+{
+	pool.waitUntil([this] { return pending.load() == 0; });
+
+} // end join
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Defines.h"
+
+/**
+ * @enum	TASK_PRIORITY
+ *
+ * @brief	Order in which queued tasks are taken. Work on the critical path of a frame, such as
+ * 			building the accelerator, is HIGH_PRIORITY. Rendering is NORMAL_PRIORITY. Background
+ * 			work such as file output is LOW_PRIORITY, so it only soaks up otherwise idle threads.
+ */
+enum TASK_PRIORITY { HIGH_PRIORITY = 0, NORMAL_PRIORITY, LOW_PRIORITY, PRIORITY_COUNT };
+
+
+/**
+ * @class	ThreadPool
+ *
+ * @brief	Work stealing task scheduler. Every thread has a deque of tasks for each priority.
+ * 			A thread pushes the tasks it spawns onto its own deques and takes them back newest
+ * 			first, so forked work stays in its cache. A thread with nothing left steals the
+ * 			oldest task of another thread, which tends to be the largest. Higher priorities are
+ * 			always taken first, from its own deques or by stealing.
+ *
+ * 			Workers are created once and sleep while there is nothing to do. A thread waiting on
+ * 			a TaskGroup runs queued tasks until the group is finished, so the calling thread
+ * 			takes part in the work and tasks may spawn and wait on tasks of their own. When
+ * 			nothing is queued it sleeps until something is or the group finishes.
+ *
+ * 			The whole program shares one pool, returned by getShared, so rendering, builds, and
+ * 			loading never run more threads than there are cores.
+ */
+class ThreadPool
+{
+public:
+
+	/**
+	 * @fn	ThreadPool::ThreadPool(const int & threadCount = 0);
+	 *
+	 * @brief	Constructor. Starts the worker threads.
+	 *
+	 * @param	threadCount	(Optional) Total number of threads including the calling thread. Zero
+	 * 						uses one thread per hardware thread.
+	 */
+	ThreadPool(const int & threadCount = 0);
+
+
+	/**
+	 * @fn	ThreadPool::~ThreadPool();
+	 *
+	 * @brief	Runs the tasks still queued, then stops and joins the worker threads.
+	 */
+	~ThreadPool();
+
+
+	/**
+	 * @fn	static ThreadPool & ThreadPool::getShared();
+	 *
+	 * @brief	The pool that everything in the program submits work to. Created with one thread
+	 * 			per hardware thread the first time it is asked for.
+	 */
+	static ThreadPool & getShared();
+
+
+	/**
+	 * @fn	void ThreadPool::parallelFor(const int & count, const std::function<void(int)> & body, const TASK_PRIORITY & priority = NORMAL_PRIORITY, const int & grainSize = 0);
+	 *
+	 * @brief	Calls body once for every index in [0, count) using all threads in the pool, and
+	 * 			returns after every call has finished. The range is split lazily: a thread runs
+	 * 			its range a grain at a time and hands the upper half of what remains to the pool
+	 * 			only while no other work is queued, so loops whose iterations vary in cost are
+	 * 			balanced without paying for a task per iteration. May be called from inside
+	 * 			another loop or task. Bodies that keep per-thread scratch memory must not wait
+	 * 			on nested work while they hold it, since the waiting thread may run another
+	 * 			iteration in the meantime.
+	 *
+	 * @param	count	 	Number of iterations.
+	 * @param	body	 	Function called with each iteration index.
+	 * @param	priority 	(Optional) Priority of the tasks the loop is split into.
+	 * @param	grainSize	(Optional) Fewest iterations run as one piece. Zero picks a size that
+	 * 						gives each thread several pieces.
+	 */
+	void parallelFor(const int & count, const std::function<void(int)> & body,
+					 const TASK_PRIORITY & priority = NORMAL_PRIORITY, const int & grainSize = 0);
+
+
+	/**
+	 * @fn	void ThreadPool::spawn(std::function<void()> work, const TASK_PRIORITY & priority = NORMAL_PRIORITY);
+	 *
+	 * @brief	Queues a task that nothing waits on. Used to resume coroutines on the pool, so a
+	 * 			suspended coroutine costs a queued task rather than a blocked thread.
+	 *
+	 * @param	work		Function run by the task. Must not refer to anything that may be
+	 * 						destroyed before it runs.
+	 * @param	priority	(Optional) Priority of the task.
+	 */
+	void spawn(std::function<void()> work, const TASK_PRIORITY & priority = NORMAL_PRIORITY);
+
+
+	/** @returns	Total number of threads that execute tasks. */
+	int getThreadCount() const { return (int)queues.size(); }
+
+
+	/**
+	 * @fn	static int ThreadPool::getThreadIndex();
+	 *
+	 * @brief	Identifies the thread running a task, so tasks can use scratch memory set aside
+	 * 			for each thread instead of allocating their own.
+	 *
+	 * @returns	Index in [0, getThreadCount()) of the calling thread. 0 for threads outside of
+	 * 			any pool, such as the one that created it.
+	 */
+	static int getThreadIndex();
+
+
+	/**
+	 * @fn	static int ThreadPool::getThreadNode();
+	 *
+	 * @brief	Memory node of the calling thread. On machines with more than one node, workers
+	 * 			are pinned to nodes, spread evenly, when they start.
+	 *
+	 * @returns	The node the thread is pinned to, or else the node it was running on when first
+	 * 			asked.
+	 */
+	static int getThreadNode();
+
+
+	/**
+	 * @fn	void ThreadPool::notifyWaiters();
+	 *
+	 * @brief	Wakes the threads sleeping in waitUntil so they check again whether what they wait
+	 * 			for has happened. Called whenever something finishes that a thread may wait on.
+	 */
+	void notifyWaiters();
+
+protected:
+
+	friend class TaskGroup;
+
+	template <typename T>
+	friend class AsyncTask;
+
+	/**
+	 * @struct	Task
+	 *
+	 * @brief	Queued piece of work and the group waiting on it.
+	 */
+	struct Task
+	{
+		std::function<void()> work;
+		class TaskGroup * group = nullptr;
+	};
+
+	/**
+	 * @struct	TaskQueue
+	 *
+	 * @brief	Deques of the tasks spawned by one thread. The owner takes from the back and
+	 * 			thieves take from the front.
+	 */
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks[PRIORITY_COUNT];
+	};
+
+
+	/**
+	 * @fn	void ThreadPool::push(Task && task, const TASK_PRIORITY & priority);
+	 *
+	 * @brief	Queues a task on the deque of the calling thread and wakes a sleeping worker.
+	 */
+	void push(Task && task, const TASK_PRIORITY & priority);
+
+
+	/**
+	 * @fn	bool ThreadPool::runOne();
+	 *
+	 * @brief	Runs the highest priority task the calling thread can find, its own or stolen.
+	 *
+	 * @returns	False if no task was queued anywhere.
+	 */
+	bool runOne();
+
+
+	/**
+	 * @fn	void ThreadPool::waitUntil(const std::function<bool()> & done);
+	 *
+	 * @brief	Runs queued tasks until done returns true, sleeping while nothing is queued. Whatever
+	 * 			makes done true must call notifyWaiters afterwards.
+	 *
+	 * @param	done	Checks whether the wait is over.
+	 */
+	void waitUntil(const std::function<bool()> & done);
+
+
+	/**
+	 * @fn	void ThreadPool::runRange(TaskGroup & group, const std::function<void(int)> & body, int begin, int end, const int & grainSize, const TASK_PRIORITY & priority);
+	 *
+	 * @brief	Runs iterations [begin, end) of a loop a grain at a time. Whenever the pool has no
+	 * 			queued work, the upper half of what remains is spawned for another thread to steal.
+	 *
+	 * @param [in,out]	group	 	Group the loop waits on.
+	 * @param 		  	body	 	Function called with each iteration index.
+	 * @param 		  	begin	 	First iteration.
+	 * @param 		  	end		 	One past the last iteration.
+	 * @param 		  	grainSize	Fewest iterations run as one piece.
+	 * @param 		  	priority 	Priority of spawned pieces.
+	 */
+	void runRange(class TaskGroup & group, const std::function<void(int)> & body, int begin, int end,
+				  const int & grainSize, const TASK_PRIORITY & priority);
+
+
+	/** @returns	True if no task is waiting to be taken, so forked work would find an idle thread. */
+	bool isHungry() const { return queuedTasks.load(std::memory_order_relaxed) == 0 && getThreadCount() > 1; }
+
+
+	/**
+	 * @fn	void ThreadPool::workerLoop(const int & threadIndex);
+	 *
+	 * @brief	Function run by each worker thread.
+	 *
+	 * @param	threadIndex	Index of the worker returned by getThreadIndex.
+	 */
+	void workerLoop(const int & threadIndex);
+
+	/** @brief	Task deques of each thread. The thread that created the pool owns the first. */
+	std::vector<std::unique_ptr<TaskQueue>> queues;
+
+	/** @brief	Worker threads. The thread that created the pool is not included. */
+	std::vector<std::thread> workers;
+
+	/** @brief	Number of tasks queued and not yet taken */
+	std::atomic<int> queuedTasks{ 0 };
+
+	/** @brief	Guards sleepingWorkers, sleepingWaiters, and stopping */
+	std::mutex sleepMutex;
+
+	/** @brief	Wakes sleeping workers when a task is queued or the pool is stopped */
+	std::condition_variable workQueued;
+
+	/** @brief	Number of workers waiting on workQueued */
+	int sleepingWorkers = 0;
+
+	/** @brief	Wakes threads sleeping in waitUntil when something finishes, or when a task is
+	queued and no worker is asleep to take it */
+	std::condition_variable waitersWoken;
+
+	/** @brief	Number of threads waiting on waitersWoken */
+	int sleepingWaiters = 0;
+
+	/** @brief	Set when the pool is being destroyed */
+	bool stopping = false;
+
+}; // end ThreadPool class
+
+
+/**
+ * @class	TaskGroup
+ *
+ * @brief	Fork and join. Tasks run by a group are spawned into its pool, and wait returns once
+ * 			all of them have finished, running queued tasks in the meantime rather than blocking.
+ */
+class TaskGroup
+{
+public:
+
+	/**
+	 * @fn	TaskGroup::TaskGroup(ThreadPool & pool = ThreadPool::getShared())
+	 *
+	 * @brief	Constructor.
+	 *
+	 * @param	pool	(Optional) Pool the tasks are run by.
+	 */
+	TaskGroup(ThreadPool & pool = ThreadPool::getShared()) : pool(pool) {}
+
+
+	/** @brief	Waits for the tasks still running. An exception one of them threw is dropped. */
+	~TaskGroup() { join(); }
+
+	TaskGroup(const TaskGroup &) = delete;
+	TaskGroup & operator=(const TaskGroup &) = delete;
+
+
+	/**
+	 * @fn	void TaskGroup::run(std::function<void()> work, const TASK_PRIORITY & priority = NORMAL_PRIORITY);
+	 *
+	 * @brief	Spawns a task. Everything it refers to must outlive the next call to wait.
+	 *
+	 * @param	work		Function run by the task.
+	 * @param	priority	(Optional) Priority of the task.
+	 */
+	void run(std::function<void()> work, const TASK_PRIORITY & priority = NORMAL_PRIORITY);
+
+
+	/**
+	 * @fn	void TaskGroup::wait();
+	 *
+	 * @brief	Returns once every task spawned by the group has finished, including tasks they
+	 * 			spawned into the group. If any of them threw, the first exception is thrown again
+	 * 			here once the rest have finished.
+	 */
+	void wait();
+
+protected:
+
+	friend class ThreadPool;
+
+	/** @brief	Returns once every task of the group has finished. */
+	void join();
+
+	/** @brief	Pool the tasks are run by */
+	ThreadPool & pool;
+
+	/** @brief	Number of tasks spawned and not yet finished */
+	std::atomic<int> pending{ 0 };
+
+	/** @brief	Guards error */
+	std::mutex errorMutex;
+
+	/** @brief	First exception thrown by a task of the group */
+	std::exception_ptr error;
+
+}; // end TaskGroup class
+
+
+/**
+ * @fn	template <typename T> inline void atomicAdd(std::atomic<T> & target, const T & value)
+ *
+ * @brief	Adds to an atomic floating point value without a lock.
+ */
+template <typename T>
+inline void atomicAdd(std::atomic<T> & target, const T & value)
+{
+	T current = target.load(std::memory_order_relaxed);
+	while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {}
+}
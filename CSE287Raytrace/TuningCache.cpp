@@ -0,0 +1,132 @@
+#include "TuningCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <intrin.h>
+#endif
+
+
+void TuningCache::load(const std::string& path)
+{
+	this->path = path;
+	entries.clear();
+
+	std::ifstream file(path);
+	std::string line;
+
+	while (std::getline(file, line)) {
+
+		std::istringstream fields(line);
+		std::string sceneKey, model, numbers;
+
+		if (!std::getline(fields, sceneKey, '\t') || !std::getline(fields, model, '\t') || !std::getline(fields, numbers)) {
+			continue;
+		}
+
+		RenderSettings settings;
+		std::istringstream values(numbers);
+
+		// Lines that do not parse are skipped rather than trusted
+		if (values >> settings.tileSize >> settings.maxLeafSize >> settings.shadowPacketSize &&
+			settings.tileSize > 0 && settings.maxLeafSize > 0 && settings.shadowPacketSize > 0) {
+			entries[std::make_pair(model, sceneKey)] = settings;
+		}
+	}
+
+} // end load
+
+
+bool TuningCache::save() const
+{
+	if (path.empty()) {
+		return false;
+	}
+
+	std::ofstream file(path);
+
+	for (auto& entry : entries) {
+
+		const RenderSettings& settings = entry.second;
+
+		file << entry.first.second << '\t' << entry.first.first << '\t' << settings.tileSize << ' '
+			<< settings.maxLeafSize << ' ' << settings.shadowPacketSize << '\n';
+	}
+
+	return (bool)file;
+
+} // end save
+
+
+bool TuningCache::find(const std::string& sceneKey, RenderSettings& settings) const
+{
+	auto entry = entries.find(std::make_pair(processor, sceneKey));
+
+	if (entry == entries.end()) {
+		return false;
+	}
+
+	settings = entry->second;
+
+	return true;
+
+} // end find
+
+
+void TuningCache::store(const std::string& sceneKey, const RenderSettings& settings)
+{
+	entries[std::make_pair(processor, sceneKey)] = settings;
+
+} // end store
+
+
+std::string TuningCache::getProcessorModel()
+{
+	std::string model;
+
+#if defined(_WIN32)
+
+	// The brand string is spread over three extended CPUID leaves
+	int registers[4];
+	char brand[49] = { 0 };
+
+	__cpuid(registers, 0x80000000);
+
+	if ((unsigned int)registers[0] >= 0x80000004) {
+
+		for (int leaf = 0; leaf < 3; leaf++) {
+			__cpuid(registers, 0x80000002 + leaf);
+			memcpy(brand + 16 * leaf, registers, sizeof(registers));
+		}
+
+		model = brand;
+	}
+
+#elif defined(__linux__)
+
+	std::ifstream cpuinfo("/proc/cpuinfo");
+	std::string line;
+
+	while (std::getline(cpuinfo, line)) {
+
+		if (line.compare(0, 10, "model name") == 0) {
+
+			size_t start = line.find_first_not_of(' ', line.find(':') + 1);
+			if (line.find(':') != std::string::npos && start != std::string::npos) {
+				model = line.substr(start);
+			}
+			break;
+		}
+	}
+
+#endif
+
+	std::replace(model.begin(), model.end(), '\t', ' ');
+	std::replace(model.begin(), model.end(), '\n', ' ');
+
+	return model.empty() ? "unknown" : model;
+
+} // end getProcessorModel
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+/**
+ * @struct	RenderSettings
+ *
+ * @brief	Settings of the ray tracer whose best values depend on the scene and the machine.
+ */
+struct RenderSettings
+{
+	/** @brief	Width and height in pixels of the tiles handed out to the rendering threads */
+	int tileSize = 32;
+
+	/** @brief	Maximum number of surfaces in a leaf of the bounding volume hierarchy */
+	int maxLeafSize = 2;
+
+	/** @brief	Maximum number of feelers in a shadow packet */
+	int shadowPacketSize = 64;
+};
+
+
+/**
+ * @class	TuningCache
+ *
+ * @brief	Settings found by the autotuner, kept in a text file so later runs start tuned.
+ * 			Entries are looked up by a key describing the scene together with the model of the
+ * 			processor, so a file copied to another machine is not trusted. Each line of the file
+ * 			holds the scene key, the processor model, and the settings, separated by tabs.
+ */
+class TuningCache
+{
+public:
+
+	/**
+	 * @fn	void TuningCache::load(const std::string & path);
+	 *
+	 * @brief	Reads the entries in a file. A missing or unreadable file leaves the cache empty.
+	 * 			Later calls to save write to the same file.
+	 *
+	 * @param	path	Path of the file.
+	 */
+	void load(const std::string & path);
+
+
+	/**
+	 * @fn	bool TuningCache::save() const;
+	 *
+	 * @brief	Writes every entry to the file given to load.
+	 *
+	 * @returns	False if the file could not be written.
+	 */
+	bool save() const;
+
+
+	/**
+	 * @fn	bool TuningCache::find(const std::string & sceneKey, RenderSettings & settings) const;
+	 *
+	 * @brief	Looks up the settings tuned for a scene on this processor.
+	 *
+	 * @param 		  	sceneKey	Key describing the scene.
+	 * @param [out]	settings	The settings if found.
+	 *
+	 * @returns	True if the scene has been tuned on this processor.
+	 */
+	bool find(const std::string & sceneKey, RenderSettings & settings) const;
+
+
+	/**
+	 * @fn	void TuningCache::store(const std::string & sceneKey, const RenderSettings & settings);
+	 *
+	 * @brief	Records the settings tuned for a scene on this processor, replacing any earlier
+	 * 			entry.
+	 */
+	void store(const std::string & sceneKey, const RenderSettings & settings);
+
+
+	/** @returns	Path of the file given to load. Empty until load is called. */
+	const std::string & getPath() const { return path; }
+
+
+	/**
+	 * @fn	static std::string TuningCache::getProcessorModel();
+	 *
+	 * @brief	Name of the processor as reported by the operating system or the CPUID
+	 * 			instruction. Tabs and line breaks are replaced so it can be stored in the file.
+	 *
+	 * @returns	The name. "unknown" if it cannot be found.
+	 */
+	static std::string getProcessorModel();
+
+protected:
+
+	/** @brief	File the entries are read from and written to */
+	std::string path;
+
+	/** @brief	Settings by processor model and scene key */
+	std::map<std::pair<std::string, std::string>, RenderSettings> entries;
+
+	/** @brief	Model of the processor running the tuner */
+	std::string processor = getProcessorModel();
+
+}; // end TuningCache class
@@ -0,0 +1,95 @@
+#include "Checks.h"
+
+#include <atomic>
+#include <thread>
+
+#include "Plane.h"
+#include "QuadricSurface.h"
+#include "Sphere.h"
+
+// Size of the rendered frames. Small so that many renders finish quickly.
+static const int FRAME_WIDTH = 160;
+static const int FRAME_HEIGHT = 120;
+
+// Threads that start renders at the same time. More than the pool has, so renders queue up.
+static const int CALLER_COUNT = 16;
+
+// Rounds of renders started together
+static const int ROUND_COUNT = 25;
+
+
+bool checkAsyncRenders()
+{
+	FrameBuffer frameBuffer(FRAME_WIDTH, FRAME_HEIGHT);
+	frameBuffer.setFrameBufferSize(FRAME_WIDTH, FRAME_HEIGHT);
+
+	RayTracer rayTracer(frameBuffer, color(0.5, 0.5, 0.75, 1.0));
+	rayTracer.setCameraFrame(dvec3(0.0, 0.0, 0.0), dvec3(0.0, 0.0, -1.0), dvec3(0.0, 1.0, 0.0));
+	rayTracer.calculatePerspectiveViewingParameters(45.0);
+
+	rayTracer.surfaces.push_back(make_shared<Plane>(dvec3(0.0, -2.0, 0.0), dvec3(0.0, 1.0, 0.0), color(0.5, 0.3, 0.0, 1.0)));
+	rayTracer.surfaces.push_back(make_shared<Sphere>(dvec3(0.0, 0.0, -10.0), 1.5, RED));
+	rayTracer.surfaces.push_back(make_shared<Sphere>(dvec3(3.0, 0.0, -12.0), 1.5, GREEN));
+	rayTracer.surfaces.push_back(make_shared<Sphere>(dvec3(-3.0, -1.0, -10.0), 1.5, BLUE));
+	rayTracer.surfaces.push_back(make_shared<QuadricSurface>(dvec3(0.0, 0.0, -30.0), CYAN));
+
+	rayTracer.lights.push_back(make_shared<PositionalLight>(dvec3(-10.0, 10.0, 10.0), color(1.0, 1.0, 1.0, 1.0)));
+	rayTracer.lights.push_back(make_shared<DirectionalLight>(dvec3(1.0, 1.0, 1.0), color(0.75, 0.75, 0.75, 1.0)));
+	rayTracer.lights.push_back(make_shared<LightSource>(color(0.15, 0.15, 0.15, 1.0)));
+
+	rayTracer.raytraceScene();
+	double expected = getChecksum(frameBuffer, FRAME_WIDTH, FRAME_HEIGHT);
+
+	// Renders that wait for each other must neither deadlock nor overlap. Half of the callers
+	// render synchronously, and the rest wait on asynchronous renders from outside the pool.
+	std::atomic<int> finished{ 0 };
+
+	for (int round = 0; round < ROUND_COUNT; round++) {
+
+		std::vector<std::thread> callers;
+
+		for (int i = 0; i < CALLER_COUNT; i++) {
+			callers.push_back(std::thread([&rayTracer, &finished, i] {
+
+				if (i % 2 == 0) {
+					rayTracer.raytraceScene();
+					finished++;
+				}
+				else if (rayTracer.raytraceSceneAsync().get()) {
+					finished++;
+				}
+			}));
+		}
+
+		for (std::thread& caller : callers) {
+			caller.join();
+		}
+	}
+
+	bool passed = check(finished.load() == ROUND_COUNT * CALLER_COUNT, "every concurrent render finished");
+
+	passed = check(getChecksum(frameBuffer, FRAME_WIDTH, FRAME_HEIGHT) == expected,
+		"concurrent renders leave the same image as one render") && passed;
+
+	// A coroutine awaiting a render is resumed once the render finishes
+	auto awaitRender = [&rayTracer]() -> AsyncTask<bool> {
+		bool finished = co_await rayTracer.raytraceSceneAsync();
+		co_return finished;
+	};
+
+	passed = check(awaitRender().get(), "awaited render finished") && passed;
+
+	// A cancelled render stops between tiles and reports that it did not finish
+	CancellationToken cancellation;
+	std::atomic<int> tiles{ 0 };
+
+	bool completed = rayTracer.raytraceSceneAsync(cancellation, [&](int done, int total) {
+		tiles++;
+		cancellation.cancel();
+	}).get();
+
+	passed = check(!completed && tiles.load() >= 1, "cancelled render stopped early") && passed;
+
+	return passed;
+
+} // end checkAsyncRenders
@@ -0,0 +1,41 @@
+#include "Checks.h"
+
+
+bool check(const bool & passed, const std::string & description)
+{
+	cout << (passed ? "PASS " : "FAIL ") << description << endl;
+
+	return passed;
+
+} // end check
+
+
+double getChecksum(FrameBuffer & frameBuffer, const int & width, const int & height)
+{
+	double sum = 0.0;
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			color pixel = frameBuffer.getPixel(x, y);
+			sum += pixel.r + 2.0 * pixel.g + 3.0 * pixel.b;
+		}
+	}
+
+	return sum;
+
+} // end getChecksum
+
+
+int main(int argc, char** argv)
+{
+	bool passed = true;
+
+	passed = checkAsyncRenders() && passed;
+	passed = checkSceneVersions() && passed;
+	passed = checkSpatialSplits() && passed;
+
+	cout << (passed ? "All checks passed" : "Some checks failed") << endl;
+
+	return passed ? 0 : 1;
+
+} // end main
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+
+#include "RayTracer.h"
+
+/**
+ * @fn	bool check(const bool & passed, const std::string & description);
+ *
+ * @brief	Reports the outcome of one check on standard output.
+ *
+ * @param	passed	   	True if the check passed.
+ * @param	description	What was checked.
+ *
+ * @returns	passed.
+ */
+bool check(const bool & passed, const std::string & description);
+
+
+/**
+ * @fn	double getChecksum(FrameBuffer & frameBuffer, const int & width, const int & height);
+ *
+ * @brief	Weighted sum of the color channels of every pixel, for comparing renders.
+ *
+ * @param [in,out]	frameBuffer	The rendered frame buffer.
+ * @param 		  	width	   	Width of the rendered area in pixels.
+ * @param 		  	height	   	Height of the rendered area in pixels.
+ *
+ * @returns	The sum.
+ */
+double getChecksum(FrameBuffer & frameBuffer, const int & width, const int & height);
+
+
+/**
+ * @fn	bool checkAsyncRenders();
+ *
+ * @brief	Runs many synchronous and asynchronous renders of one ray tracer from several threads
+ * 			at once. Every render must finish and leave the same image as a render on its own.
+ *
+ * @returns	True if every check passed.
+ */
+bool checkAsyncRenders();
+
+
+/**
+ * @fn	bool checkSceneVersions();
+ *
+ * @brief	Pins versions of an edited scene from more threads than there are reader slots. A pin
+ * 			must wait for a slot while every slot is taken, every pin must succeed, and every
+ * 			replaced version must be freed once nothing has it pinned.
+ *
+ * @returns	True if every check passed.
+ */
+bool checkSceneVersions();
+
+
+/**
+ * @fn	bool checkSpatialSplits();
+ *
+ * @brief	Compares hierarchies built with and without spatial splits over a random scene of
+ * 			spheres: closest hits, occlusion and gathered surfaces must all agree. Also builds a
+ * 			scene that would be deeper than the traversal stack and checks that every surface in
+ * 			it is still found.
+ *
+ * @returns	True if every check passed.
+ */
+bool checkSpatialSplits();
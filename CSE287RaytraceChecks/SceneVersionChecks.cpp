@@ -0,0 +1,83 @@
+#include "Checks.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "SceneVersions.h"
+#include "Sphere.h"
+
+// Threads that pin versions at the same time. More than there are reader slots.
+static const int READER_COUNT = 3 * SceneVersions::MAX_READERS;
+
+// Times each reader pins a version
+static const int PINS_PER_READER = 200;
+
+
+bool checkSceneVersions()
+{
+	SceneVersions versions({ make_shared<Sphere>(dvec3(0.0, 0.0, -10.0), 1.0, RED) });
+
+	// Once every slot is taken a further pin waits for one to be released
+	std::vector<std::unique_ptr<SceneVersions::Pin>> pins;
+
+	for (int i = 0; i < SceneVersions::MAX_READERS; i++) {
+		pins.push_back(std::make_unique<SceneVersions::Pin>(versions));
+	}
+
+	std::atomic<bool> pinned{ false };
+
+	std::thread waiting([&versions, &pinned] {
+		SceneVersions::Pin pin(versions);
+		pinned = true;
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	bool waited = !pinned.load();
+
+	pins.pop_back();
+	waiting.join();
+
+	bool passed = check(waited && pinned.load(), "pin waits for a free reader slot");
+
+	pins.clear();
+
+	// Readers outnumbering the slots all get their pins while the scene is being edited
+	std::atomic<int> pinCount{ 0 };
+	std::atomic<bool> editing{ true };
+
+	std::thread editor([&versions, &editing] {
+		while (editing.load()) {
+			versions.edit([](SceneVersions::Edit& edit) {
+				edit.modifySurface<Sphere>(0)->center.x += 1.0;
+			});
+		}
+	});
+
+	std::vector<std::thread> readers;
+
+	for (int i = 0; i < READER_COUNT; i++) {
+		readers.push_back(std::thread([&versions, &pinCount] {
+			for (int k = 0; k < PINS_PER_READER; k++) {
+				SceneVersions::Pin pin(versions);
+				if (pin->surfaces.size() == 1) {
+					pinCount++;
+				}
+			}
+		}));
+	}
+
+	for (std::thread& reader : readers) {
+		reader.join();
+	}
+
+	editing = false;
+	editor.join();
+
+	passed = check(pinCount.load() == READER_COUNT * PINS_PER_READER, "more readers than slots all pin a version") && passed;
+	passed = check(versions.getRetiredCount() == 0, "every replaced version is freed once unpinned") && passed;
+
+	return passed;
+
+} // end checkSceneVersions
@@ -0,0 +1,193 @@
+#include "Checks.h"
+
+#include <cmath>
+#include <random>
+#include <set>
+
+#include "BoundingVolumeHierarchy.h"
+#include "Sphere.h"
+
+// Spheres in the random scene
+static const int SPHERE_COUNT = 300;
+
+// Half the width of the cube the random spheres are centered in
+static const double SCENE_EXTENT = 20.0;
+
+// Rays traced through the random scene
+static const int RAY_COUNT = 20000;
+
+// Boxes whose surfaces are gathered from the random scene
+static const int REGION_COUNT = 500;
+
+// Spheres in the chain that would build a tree deeper than the traversal stack
+static const int CHAIN_LENGTH = 1000;
+
+// Spheres in the chain that are small enough to be hit accurately
+static const int HITTABLE_CHAIN_LENGTH = 500;
+
+
+/**
+ * @fn	static std::set<ImplicitSurface*> gather(const BoundingVolumeHierarchy & hierarchy, const BoundingBox & region, bool & duplicated)
+ *
+ * @brief	Surfaces a hierarchy finds in a region.
+ *
+ * @param 		  	hierarchy 	The hierarchy.
+ * @param 		  	region	  	The region.
+ * @param [in,out]	duplicated	Set if a surface was found more than once.
+ *
+ * @returns	The surfaces found.
+ */
+static std::set<ImplicitSurface*> gather(const BoundingVolumeHierarchy& hierarchy, const BoundingBox& region, bool& duplicated)
+{
+	std::vector<ImplicitSurface*> found;
+	hierarchy.gatherSurfaces(region, ALL_RAY_TYPES, 0.0, found);
+
+	std::set<ImplicitSurface*> unique(found.begin(), found.end());
+	duplicated = duplicated || unique.size() != found.size();
+
+	return unique;
+
+} // end gather
+
+
+/**
+ * @fn	static bool touches(const Sphere & sphere, const BoundingBox & region)
+ *
+ * @brief	Whether any of a sphere is inside of a region.
+ *
+ * @param	sphere	The sphere.
+ * @param	region	The region.
+ *
+ * @returns	True if the sphere overlaps the region.
+ */
+static bool touches(const Sphere& sphere, const BoundingBox& region)
+{
+	dvec3 closest = glm::clamp(sphere.center, region.minCorner, region.maxCorner);
+
+	return glm::length(closest - sphere.center) <= sphere.radius;
+
+} // end touches
+
+
+bool checkSpatialSplits()
+{
+	std::mt19937 random(287);
+	std::uniform_real_distribution<double> position(-SCENE_EXTENT, SCENE_EXTENT);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+	// Mostly small spheres with a few large ones, which spatial splits clip into several leaves
+	SurfaceVector surfaces;
+
+	for (int i = 0; i < SPHERE_COUNT; i++) {
+		double radius = 0.2 + unit(random) * unit(random) * unit(random) * 8.0;
+		surfaces.push_back(make_shared<Sphere>(dvec3(position(random), position(random), position(random)), radius, RED));
+	}
+
+	BoundingVolumeHierarchy objectSplits;
+	objectSplits.setSpatialSplits(0.0);
+	objectSplits.build(surfaces);
+
+	BoundingVolumeHierarchy spatialSplits;
+	spatialSplits.setSpatialSplits(1.0);
+	spatialSplits.build(surfaces);
+
+	// Both trees find the same closest hit and the same occlusion for every ray
+	int closestMismatches = 0;
+	int occlusionMismatches = 0;
+
+	for (int i = 0; i < RAY_COUNT; i++) {
+
+		dvec3 origin(position(random), position(random), position(random));
+		dvec3 direction = glm::normalize(dvec3(unit(random) - 0.5, unit(random) - 0.5, unit(random) - 0.5));
+		Ray ray(origin, direction);
+
+		HitRecord expected = objectSplits.findClosestIntersection(ray);
+		HitRecord found = spatialSplits.findClosestIntersection(ray);
+
+		if (expected.t != found.t || (expected.t < INFINITY && expected.interceptPoint != found.interceptPoint)) {
+			closestMismatches++;
+		}
+
+		double maxDistance = unit(random) * SCENE_EXTENT;
+
+		if (objectSplits.isOccluded(ray, maxDistance) != spatialSplits.isOccluded(ray, maxDistance)) {
+			occlusionMismatches++;
+		}
+	}
+
+	bool passed = check(closestMismatches == 0, "spatial splits find the same closest hits");
+	passed = check(occlusionMismatches == 0, "spatial splits find the same occlusion") && passed;
+
+	// Spheres are clipped to their shape rather than their bounds, so the tree with spatial
+	// splits may leave out spheres whose bounds reach the region but whose shape does not. It
+	// must find every other sphere the tree without them finds, and each only once.
+	int gatherMismatches = 0;
+	bool duplicated = false;
+
+	for (int i = 0; i < REGION_COUNT; i++) {
+
+		BoundingBox region;
+		region.expand(dvec3(position(random), position(random), position(random)));
+		region.expand(dvec3(position(random), position(random), position(random)));
+
+		std::set<ImplicitSurface*> expected = gather(objectSplits, region, duplicated);
+		std::set<ImplicitSurface*> found = gather(spatialSplits, region, duplicated);
+
+		for (ImplicitSurface* surface : expected) {
+			if (found.count(surface) == 0 && touches(*static_cast<Sphere*>(surface), region)) {
+				gatherMismatches++;
+			}
+		}
+
+		for (ImplicitSurface* surface : found) {
+			if (expected.count(surface) == 0) {
+				gatherMismatches++;
+			}
+		}
+	}
+
+	passed = check(gatherMismatches == 0, "spatial splits gather every surface in the region") && passed;
+	passed = check(!duplicated, "gathered surfaces are not duplicated") && passed;
+
+	// Spheres at doubling distances would give a tree one level per sphere if nothing limited
+	// its depth. The tree must stay within the traversal stack and still find every sphere.
+	SurfaceVector chain;
+
+	for (int i = 0; i < CHAIN_LENGTH; i++) {
+		chain.push_back(make_shared<Sphere>(dvec3(std::ldexp(1.0, i), 0.0, 0.0), std::ldexp(1.0, i - 2), RED));
+	}
+
+	BoundingVolumeHierarchy deep;
+	deep.setMaxLeafSize(1);
+	deep.setSpatialSplits(1.0);
+	deep.build(chain);
+
+	int hits = 0;
+	int occluded = 0;
+
+	for (int i = 0; i < HITTABLE_CHAIN_LENGTH; i++) {
+
+		Ray ray(dvec3(std::ldexp(1.0, i), 0.0, std::ldexp(1.0, i)), dvec3(0.0, 0.0, -1.0));
+
+		if (deep.findClosestIntersection(ray).t < std::ldexp(1.0, i)) {
+			hits++;
+		}
+
+		if (deep.isOccluded(ray, std::ldexp(1.0, i))) {
+			occluded++;
+		}
+	}
+
+	BoundingBox everything;
+	everything.expand(dvec3(-1.0));
+	everything.expand(dvec3(INFINITY, 1.0, 1.0));
+
+	bool chainDuplicated = false;
+
+	passed = check(hits == HITTABLE_CHAIN_LENGTH && occluded == HITTABLE_CHAIN_LENGTH, "depth limited tree finds every sphere") && passed;
+	passed = check(gather(deep, everything, chainDuplicated).size() == CHAIN_LENGTH && !chainDuplicated,
+		"depth limited tree gathers every sphere") && passed;
+
+	return passed;
+
+} // end checkSpatialSplits
@@ -225,10 +225,10 @@ public:
 	GLubyte clearColor[BYTES_PER_PIXEL];
 
 	/** @brief	Storage for red, green, blue, alpha color values */
-	GLubyte* colorBuffer;
+	GLubyte* colorBuffer = nullptr;
 
 	/** @brief	Buffer for depth data */
-	float* depthBuffer;
+	float* depthBuffer = nullptr;
 
 }; // end FrameBuffer class
 